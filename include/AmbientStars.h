@@ -7,11 +7,58 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <GL/glut.h>
 
 #include "Camera.h"
+#include "Profiler.h"
 #include "Textures.h"
+#include "JobSystem.h"
+#include "StarField.h"
+#include "StarCatalog.h"
+#include "MemoryTracker.h"
+#include "TextureLoader.h"
+
+
+#ifndef GL_ARRAY_BUFFER
+#   define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_STATIC_DRAW
+#   define GL_STATIC_DRAW 0x88E4
+#endif
+
+#ifndef GL_TEXTURE_CUBE_MAP
+#   define GL_TEXTURE_CUBE_MAP 0x8513
+#endif
+#ifndef GL_TEXTURE_CUBE_MAP_POSITIVE_X
+#   define GL_TEXTURE_CUBE_MAP_POSITIVE_X 0x8515
+#endif
+#ifndef GL_MAX_CUBE_MAP_TEXTURE_SIZE
+#   define GL_MAX_CUBE_MAP_TEXTURE_SIZE 0x851C
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#   define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+// Without cube maps, the stars of a catalog are drawn as quads tangent to the sky sphere, facing its
+// centre (and so the camera), sized and lit like those of the baked star field (see `StarField.h`).
+// Scale of the vertices' (quantized) coordinates on the unit sky sphere.
+#define AMBIENT_STARS_VERTEX_SCALE 32000.0f
+
+// Texels per side of the sprite every star is drawn with.
+#define AMBIENT_STARS_SPRITE_SIZE 32
+
+typedef struct StarVertex
+{
+    GLubyte color[4];
+
+    GLshort position[3];
+    GLshort texCoord[2];
+
+    GLshort padding;
+
+} StarVertex;
 
 
 typedef struct AmbientStars
@@ -29,51 +76,104 @@ typedef struct AmbientStars
 
     GLuint texture;
 
+    // Stars of a catalog (see `buildStarsFromCatalog`), 4 vertices each, drawn all at once; 0 otherwise.
+    int numCatalogStars;
+
+    // The vertices live in `vertexBuffer` if the driver has buffer objects, in `vertices` otherwise.
+    GLuint vertexBuffer;
+
+    StarVertex* vertices;
+
+    GLuint spriteTexture;
+
+    // The baked star field (see `buildStarsCubeMap`), drawn as a background; 0 otherwise.
+    GLuint cubeMap;
+
+    int cubeMapResolution;
+
 } AmbientStars;
 
 
-AmbientStars* buildStars(const int number_of_stars, Camera* POVAnchor)
+// Scatters point stars over the sky sphere, in place of a sky texture (or of a baked star field, if
+// the driver has no cube maps).
+void scatterStars(AmbientStars* stars, const int number_of_stars, uint32_t seed)
 {
-    AmbientStars* stars = (AmbientStars *)malloc(sizeof(AmbientStars));
+    Camera* POVAnchor = stars->POVAnchor;
 
     stars->numberOfStars = number_of_stars;
     
-    stars->positions = (vector3r*)malloc(number_of_stars * sizeof(vector3r));
-
-    stars->POVAnchor = POVAnchor;
+    stars->positions = (vector3r *)trackedMalloc(MEMORY_TAG_STARS, number_of_stars * sizeof(vector3r));
 
     stars->sizeInWorld = (real_t)POVAnchor->renderDistance * 0.0007;
 
-    stars->quads = (GLUquadric **)malloc(number_of_stars * sizeof(GLUquadric *));
+    stars->quads = (GLUquadric **)trackedMalloc(MEMORY_TAG_STARS, number_of_stars * sizeof(GLUquadric *));
 
     stars->texture = 0;
 
+    stars->numCatalogStars = 0;
+    stars->vertexBuffer = 0;
+    stars->vertices = NULL;
+    stars->spriteTexture = 0;
+    stars->cubeMap = 0;
+    stars->cubeMapResolution = 0;
+
     for (int i = 0; i < stars->numberOfStars; ++i)
     {
         stars->quads[i] = gluNewQuadric();
         gluQuadricDrawStyle(stars->quads[i], GLU_FILL);
 
-        real_t x = (real_t)(2.0 * ((double)rand() / RAND_MAX) - 1.0);
-        real_t y = (real_t)(2.0 * ((double)rand() / RAND_MAX) - 1.0);
-        real_t z = (real_t)(2.0 * ((double)rand() / RAND_MAX) - 1.0);
+        PackedStar star;
+        generateStar(seed, i, &star);
 
-        real_t len = (real_t)sqrt((double)(x * x + y * y + z * z));
+        float d[3];
+        getPackedStarDirection(&star, d);
 
-        x /= len;
-        y /= len;
-        z /= len;
+        real_t x = (real_t)d[0];
+        real_t y = (real_t)d[1];
+        real_t z = (real_t)d[2];
 
         stars->positions[i][0] = (real_t)(x * (POVAnchor->renderDistance * (real_t)0.8));
         stars->positions[i][1] = (real_t)(y * (POVAnchor->renderDistance * (real_t)0.8));
         stars->positions[i][2] = (real_t)(z * (POVAnchor->renderDistance * (real_t)0.8));
     }
+}
+
+AmbientStars* buildStars(const int number_of_stars, uint32_t seed, Camera* POVAnchor)
+{
+    AmbientStars* stars = (AmbientStars *)trackedMalloc(MEMORY_TAG_STARS, sizeof(AmbientStars));
+
+    stars->POVAnchor = POVAnchor;
+
+    scatterStars(stars, number_of_stars, seed);
 
     return stars;
 }
 
+// Called once the sky texture has been loaded by the `texture_loader`; on failure, the sky falls
+// back to point stars.
+void callbackStarsTexture(void* user, GLuint texture, bool loaded)
+{
+    AmbientStars* stars = (AmbientStars *)user;
+
+    if (!loaded)
+    {
+        fprintf(stderr, "Warning: Could not load the sky texture; Continuing with point stars.\n");
+
+        gluDeleteQuadric(stars->quads[0]);
+        trackedFree(stars->quads);
+
+        scatterStars(stars, 1000, STAR_FIELD_DEFAULT_SEED);
+        return;
+    }
+
+    stars->texture = texture;
+}
+
+// With a `texture_loader`, the texture is only submitted, and `texture` is set once it is uploaded;
+// until then, the sky is left empty.
 AmbientStars* buildStarsFromTexture(const char* data_dir, Camera* POVAnchor)
 {
-    AmbientStars* stars = (AmbientStars *)malloc(sizeof(AmbientStars));
+    AmbientStars* stars = (AmbientStars *)trackedMalloc(MEMORY_TAG_STARS, sizeof(AmbientStars));
 
     stars->numberOfStars = 1;
     
@@ -83,17 +183,32 @@ AmbientStars* buildStarsFromTexture(const char* data_dir, Camera* POVAnchor)
 
     stars->sizeInWorld = (real_t).0;
 
-    stars->quads = (GLUquadric **)malloc(sizeof(GLUquadric *));
+    stars->texture = 0;
+
+    stars->numCatalogStars = 0;
+    stars->vertexBuffer = 0;
+    stars->vertices = NULL;
+    stars->spriteTexture = 0;
+    stars->cubeMap = 0;
+    stars->cubeMapResolution = 0;
+
+    stars->quads = (GLUquadric **)trackedMalloc(MEMORY_TAG_STARS, sizeof(GLUquadric *));
 
     stars->quads[0] = gluNewQuadric();
     gluQuadricTexture(stars->quads[0], GL_TRUE);
 
-    char* texture_filename = strCat(2, data_dir, "SKYBOX.bmp");
+    char* texture_filename = strCat(2, data_dir, "SKYBOX");
 
-    if (!registerTexture(texture_filename, &stars->texture))
+    if (texture_loader != NULL)
+    {
+        submitTexture(texture_loader, texture_filename, callbackStarsTexture, stars);
+    }
+    else if (!registerTexture(texture_filename, &stars->texture))
     {
+        gluDeleteQuadric(stars->quads[0]);
+        trackedFree(stars->quads);
         free(texture_filename);
-        free(stars);
+        trackedFree(stars);
         return NULL;
     }
     free(texture_filename);
@@ -101,20 +216,277 @@ AmbientStars* buildStarsFromTexture(const char* data_dir, Camera* POVAnchor)
     return stars;
 }
 
+// Fills in the 4 vertices of a star's quad.
+void buildStarVertices(const PackedStar* star, StarVertex* v)
+{
+    float d[3];
+    getPackedStarDirection(star, d);
+
+    float size, brightness, rgb[3];
+    getStarAppearance(star, &size, &brightness, rgb);
+
+    // Tangent axes of the quad, away from the poles' singularity.
+    float up[3] = { .0f, 1.0f, .0f };
+
+    if (fabsf(d[1]) > 0.9f)
+    {
+        up[0] = 1.0f;
+        up[1] = .0f;
+    }
+
+    float u[3] = { d[1] * up[2] - d[2] * up[1], d[2] * up[0] - d[0] * up[2], d[0] * up[1] - d[1] * up[0] };
+
+    float length = sqrtf(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+
+    for (int a = 0; a < 3; ++a)
+        u[a] /= length;
+
+    float w[3] = { d[1] * u[2] - d[2] * u[1], d[2] * u[0] - d[0] * u[2], d[0] * u[1] - d[1] * u[0] };
+
+    static const float corners[4][2] = { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } };
+
+    for (int k = 0; k < 4; ++k)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            float p = d[a] + size * (corners[k][0] * u[a] + corners[k][1] * w[a]);
+
+            v[k].position[a] = (GLshort)lrintf(p * AMBIENT_STARS_VERTEX_SCALE);
+        }
+
+        v[k].texCoord[0] = (GLshort)(corners[k][0] > .0f);
+        v[k].texCoord[1] = (GLshort)(corners[k][1] > .0f);
+
+        v[k].color[0] = (GLubyte)lrintf(rgb[0] * 255.0f);
+        v[k].color[1] = (GLubyte)lrintf(rgb[1] * 255.0f);
+        v[k].color[2] = (GLubyte)lrintf(rgb[2] * 255.0f);
+        v[k].color[3] = (GLubyte)lrintf(brightness * 255.0f);
+
+        v[k].padding = 0;
+    }
+}
+
+void buildStarVerticesRange(void* data, int begin, int end)
+{
+    const void** args = (const void **)data;
+
+    const PackedStar* stars = (const PackedStar *)args[0];
+    StarVertex* vertices = (StarVertex *)args[1];
+
+    for (int i = begin; i < end; ++i)
+        buildStarVertices(&stars[i], &vertices[4 * i]);
+}
+
+// Round sprite with a soft (gaussian) edge, modulated by each star's color and brightness.
+GLuint generateStarSprite(void)
+{
+    static GLubyte texels[AMBIENT_STARS_SPRITE_SIZE][AMBIENT_STARS_SPRITE_SIZE][2];
+
+    for (int y = 0; y < AMBIENT_STARS_SPRITE_SIZE; ++y)
+    {
+        for (int x = 0; x < AMBIENT_STARS_SPRITE_SIZE; ++x)
+        {
+            float dx = ((float)x + 0.5f) / AMBIENT_STARS_SPRITE_SIZE * 2.0f - 1.0f;
+            float dy = ((float)y + 0.5f) / AMBIENT_STARS_SPRITE_SIZE * 2.0f - 1.0f;
+
+            float r2 = dx * dx + dy * dy;
+
+            texels[y][x][0] = 255;
+            texels[y][x][1] = (GLubyte)lrintf(r2 < 1.0f ? 255.0f * expf(-4.0f * r2) * (1.0f - r2) : 0.0f);
+        }
+    }
+
+    GLuint texture;
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, AMBIENT_STARS_SPRITE_SIZE, AMBIENT_STARS_SPRITE_SIZE, 0,
+        GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, texels
+    );
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+
+    trackTextureMemory(texture, estimateTextureLevelBytes(AMBIENT_STARS_SPRITE_SIZE, AMBIENT_STARS_SPRITE_SIZE, false));
+
+    return texture;
+}
+
+// Stars of a catalog file (see `StarCatalog.h`), drawn with a single call. The vertices are built in
+// parallel by the job system and kept in a buffer object if the driver has them. Returns NULL if the
+// catalog cannot be loaded. Must be called from the GL thread.
+AmbientStars* buildStarsFromCatalog(JobSystem* js, const char* filename, Camera* POVAnchor)
+{
+    StarCatalog* catalog = loadStarCatalog(js, filename);
+
+    if (catalog == NULL)
+        return NULL;
+
+    AmbientStars* stars = (AmbientStars *)trackedMalloc(MEMORY_TAG_STARS, sizeof(AmbientStars));
+
+    stars->POVAnchor = POVAnchor;
+
+    stars->numberOfStars = 0;
+    stars->positions = NULL;
+    stars->quads = NULL;
+    stars->sizeInWorld = (real_t).0;
+    stars->texture = 0;
+
+    stars->numCatalogStars = catalog->count;
+    stars->vertexBuffer = 0;
+    stars->cubeMap = 0;
+    stars->cubeMapResolution = 0;
+
+    size_t bytes = (size_t)catalog->count * 4 * sizeof(StarVertex);
+
+    stars->vertices = (StarVertex *)trackedMalloc(MEMORY_TAG_STARS, bytes + sizeof(StarVertex));
+
+    const void* args[2] = { catalog->stars, stars->vertices };
+
+    parallelFor(js, 0, catalog->count, 4096, buildStarVerticesRange, (void *)args);
+
+    deleteStarCatalog(catalog);
+
+    const PixelBufferProcs* buffers = getPixelBufferProcs();
+
+    if (buffers != NULL)
+    {
+        buffers->genBuffers(1, &stars->vertexBuffer);
+        buffers->bindBuffer(GL_ARRAY_BUFFER, stars->vertexBuffer);
+        buffers->bufferData(GL_ARRAY_BUFFER, (ptrdiff_t)bytes, stars->vertices, GL_STATIC_DRAW);
+        buffers->bindBuffer(GL_ARRAY_BUFFER, 0);
+
+        trackMemory(MEMORY_TAG_BUFFERS, bytes);
+
+        trackedFree(stars->vertices);
+        stars->vertices = NULL;
+    }
+
+    stars->spriteTexture = generateStarSprite();
+
+    printf("Loaded %d stars from \"%s\".\n", stars->numCatalogStars, filename);
+
+    return stars;
+}
+
+// The star field of a catalog, or procedural stars if `catalog_filename` is NULL, baked into a cube
+// map (see `StarField.h`) and cached in `data_dir`. Returns NULL if the driver has no cube maps or if
+// the catalog cannot be loaded. Must be called from the GL thread.
+AmbientStars* buildStarsCubeMap(JobSystem* js, const StarFieldSettings* settings, const char* catalog_filename, const char* data_dir, Camera* POVAnchor)
+{
+    if (!isCubeMapSupported())
+        return NULL;
+
+    StarFieldSettings field = *settings;
+
+    GLint max_resolution = 0;
+    glGetIntegerv(GL_MAX_CUBE_MAP_TEXTURE_SIZE, &max_resolution);
+
+    if (max_resolution > 0 && field.resolution > max_resolution)
+    {
+        fprintf(stderr, "Warning: Star field resolution %d exceeds the driver's maximum; Using %d.\n", field.resolution, (int)max_resolution);
+        field.resolution = (int)max_resolution;
+    }
+
+    char* cache_filename = strCat(2, data_dir, STAR_FIELD_CACHE_FILENAME);
+
+    StarFieldImage* image = loadStarField(js, &field, catalog_filename, cache_filename);
+
+    free(cache_filename);
+
+    if (image == NULL)
+        return NULL;
+
+    AmbientStars* stars = (AmbientStars *)trackedMalloc(MEMORY_TAG_STARS, sizeof(AmbientStars));
+
+    stars->POVAnchor = POVAnchor;
+
+    stars->numberOfStars = 0;
+    stars->positions = NULL;
+    stars->quads = NULL;
+    stars->sizeInWorld = (real_t).0;
+    stars->texture = 0;
+
+    stars->numCatalogStars = 0;
+    stars->vertexBuffer = 0;
+    stars->vertices = NULL;
+    stars->spriteTexture = 0;
+
+    stars->cubeMapResolution = image->resolution;
+
+    size_t face_bytes = (size_t)image->resolution * image->resolution * 3;
+
+    glGenTextures(1, &stars->cubeMap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, stars->cubeMap);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (int f = 0; f < 6; ++f)
+    {
+        glTexImage2D(
+            GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, GL_RGB, image->resolution, image->resolution, 0,
+            GL_RGB, GL_UNSIGNED_BYTE, image->pixels + f * face_bytes
+        );
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+    trackTextureMemory(stars->cubeMap, 6 * estimateTextureLevelBytes((unsigned int)image->resolution, (unsigned int)image->resolution, false));
+
+    deleteStarFieldImage(image);
+
+    return stars;
+}
+
 void deleteStars(AmbientStars* stars)
 {
     if (stars == NULL)
         return;
 
+    if (stars->cubeMap != 0)
+    {
+        deleteTextures(1, &stars->cubeMap);
+        trackedFree(stars);
+        return;
+    }
+
+    if (stars->numCatalogStars > 0 || stars->spriteTexture != 0)
+    {
+        if (stars->vertexBuffer != 0)
+        {
+            getPixelBufferProcs()->deleteBuffers(1, &stars->vertexBuffer);
+            untrackMemory(MEMORY_TAG_BUFFERS, (size_t)stars->numCatalogStars * 4 * sizeof(StarVertex));
+        }
+
+        trackedFree(stars->vertices);
+        deleteTextures(1, &stars->spriteTexture);
+        trackedFree(stars);
+        return;
+    }
+
     for (int i = 0; i < stars->numberOfStars; ++i)
         gluDeleteQuadric(stars->quads[i]);
 
-    free(stars->quads);
+    trackedFree(stars->quads);
 
     if (stars->positions == NULL)
-        glDeleteTextures(1, &stars->texture);
+        deleteTextures(1, &stars->texture);
     else
-        free(stars->positions);
+        trackedFree(stars->positions);
+
+    trackedFree(stars);
 }
 
 void renderStars(AmbientStars* stars)
@@ -125,7 +497,102 @@ void renderStars(AmbientStars* stars)
 
     glLoadIdentity();
 
-    if (stars->positions != NULL)
+    if (stars->cubeMap != 0)
+    {
+        // A cube around the camera, looked up by direction, drawn before everything else and with
+        // neither depth test nor depth writes: it is the background, whatever the render distance.
+        static const GLfloat corners[8][3] = {
+            { -1.0f, -1.0f, -1.0f }, {  1.0f, -1.0f, -1.0f }, {  1.0f,  1.0f, -1.0f }, { -1.0f,  1.0f, -1.0f },
+            { -1.0f, -1.0f,  1.0f }, {  1.0f, -1.0f,  1.0f }, {  1.0f,  1.0f,  1.0f }, { -1.0f,  1.0f,  1.0f }
+        };
+        static const GLubyte faces[24] = {
+            0, 1, 2, 3,   4, 7, 6, 5,   0, 4, 5, 1,   3, 2, 6, 7,   0, 3, 7, 4,   1, 5, 6, 2
+        };
+
+        float scale = (float)(stars->POVAnchor->renderDistance * 0.5);
+
+        glTranslatef(
+            (float)stars->POVAnchor->position[0], 
+            (float)stars->POVAnchor->position[1],
+            (float)stars->POVAnchor->position[2]
+        );
+        glScalef(scale, scale, scale);
+
+        glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT);
+
+        glDisable(GL_LIGHTING);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDepthMask(GL_FALSE);
+
+        glEnable(GL_TEXTURE_CUBE_MAP);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, stars->cubeMap);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+        glVertexPointer(3, GL_FLOAT, 0, corners);
+        glTexCoordPointer(3, GL_FLOAT, 0, corners);
+
+        glDrawElements(GL_QUADS, 24, GL_UNSIGNED_BYTE, faces);
+        countDrawCalls(1);
+
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+
+        glPopAttrib();
+    }
+    else if (stars->numCatalogStars > 0)
+    {
+        // Every star at once: additive blending, so that their order does not matter, and no depth
+        // writes, so that the sky stays behind everything drawn after it.
+        float scale = (float)(stars->POVAnchor->renderDistance * 0.8) / AMBIENT_STARS_VERTEX_SCALE;
+
+        glTranslatef(
+            (float)stars->POVAnchor->position[0], 
+            (float)stars->POVAnchor->position[1],
+            (float)stars->POVAnchor->position[2]
+        );
+        glScalef(scale, scale, scale);
+
+        glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_TEXTURE_BIT);
+
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, stars->spriteTexture);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        glDepthMask(GL_FALSE);
+
+        const StarVertex* base = stars->vertices;
+
+        if (stars->vertexBuffer != 0)
+            getPixelBufferProcs()->bindBuffer(GL_ARRAY_BUFFER, stars->vertexBuffer);
+
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+        // With a buffer object bound, the pointers are offsets into it.
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(StarVertex), (const char *)base + offsetof(StarVertex, color));
+        glVertexPointer(3, GL_SHORT, sizeof(StarVertex), (const char *)base + offsetof(StarVertex, position));
+        glTexCoordPointer(2, GL_SHORT, sizeof(StarVertex), (const char *)base + offsetof(StarVertex, texCoord));
+
+        glDrawArrays(GL_QUADS, 0, 4 * stars->numCatalogStars);
+        countDrawCalls(1);
+
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+
+        if (stars->vertexBuffer != 0)
+            getPixelBufferProcs()->bindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glPopAttrib();
+    }
+    else if (stars->positions != NULL)
     {
         glColor3f(1.0f, 1.0f, 1.0f);
 
@@ -147,13 +614,14 @@ void renderStars(AmbientStars* stars)
             );
 
             gluSphere(stars->quads[i], stars->sizeInWorld, 3, 3);
+            countDrawCalls(1);
 
             glPopMatrix();
         }
     }
-    else
+    else if (stars->texture != 0)
     {
-        // High Resolution Sky rendering.   
+        // High Resolution Sky rendering (once the texture has been streamed in).   
         glColor3f(1.0f, 1.0f, 1.0f);
 
         glEnable(GL_TEXTURE_2D);
@@ -172,6 +640,7 @@ void renderStars(AmbientStars* stars)
             (double)stars->POVAnchor->renderDistance * 0.8, 
             128, 64
         );
+        countDrawCalls(1);
 
         glDisable(GL_TEXTURE_2D);
     }
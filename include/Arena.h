@@ -0,0 +1,276 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "MemoryTracker.h"
+
+
+// Bump allocator for data that lives as long as a loaded system (bodies, names, ...). Allocations
+// are carved out of large chunks one after the other, the chunks growing geometrically as the
+// arena fills up, and are never freed individually: the whole arena is released at once by
+// `deleteArena`. Temporaries can still be given back in bulk with `getArenaMark`/`rewindArena`.
+// Chunks are accounted to the arena's `MemoryTag` as a whole. Not thread-safe.
+
+// Alignment of `arenaAlloc`, enough for any type.
+#define ARENA_ALIGNMENT (_Alignof(max_align_t))
+
+#define ARENA_MIN_CHUNK_SIZE ((size_t)64 << 10)
+#define ARENA_MAX_CHUNK_SIZE ((size_t)64 << 20)
+
+typedef struct ArenaChunk
+{
+    // The chunk allocated before this one, NULL for the first.
+    struct ArenaChunk* previous;
+
+    // Bytes available past the header, and bytes handed out so far.
+    size_t size;
+    size_t used;
+
+} ArenaChunk;
+
+// Allocation position of an arena, to rewind it to (see `rewindArena`).
+typedef struct ArenaMark
+{
+    ArenaChunk* chunk;
+
+    size_t used;
+
+    size_t numAllocations;
+
+} ArenaMark;
+
+typedef struct Arena
+{
+    // The chunk being allocated from, i.e. the newest.
+    ArenaChunk* chunk;
+
+    // Size of the next chunk, unless an allocation needs a larger one.
+    size_t nextChunkSize;
+
+    MemoryTag tag;
+
+    // Statistics (see `printArenaStatistics`).
+    size_t numAllocations;
+
+    int numChunks;
+
+    // Bytes of the chunks, handed out (padding included), and the most ever handed out at once.
+    size_t bytesReserved;
+    size_t bytesUsed;
+    size_t peakBytesUsed;
+
+} Arena;
+
+
+// The chunk header is padded so that every chunk's data is aligned for any type.
+#define ARENA_CHUNK_HEADER_SIZE ((sizeof(ArenaChunk) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+// Arena constructor (heap-allocated), its chunks accounted to `tag`. `first_chunk_size` is only a
+// sizing hint (e.g. the expected total size); no memory is reserved before the first allocation.
+Arena* initArena(MemoryTag tag, size_t first_chunk_size)
+{
+    Arena* a = (Arena *)malloc(sizeof(Arena));
+
+    a->chunk = NULL;
+    a->tag = tag;
+
+    a->nextChunkSize = (first_chunk_size > ARENA_MIN_CHUNK_SIZE ? first_chunk_size : ARENA_MIN_CHUNK_SIZE);
+
+    a->numAllocations = 0;
+    a->numChunks = 0;
+
+    a->bytesReserved = 0;
+    a->bytesUsed = 0;
+    a->peakBytesUsed = 0;
+
+    return a;
+}
+
+// Returns `size` bytes aligned to `alignment` (a power of 2 up to `ARENA_ALIGNMENT`), valid until
+// the arena is deleted or rewound past them. Never returns NULL; running out of memory is fatal.
+void* arenaAllocAligned(Arena* a, size_t size, size_t alignment)
+{
+    ArenaChunk* c = a->chunk;
+
+    size_t offset = (c != NULL ? (c->used + alignment - 1) & ~(alignment - 1) : 0);
+
+    if (c == NULL || offset + size > c->size)
+    {
+        size_t chunk_size = a->nextChunkSize;
+
+        if (chunk_size < size)
+            chunk_size = size;
+
+        c = (ArenaChunk *)malloc(ARENA_CHUNK_HEADER_SIZE + chunk_size);
+
+        if (c == NULL)
+        {
+            fprintf(stderr, "Error: Unable to allocate %zu bytes for the arena; Exiting.\n", chunk_size);
+            exit(EXIT_FAILURE);
+        }
+
+        c->previous = a->chunk;
+        c->size = chunk_size;
+        c->used = 0;
+
+        a->chunk = c;
+        a->numChunks += 1;
+        a->bytesReserved += chunk_size;
+
+        trackMemory(a->tag, ARENA_CHUNK_HEADER_SIZE + chunk_size);
+
+        // The rest of the last chunk is abandoned; doubling the chunks bounds that waste (and the
+        // number of chunks) logarithmically.
+        if (a->nextChunkSize < ARENA_MAX_CHUNK_SIZE)
+            a->nextChunkSize *= 2;
+
+        offset = 0;
+    }
+
+    a->bytesUsed += (offset - c->used) + size;
+
+    if (a->bytesUsed > a->peakBytesUsed)
+        a->peakBytesUsed = a->bytesUsed;
+
+    a->numAllocations += 1;
+
+    c->used = offset + size;
+
+    return (char *)c + ARENA_CHUNK_HEADER_SIZE + offset;
+}
+
+void* arenaAlloc(Arena* a, size_t size)
+{
+    return arenaAllocAligned(a, size, ARENA_ALIGNMENT);
+}
+
+// `strBuild` into the arena.
+char* arenaStrBuild(Arena* a, const char* original_string)
+{
+    size_t str_length = strlen(original_string);
+
+    char* copy = (char *)arenaAllocAligned(a, str_length + 1, 1);
+
+    memcpy(copy, original_string, str_length + 1);
+
+    return copy;
+}
+
+// `strCat` into the arena: concatenates a total of n strings, each one succeeding the other.
+char* arenaStrCat(Arena* a, int n_strings, ...)
+{
+    va_list strings;
+
+    size_t length = 0;
+
+    va_start(strings, n_strings);
+
+    for (int i = 0; i < n_strings; ++i)
+        length += strlen(va_arg(strings, const char *));
+
+    va_end(strings);
+
+    char* result = (char *)arenaAllocAligned(a, length + 1, 1);
+
+    size_t k = 0;
+
+    va_start(strings, n_strings);
+
+    for (int i = 0; i < n_strings; ++i)
+    {
+        const char* arg = va_arg(strings, const char *);
+
+        size_t arg_length = strlen(arg);
+
+        memcpy(result + k, arg, arg_length);
+
+        k += arg_length;
+    }
+
+    va_end(strings);
+
+    result[k] = '\0';
+
+    return result;
+}
+
+ArenaMark getArenaMark(const Arena* a)
+{
+    ArenaMark mark;
+
+    mark.chunk = a->chunk;
+    mark.used = (a->chunk != NULL ? a->chunk->used : 0);
+    mark.numAllocations = a->numAllocations;
+
+    return mark;
+}
+
+// Gives back everything allocated since `mark` was taken (see `getArenaMark`), e.g. temporary
+// filenames; chunks added since are freed.
+void rewindArena(Arena* a, ArenaMark mark)
+{
+    while (a->chunk != mark.chunk)
+    {
+        ArenaChunk* c = a->chunk;
+
+        a->chunk = c->previous;
+
+        a->numChunks -= 1;
+        a->bytesReserved -= c->size;
+        a->bytesUsed -= c->used;
+
+        untrackMemory(a->tag, ARENA_CHUNK_HEADER_SIZE + c->size);
+
+        free(c);
+    }
+
+    if (a->chunk != NULL)
+    {
+        a->bytesUsed -= a->chunk->used - mark.used;
+        a->chunk->used = mark.used;
+    }
+
+    a->numAllocations = mark.numAllocations;
+}
+
+void printArenaStatistics(const Arena* a, const char* name)
+{
+    printf(
+        "Arena \"%s\": %zu allocations, %.2lf MiB used of %.2lf MiB reserved in %d chunks (peak %.2lf MiB).\n",
+        name, a->numAllocations,
+        (double)a->bytesUsed / (1 << 20), (double)a->bytesReserved / (1 << 20), a->numChunks,
+        (double)a->peakBytesUsed / (1 << 20)
+    );
+}
+
+// Releases every allocation of the arena at once.
+void deleteArena(Arena* a)
+{
+    if (a == NULL)
+        return;
+
+    while (a->chunk != NULL)
+    {
+        ArenaChunk* c = a->chunk;
+
+        a->chunk = c->previous;
+
+        untrackMemory(a->tag, ARENA_CHUNK_HEADER_SIZE + c->size);
+
+        free(c);
+    }
+
+    free(a);
+}
+
+#endif // ARENA_H
@@ -0,0 +1,301 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "Camera.h"
+#include "Profiler.h"
+#include "CameraPath.h"
+#include "CustomTypes.h"
+
+
+// Benchmark mode: flies the camera along a `CameraPath` at a fixed timestep and unlimited
+// framerate, collecting the profiler's measurements of every frame, and writes them as a
+// JSON report once the path is over.
+
+typedef struct BenchmarkFrame
+{
+    int segment;
+
+    unsigned long drawCalls;
+
+    uint64_t frameMicros;
+
+    uint64_t stageMicros[PROFILER_NUM_STAGES];
+
+} BenchmarkFrame;
+
+typedef struct Benchmark
+{
+    CameraPath* path;
+
+    char* reportFilename;
+
+    // Path time of the current frame, in seconds.
+    real_t pathTime;
+
+    int currentSegment;
+
+    BenchmarkFrame* frames;
+
+    size_t numFrames;
+    size_t capacity;
+
+    // Peak resident memory of the process at the end of each segment.
+    size_t* segmentPeakMemory;
+
+    uint64_t startMicros;
+    uint64_t totalMicros;
+
+} Benchmark;
+
+
+// Benchmark constructor (heap-allocated); takes ownership of the camera path.
+Benchmark* initBenchmark(CameraPath* path, const char* report_filename)
+{
+    Benchmark* b = (Benchmark *)malloc(sizeof(Benchmark));
+
+    b->path = path;
+    b->reportFilename = strBuild(report_filename);
+    b->pathTime = path->keyframes[0].time;
+    b->currentSegment = 0;
+
+    b->capacity = (size_t)(getCameraPathDuration(path) / path->timestep) + 2;
+    b->frames = (BenchmarkFrame *)malloc(b->capacity * sizeof(BenchmarkFrame));
+    b->numFrames = 0;
+
+    b->segmentPeakMemory = (size_t *)calloc((size_t)path->numKeyframes, sizeof(size_t));
+
+    b->startMicros = 0;
+    b->totalMicros = 0;
+
+    return b;
+}
+
+// Returns false once the path is over; otherwise stores the segment's simulation speed.
+bool beginBenchmarkFrame(Benchmark* b, real_t* simulation_speed)
+{
+    if (b->pathTime > b->path->keyframes[b->path->numKeyframes - 1].time)
+    {
+        if (b->totalMicros == 0)
+        {
+            b->totalMicros = getAbsoluteTimeMicros() - b->startMicros;
+            b->segmentPeakMemory[b->currentSegment] = getPeakMemoryBytes();
+        }
+        return false;
+    }
+
+    if (b->numFrames == 0)
+        b->startMicros = getAbsoluteTimeMicros();
+
+    int segment = getCameraPathSegment(b->path, b->pathTime);
+
+    if (segment != b->currentSegment)
+    {
+        b->segmentPeakMemory[b->currentSegment] = getPeakMemoryBytes();
+        b->currentSegment = segment;
+    }
+
+    *simulation_speed = b->path->keyframes[segment].simulationSpeed;
+
+    return true;
+}
+
+// Stores the profiler's measurements of the frame that just ended and advances the path.
+void endBenchmarkFrame(Benchmark* b)
+{
+    if (b->numFrames == b->capacity)
+    {
+        b->capacity *= 2;
+        b->frames = (BenchmarkFrame *)realloc(b->frames, b->capacity * sizeof(BenchmarkFrame));
+    }
+
+    BenchmarkFrame* f = &b->frames[b->numFrames++];
+
+    f->segment = b->currentSegment;
+    f->drawCalls = profiler_draw_calls;
+    f->frameMicros = profiler_frame_micros;
+    memcpy(f->stageMicros, profiler_stage_micros, sizeof(f->stageMicros));
+
+    b->pathTime += b->path->timestep;
+}
+
+
+int compareUInt64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of an ascending array.
+uint64_t getPercentile(const uint64_t* sorted, size_t n, double percentile)
+{
+    if (n == 0)
+        return 0;
+
+    size_t rank = (size_t)(percentile / 100.0 * (double)n + 0.999999);
+
+    rank = (rank == 0 ? 1 : (rank > n ? n : rank));
+
+    return sorted[rank - 1];
+}
+
+// Writes the statistics of the given samples (microseconds) as a JSON object in milliseconds.
+void writeBenchmarkTimings(FILE* fp, uint64_t* samples, size_t n)
+{
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < n; ++i)
+        sum += samples[i];
+
+    qsort(samples, n, sizeof(uint64_t), compareUInt64);
+
+    fprintf(
+        fp,
+        "{ \"mean\" : %.4lf, \"p50\" : %.4lf, \"p90\" : %.4lf, \"p95\" : %.4lf, \"p99\" : %.4lf, \"max\" : %.4lf }",
+        (n > 0 ? (double)sum / (double)n / 1000.0 : .0),
+        (double)getPercentile(samples, n, 50.0) / 1000.0,
+        (double)getPercentile(samples, n, 90.0) / 1000.0,
+        (double)getPercentile(samples, n, 95.0) / 1000.0,
+        (double)getPercentile(samples, n, 99.0) / 1000.0,
+        (n > 0 ? (double)samples[n - 1] / 1000.0 : .0)
+    );
+}
+
+// Writes frame-time and per-stage statistics of the frames of `segment` (-1 for all frames).
+void writeBenchmarkFrameStatistics(FILE* fp, const Benchmark* b, int segment, const char* indent)
+{
+    uint64_t* samples = (uint64_t *)malloc((b->numFrames + 1) * sizeof(uint64_t));
+
+    size_t n = 0;
+
+    for (size_t i = 0; i < b->numFrames; ++i)
+        if (segment < 0 || b->frames[i].segment == segment)
+            samples[n++] = b->frames[i].frameMicros;
+
+    fprintf(fp, "%s\"frames\" : %zu,\n", indent, n);
+    fprintf(fp, "%s\"frame_time_ms\" : ", indent);
+    writeBenchmarkTimings(fp, samples, n);
+    fprintf(fp, ",\n%s\"stages_ms\" : {\n", indent);
+
+    for (int s = 0; s < PROFILER_NUM_STAGES; ++s)
+    {
+        n = 0;
+
+        for (size_t i = 0; i < b->numFrames; ++i)
+            if (segment < 0 || b->frames[i].segment == segment)
+                samples[n++] = b->frames[i].stageMicros[s];
+
+        fprintf(fp, "%s    \"%s\" : ", indent, profiler_stage_names[s]);
+        writeBenchmarkTimings(fp, samples, n);
+        fprintf(fp, "%s\n", (s + 1 < PROFILER_NUM_STAGES ? "," : ""));
+    }
+    fprintf(fp, "%s},\n", indent);
+
+    unsigned long long total_draw_calls = 0;
+    unsigned long max_draw_calls = 0;
+
+    n = 0;
+
+    for (size_t i = 0; i < b->numFrames; ++i)
+    {
+        if (segment >= 0 && b->frames[i].segment != segment)
+            continue;
+
+        total_draw_calls += b->frames[i].drawCalls;
+
+        if (b->frames[i].drawCalls > max_draw_calls)
+            max_draw_calls = b->frames[i].drawCalls;
+        ++n;
+    }
+
+    fprintf(
+        fp, "%s\"draw_calls\" : { \"total\" : %llu, \"mean_per_frame\" : %.2lf, \"max_per_frame\" : %lu }",
+        indent, total_draw_calls, (n > 0 ? (double)total_draw_calls / (double)n : .0), max_draw_calls
+    );
+
+    free(samples);
+}
+
+bool writeBenchmarkReport(const Benchmark* b, const char* system_dir)
+{
+    FILE* fp = fopen(b->reportFilename, "w");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error: Unable to create the benchmark report \"%s\".\n", b->reportFilename);
+        return false;
+    }
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "    \"camera_path\" : ");
+    fprintJsonString(fp, b->path->filename);
+    fprintf(fp, ",\n    \"system\" : ");
+    fprintJsonString(fp, system_dir);
+    fprintf(fp, ",\n");
+    fprintf(fp, "    \"timestep\" : %.6lf,\n", (double)b->path->timestep);
+    fprintf(fp, "    \"total_ms\" : %.3lf,\n", (double)b->totalMicros / 1000.0);
+    fprintf(fp, "    \"peak_memory_bytes\" : %zu,\n", getPeakMemoryBytes());
+
+    writeBenchmarkFrameStatistics(fp, b, -1, "    ");
+
+    fprintf(fp, ",\n    \"segments\" : [\n");
+
+    for (int seg = 0; seg + 1 < b->path->numKeyframes; ++seg)
+    {
+        const CameraKeyframe* k = &b->path->keyframes[seg];
+
+        fprintf(fp, "        {\n");
+        fprintf(fp, "            \"index\" : %d,\n", seg);
+        fprintf(fp, "            \"start_time\" : %.4lf,\n", (double)k->time);
+        fprintf(fp, "            \"end_time\" : %.4lf,\n", (double)k[1].time);
+
+        fprintf(fp, "            \"anchor\" : ");
+
+        if (k->anchor != NULL)
+            fprintJsonString(fp, k->anchor->name);
+        else
+            fprintf(fp, "null");
+
+        fprintf(fp, ",\n");
+
+        fprintf(fp, "            \"simulation_speed\" : %.4lf,\n", (double)k->simulationSpeed);
+        fprintf(fp, "            \"peak_memory_bytes\" : %zu,\n", b->segmentPeakMemory[seg]);
+
+        writeBenchmarkFrameStatistics(fp, b, seg, "            ");
+
+        fprintf(fp, "\n        }%s\n", (seg + 2 < b->path->numKeyframes ? "," : ""));
+    }
+
+    fprintf(fp, "    ]\n}\n");
+    fclose(fp);
+
+    printf("Benchmark report written to \"%s\" (%zu frames).\n", b->reportFilename, b->numFrames);
+
+    return true;
+}
+
+void deleteBenchmark(Benchmark* b)
+{
+    if (b == NULL)
+        return;
+
+    deleteCameraPath(b->path);
+    free(b->segmentPeakMemory);
+    free(b->frames);
+    free(b->reportFilename);
+    free(b);
+}
+
+#endif // BENCHMARK_H
@@ -6,9 +6,13 @@
 #endif 
 
 #include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
+#include <stdbool.h>
 
+#include "MappedFile.h"
 #include "CustomTypes.h"
+#include "MemoryTracker.h"
 
 
 // bmp file header 
@@ -74,77 +78,237 @@ typedef struct TagBitmapInfoHeader BitmapInfoHeader;
 typedef struct TagBitmapFileHeader BitmapFileHeader;
 
 
-ubyte_t* loadBitmapToRGBArray(const char* filename, unsigned int* width, unsigned int* height, bool debug)
+#define BITMAP_COMPRESSION_RGB 0
+#define BITMAP_COMPRESSION_BITFIELDS 3
+
+// Pixel data of a 24 or 32-bit image, laid out the way OpenGL expects it: rows from bottom to top,
+// each one padded to a multiple of 4 bytes (the default GL_UNPACK_ALIGNMENT), with the channels in
+// BGR(A) order. It can thus be uploaded as-is with GL_BGR/GL_BGRA. Besides bitmap files, it holds
+// the output of the JPEG and PNG decoders (see `ImageFormats.h`).
+typedef struct BitmapImage
+{
+    // Points into `file` for bottom-up bitmaps (no copy at all), or to `buffer` otherwise.
+    const ubyte_t* pixels;
+
+    unsigned int width;
+    unsigned int height;
+
+    // 3 (BGR) or 4 (BGRA).
+    unsigned int bytesPerPixel;
+
+    // Bytes from the start of one row to the next.
+    size_t rowStride;
+
+    // NULL unless the pixels are used in place.
+    MappedFile* file;
+
+    // Owned pixels: the flipped rows of a top-down bitmap, or decoded pixels (accounted to
+    // `MEMORY_TAG_IMAGES`).
+    ubyte_t* buffer;
+
+} BitmapImage;
+
+
+void printBitmapHeaders(const char* filename, const BitmapFileHeader* bmfh, const BitmapInfoHeader* bmih)
+{
+    printf("File: %s\n", filename);
+    printf("Header Info\n");
+    printf("--------------------\n");
+    printf("Size:%i\n", bmfh->bfSize);
+    printf("Offset:%i\n", bmfh->bfOffBits);
+    printf("--------------------\n");
+    printf("Size:%i\n", bmih->biSize);
+    printf("biWidth:%i\n", bmih->biWidth);
+    printf("biHeight:%i\n", bmih->biHeight);
+    printf("biPlanes:%i\n", bmih->biPlanes);
+    printf("biBitCount:%i\n", bmih->biBitCount);
+    printf("biCompression:%i\n", bmih->biCompression);
+    printf("biSizeImage:%i\n", bmih->biSizeImage);
+    printf("biXPelsPerMeter:%i\n", bmih->biXPelsPerMeter);
+    printf("biYPelsPerMeter:%i\n", bmih->biYPelsPerMeter);
+    printf("biClrUsed:%i\n", bmih->biClrUsed);
+    printf("biClrImportant:%i\n", bmih->biClrImportant);
+    printf("--------------------\n");
+}
+
+void deleteBitmapImage(BitmapImage* image)
+{
+    if (image == NULL)
+        return;
+
+    closeMappedFile(image->file);
+    trackedFree(image->buffer);
+    free(image);
+}
+
+// Allocates an image with its own (uninitialised) pixel buffer, for decoders to write into.
+BitmapImage* allocateBitmapImage(unsigned int width, unsigned int height, unsigned int bytes_per_pixel)
 {
-    FILE* fp;
+    BitmapImage* image = (BitmapImage *)malloc(sizeof(BitmapImage));
 
-    unsigned int x, y;
+    image->width = width;
+    image->height = height;
+    image->bytesPerPixel = bytes_per_pixel;
+    image->rowStride = ((size_t)width * bytes_per_pixel + 3) & ~(size_t)3;
 
+    image->file = NULL;
+    image->buffer = (ubyte_t *)trackedMalloc(MEMORY_TAG_IMAGES, image->rowStride * height);
+    image->pixels = image->buffer;
+
+    if (image->buffer == NULL)
+    {
+        free(image);
+        return NULL;
+    }
+
+    return image;
+}
+
+// Bitmap image constructor (heap-allocated) over a mapped file, which it takes ownership of (it is
+// closed on failure). The pixel array (found at `bfOffBits`) is used in place unless the rows are
+// stored top-down, in which case they are copied in reverse order. Returns NULL for truncated or
+// unsupported files (only uncompressed 24-bit and 32-bit BGR(A) images are supported).
+BitmapImage* decodeBitmapImage(MappedFile* file, const char* filename, bool debug)
+{
     BitmapFileHeader bmfh;
-    
     BitmapInfoHeader bmih;
 
+    if (file->size < sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader))
+    {
+        fprintf(stderr, "Error: Bitmap image file is truncated; Inspect \"%s\".\n", filename);
+        closeMappedFile(file);
+        return NULL;
+    }
+
+    // The headers are copied out, as the mapping is not suitably aligned for them.
+    memcpy(&bmfh, file->data, sizeof(BitmapFileHeader));
+    memcpy(&bmih, file->data + sizeof(BitmapFileHeader), sizeof(BitmapInfoHeader));
 
-    // Opening the file: using "rb" mode to read this *binary* file
-    fp = fopen(filename, "rb");
+    if (debug)
+        printBitmapHeaders(filename, &bmfh, &bmih);
 
-    if (fp == NULL)
+    bool supported = (
+        bmfh.bfType == 0x4D42 && bmih.biWidth > 0 && bmih.biHeight != 0 &&
+        (bmih.biBitCount == 24 || bmih.biBitCount == 32) &&
+        (bmih.biCompression == BITMAP_COMPRESSION_RGB || bmih.biCompression == BITMAP_COMPRESSION_BITFIELDS)
+    );
+
+    // Bit fields are only supported in the standard BGRA layout; their masks follow the
+    // 40-byte info header (either inside a larger header or right after the basic one).
+    if (supported && bmih.biCompression == BITMAP_COMPRESSION_BITFIELDS)
     {
-        fprintf(stderr, "Error: Bitmap image file is unavailable; Inspect \"%s\".\n", filename);
+        unsigned int masks[3];
+
+        size_t masks_offset = sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader);
+
+        supported = (bmih.biBitCount == 32 && file->size >= masks_offset + sizeof(masks));
+
+        if (supported)
+        {
+            memcpy(masks, file->data + masks_offset, sizeof(masks));
+            supported = (masks[0] == 0x00FF0000u && masks[1] == 0x0000FF00u && masks[2] == 0x000000FFu);
+        }
+    }
+
+    if (!supported)
+    {
+        fprintf(
+            stderr, "Error: Unsupported bitmap image format (%u bpp, compression %u); Inspect \"%s\".\n",
+            (unsigned int)bmih.biBitCount, bmih.biCompression, filename
+        );
+        closeMappedFile(file);
         return NULL;
     }
 
-    // Reading the file header and any following bitmap information...
-    fread(&bmfh, sizeof(BitmapFileHeader), 1, fp);
-    fread(&bmih, sizeof(BitmapInfoHeader), 1, fp);
+    BitmapImage* image = (BitmapImage *)malloc(sizeof(BitmapImage));
+
+    image->file = file;
+    image->buffer = NULL;
+    image->width = (unsigned int)bmih.biWidth;
+    image->height = (unsigned int)(bmih.biHeight < 0 ? -bmih.biHeight : bmih.biHeight);
+    image->bytesPerPixel = bmih.biBitCount / 8;
 
-    // Extract the width & height from bmp header info
-    *width = bmih.biWidth;
-    *height = bmih.biHeight;
+    // Rows are padded to 4-byte boundaries.
+    image->rowStride = ((size_t)image->width * image->bytesPerPixel + 3) & ~(size_t)3;
 
-    ubyte_t* image = (ubyte_t *)malloc((*width) * (*height) * 3 * sizeof(ubyte_t));
+    size_t pixels_size = image->rowStride * image->height;
 
-    // Reading the pixels of input image
-    for (y = 0; y < *height; y++)
+    if (bmfh.bfOffBits > file->size || file->size - bmfh.bfOffBits < pixels_size)
     {
-        size_t rowOffset = 3 * (*width) * y; 
+        fprintf(stderr, "Error: Bitmap image file is truncated; Inspect \"%s\".\n", filename);
+        deleteBitmapImage(image);
+        return NULL;
+    }
 
-        for (x = 0; x < *width; x++)
-        {
-            register size_t offset = rowOffset + 3 * x;
+    image->pixels = (const ubyte_t *)file->data + bmfh.bfOffBits;
+
+    // Top-down images (negative height) are flipped to OpenGL's bottom-up order.
+    if (bmih.biHeight < 0)
+    {
+        image->buffer = (ubyte_t *)trackedMalloc(MEMORY_TAG_IMAGES, pixels_size);
 
-            image[offset + 2] = fgetc(fp);
-            image[offset + 1] = fgetc(fp);
-            image[offset + 0] = fgetc(fp);
+        for (unsigned int y = 0; y < image->height; ++y)
+        {
+            memcpy(
+                image->buffer + (size_t)y * image->rowStride,
+                image->pixels + (size_t)(image->height - 1 - y) * image->rowStride,
+                image->rowStride
+            );
         }
+
+        image->pixels = image->buffer;
     }
-    
-    fclose(fp);
 
-    if (debug)
-    {   
-        printf("File: %s\n", filename);
-        printf("Header Info\n");
-        printf("--------------------\n");
-        printf("Size:%i\n", bmfh.bfSize);
-        printf("Offset:%i\n", bmfh.bfOffBits);
-        printf("--------------------\n");
-        printf("Size:%i\n", bmih.biSize);
-        printf("biWidth:%i\n", bmih.biWidth);
-        printf("biHeight:%i\n", bmih.biHeight);
-        printf("biPlanes:%i\n", bmih.biPlanes);
-        printf("biBitCount:%i\n", bmih.biBitCount);
-        printf("biCompression:%i\n", bmih.biCompression);
-        printf("biSizeImage:%i\n", bmih.biSizeImage);
-        printf("biXPelsPerMeter:%i\n", bmih.biXPelsPerMeter);
-        printf("biYPelsPerMeter:%i\n", bmih.biYPelsPerMeter);
-        printf("biClrUsed:%i\n", bmih.biClrUsed);
-        printf("biClrImportant:%i\n", bmih.biClrImportant);
-        printf("--------------------\n");
+    return image;
+}
+
+// Maps and decodes a bitmap file; see `decodeBitmapImage`.
+BitmapImage* loadBitmapImage(const char* filename, bool debug)
+{
+    MappedFile* file = openMappedFile(filename, true);
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: Bitmap image file is unavailable; Inspect \"%s\".\n", filename);
+        return NULL;
     }
 
+    return decodeBitmapImage(file, filename, debug);
+}
+
+// Returns the image's pixels as tightly packed RGB triplets (bottom-up rows), or NULL on failure.
+ubyte_t* loadBitmapToRGBArray(const char* filename, unsigned int* width, unsigned int* height, bool debug)
+{
+    BitmapImage* bitmap = loadBitmapImage(filename, debug);
+
+    if (bitmap == NULL)
+        return NULL;
+
+    *width = bitmap->width;
+    *height = bitmap->height;
+
+    ubyte_t* image = (ubyte_t *)malloc((size_t)(*width) * (*height) * 3 * sizeof(ubyte_t));
+
+    const unsigned int bpp = bitmap->bytesPerPixel;
+
+    for (unsigned int y = 0; y < *height; ++y)
+    {
+        const ubyte_t* src = bitmap->pixels + (size_t)y * bitmap->rowStride;
+        ubyte_t* dst = image + (size_t)y * (*width) * 3;
+
+        // BGR(A) -> RGB, one row at a time.
+        for (unsigned int x = 0; x < *width; ++x)
+        {
+            dst[3 * x + 0] = src[bpp * x + 2];
+            dst[3 * x + 1] = src[bpp * x + 1];
+            dst[3 * x + 2] = src[bpp * x + 0];
+        }
+    }
+
+    deleteBitmapImage(bitmap);
+
     return image;
 }
 
 
-#endif // IMAGES_H
\ No newline at end of file
+#endif // IMAGES_H
@@ -3,12 +3,17 @@
 
 #include <GL/glut.h>
 
+#include "Transform.h"
 #include "CustomTypes.h"
 #include "StellarObject.h"
 #include "KeyboardCallback.h"
 #include "MotionCallback.h"
 
 
+// Vertical field of view in degrees, and width to height ratio of the projection.
+#define CAMERA_FIELD_OF_VIEW 60.0
+#define CAMERA_ASPECT_RATIO (16.0 / 9.0)
+
 // Documentation:
 // - IV. Interaction: https://github.com/DimYfantidis/solar_demo?tab=readme-ov-file#iv-interaction
 // - V. Classes@Camera: https://github.com/DimYfantidis/solar_demo?tab=readme-ov-file#camera
@@ -30,6 +35,17 @@ typedef struct Camera
     // Non-null value implies the camera is in locked mode, i.e. observes the pointed astronomical 
     // object without freedom of movement (check "IV. Interaction" section in documentation).
     StellarObject* anchor;
+
+    // Cached `gluPerspective` equivalent; only rebuilt when `projectionDirty` is set.
+    matrix4f projectionMatrix;
+
+    bool projectionDirty;
+
+    // Cached `gluLookAt` equivalent, rebuilt once per frame by `updateCameraMatrices`.
+    matrix4f viewMatrix;
+
+    // projectionMatrix * viewMatrix, loaded into GL_PROJECTION as a whole.
+    matrix4f viewProjectionMatrix;
     
 } Camera;
 
@@ -63,22 +79,91 @@ Camera* initCamera(
     camera->upVector[1] = (real_t)up_y;
     camera->upVector[2] = (real_t)up_z;
 
-    camera->movementSpeed = (real_t)0.5;
+    camera->movementSpeed = (real_t)1.0;
     camera->renderDistance = (real_t)render_distance;
 
     camera->anchor = NULL;
 
+    camera->projectionDirty = true;
+
+    matrixIdentity4f(camera->viewMatrix);
+
     return camera;
 }
 
 
-// Listens for events to update camera position and orientation, and modifies GLUT's projection matrix.
-void updateCamera(Camera* camera)
+// Rebuilds the camera's view matrix from its current position/orientation and loads
+// the combined view-projection matrix into GLUT's projection matrix. Does not poll input.
+void updateCameraMatrices(Camera* camera)
 {
+    if (camera->projectionDirty)
+    {
+        matrixPerspective4f(camera->projectionMatrix, CAMERA_FIELD_OF_VIEW, CAMERA_ASPECT_RATIO, 0.01, (double)camera->renderDistance);
+        camera->projectionDirty = false;
+    }
+
+    vector3r centre = {
+        camera->position[0] + camera->lookAt[0],
+        camera->position[1] + camera->lookAt[1],
+        camera->position[2] + camera->lookAt[2]
+    };
+
+    matrixLookAt4f(camera->viewMatrix, camera->position, centre, camera->upVector);
+    matrixMultiply4f(camera->viewProjectionMatrix, camera->projectionMatrix, camera->viewMatrix);
+
     glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-    gluPerspective(60.0, 16.0 / 9.0, 0.01, (double)camera->renderDistance);
+    glLoadMatrixf(camera->viewProjectionMatrix);
+}
+
+// Direction (normalized) of the ray from the camera through the point (x, y) of the view, both in
+// [-1, 1] from its bottom-left corner to its top-right one.
+void getCameraRay(const Camera* camera, double x, double y, vector3r direction)
+{
+    double scale_y = tan(CAMERA_FIELD_OF_VIEW * (M_PI / 360.0));
+    double scale_x = scale_y * CAMERA_ASPECT_RATIO;
+
+    // The camera's basis, as in `matrixLookAt4f`.
+    double f[3] = { (double)camera->lookAt[0], (double)camera->lookAt[1], (double)camera->lookAt[2] };
+    double up[3] = { (double)camera->upVector[0], (double)camera->upVector[1], (double)camera->upVector[2] };
 
+    double len = sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+
+    f[0] /= len;
+    f[1] /= len;
+    f[2] /= len;
+
+    double s[3] = {
+        f[1] * up[2] - f[2] * up[1],
+        f[2] * up[0] - f[0] * up[2],
+        f[0] * up[1] - f[1] * up[0]
+    };
+    len = sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+
+    s[0] /= len;
+    s[1] /= len;
+    s[2] /= len;
+
+    double u[3] = {
+        s[1] * f[2] - s[2] * f[1],
+        s[2] * f[0] - s[0] * f[2],
+        s[0] * f[1] - s[1] * f[0]
+    };
+
+    double d[3];
+
+    for (int i = 0; i < 3; ++i)
+        d[i] = f[i] + s[i] * x * scale_x + u[i] * y * scale_y;
+
+    len = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+    for (int i = 0; i < 3; ++i)
+        direction[i] = (real_t)(d[i] / len);
+}
+
+// Listens for events to update camera position and orientation, and modifies GLUT's projection matrix.
+// Meant to be called exactly once per frame, after the astronomical objects have been updated.
+void updateCamera(Camera* camera)
+{
     double sin_vert = sin((double)camera_angle_vertical);
 	double sin_horz = sin((double)camera_angle_horizontal);
 	double cos_vert = cos((double)camera_angle_vertical);
@@ -102,19 +187,7 @@ void updateCamera(Camera* camera)
         camera->position[1] += camera->anchor->radius * (real_t)4.5;
         camera->position[2] += camera->anchor->radius * (real_t)4.5;
 
-        gluLookAt(
-            (double)camera->position[0], 
-            (double)camera->position[1], 
-            (double)camera->position[2],
-
-            (double)(camera->position[0] + camera->lookAt[0]), 
-            (double)(camera->position[1] + camera->lookAt[1]), 
-            (double)(camera->position[2] + camera->lookAt[2]),
-
-            (double)camera->upVector[0], 
-            (double)camera->upVector[1], 
-            (double)camera->upVector[2]
-        );
+        updateCameraMatrices(camera);
 
         return;
     }
@@ -162,19 +235,7 @@ void updateCamera(Camera* camera)
         camera->position[1] += movementSpeed;
     }
 
-    gluLookAt(
-        (double)camera->position[0], 
-        (double)camera->position[1], 
-        (double)camera->position[2],
-
-        (double)(camera->position[0] + camera->lookAt[0]), 
-        (double)(camera->position[1] + camera->lookAt[1]), 
-        (double)(camera->position[2] + camera->lookAt[2]),
-
-        (double)camera->upVector[0], 
-        (double)camera->upVector[1], 
-        (double)camera->upVector[2]
-    );
+    updateCameraMatrices(camera);
 }
 
 inline void deleteCamera(Camera* camera)
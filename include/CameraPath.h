@@ -0,0 +1,313 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cJSON.h>
+
+#include "Camera.h"
+#include "MappedFile.h"
+#include "CustomTypes.h"
+#include "StellarObject.h"
+
+
+// A scripted camera trajectory, loaded from a JSON file of the following structure:
+//
+// {
+//     "timestep" : <float_value>,              (path seconds advanced per frame; defaults to 1/60)
+//     "keyframes" : [
+//         {
+//             "time" : <float_value>,          (seconds since the beginning of the path; increasing)
+//             "position" : [x, y, z],          (world units; relative to the anchor, if any)
+//             "look_at" : [x, y, z],           (gaze direction; normalized on load)
+//             "anchor" : <string_value|null>,  (name of the StellarObject the camera follows)
+//             "simulation_speed" : <float_value>
+//         },
+//         ...
+//     ]
+// }
+//
+// The camera's position is interpolated with a Catmull-Rom spline through consecutive keyframes
+// that share the same anchor, in the anchor's frame of reference. Segments that switch anchors are
+// interpolated in world coordinates (evaluated at the current simulation time) with zero tangents at
+// their ends, so the camera eases from one anchor to the next without overshooting. The gaze direction
+// is interpolated linearly, while the anchor and the simulation speed of a keyframe hold until the next one.
+
+typedef struct CameraKeyframe
+{
+    real_t time;
+
+    vector3r position;
+
+    vector3r lookAt;
+
+    StellarObject* anchor;
+
+    real_t simulationSpeed;
+
+} CameraKeyframe;
+
+typedef struct CameraPath
+{
+    char* filename;
+
+    CameraKeyframe* keyframes;
+
+    int numKeyframes;
+
+    real_t timestep;
+
+} CameraPath;
+
+
+bool readCameraPathVector(const cJSON* array, vector3r v)
+{
+    if (!cJSON_IsArray(array) || cJSON_GetArraySize(array) != 3)
+        return false;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        cJSON* item = cJSON_GetArrayItem(array, i);
+
+        if (!cJSON_IsNumber(item))
+            return false;
+
+        v[i] = (real_t)item->valuedouble;
+    }
+    return true;
+}
+
+// Loads the camera path; anchors are resolved by name among `objects`.
+CameraPath* loadCameraPath(const char* filename, StellarObject** objects, int num_objects)
+{
+    MappedFile* file = openMappedFile(filename, true);
+
+    if (file == NULL || file->size == 0)
+    {
+        fprintf(stderr, "Error: Unable to open the camera path file \"%s\".\n", filename);
+        closeMappedFile(file);
+        return NULL;
+    }
+
+    cJSON* json = cJSON_ParseWithLength(file->data, file->size);
+
+    closeMappedFile(file);
+
+    if (json == NULL)
+    {
+        const char *error_ptr = cJSON_GetErrorPtr();
+        if (error_ptr != NULL) {
+            fprintf(stderr, "Error: %s\n", error_ptr);
+        }
+        return NULL;
+    }
+
+    const cJSON* timestep = cJSON_GetObjectItemCaseSensitive(json, "timestep");
+    const cJSON* keyframes = cJSON_GetObjectItemCaseSensitive(json, "keyframes");
+
+    if (!cJSON_IsArray(keyframes) || cJSON_GetArraySize(keyframes) < 2)
+    {
+        fprintf(stderr, "Error: `keyframes` should be an array of at least 2 objects; Inspect \"%s\".\n", filename);
+        cJSON_Delete(json);
+        return NULL;
+    }
+
+    CameraPath* path = (CameraPath *)malloc(sizeof(CameraPath));
+
+    path->filename = strBuild(filename);
+    path->numKeyframes = 0;
+    path->timestep = (cJSON_IsNumber(timestep) && timestep->valuedouble > .0 ? (real_t)timestep->valuedouble : (real_t)(1.0 / 60.0));
+    path->keyframes = (CameraKeyframe *)malloc(cJSON_GetArraySize(keyframes) * sizeof(CameraKeyframe));
+
+    static const char* error_field_message = "Error: Camera keyframe idx.#%d - `%s` field is invalid; Inspect \"%s\".\n";
+
+    const cJSON* iterator = NULL;
+
+    cJSON_ArrayForEach(iterator, keyframes)
+    {
+        CameraKeyframe* k = &path->keyframes[path->numKeyframes];
+
+        const cJSON* time = cJSON_GetObjectItemCaseSensitive(iterator, "time");
+        const cJSON* position = cJSON_GetObjectItemCaseSensitive(iterator, "position");
+        const cJSON* look_at = cJSON_GetObjectItemCaseSensitive(iterator, "look_at");
+        const cJSON* anchor = cJSON_GetObjectItemCaseSensitive(iterator, "anchor");
+        const cJSON* simulation_speed = cJSON_GetObjectItemCaseSensitive(iterator, "simulation_speed");
+
+        const char* error_field = NULL;
+
+        if (!cJSON_IsNumber(time) || (path->numKeyframes > 0 && time->valuedouble <= k[-1].time))
+            error_field = "time";
+
+        else if (!readCameraPathVector(position, k->position))
+            error_field = "position";
+
+        else if (!readCameraPathVector(look_at, k->lookAt) || vectorLength3rv(k->lookAt) == (real_t).0)
+            error_field = "look_at";
+
+        else if (!cJSON_IsNumber(simulation_speed))
+            error_field = "simulation_speed";
+
+        else if (anchor != NULL && !cJSON_IsNull(anchor) && !cJSON_IsString(anchor))
+            error_field = "anchor";
+
+        if (error_field != NULL)
+        {
+            fprintf(stderr, error_field_message, path->numKeyframes, error_field, filename);
+            cJSON_Delete(json);
+            free(path->keyframes);
+            free(path->filename);
+            free(path);
+            return NULL;
+        }
+
+        k->time = (real_t)time->valuedouble;
+        k->simulationSpeed = (real_t)simulation_speed->valuedouble;
+        k->anchor = NULL;
+
+        real_t len = vectorLength3rv(k->lookAt);
+
+        k->lookAt[0] /= len;
+        k->lookAt[1] /= len;
+        k->lookAt[2] /= len;
+
+        if (cJSON_IsString(anchor))
+        {
+            for (int i = 0; i < num_objects; ++i)
+            {
+                if (strcmp(objects[i]->name, anchor->valuestring) == 0)
+                {
+                    k->anchor = objects[i];
+                    break;
+                }
+            }
+
+            if (k->anchor == NULL)
+            {
+                fprintf(
+                    stderr,
+                    "Warning: Camera keyframe idx.#%d is anchored to %s, which is not loaded; Using world coordinates.\n",
+                    path->numKeyframes, anchor->valuestring
+                );
+            }
+        }
+
+        path->numKeyframes += 1;
+    }
+
+    cJSON_Delete(json);
+
+    return path;
+}
+
+real_t getCameraPathDuration(const CameraPath* path)
+{
+    return path->keyframes[path->numKeyframes - 1].time - path->keyframes[0].time;
+}
+
+// Returns the index of the segment (i.e. of its starting keyframe) that contains the path time `t`.
+int getCameraPathSegment(const CameraPath* path, real_t t)
+{
+    int lo = 0;
+    int hi = path->numKeyframes - 2;
+
+    // Binary search for the last keyframe whose time is <= t.
+    while (lo < hi)
+    {
+        int mid = (lo + hi + 1) / 2;
+
+        if (path->keyframes[mid].time <= t)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+// Places the camera at path time `t` and sets its anchor.
+// Must be called after the keyframes' anchors have been updated for the current frame.
+void evaluateCameraPath(const CameraPath* path, real_t t, Camera* camera)
+{
+    int seg = getCameraPathSegment(path, t);
+
+    const CameraKeyframe* k = path->keyframes;
+
+    bool same_anchor = (k[seg].anchor == k[seg + 1].anchor);
+
+    // Control points of the spline; the outer ones are clamped at the ends of the path and wherever
+    // the neighbouring keyframe is expressed relative to a different anchor.
+    int idx[4] = {
+        (seg > 0 && same_anchor && k[seg - 1].anchor == k[seg].anchor ? seg - 1 : seg),
+        seg,
+        seg + 1,
+        (seg + 2 < path->numKeyframes && same_anchor && k[seg + 2].anchor == k[seg].anchor ? seg + 2 : seg + 1)
+    };
+
+    vector3r p[4];
+
+    for (int j = 0; j < 4; ++j)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            p[j][i] = k[idx[j]].position[i];
+
+            // Segments that switch anchors are interpolated in world coordinates.
+            if (!same_anchor && k[idx[j]].anchor != NULL)
+                p[j][i] += k[idx[j]].anchor->position[i];
+        }
+    }
+
+    real_t u = (t - k[seg].time) / (k[seg + 1].time - k[seg].time);
+
+    u = (u < (real_t).0 ? (real_t).0 : (u > (real_t)1.0 ? (real_t)1.0 : u));
+
+    real_t u2 = u * u;
+    real_t u3 = u2 * u;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        // Uniform Catmull-Rom spline.
+        camera->position[i] = (real_t)0.5 * (
+            (real_t)2.0 * p[1][i] +
+            (-p[0][i] + p[2][i]) * u +
+            ((real_t)2.0 * p[0][i] - (real_t)5.0 * p[1][i] + (real_t)4.0 * p[2][i] - p[3][i]) * u2 +
+            (-p[0][i] + (real_t)3.0 * p[1][i] - (real_t)3.0 * p[2][i] + p[3][i]) * u3
+        );
+
+        if (same_anchor && k[seg].anchor != NULL)
+            camera->position[i] += k[seg].anchor->position[i];
+
+        camera->lookAt[i] = k[seg].lookAt[i] + (k[seg + 1].lookAt[i] - k[seg].lookAt[i]) * u;
+    }
+
+    real_t len = vectorLength3rv(camera->lookAt);
+
+    if (len > (real_t).0)
+    {
+        camera->lookAt[0] /= len;
+        camera->lookAt[1] /= len;
+        camera->lookAt[2] /= len;
+    }
+    else
+    {
+        memcpy(camera->lookAt, k[seg].lookAt, sizeof(vector3r));
+    }
+
+    camera->anchor = k[seg].anchor;
+}
+
+void deleteCameraPath(CameraPath* path)
+{
+    if (path == NULL)
+        return;
+
+    free(path->keyframes);
+    free(path->filename);
+    free(path);
+}
+
+#endif // CAMERA_PATH_H
@@ -36,6 +36,9 @@ typedef real_t vector2r[2];
 
 typedef ubyte_t vector3ub[3];
 
+// 4x4 matrix in column-major order (OpenGL's layout).
+typedef float matrix4f[16];
+
 
 float vectorLength3fv(vector3f v)
 {
@@ -108,11 +111,34 @@ char* strCat(int n_strings, ...)
     return result;
 }
 
+// Writes the string as a quoted JSON string literal, escaping it where needed.
+void fprintJsonString(FILE* fp, const char* string)
+{
+    fputc('"', fp);
+
+    for (const char* c = string; *c != '\0'; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            fprintf(fp, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            fprintf(fp, "\\u%04x", (unsigned int)(unsigned char)*c);
+        else
+            fputc(*c, fp);
+    }
+
+    fputc('"', fp);
+}
+
 real_t AUtoR(real_t au)
 {
     return au * 200.0;
 }
 
+real_t RtoAU(real_t r)
+{
+    return r / 200.0;
+}
+
 size_t getFileSizeInBytes(const char* filename)
 {
     FILE * fp;
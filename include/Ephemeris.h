@@ -0,0 +1,641 @@
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#if defined(_MSC_VER) && !defined(_USE_MATH_DEFINES)
+#   define _USE_MATH_DEFINES
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "JobSystem.h"
+#include "CustomTypes.h"
+#include "SystemBinary.h"
+#include "StellarCatalog.h"
+
+
+// Positions of a system's bodies at any time, evaluated in closed form the way the simulation moves
+// them (see `updateStellarObject`): every body goes around its parent on a circle, at a constant
+// angular velocity, from the angle -pi at the start of the simulation. Times are in days since the
+// start of the simulation and positions in AU. It has no OpenGL dependency, so that the
+// `export_ephemeris` tool can use it.
+//
+// Exported files are laid out as follows (native byte order):
+//
+//     EphemerisFileHeader
+//     int32_t  parent[n]            (index of the parent, always < own index; -1 for none)
+//     uint32_t nameOffset[n]        (into the string table)
+//     char     strings[]            (null-terminated names)
+//     blocks of `blockSteps` steps each (the last one may have fewer, m), from `firstBlockOffset` on:
+//         double time[m]
+//         double x[m], y[m], z[m]   of body 0, then of body 1, and so on
+//
+// i.e. columnar within each block, so that the track of a body over a block is contiguous. Blocks
+// are evaluated in parallel and written in order, each with a single call.
+
+#define EPHEMERIS_FILE_MAGIC "SEPH"
+#define EPHEMERIS_FILE_VERSION 1
+#define EPHEMERIS_FILE_BYTE_ORDER 0x01020304u
+#define EPHEMERIS_FILE_ALIGNMENT 16
+
+// Bytes per block, roughly.
+#define EPHEMERIS_BLOCK_BYTES (8 << 20)
+
+// Within a block, the bodies' angles are advanced by a rotation per step rather than evaluated from
+// scratch; this bounds the rounding error that accumulates.
+#define EPHEMERIS_MAX_BLOCK_STEPS 4096
+
+typedef enum EphemerisFormat
+{
+    EPHEMERIS_FORMAT_BINARY = 0,
+
+    // One `time,body,x,y,z` row per body and step; far larger and slower to write.
+    EPHEMERIS_FORMAT_CSV
+
+} EphemerisFormat;
+
+typedef struct EphemerisBody
+{
+    // Index of the parent, always lower than the body's own; -1 for none.
+    int parent;
+
+    // In rad/day.
+    double angularVelocity;
+
+    // Radius of the orbit, in AU.
+    double distance;
+
+    // Radius of the body itself, in AU.
+    double radius;
+
+    // Tilt of the orbit's plane, the parents' included, in degrees.
+    double globalTilt;
+
+    double cosGlobalTilt;
+    double sinGlobalTilt;
+
+} EphemerisBody;
+
+typedef struct Ephemeris
+{
+    EphemerisBody* bodies;
+
+    int numBodies;
+
+    // The names, one after the other, and where each one starts.
+    char* strings;
+    size_t stringsSize;
+
+    uint32_t* nameOffsets;
+
+} Ephemeris;
+
+typedef struct EphemerisFileHeader
+{
+    char magic[4];
+
+    uint32_t version;
+
+    // EPHEMERIS_FILE_BYTE_ORDER as written; tells apart files of another endianness.
+    uint32_t byteOrder;
+
+    uint32_t numBodies;
+
+    uint64_t numSteps;
+    uint64_t blockSteps;
+
+    // In days.
+    double startTime;
+    double step;
+
+    uint64_t stringsSize;
+    uint64_t firstBlockOffset;
+
+} EphemerisFileHeader;
+
+// A block of steps, evaluated (and, for CSV, formatted) by a job of its own.
+typedef struct EphemerisBlock
+{
+    const Ephemeris* ephemeris;
+
+    EphemerisFormat format;
+
+    double startTime;
+    double step;
+
+    uint64_t firstStep;
+    int numSteps;
+
+    // The block's columns, as laid out in the file, and their CSV rows.
+    double* columns;
+
+    char* text;
+    size_t textSize;
+
+    // Names as CSV fields, shared by the blocks.
+    const char* const* csvNames;
+
+    Job job;
+    JobCounter done;
+
+} EphemerisBlock;
+
+
+// Ephemeris constructor (heap-allocated) of `num_bodies` bodies named `names`; their orbits are set
+// with `setEphemerisBody`, parents first.
+Ephemeris* initEphemeris(int num_bodies, const char* const* names)
+{
+    Ephemeris* e = (Ephemeris *)malloc(sizeof(Ephemeris));
+
+    e->numBodies = num_bodies;
+    e->bodies = (EphemerisBody *)calloc((size_t)num_bodies + 1, sizeof(EphemerisBody));
+    e->nameOffsets = (uint32_t *)malloc(((size_t)num_bodies + 1) * sizeof(uint32_t));
+
+    e->stringsSize = 0;
+
+    for (int i = 0; i < num_bodies; ++i)
+        e->stringsSize += strlen(names[i]) + 1;
+
+    e->strings = (char *)malloc(e->stringsSize + 1);
+
+    size_t offset = 0;
+
+    for (int i = 0; i < num_bodies; ++i)
+    {
+        size_t length = strlen(names[i]) + 1;
+
+        memcpy(e->strings + offset, names[i], length);
+
+        e->nameOffsets[i] = (uint32_t)offset;
+        offset += length;
+    }
+
+    return e;
+}
+
+// Sets the orbit of body `i` from its catalog fields, as `getStellarObjectParameters` does.
+void setEphemerisBody(Ephemeris* e, int i, int parent, real_t radius, real_t orbit_period, real_t parent_distance, real_t solar_tilt)
+{
+    EphemerisBody* body = &e->bodies[i];
+
+    body->parent = parent;
+    body->radius = (double)radius;
+    body->angularVelocity = (orbit_period != (real_t).0 ? 2.0 * M_PI / (double)orbit_period : 0.0);
+    body->distance = (double)parent_distance;
+    body->globalTilt = (double)solar_tilt + (parent >= 0 ? e->bodies[parent].globalTilt : 0.0);
+
+    body->cosGlobalTilt = cos(body->globalTilt * (M_PI / 180.0));
+    body->sinGlobalTilt = sin(body->globalTilt * (M_PI / 180.0));
+}
+
+const char* getEphemerisName(const Ephemeris* e, int i)
+{
+    return e->strings + e->nameOffsets[i];
+}
+
+void deleteEphemeris(Ephemeris* e)
+{
+    if (e == NULL)
+        return;
+
+    free(e->strings);
+    free(e->nameOffsets);
+    free(e->bodies);
+    free(e);
+}
+
+// Ephemeris of the system in `data_dir` (which ends with a path separator), from its `data.bin` if
+// it has an up-to-date one, or else from its `data.json`. Returns NULL, after reporting the problem,
+// if neither can be read.
+Ephemeris* loadEphemeris(const char* data_dir)
+{
+    char* json_filename = strCat(2, data_dir, "data.json");
+    char* binary_filename = strCat(2, data_dir, "data.bin");
+
+    SystemBinary* b = openSystemBinary(binary_filename, json_filename);
+    StellarCatalog* c = (b == NULL ? parseStellarCatalog(json_filename, NULL, NULL) : NULL);
+
+    free(binary_filename);
+    free(json_filename);
+
+    if (b == NULL && c == NULL)
+        return NULL;
+
+    int n = (b != NULL ? b->numObjects : c->count);
+
+    const char** names = (const char **)calloc((size_t)n + 1, sizeof(const char *));
+
+    for (int i = 0; i < n; ++i)
+        names[i] = (b != NULL ? getSystemBinaryName(b, i) : getName(c->names, c->entries[i].nameId));
+
+    Ephemeris* e = initEphemeris(n, names);
+
+    free(names);
+
+    // Both list parents before their children.
+    for (int i = 0; i < n; ++i)
+    {
+        if (b != NULL)
+        {
+            setEphemerisBody(e, i, (int)b->parent[i], b->radius[i], b->orbitPeriod[i], b->parentDistance[i], b->solarTilt[i]);
+        }
+        else
+        {
+            const StellarCatalogEntry* entry = &c->entries[i];
+
+            setEphemerisBody(e, i, c->parents[i], entry->radius, entry->orbitPeriod, entry->parentDistance, entry->solarTilt);
+        }
+    }
+
+    closeSystemBinary(b);
+    deleteStellarCatalog(c);
+
+    return e;
+}
+
+// Angle of the body along its orbit at `time`, in [-pi, pi).
+double getEphemerisAngle(const EphemerisBody* body, double time)
+{
+    double angle = fmod(body->angularVelocity * time, 2.0 * M_PI);
+
+    if (angle < 0.0)
+        angle += 2.0 * M_PI;
+
+    return angle - M_PI;
+}
+
+// Position of every body at `time`, into `positions` (x, y and z of each body in turn).
+void evaluateEphemeris(const Ephemeris* e, double time, double* positions)
+{
+    for (int i = 0; i < e->numBodies; ++i)
+    {
+        const EphemerisBody* body = &e->bodies[i];
+
+        double angle = getEphemerisAngle(body, time);
+
+        double u = cos(angle) * body->distance;
+        double w = sin(angle) * body->distance;
+
+        double* p = &positions[3 * i];
+
+        p[0] = u * body->cosGlobalTilt;
+        p[1] = u * body->sinGlobalTilt;
+        p[2] = w;
+
+        if (body->parent >= 0)
+        {
+            const double* q = &positions[3 * body->parent];
+
+            p[0] += q[0];
+            p[1] += q[1];
+            p[2] += q[2];
+        }
+    }
+}
+
+// Position (AU) and velocity (AU/day) of body `i` alone at `time`, its ancestors' orbits included.
+void evaluateEphemerisState(const Ephemeris* e, int i, double time, double* position, double* velocity)
+{
+    memset(position, 0, 3 * sizeof(double));
+    memset(velocity, 0, 3 * sizeof(double));
+
+    for (int j = i; j >= 0; j = e->bodies[j].parent)
+    {
+        const EphemerisBody* body = &e->bodies[j];
+
+        double angle = getEphemerisAngle(body, time);
+
+        double c = cos(angle), s = sin(angle);
+
+        double u = c * body->distance;
+        double du = -s * body->distance * body->angularVelocity;
+
+        position[0] += u * body->cosGlobalTilt;
+        position[1] += u * body->sinGlobalTilt;
+        position[2] += s * body->distance;
+
+        velocity[0] += du * body->cosGlobalTilt;
+        velocity[1] += du * body->sinGlobalTilt;
+        velocity[2] += c * body->distance * body->angularVelocity;
+    }
+}
+
+// Evaluates `num_steps` steps, from step `first_step` of a range starting at `start_time`, into
+// `columns`: the times, followed by the x, y and z columns of each body (see the file layout).
+// Each body's angle is evaluated at the first step only, and then rotated by its constant
+// increment, so that the steps cost no trigonometry.
+void evaluateEphemerisBlock(const Ephemeris* e, double start_time, double step, uint64_t first_step, int num_steps, double* columns)
+{
+    size_t m = (size_t)num_steps;
+
+    for (size_t k = 0; k < m; ++k)
+        columns[k] = start_time + step * (double)(first_step + k);
+
+    for (int i = 0; i < e->numBodies; ++i)
+    {
+        const EphemerisBody* body = &e->bodies[i];
+
+        double* x = columns + (1 + 3 * (size_t)i) * m;
+        double* y = x + m;
+        double* z = y + m;
+
+        double angle = getEphemerisAngle(body, columns[0]);
+
+        double c = cos(angle), s = sin(angle);
+        double dc = cos(body->angularVelocity * step), ds = sin(body->angularVelocity * step);
+
+        for (size_t k = 0; k < m; ++k)
+        {
+            double u = c * body->distance;
+
+            x[k] = u * body->cosGlobalTilt;
+            y[k] = u * body->sinGlobalTilt;
+            z[k] = s * body->distance;
+
+            double next_c = c * dc - s * ds;
+
+            s = s * dc + c * ds;
+            c = next_c;
+        }
+
+        if (body->parent >= 0)
+        {
+            // Parents precede their children, so theirs are already in the block.
+            const double* parent_x = columns + (1 + 3 * (size_t)body->parent) * m;
+
+            for (size_t k = 0; k < 3 * m; ++k)
+                x[k] += parent_x[k];
+        }
+    }
+}
+
+// Longest CSV row of the ephemeris: the time and coordinates at "%.17g", and the longest name.
+size_t getEphemerisCSVRowSize(const char* const* csv_names, int num_bodies)
+{
+    size_t longest = 0;
+
+    for (int i = 0; i < num_bodies; ++i)
+    {
+        size_t length = strlen(csv_names[i]);
+
+        if (length > longest)
+            longest = length;
+    }
+
+    return 4 * 32 + longest + 8;
+}
+
+// A name as a CSV field (heap-allocated): quoted, with its quotes doubled.
+char* buildEphemerisCSVName(const char* name)
+{
+    size_t length = 2;
+
+    for (const char* c = name; *c != '\0'; ++c)
+        length += (*c == '"' ? 2 : 1);
+
+    char* field = (char *)malloc(length + 1);
+    char* out = field;
+
+    *out++ = '"';
+
+    for (const char* c = name; *c != '\0'; ++c)
+    {
+        if (*c == '"')
+            *out++ = '"';
+
+        *out++ = *c;
+    }
+
+    *out++ = '"';
+    *out = '\0';
+
+    return field;
+}
+
+void evaluateEphemerisBlockJob(void* data)
+{
+    EphemerisBlock* block = (EphemerisBlock *)data;
+
+    const Ephemeris* e = block->ephemeris;
+
+    evaluateEphemerisBlock(e, block->startTime, block->step, block->firstStep, block->numSteps, block->columns);
+
+    if (block->format != EPHEMERIS_FORMAT_CSV)
+        return;
+
+    // The text buffer fits the longest row for every body and step.
+    size_t m = (size_t)block->numSteps;
+    size_t row_size = getEphemerisCSVRowSize(block->csvNames, e->numBodies);
+
+    block->textSize = 0;
+
+    for (size_t k = 0; k < m; ++k)
+    {
+        for (int i = 0; i < e->numBodies; ++i)
+        {
+            const double* x = block->columns + (1 + 3 * (size_t)i) * m;
+
+            // (Adding zero turns the negative zeros of bodies at their parent's centre positive.)
+            block->textSize += (size_t)snprintf(
+                block->text + block->textSize, row_size, "%.17g,%s,%.17g,%.17g,%.17g\n",
+                block->columns[k], block->csvNames[i], x[k] + 0.0, x[m + k] + 0.0, x[2 * m + k] + 0.0
+            );
+        }
+    }
+}
+
+// Writes the header, parents and names of a binary export, padded up to its first block.
+bool writeEphemerisFileHeader(FILE* fp, const Ephemeris* e, double start_time, double step, uint64_t num_steps, uint64_t block_steps, uint64_t* offset)
+{
+    size_t n = (size_t)e->numBodies;
+
+    EphemerisFileHeader h;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, EPHEMERIS_FILE_MAGIC, 4);
+
+    h.version = EPHEMERIS_FILE_VERSION;
+    h.byteOrder = EPHEMERIS_FILE_BYTE_ORDER;
+    h.numBodies = (uint32_t)n;
+    h.numSteps = num_steps;
+    h.blockSteps = block_steps;
+    h.startTime = start_time;
+    h.step = step;
+    h.stringsSize = (uint64_t)e->stringsSize;
+
+    uint64_t size = sizeof(h) + n * sizeof(int32_t) + n * sizeof(uint32_t) + e->stringsSize;
+
+    h.firstBlockOffset = (size + EPHEMERIS_FILE_ALIGNMENT - 1) / EPHEMERIS_FILE_ALIGNMENT * EPHEMERIS_FILE_ALIGNMENT;
+
+    int32_t* parents = (int32_t *)malloc((n + 1) * sizeof(int32_t));
+
+    for (size_t i = 0; i < n; ++i)
+        parents[i] = (int32_t)e->bodies[i].parent;
+
+    static const char zeros[EPHEMERIS_FILE_ALIGNMENT] = { 0 };
+
+    bool ok = (
+        fwrite(&h, sizeof(h), 1, fp) == 1 &&
+        fwrite(parents, sizeof(int32_t), n, fp) == n &&
+        fwrite(e->nameOffsets, sizeof(uint32_t), n, fp) == n &&
+        fwrite(e->strings, 1, e->stringsSize, fp) == e->stringsSize &&
+        fwrite(zeros, 1, (size_t)(h.firstBlockOffset - size), fp) == (size_t)(h.firstBlockOffset - size)
+    );
+
+    free(parents);
+
+    *offset = h.firstBlockOffset;
+
+    return ok;
+}
+
+// Evaluates `num_steps` steps of `step` days from `start_time` on and writes them to `filename`, in
+// the given format. Blocks of steps are evaluated by the job system's workers, a few of them ahead,
+// while the calling thread writes the finished ones in order, straight from their buffers; the
+// export is thus bound by the disk rather than by the evaluation. Returns false, after reporting the
+// problem, if the file could not be written; `bytes_written` is set either way.
+bool exportEphemeris(
+    JobSystem* js, const Ephemeris* e, double start_time, double step, uint64_t num_steps,
+    const char* filename, EphemerisFormat format, uint64_t* bytes_written
+)
+{
+    *bytes_written = 0;
+
+    FILE* fp = fopen(filename, "wb");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error: Unable to create the ephemeris file \"%s\".\n", filename);
+        return false;
+    }
+
+    // Blocks are large enough as they are; stdio's buffer would only copy them once more.
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    size_t n = (size_t)e->numBodies;
+    size_t step_bytes = (1 + 3 * n) * sizeof(double);
+
+    uint64_t block_steps = EPHEMERIS_BLOCK_BYTES / step_bytes;
+
+    if (block_steps < 1)
+        block_steps = 1;
+    if (block_steps > EPHEMERIS_MAX_BLOCK_STEPS)
+        block_steps = EPHEMERIS_MAX_BLOCK_STEPS;
+    if (block_steps > num_steps)
+        block_steps = (num_steps > 0 ? num_steps : 1);
+
+    uint64_t num_blocks = (num_steps + block_steps - 1) / block_steps;
+
+    bool ok;
+
+    char** csv_names = NULL;
+    size_t row_size = 0;
+
+    if (format == EPHEMERIS_FORMAT_CSV)
+    {
+        csv_names = (char **)malloc((n + 1) * sizeof(char *));
+
+        for (size_t i = 0; i < n; ++i)
+            csv_names[i] = buildEphemerisCSVName(getEphemerisName(e, (int)i));
+
+        row_size = getEphemerisCSVRowSize((const char* const*)csv_names, (int)n);
+
+        static const char* csv_header = "time,body,x,y,z\n";
+
+        ok = (fwrite(csv_header, 1, strlen(csv_header), fp) == strlen(csv_header));
+
+        *bytes_written = strlen(csv_header);
+    }
+    else
+    {
+        ok = writeEphemerisFileHeader(fp, e, start_time, step, num_steps, block_steps, bytes_written);
+    }
+
+    // Enough blocks in flight to keep every worker busy while the previous ones are written.
+    uint64_t num_slots = 2 * (uint64_t)getJobThreadCount(js);
+
+    if (num_slots > num_blocks)
+        num_slots = (num_blocks > 0 ? num_blocks : 1);
+
+    EphemerisBlock* blocks = (EphemerisBlock *)calloc((size_t)num_slots, sizeof(EphemerisBlock));
+
+    for (uint64_t s = 0; s < num_slots; ++s)
+    {
+        EphemerisBlock* block = &blocks[s];
+
+        block->ephemeris = e;
+        block->format = format;
+        block->startTime = start_time;
+        block->step = step;
+        block->csvNames = (const char* const*)csv_names;
+        block->columns = (double *)malloc((size_t)block_steps * step_bytes);
+        block->text = (format == EPHEMERIS_FORMAT_CSV ? (char *)malloc((size_t)block_steps * n * row_size + 1) : NULL);
+
+        block->job.function = evaluateEphemerisBlockJob;
+        block->job.data = block;
+
+        initJobCounter(&block->done);
+    }
+
+    for (uint64_t b = 0; b < num_blocks + num_slots; ++b)
+    {
+        EphemerisBlock* block = &blocks[b % num_slots];
+
+        // The slot's previous block is the oldest one in flight, hence the next one to be written.
+        if (block->numSteps > 0)
+        {
+            waitForJobs(js, &block->done);
+
+            const void* data = (format == EPHEMERIS_FORMAT_CSV ? (const void *)block->text : (const void *)block->columns);
+            size_t size = (format == EPHEMERIS_FORMAT_CSV ? block->textSize : (size_t)block->numSteps * step_bytes);
+
+            if (ok && fwrite(data, 1, size, fp) != size)
+            {
+                fprintf(stderr, "Error: Unable to write the ephemeris file \"%s\"; Is the disk full?\n", filename);
+                ok = false;
+            }
+
+            if (ok)
+                *bytes_written += size;
+
+            block->numSteps = 0;
+        }
+
+        if (b < num_blocks && ok)
+        {
+            block->firstStep = b * block_steps;
+            block->numSteps = (int)(num_steps - block->firstStep < block_steps ? num_steps - block->firstStep : block_steps);
+
+            submitBackgroundJob(js, &block->job, &block->done);
+        }
+    }
+
+    for (uint64_t s = 0; s < num_slots; ++s)
+    {
+        free(blocks[s].columns);
+        free(blocks[s].text);
+    }
+    free(blocks);
+
+    for (size_t i = 0; i < n && csv_names != NULL; ++i)
+        free(csv_names[i]);
+    free(csv_names);
+
+    if (fclose(fp) != 0 && ok)
+    {
+        fprintf(stderr, "Error: Unable to write the ephemeris file \"%s\".\n", filename);
+        ok = false;
+    }
+
+    return ok;
+}
+
+#endif // EPHEMERIS_H
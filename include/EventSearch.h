@@ -0,0 +1,788 @@
+#ifndef EVENT_SEARCH_H
+#define EVENT_SEARCH_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#if defined(_MSC_VER) && !defined(_USE_MATH_DEFINES)
+#   define _USE_MATH_DEFINES
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "Ephemeris.h"
+#include "JobSystem.h"
+#include "CustomTypes.h"
+
+
+// Searches a range of simulated time for events between the bodies of an ephemeris (see
+// `Ephemeris.h`):
+//  - close approaches: two bodies pass within a distance of each other;
+//  - conjunctions and oppositions: two bodies line up as seen from a third, the observer, on the
+//    same side or on opposite sides of it, within an angle. A conjunction in which the nearer body
+//    covers the farther one's disc is an occultation (e.g. a solar eclipse, seen from the Earth); an
+//    opposition in which the nearer body enters the observer's shadow is an eclipse (e.g. a lunar
+//    eclipse, seen from the Earth).
+//
+// Every event is a local minimum, in time, of a quantity of the pair: the distance between the
+// bodies, or the chord between their directions as seen from the observer. Each pair is stepped
+// through the range, by bounds on how fast that quantity can change: the step skips ahead as far as
+// the quantity cannot reach the threshold, and shrinks to a fraction of the shortest orbital period
+// involved near it. A minimum is bracketed by a change of sign of the quantity's derivative, which
+// is evaluated analytically, and then refined to the root of the derivative. The range is split in
+// windows that are searched in parallel by the job system.
+//
+// Candidate pairs for close approaches are pruned beforehand with a sweep over the bodies' orbit
+// bounds: the shell of distances from their system's centre that each body can be at. All pairs of
+// the selected bodies are searched for alignments.
+
+// Minimum step, as a fraction of the shortest orbital period that a pair's quantity depends on.
+#define EVENT_SEARCH_STEP_FRACTION (1.0 / 32.0)
+
+// Precision of the events' times, in days.
+#define EVENT_SEARCH_TIME_TOLERANCE 1e-9
+
+#define EVENT_SEARCH_MAX_ITERATIONS 100
+
+// Windows the range is split in, per thread.
+#define EVENT_SEARCH_WINDOWS_PER_THREAD 4
+
+typedef enum EventType
+{
+    EVENT_CLOSE_APPROACH = 0,
+    EVENT_CONJUNCTION,
+    EVENT_OCCULTATION,
+    EVENT_OPPOSITION,
+    EVENT_ECLIPSE,
+    EVENT_NUM_TYPES
+
+} EventType;
+
+const char* const event_type_names[EVENT_NUM_TYPES] = {
+    "close_approach",
+    "conjunction",
+    "occultation",
+    "opposition",
+    "eclipse"
+};
+
+typedef struct EventQuery
+{
+    // In days.
+    double startTime;
+    double endTime;
+
+    // Close approaches within this distance (AU) are searched for, unless it is 0.
+    double approachDistance;
+
+    // Alignments seen from this body, within this angle (degrees), are searched for, unless it is -1.
+    int observer;
+    double alignmentAngle;
+
+    // Which bodies take part in the search; NULL for all of them.
+    const bool* selected;
+
+} EventQuery;
+
+typedef struct Event
+{
+    EventType type;
+
+    // For alignments: -1 otherwise.
+    int observer;
+
+    // In order of the pair, except for occultations (the covered body, then the one in front) and
+    // eclipses (the body casting the light, then the one in the shadow).
+    int bodies[2];
+
+    // In days.
+    double time;
+
+    // Distance (AU) of close approaches; for alignments, angle (degrees) away from an exact one.
+    double value;
+
+} Event;
+
+typedef struct EventList
+{
+    Event* events;
+
+    int count;
+    int capacity;
+
+} EventList;
+
+typedef enum EventPairKind
+{
+    EVENT_PAIR_APPROACH = 0,
+    EVENT_PAIR_CONJUNCTION,
+    EVENT_PAIR_OPPOSITION
+
+} EventPairKind;
+
+// A pair of bodies to search, and the bounds that its steps are based on.
+typedef struct EventPair
+{
+    EventPairKind kind;
+
+    int bodies[2];
+
+    // Bounds on the speed (AU/day) of each body relative to the observer for alignments; of the
+    // first body relative to the second for close approaches.
+    double speeds[2];
+
+    // In days.
+    double minStep;
+
+} EventPair;
+
+// A pair's quantity at an instant, with its time derivative, and the bodies' distances from the
+// observer (for alignments).
+typedef struct EventSample
+{
+    double value;
+    double derivative;
+
+    double distances[2];
+
+} EventSample;
+
+typedef struct EventSearchArgs
+{
+    const Ephemeris* ephemeris;
+    const EventQuery* query;
+
+    const EventPair* pairs;
+    int numPairs;
+
+    // One list per window.
+    EventList* lists;
+    int numWindows;
+
+} EventSearchArgs;
+
+
+void initEventList(EventList* list)
+{
+    list->events = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+void addEvent(EventList* list, const Event* event)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = (list->capacity > 0 ? 2 * list->capacity : 16);
+        list->events = (Event *)realloc(list->events, (size_t)list->capacity * sizeof(Event));
+    }
+    list->events[list->count++] = *event;
+}
+
+// Events constructor (heap-allocated).
+EventList* initEvents(void)
+{
+    EventList* list = (EventList *)malloc(sizeof(EventList));
+
+    initEventList(list);
+
+    return list;
+}
+
+void deleteEvents(EventList* list)
+{
+    if (list == NULL)
+        return;
+
+    free(list->events);
+    free(list);
+}
+
+int getEphemerisDepth(const Ephemeris* e, int i)
+{
+    int depth = 0;
+
+    for (int j = e->bodies[i].parent; j >= 0; j = e->bodies[j].parent)
+        depth += 1;
+
+    return depth;
+}
+
+// Bounds how fast body `a` can move relative to body `b` (AU/day), and finds the shortest period of
+// the orbits that separate them (days; INFINITY if none of them moves): those from either body up
+// to their common ancestor, which move both alike.
+void getEphemerisRelativeMotion(const Ephemeris* e, int a, int b, double* speed, double* period)
+{
+    *speed = 0.0;
+    *period = (double)INFINITY;
+
+    int depth_a = getEphemerisDepth(e, a);
+    int depth_b = getEphemerisDepth(e, b);
+
+    while (a != b)
+    {
+        int* i = (depth_a >= depth_b ? &a : &b);
+        int* depth = (depth_a >= depth_b ? &depth_a : &depth_b);
+
+        const EphemerisBody* body = &e->bodies[*i];
+
+        double velocity = fabs(body->angularVelocity) * body->distance;
+
+        if (velocity > 0.0)
+        {
+            *speed += velocity;
+
+            if (2.0 * M_PI / fabs(body->angularVelocity) < *period)
+                *period = 2.0 * M_PI / fabs(body->angularVelocity);
+        }
+
+        *i = body->parent;
+        *depth -= 1;
+    }
+}
+
+// Lowest and highest distances from their root's centre that each body can be at, in turn.
+double* getEphemerisShells(const Ephemeris* e)
+{
+    double* shells = (double *)malloc(((size_t)e->numBodies + 1) * 2 * sizeof(double));
+
+    // Parents precede their children.
+    for (int i = 0; i < e->numBodies; ++i)
+    {
+        const EphemerisBody* body = &e->bodies[i];
+
+        double low = 0.0, high = 0.0;
+
+        if (body->parent >= 0)
+        {
+            low = shells[2 * body->parent];
+            high = shells[2 * body->parent + 1];
+        }
+
+        // Around a parent anywhere in [low, high], at `distance` from it.
+        shells[2 * i] = (body->distance > high ? body->distance - high : (low > body->distance ? low - body->distance : 0.0));
+        shells[2 * i + 1] = high + body->distance;
+    }
+
+    return shells;
+}
+
+typedef struct EventShellBound
+{
+    int body;
+    double low;
+    double high;
+
+} EventShellBound;
+
+int compareEventShellBounds(const void* a, const void* b)
+{
+    double x = ((const EventShellBound *)a)->low;
+    double y = ((const EventShellBound *)b)->low;
+
+    return (x < y ? -1 : (x > y ? 1 : 0));
+}
+
+bool isEventBodySelected(const EventQuery* q, int i)
+{
+    return (q->selected == NULL || q->selected[i]);
+}
+
+void addEventPair(EventPair** pairs, int* num_pairs, int* capacity, const EventPair* pair)
+{
+    if (*num_pairs == *capacity)
+    {
+        *capacity = (*capacity > 0 ? 2 * *capacity : 64);
+        *pairs = (EventPair *)realloc(*pairs, (size_t)*capacity * sizeof(EventPair));
+    }
+    (*pairs)[(*num_pairs)++] = *pair;
+}
+
+// The pairs to search for the query (heap-allocated).
+EventPair* buildEventPairs(const Ephemeris* e, const EventQuery* q, int* num_pairs)
+{
+    EventPair* pairs = NULL;
+    int capacity = 0;
+
+    *num_pairs = 0;
+
+    if (q->approachDistance > 0.0)
+    {
+        // Sweep and prune: bodies sorted by the inner bound of their shell, and each one paired with
+        // the bodies before it whose shell reaches its own, within the distance.
+        double* shells = getEphemerisShells(e);
+
+        EventShellBound* bounds = (EventShellBound *)malloc(((size_t)e->numBodies + 1) * sizeof(EventShellBound));
+
+        int n = 0;
+
+        for (int i = 0; i < e->numBodies; ++i)
+        {
+            if (isEventBodySelected(q, i))
+            {
+                bounds[n].body = i;
+                bounds[n].low = shells[2 * i] - 0.5 * q->approachDistance;
+                bounds[n].high = shells[2 * i + 1] + 0.5 * q->approachDistance;
+                n += 1;
+            }
+        }
+
+        qsort(bounds, (size_t)n, sizeof(EventShellBound), compareEventShellBounds);
+
+        // Bodies whose shell may still reach the next ones.
+        int* active = (int *)malloc(((size_t)n + 1) * sizeof(int));
+        int num_active = 0;
+
+        for (int k = 0; k < n; ++k)
+        {
+            int kept = 0;
+
+            for (int j = 0; j < num_active; ++j)
+            {
+                const EventShellBound* other = &bounds[active[j]];
+
+                if (other->high < bounds[k].low)
+                    continue;
+
+                active[kept++] = active[j];
+
+                int a = other->body, b = bounds[k].body;
+
+                // A body stays at the same distance from its parent.
+                if (e->bodies[a].parent == b || e->bodies[b].parent == a)
+                    continue;
+
+                EventPair pair;
+
+                pair.kind = EVENT_PAIR_APPROACH;
+                pair.bodies[0] = (a < b ? a : b);
+                pair.bodies[1] = (a < b ? b : a);
+                pair.speeds[1] = 0.0;
+
+                double period;
+
+                getEphemerisRelativeMotion(e, a, b, &pair.speeds[0], &period);
+
+                if (pair.speeds[0] > 0.0)
+                {
+                    pair.minStep = period * EVENT_SEARCH_STEP_FRACTION;
+                    addEventPair(&pairs, num_pairs, &capacity, &pair);
+                }
+            }
+
+            num_active = kept;
+            active[num_active++] = k;
+        }
+
+        free(active);
+        free(bounds);
+        free(shells);
+    }
+
+    if (q->observer >= 0 && q->alignmentAngle > 0.0)
+    {
+        for (int a = 0; a < e->numBodies; ++a)
+        {
+            for (int b = a + 1; b < e->numBodies; ++b)
+            {
+                if (a == q->observer || b == q->observer || !isEventBodySelected(q, a) || !isEventBodySelected(q, b))
+                    continue;
+
+                EventPair pair;
+
+                pair.bodies[0] = a;
+                pair.bodies[1] = b;
+
+                double period_a, period_b;
+
+                getEphemerisRelativeMotion(e, a, q->observer, &pair.speeds[0], &period_a);
+                getEphemerisRelativeMotion(e, b, q->observer, &pair.speeds[1], &period_b);
+
+                if (pair.speeds[0] == 0.0 && pair.speeds[1] == 0.0)
+                    continue;
+
+                pair.minStep = (period_a < period_b ? period_a : period_b) * EVENT_SEARCH_STEP_FRACTION;
+
+                pair.kind = EVENT_PAIR_CONJUNCTION;
+                addEventPair(&pairs, num_pairs, &capacity, &pair);
+
+                pair.kind = EVENT_PAIR_OPPOSITION;
+                addEventPair(&pairs, num_pairs, &capacity, &pair);
+            }
+        }
+    }
+
+    return pairs;
+}
+
+double dotEventVectors(const double* u, const double* v)
+{
+    return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+}
+
+// Evaluates the pair's quantity at `time`: the distance between the bodies for close approaches;
+// the chord between the directions of the bodies seen from the observer for conjunctions, and
+// between one of them and the opposite of the other for oppositions.
+void sampleEventPair(const Ephemeris* e, const EventQuery* q, const EventPair* pair, double time, EventSample* sample)
+{
+    double p[2][3], v[2][3];
+
+    for (int k = 0; k < 2; ++k)
+        evaluateEphemerisState(e, pair->bodies[k], time, p[k], v[k]);
+
+    if (pair->kind == EVENT_PAIR_APPROACH)
+    {
+        double r[3], dr[3];
+
+        for (int a = 0; a < 3; ++a)
+        {
+            r[a] = p[1][a] - p[0][a];
+            dr[a] = v[1][a] - v[0][a];
+        }
+
+        sample->value = sqrt(dotEventVectors(r, r));
+        sample->derivative = (sample->value > 0.0 ? dotEventVectors(r, dr) / sample->value : 0.0);
+        sample->distances[0] = sample->distances[1] = sample->value;
+        return;
+    }
+
+    double o[3], vo[3];
+
+    evaluateEphemerisState(e, q->observer, time, o, vo);
+
+    // Unit directions from the observer, and their derivatives.
+    double u[2][3], du[2][3];
+
+    for (int k = 0; k < 2; ++k)
+    {
+        double r[3], dr[3];
+
+        for (int a = 0; a < 3; ++a)
+        {
+            r[a] = p[k][a] - o[a];
+            dr[a] = v[k][a] - vo[a];
+        }
+
+        double length = sqrt(dotEventVectors(r, r));
+
+        sample->distances[k] = length;
+
+        if (length == 0.0)
+            length = 1.0;
+
+        for (int a = 0; a < 3; ++a)
+            u[k][a] = r[a] / length;
+
+        double radial = dotEventVectors(u[k], dr);
+
+        for (int a = 0; a < 3; ++a)
+            du[k][a] = (dr[a] - u[k][a] * radial) / length;
+    }
+
+    double sign = (pair->kind == EVENT_PAIR_OPPOSITION ? 1.0 : -1.0);
+
+    double chord[3], d_chord[3];
+
+    for (int a = 0; a < 3; ++a)
+    {
+        chord[a] = u[0][a] + sign * u[1][a];
+        d_chord[a] = du[0][a] + sign * du[1][a];
+    }
+
+    sample->value = sqrt(dotEventVectors(chord, chord));
+    sample->derivative = (sample->value > 0.0 ? dotEventVectors(chord, d_chord) / sample->value : 0.0);
+}
+
+// How far ahead of a sample the pair's quantity cannot have come down to `threshold`.
+double getEventPairReach(const EventPair* pair, const EventSample* sample, double threshold)
+{
+    double margin = sample->value - threshold;
+
+    if (margin <= 0.0)
+        return 0.0;
+
+    if (pair->kind == EVENT_PAIR_APPROACH)
+        return margin / pair->speeds[0];
+
+    // A chord changes at most as fast as both directions turn, which is bounded for as long as the
+    // bodies are no closer than half their current distance to the observer.
+    double reach = (double)INFINITY;
+    double rate = 0.0;
+
+    for (int k = 0; k < 2; ++k)
+    {
+        if (pair->speeds[k] == 0.0)
+            continue;
+
+        if (sample->distances[k] / (2.0 * pair->speeds[k]) < reach)
+            reach = sample->distances[k] / (2.0 * pair->speeds[k]);
+
+        rate += 2.0 * pair->speeds[k] / sample->distances[k];
+    }
+
+    return (margin / rate < reach ? margin / rate : reach);
+}
+
+// Refines the minimum of the pair's quantity bracketed by [begin, end], over which its derivative
+// goes from negative to non-negative (Illinois variant of the false position method).
+double refineEventPair(const Ephemeris* e, const EventQuery* q, const EventPair* pair, double begin, double end, double f_begin, double f_end)
+{
+    int side = 0;
+
+    double t = begin;
+
+    for (int i = 0; i < EVENT_SEARCH_MAX_ITERATIONS && end - begin > EVENT_SEARCH_TIME_TOLERANCE; ++i)
+    {
+        t = (f_end - f_begin != 0.0 ? begin - f_begin * (end - begin) / (f_end - f_begin) : 0.5 * (begin + end));
+
+        if (!(t > begin && t < end))
+            t = 0.5 * (begin + end);
+
+        EventSample sample;
+        sampleEventPair(e, q, pair, t, &sample);
+
+        if (sample.derivative < 0.0)
+        {
+            begin = t;
+            f_begin = sample.derivative;
+
+            if (side == -1)
+                f_end *= 0.5;
+            side = -1;
+        }
+        else
+        {
+            end = t;
+            f_end = sample.derivative;
+
+            if (side == 1)
+                f_begin *= 0.5;
+            side = 1;
+        }
+    }
+
+    return 0.5 * (begin + end);
+}
+
+// Classifies an alignment at its minimum and adds it to the list.
+void addEventAlignment(const Ephemeris* e, const EventQuery* q, const EventPair* pair, double time, const EventSample* sample, EventList* list)
+{
+    Event event;
+
+    event.observer = q->observer;
+    event.time = time;
+    event.bodies[0] = pair->bodies[0];
+    event.bodies[1] = pair->bodies[1];
+
+    // Chord between the directions, as an angle.
+    double separation = 2.0 * asin(fmin(sample->value * 0.5, 1.0)) * (180.0 / M_PI);
+
+    int near = (sample->distances[0] <= sample->distances[1] ? 0 : 1);
+    int far = 1 - near;
+
+    double distance_near = sample->distances[near];
+    double distance_far = sample->distances[far];
+
+    // Apparent radii (degrees) of the bodies, and of the observer seen from them.
+    double radius_near = asin(fmin(e->bodies[pair->bodies[near]].radius / distance_near, 1.0)) * (180.0 / M_PI);
+    double radius_far = asin(fmin(e->bodies[pair->bodies[far]].radius / distance_far, 1.0)) * (180.0 / M_PI);
+
+    double parallax_near = asin(fmin(e->bodies[q->observer].radius / distance_near, 1.0)) * (180.0 / M_PI);
+    double parallax_far = asin(fmin(e->bodies[q->observer].radius / distance_far, 1.0)) * (180.0 / M_PI);
+
+    if (pair->kind == EVENT_PAIR_CONJUNCTION)
+    {
+        event.type = EVENT_CONJUNCTION;
+        event.value = separation;
+
+        if (separation < radius_near + radius_far)
+        {
+            event.type = EVENT_OCCULTATION;
+            event.bodies[0] = pair->bodies[far];
+            event.bodies[1] = pair->bodies[near];
+        }
+    }
+    else
+    {
+        event.type = EVENT_OPPOSITION;
+        event.value = separation;
+
+        // Whether the nearer body is within the penumbra that the observer casts, lit by the farther.
+        if (separation < radius_near + parallax_near + parallax_far + radius_far)
+        {
+            event.type = EVENT_ECLIPSE;
+            event.bodies[0] = pair->bodies[far];
+            event.bodies[1] = pair->bodies[near];
+        }
+    }
+
+    addEvent(list, &event);
+}
+
+// Searches a pair over [begin, end) (or [begin, end] for the last window).
+void searchEventPair(const Ephemeris* e, const EventQuery* q, const EventPair* pair, double begin, double end, EventList* list)
+{
+    double threshold = (
+        pair->kind == EVENT_PAIR_APPROACH ? q->approachDistance :
+        2.0 * sin(q->alignmentAngle * (M_PI / 360.0))
+    );
+
+    bool last = (end >= q->endTime);
+
+    double t = begin;
+
+    EventSample sample;
+    sampleEventPair(e, q, pair, t, &sample);
+
+    while (t < end)
+    {
+        double step = getEventPairReach(pair, &sample, threshold);
+
+        if (step < pair->minStep)
+            step = pair->minStep;
+
+        double next_t = (t + step < end ? t + step : end);
+
+        EventSample next;
+        sampleEventPair(e, q, pair, next_t, &next);
+
+        if (sample.derivative < 0.0 && next.derivative >= 0.0)
+        {
+            double time = refineEventPair(e, q, pair, t, next_t, sample.derivative, next.derivative);
+
+            EventSample minimum;
+            sampleEventPair(e, q, pair, time, &minimum);
+
+            if (minimum.value <= threshold && (time < end || last))
+            {
+                if (pair->kind == EVENT_PAIR_APPROACH)
+                {
+                    Event event = { EVENT_CLOSE_APPROACH, -1, { pair->bodies[0], pair->bodies[1] }, time, minimum.value };
+                    addEvent(list, &event);
+                }
+                else
+                {
+                    addEventAlignment(e, q, pair, time, &minimum, list);
+                }
+            }
+        }
+
+        t = next_t;
+        sample = next;
+    }
+}
+
+void searchEventWindowRange(void* data, int begin, int end)
+{
+    const EventSearchArgs* args = (const EventSearchArgs *)data;
+
+    const EventQuery* q = args->query;
+
+    double duration = q->endTime - q->startTime;
+
+    for (int w = begin; w < end; ++w)
+    {
+        double window_begin = q->startTime + duration * (double)w / (double)args->numWindows;
+        double window_end = (w + 1 < args->numWindows ? q->startTime + duration * (double)(w + 1) / (double)args->numWindows : q->endTime);
+
+        for (int i = 0; i < args->numPairs; ++i)
+            searchEventPair(args->ephemeris, q, &args->pairs[i], window_begin, window_end, &args->lists[w]);
+    }
+}
+
+int compareEvents(const void* a, const void* b)
+{
+    const Event* x = (const Event *)a;
+    const Event* y = (const Event *)b;
+
+    if (x->time != y->time)
+        return (x->time < y->time ? -1 : 1);
+    if (x->type != y->type)
+        return (int)x->type - (int)y->type;
+    if (x->bodies[0] != y->bodies[0])
+        return x->bodies[0] - y->bodies[0];
+
+    return x->bodies[1] - y->bodies[1];
+}
+
+// Searches the query's range for its events, in parallel over windows of time. Returns the events
+// (heap-allocated) in chronological order.
+EventList* searchEvents(JobSystem* js, const Ephemeris* e, const EventQuery* q)
+{
+    EventSearchArgs args;
+
+    args.ephemeris = e;
+    args.query = q;
+    args.pairs = buildEventPairs(e, q, &args.numPairs);
+    args.numWindows = EVENT_SEARCH_WINDOWS_PER_THREAD * getJobThreadCount(js);
+    args.lists = (EventList *)malloc((size_t)args.numWindows * sizeof(EventList));
+
+    for (int w = 0; w < args.numWindows; ++w)
+        initEventList(&args.lists[w]);
+
+    if (args.numPairs > 0 && q->endTime > q->startTime)
+        parallelFor(js, 0, args.numWindows, 1, searchEventWindowRange, &args);
+
+    EventList* events = initEvents();
+
+    for (int w = 0; w < args.numWindows; ++w)
+    {
+        for (int i = 0; i < args.lists[w].count; ++i)
+            addEvent(events, &args.lists[w].events[i]);
+
+        free(args.lists[w].events);
+    }
+
+    qsort(events->events, (size_t)events->count, sizeof(Event), compareEvents);
+
+    free(args.lists);
+    free((EventPair *)args.pairs);
+
+    return events;
+}
+
+// Writes the events as a JSON document.
+void writeEventsJson(FILE* fp, const Ephemeris* e, const EventQuery* q, const EventList* events, const char* system_dir)
+{
+    fprintf(fp, "{\n");
+    fprintf(fp, "    \"system\" : ");
+    fprintJsonString(fp, system_dir);
+    fprintf(fp, ",\n");
+    fprintf(fp, "    \"start_time\" : %.9lf,\n", q->startTime);
+    fprintf(fp, "    \"end_time\" : %.9lf,\n", q->endTime);
+    fprintf(fp, "    \"events\" : [");
+
+    for (int i = 0; i < events->count; ++i)
+    {
+        const Event* event = &events->events[i];
+
+        fprintf(fp, "%s\n        { \"type\" : \"%s\", ", (i > 0 ? "," : ""), event_type_names[event->type]);
+
+        if (event->observer >= 0)
+        {
+            fprintf(fp, "\"observer\" : ");
+            fprintJsonString(fp, getEphemerisName(e, event->observer));
+            fprintf(fp, ", ");
+        }
+
+        fprintf(fp, "\"bodies\" : [ ");
+        fprintJsonString(fp, getEphemerisName(e, event->bodies[0]));
+        fprintf(fp, ", ");
+        fprintJsonString(fp, getEphemerisName(e, event->bodies[1]));
+        fprintf(fp, " ], \"time\" : %.9lf, ", event->time);
+
+        if (event->type == EVENT_CLOSE_APPROACH)
+            fprintf(fp, "\"distance\" : %.12lg }", event->value);
+        else
+            fprintf(fp, "\"separation\" : %.9lf }", event->value);
+    }
+
+    fprintf(fp, "%s]\n}\n", (events->count > 0 ? "\n    " : ""));
+}
+
+#endif // EVENT_SEARCH_H
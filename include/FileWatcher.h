@@ -0,0 +1,162 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__linux__)
+#   include <errno.h>
+#   include <unistd.h>
+#   include <sys/inotify.h>
+#endif
+
+#include "Timer.h"
+#include "MappedFile.h"
+#include "CustomTypes.h"
+
+
+// Non-blocking detection of changes to a single file. On Linux, the file's directory is watched
+// through inotify, which also catches editors that save by writing a new file and renaming it over
+// the old one; elsewhere (or if inotify is unavailable), the file's size and modification time are
+// compared every `FILE_WATCHER_POLL_MILLIS` instead.
+
+#define FILE_WATCHER_POLL_MILLIS 500
+
+typedef struct FileWatcher
+{
+    char* filename;
+
+    // Points into `filename`, past its directory.
+    const char* baseName;
+
+    // inotify instance watching the file's directory; -1 when polling.
+    int fd;
+
+    // The file's stamp when last polled (see `getFileStamp`); a size of UINT64_MAX if it was missing.
+    uint64_t size;
+    int64_t mtime;
+
+    uint64_t lastPollMillis;
+
+} FileWatcher;
+
+
+// File watcher constructor (heap-allocated). `directory` must end with a path separator, as the
+// system directories given to the simulation do.
+FileWatcher* initFileWatcher(const char* directory, const char* name)
+{
+    FileWatcher* w = (FileWatcher *)malloc(sizeof(FileWatcher));
+
+    w->filename = strCat(2, directory, name);
+    w->baseName = w->filename + strlen(directory);
+
+    w->fd = -1;
+
+    if (!getFileStamp(w->filename, &w->size, &w->mtime))
+    {
+        w->size = UINT64_MAX;
+        w->mtime = 0;
+    }
+
+    w->lastPollMillis = getAbsoluteTimeMillis();
+
+#if defined(__linux__)
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (w->fd >= 0)
+    {
+        char* watched = strBuild(directory[0] != '\0' ? directory : "./");
+
+        if (inotify_add_watch(w->fd, watched, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+        {
+            close(w->fd);
+            w->fd = -1;
+        }
+
+        free(watched);
+    }
+
+    if (w->fd < 0)
+        fprintf(stderr, "Warning: Unable to watch \"%s\" (%s); Polling it instead.\n", directory, strerror(errno));
+#endif
+
+    return w;
+}
+
+// Returns true if the file has been written, replaced or created since the last call. Never blocks.
+bool hasFileChanged(FileWatcher* w)
+{
+    bool changed = false;
+
+#if defined(__linux__)
+    if (w->fd >= 0)
+    {
+        // Events are variable-sized; the buffer holds at least one with the longest name.
+        char buffer[16 * (sizeof(struct inotify_event) + 256)] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+        ssize_t length;
+
+        while ((length = read(w->fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (ssize_t offset = 0; offset < length; )
+            {
+                const struct inotify_event* event = (const struct inotify_event *)(buffer + offset);
+
+                if (event->len > 0 && strcmp(event->name, w->baseName) == 0)
+                    changed = true;
+
+                offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+            }
+        }
+
+        return changed;
+    }
+#endif
+
+    uint64_t now = getAbsoluteTimeMillis();
+
+    if (now - w->lastPollMillis < FILE_WATCHER_POLL_MILLIS)
+        return false;
+
+    w->lastPollMillis = now;
+
+    uint64_t size;
+    int64_t mtime;
+
+    if (!getFileStamp(w->filename, &size, &mtime))
+    {
+        size = UINT64_MAX;
+        mtime = 0;
+    }
+
+    changed = (size != w->size || mtime != w->mtime);
+
+    w->size = size;
+    w->mtime = mtime;
+
+    // A file that has just disappeared (e.g. mid-save) is not reported until it is back.
+    return (changed && size != UINT64_MAX);
+}
+
+void deleteFileWatcher(FileWatcher* w)
+{
+    if (w == NULL)
+        return;
+
+#if defined(__linux__)
+    if (w->fd >= 0)
+        close(w->fd);
+#endif
+
+    free(w->filename);
+    free(w);
+}
+
+#endif // FILE_WATCHER_H
@@ -0,0 +1,129 @@
+#ifndef IMAGE_FORMATS_H
+#define IMAGE_FORMATS_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "MappedFile.h"
+#include "PngImages.h"
+#include "JpegImages.h"
+#include "CustomTypes.h"
+#include "BitmapImages.h"
+
+
+// Image loading front-end. The format is detected from the file's header rather than from its
+// extension (e.g. a PNG image named `*.jpg` is still read as PNG). Bitmaps keep being used in
+// place (see `BitmapImages.h`); JPEG and PNG images are decoded from the mapped file straight into
+// an upload-ready `BitmapImage`, and the file is unmapped right after.
+
+typedef enum ImageFormat
+{
+    IMAGE_FORMAT_UNKNOWN,
+    IMAGE_FORMAT_BMP,
+    IMAGE_FORMAT_JPEG,
+    IMAGE_FORMAT_PNG
+
+} ImageFormat;
+
+// Extensions tried, in order, by `findImageFile` for names given without one.
+const char* image_extensions[] = { ".jpg", ".jpeg", ".png", ".bmp" };
+
+#define NUM_IMAGE_EXTENSIONS (int)(sizeof(image_extensions) / sizeof(image_extensions[0]))
+
+
+ImageFormat detectImageFormat(const ubyte_t* data, size_t size)
+{
+    if (isJpegImage(data, size))
+        return IMAGE_FORMAT_JPEG;
+
+    if (isPngImage(data, size))
+        return IMAGE_FORMAT_PNG;
+
+    if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+        return IMAGE_FORMAT_BMP;
+
+    return IMAGE_FORMAT_UNKNOWN;
+}
+
+// Decodes an image from a mapped file, which it takes ownership of.
+BitmapImage* decodeImage(MappedFile* file, const char* filename)
+{
+    BitmapImage* image = NULL;
+
+    switch (detectImageFormat((const ubyte_t *)file->data, file->size))
+    {
+        // The bitmap keeps the file mapped, as its pixels are used in place.
+        case IMAGE_FORMAT_BMP:
+            return decodeBitmapImage(file, filename, false);
+
+        case IMAGE_FORMAT_JPEG:
+            image = decodeJpegImage((const ubyte_t *)file->data, file->size, filename);
+            break;
+
+        case IMAGE_FORMAT_PNG:
+            image = decodePngImage((const ubyte_t *)file->data, file->size, filename);
+            break;
+
+        default:
+            fprintf(stderr, "Error: Unrecognised image format; Inspect \"%s\".\n", filename);
+            break;
+    }
+
+    closeMappedFile(file);
+
+    return image;
+}
+
+// Returns the path of the image `filename` refers to (heap-allocated): `filename` itself if it
+// exists, or else `filename` followed by the first of `image_extensions` that exists. NULL if none does.
+char* findImageFile(const char* filename)
+{
+    uint64_t size;
+    int64_t mtime;
+
+    if (getFileStamp(filename, &size, &mtime))
+        return strBuild(filename);
+
+    for (int i = 0; i < NUM_IMAGE_EXTENSIONS; ++i)
+    {
+        char* candidate = strCat(2, filename, image_extensions[i]);
+
+        if (getFileStamp(candidate, &size, &mtime))
+            return candidate;
+
+        free(candidate);
+    }
+
+    return NULL;
+}
+
+// Image constructor (heap-allocated): loads a BMP, JPEG or PNG image, found through `findImageFile`
+// so that textures can be named without committing to a format. Returns NULL for missing, corrupt
+// or unsupported images.
+BitmapImage* loadImage(const char* filename)
+{
+    char* path = findImageFile(filename);
+
+    MappedFile* file = (path != NULL ? openMappedFile(path, true) : NULL);
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: Image file is unavailable; Inspect \"%s\".\n", filename);
+        free(path);
+        return NULL;
+    }
+
+    BitmapImage* image = decodeImage(file, path);
+
+    free(path);
+
+    return image;
+}
+
+#endif // IMAGE_FORMATS_H
@@ -0,0 +1,552 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "CustomTypes.h"
+
+
+// DEFLATE (RFC 1951) decompressor for zlib streams (RFC 1950), as found in PNG images. The whole
+// output is decompressed into a caller-provided buffer of known size, so no window is kept aside:
+// back-references point straight into the output.
+//
+// Huffman codes are decoded through a lookup table indexed by the next `INFLATE_FAST_BITS` bits,
+// which resolves nearly every symbol in one step; longer codes fall back to canonical decoding.
+
+#define INFLATE_FAST_BITS 9
+
+#define INFLATE_ERROR ((size_t)-1)
+
+typedef struct InflateHuffman
+{
+    // (length << 9) | symbol, for codes of up to `INFLATE_FAST_BITS` bits; 0 for longer codes.
+    uint16_t fast[1 << INFLATE_FAST_BITS];
+
+    // Number of codes of each length, and the symbols sorted by code.
+    uint16_t counts[16];
+    uint16_t symbols[288];
+
+} InflateHuffman;
+
+typedef struct InflateStream
+{
+    const ubyte_t* in;
+
+    size_t inSize;
+    size_t inPos;
+
+    // Bits not yet consumed, least significant first.
+    uint64_t bitBuffer;
+
+    int bitCount;
+
+    ubyte_t* out;
+
+    size_t outSize;
+    size_t outPos;
+
+    const char* errorMessage;
+
+} InflateStream;
+
+
+const uint16_t inflate_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+const uint8_t inflate_length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+const uint16_t inflate_distance_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+const uint8_t inflate_distance_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Order in which the code length code lengths are stored in a dynamic block's header.
+const uint8_t inflate_code_length_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+
+// Tops up the bit buffer; past the end of the input, `bitCount` simply stops growing.
+void refillInflateBits(InflateStream* s)
+{
+    while (s->bitCount <= 56 && s->inPos < s->inSize)
+    {
+        s->bitBuffer |= (uint64_t)s->in[s->inPos++] << s->bitCount;
+        s->bitCount += 8;
+    }
+}
+
+bool readInflateBits(InflateStream* s, int count, unsigned int* value)
+{
+    if (s->bitCount < count)
+    {
+        refillInflateBits(s);
+
+        if (s->bitCount < count)
+        {
+            s->errorMessage = "unexpected end of data";
+            return false;
+        }
+    }
+
+    *value = (unsigned int)(s->bitBuffer & ((1ull << count) - 1));
+
+    s->bitBuffer >>= count;
+    s->bitCount -= count;
+
+    return true;
+}
+
+// Builds the decoding tables of a canonical Huffman code from its code lengths.
+// Incomplete codes are accepted (as zlib does for single-symbol distance codes).
+bool buildInflateHuffman(InflateHuffman* h, const uint8_t* lengths, int num_symbols)
+{
+    uint16_t offsets[16];
+
+    memset(h->counts, 0, sizeof(h->counts));
+    memset(h->fast, 0, sizeof(h->fast));
+
+    for (int i = 0; i < num_symbols; ++i)
+        h->counts[lengths[i]] += 1;
+
+    h->counts[0] = 0;
+
+    // Reject over-subscribed codes.
+    int left = 1;
+
+    for (int len = 1; len < 16; ++len)
+    {
+        left = 2 * left - h->counts[len];
+
+        if (left < 0)
+            return false;
+    }
+
+    offsets[1] = 0;
+
+    for (int len = 1; len < 15; ++len)
+        offsets[len + 1] = offsets[len] + h->counts[len];
+
+    for (int i = 0; i < num_symbols; ++i)
+    {
+        if (lengths[i] != 0)
+            h->symbols[offsets[lengths[i]]++] = (uint16_t)i;
+    }
+
+    // Canonical codes are assigned in symbol order within each length; the stream stores them
+    // most significant bit first, so the table is indexed by their bit-reversed value.
+    unsigned int code = 0;
+    int index = 0;
+
+    for (int len = 1; len <= INFLATE_FAST_BITS; ++len)
+    {
+        for (int k = 0; k < h->counts[len]; ++k, ++code, ++index)
+        {
+            unsigned int reversed = 0;
+
+            for (int b = 0; b < len; ++b)
+                reversed |= ((code >> b) & 1u) << (len - 1 - b);
+
+            for (unsigned int i = reversed; i < (1u << INFLATE_FAST_BITS); i += 1u << len)
+                h->fast[i] = (uint16_t)((len << 9) | h->symbols[index]);
+        }
+        code <<= 1;
+    }
+
+    return true;
+}
+
+// Returns the next symbol, or -1 on an invalid code or the end of data.
+int decodeInflateSymbol(InflateStream* s, const InflateHuffman* h)
+{
+    if (s->bitCount < 15)
+        refillInflateBits(s);
+
+    uint16_t entry = h->fast[s->bitBuffer & ((1u << INFLATE_FAST_BITS) - 1)];
+
+    if (entry != 0)
+    {
+        int len = entry >> 9;
+
+        if (len > s->bitCount)
+            return -1;
+
+        s->bitBuffer >>= len;
+        s->bitCount -= len;
+
+        return entry & 0x1FF;
+    }
+
+    // Longer codes: walk the lengths one bit at a time (as in zlib's `puff`).
+    int code = 0, first = 0, index = 0;
+
+    for (int len = 1; len < 16 && len <= s->bitCount; ++len)
+    {
+        code |= (int)((s->bitBuffer >> (len - 1)) & 1u);
+
+        int count = h->counts[len];
+
+        if (code - count < first)
+        {
+            s->bitBuffer >>= len;
+            s->bitCount -= len;
+
+            return h->symbols[index + (code - first)];
+        }
+
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+bool inflateStoredBlock(InflateStream* s)
+{
+    // Skip to the byte boundary; whole bytes still in the bit buffer are given back to the input.
+    s->bitBuffer >>= s->bitCount & 7;
+    s->bitCount -= s->bitCount & 7;
+
+    s->inPos -= (size_t)(s->bitCount / 8);
+    s->bitBuffer = 0;
+    s->bitCount = 0;
+
+    if (s->inSize - s->inPos < 4)
+    {
+        s->errorMessage = "unexpected end of data";
+        return false;
+    }
+
+    unsigned int length = s->in[s->inPos] | (s->in[s->inPos + 1] << 8);
+    unsigned int complement = s->in[s->inPos + 2] | (s->in[s->inPos + 3] << 8);
+
+    s->inPos += 4;
+
+    if (length != (~complement & 0xFFFFu))
+    {
+        s->errorMessage = "corrupt stored block";
+        return false;
+    }
+
+    if (s->inSize - s->inPos < length || s->outSize - s->outPos < length)
+    {
+        s->errorMessage = (s->inSize - s->inPos < length ? "unexpected end of data" : "output overflow");
+        return false;
+    }
+
+    memcpy(s->out + s->outPos, s->in + s->inPos, length);
+
+    s->inPos += length;
+    s->outPos += length;
+
+    return true;
+}
+
+bool inflateCompressedBlock(InflateStream* s, const InflateHuffman* literals, const InflateHuffman* distances)
+{
+    for (;;)
+    {
+        int symbol = decodeInflateSymbol(s, literals);
+
+        if (symbol < 0)
+        {
+            s->errorMessage = "invalid literal/length code";
+            return false;
+        }
+
+        if (symbol < 256)
+        {
+            if (s->outPos == s->outSize)
+            {
+                s->errorMessage = "output overflow";
+                return false;
+            }
+
+            s->out[s->outPos++] = (ubyte_t)symbol;
+            continue;
+        }
+
+        if (symbol == 256)
+            return true;
+
+        symbol -= 257;
+
+        if (symbol >= 29)
+        {
+            s->errorMessage = "invalid length symbol";
+            return false;
+        }
+
+        unsigned int extra;
+
+        if (!readInflateBits(s, inflate_length_extra[symbol], &extra))
+            return false;
+
+        size_t length = inflate_length_base[symbol] + extra;
+
+        symbol = decodeInflateSymbol(s, distances);
+
+        if (symbol < 0 || symbol >= 30)
+        {
+            s->errorMessage = "invalid distance code";
+            return false;
+        }
+
+        if (!readInflateBits(s, inflate_distance_extra[symbol], &extra))
+            return false;
+
+        size_t distance = inflate_distance_base[symbol] + extra;
+
+        if (distance > s->outPos)
+        {
+            s->errorMessage = "distance too far back";
+            return false;
+        }
+
+        if (s->outSize - s->outPos < length)
+        {
+            s->errorMessage = "output overflow";
+            return false;
+        }
+
+        ubyte_t* dst = s->out + s->outPos;
+        const ubyte_t* src = dst - distance;
+
+        // Byte by byte, as the copy may overlap its own output (e.g. runs with distance 1).
+        if (distance >= length)
+            memcpy(dst, src, length);
+        else
+            for (size_t i = 0; i < length; ++i)
+                dst[i] = src[i];
+
+        s->outPos += length;
+    }
+}
+
+bool inflateFixedBlock(InflateStream* s)
+{
+    InflateHuffman literals, distances;
+
+    uint8_t lengths[288];
+
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 112);
+    memset(lengths + 256, 7, 24);
+    memset(lengths + 280, 8, 8);
+
+    buildInflateHuffman(&literals, lengths, 288);
+
+    memset(lengths, 5, 30);
+
+    buildInflateHuffman(&distances, lengths, 30);
+
+    return inflateCompressedBlock(s, &literals, &distances);
+}
+
+bool inflateDynamicBlock(InflateStream* s)
+{
+    unsigned int num_literals, num_distances, num_code_lengths;
+
+    if (!readInflateBits(s, 5, &num_literals) || !readInflateBits(s, 5, &num_distances) ||
+        !readInflateBits(s, 4, &num_code_lengths))
+        return false;
+
+    num_literals += 257;
+    num_distances += 1;
+    num_code_lengths += 4;
+
+    if (num_literals > 286 || num_distances > 30)
+    {
+        s->errorMessage = "too many length or distance symbols";
+        return false;
+    }
+
+    uint8_t lengths[288 + 32];
+
+    memset(lengths, 0, 19);
+
+    for (unsigned int i = 0; i < num_code_lengths; ++i)
+    {
+        unsigned int length;
+
+        if (!readInflateBits(s, 3, &length))
+            return false;
+
+        lengths[inflate_code_length_order[i]] = (uint8_t)length;
+    }
+
+    InflateHuffman code_lengths, literals, distances;
+
+    if (!buildInflateHuffman(&code_lengths, lengths, 19))
+    {
+        s->errorMessage = "invalid code lengths code";
+        return false;
+    }
+
+    unsigned int total = num_literals + num_distances;
+
+    for (unsigned int i = 0; i < total; )
+    {
+        int symbol = decodeInflateSymbol(s, &code_lengths);
+
+        if (symbol < 0)
+        {
+            s->errorMessage = "invalid code lengths code";
+            return false;
+        }
+
+        if (symbol < 16)
+        {
+            lengths[i++] = (uint8_t)symbol;
+            continue;
+        }
+
+        unsigned int repeat;
+        uint8_t value = 0;
+
+        if (symbol == 16)
+        {
+            if (i == 0)
+            {
+                s->errorMessage = "repeat with no first length";
+                return false;
+            }
+
+            value = lengths[i - 1];
+
+            if (!readInflateBits(s, 2, &repeat))
+                return false;
+
+            repeat += 3;
+        }
+        else if (symbol == 17)
+        {
+            if (!readInflateBits(s, 3, &repeat))
+                return false;
+
+            repeat += 3;
+        }
+        else
+        {
+            if (!readInflateBits(s, 7, &repeat))
+                return false;
+
+            repeat += 11;
+        }
+
+        if (i + repeat > total)
+        {
+            s->errorMessage = "too many code lengths";
+            return false;
+        }
+
+        memset(lengths + i, value, repeat);
+        i += repeat;
+    }
+
+    if (lengths[256] == 0)
+    {
+        s->errorMessage = "missing end-of-block code";
+        return false;
+    }
+
+    if (!buildInflateHuffman(&literals, lengths, (int)num_literals) ||
+        !buildInflateHuffman(&distances, lengths + num_literals, (int)num_distances))
+    {
+        s->errorMessage = "invalid literal/length or distance code";
+        return false;
+    }
+
+    return inflateCompressedBlock(s, &literals, &distances);
+}
+
+uint32_t computeAdler32(const ubyte_t* data, size_t size)
+{
+    uint32_t a = 1, b = 0;
+
+    while (size > 0)
+    {
+        // Largest run for which `b` cannot overflow before the modulo.
+        size_t run = (size < 5552 ? size : 5552);
+
+        for (size_t i = 0; i < run; ++i)
+        {
+            a += data[i];
+            b += a;
+        }
+
+        a %= 65521u;
+        b %= 65521u;
+
+        data += run;
+        size -= run;
+    }
+
+    return (b << 16) | a;
+}
+
+// Decompresses a zlib stream into `dst`. Returns the number of bytes written, or `INFLATE_ERROR`,
+// in which case `error_message` (optional) describes the problem.
+size_t inflateZlib(const ubyte_t* src, size_t src_size, ubyte_t* dst, size_t dst_size, const char** error_message)
+{
+    InflateStream s = { src, src_size, 2, 0, 0, dst, dst_size, 0, NULL };
+
+    if (src_size < 6 || (src[0] & 0x0F) != 8 || ((src[0] << 8) | src[1]) % 31 != 0 || (src[1] & 0x20))
+    {
+        s.errorMessage = "invalid zlib header";
+    }
+    else
+    {
+        unsigned int last = 0, type;
+
+        while (!last && s.errorMessage == NULL)
+        {
+            if (!readInflateBits(&s, 1, &last) || !readInflateBits(&s, 2, &type))
+                break;
+
+            if (type == 0)
+                inflateStoredBlock(&s);
+            else if (type == 1)
+                inflateFixedBlock(&s);
+            else if (type == 2)
+                inflateDynamicBlock(&s);
+            else
+                s.errorMessage = "invalid block type";
+        }
+
+        if (s.errorMessage == NULL)
+        {
+            // The Adler-32 checksum follows the last block, on a byte boundary.
+            size_t end = s.inPos - (size_t)(s.bitCount / 8);
+
+            if (src_size - end < 4)
+                s.errorMessage = "missing checksum";
+            else if (computeAdler32(dst, s.outPos) != (
+                ((uint32_t)src[end] << 24) | ((uint32_t)src[end + 1] << 16) | ((uint32_t)src[end + 2] << 8) | src[end + 3]))
+                s.errorMessage = "checksum mismatch";
+        }
+    }
+
+    if (error_message != NULL)
+        *error_message = s.errorMessage;
+
+    return (s.errorMessage == NULL ? s.outPos : INFLATE_ERROR);
+}
+
+#endif // INFLATE_H
@@ -0,0 +1,424 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <GL/glut.h>
+
+#include "Timer.h"
+#include "CustomTypes.h"
+#include "MouseCallback.h"
+#include "MotionCallback.h"
+#include "KeyboardCallback.h"
+#include "MouseWheelCallback.h"
+
+
+// Input recordings are compact binary files (native byte order) that consist of an
+// `InputRecordingHeader` followed by `numEvents` fixed-size `InputEvent` records, sorted by frame.
+//
+// While recording or replaying, the simulation advances by a fixed `timestep` per frame and the
+// input clock (see `getInputTimeMillis`) is driven by the frame counter, so that the same
+// recording always produces the same sequence of frames, regardless of how fast they are rendered.
+
+#define INPUT_RECORDING_MAGIC   "SSIR"
+#define INPUT_RECORDING_VERSION 1
+
+
+typedef enum InputRecorderMode
+{
+    INPUT_RECORDER_OFF = 0,
+    INPUT_RECORDER_RECORD,
+    INPUT_RECORDER_REPLAY
+
+} InputRecorderMode;
+
+typedef enum InputEventType
+{
+    INPUT_EVENT_KEY_DOWN = 1,
+    INPUT_EVENT_KEY_UP,
+    INPUT_EVENT_SPECIAL_KEY,
+    // Camera angles after a mouse movement, stored in `x` (horizontal) and `y` (vertical).
+    INPUT_EVENT_MOTION,
+    // Mouse wheel direction, stored in `key` (1 for up, 0 for down).
+    INPUT_EVENT_WHEEL,
+    // Left click, at the view position stored in `x` and `y` (see `mouse_click_x`).
+    INPUT_EVENT_CLICK,
+    // Character typed into a text field (see `keyboard_text_input`), stored as is in `key`.
+    INPUT_EVENT_TEXT
+
+} InputEventType;
+
+// Bit flags of `InputEvent::modifiers`.
+#define INPUT_MODIFIER_SHIFT    0x1
+#define INPUT_MODIFIER_ALT      0x2
+#define INPUT_MODIFIER_CTRL     0x4
+
+
+typedef struct InputRecordingHeader
+{
+    char magic[4];
+
+    uint32_t version;
+
+    // Seed passed to `srand` at startup.
+    uint32_t seed;
+
+    // Number of frames covered by the recording.
+    uint32_t numFrames;
+
+    // Fixed simulation timestep in seconds.
+    double timestep;
+
+    uint64_t numEvents;
+
+} InputRecordingHeader;
+
+typedef struct InputEvent
+{
+    // Index of the frame before which the event is applied.
+    uint32_t frame;
+
+    uint8_t type;
+
+    uint8_t key;
+
+    uint8_t modifiers;
+
+    uint8_t reserved;
+
+    float x;
+    float y;
+
+} InputEvent;
+
+
+typedef struct InputRecorder
+{
+    InputRecorderMode mode;
+
+    FILE* file;
+
+    char* filename;
+
+    InputRecordingHeader header;
+
+    // Index of the frame that is about to be rendered.
+    uint32_t frame;
+
+    // Replay mode only: all recorded events and the index of the next one to be applied.
+    InputEvent* events;
+
+    size_t nextEvent;
+
+    // Replay mode only: wall clock statistics of the rendered frames.
+    uint64_t replayStartMicros;
+    uint64_t frameStartMicros;
+    uint64_t minFrameMicros;
+    uint64_t maxFrameMicros;
+
+} InputRecorder;
+
+
+// The recorder driven by the `callbackRecord*` GLUT callbacks.
+InputRecorder* input_recorder = NULL;
+
+
+// Input recorder constructor (heap-allocated) for record mode. `seed` should be the value
+// passed to `srand` and `timestep` the fixed simulation step in seconds.
+InputRecorder* initInputRecorder(const char* filename, uint32_t seed, double timestep)
+{
+    FILE* fp = fopen(filename, "wb");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error: Unable to create the input recording file \"%s\".\n", filename);
+        return NULL;
+    }
+
+    InputRecorder* r = (InputRecorder *)malloc(sizeof(InputRecorder));
+
+    memset(r, 0, sizeof(InputRecorder));
+
+    r->mode = INPUT_RECORDER_RECORD;
+    r->file = fp;
+    r->filename = strBuild(filename);
+
+    memcpy(r->header.magic, INPUT_RECORDING_MAGIC, sizeof(r->header.magic));
+    r->header.version = INPUT_RECORDING_VERSION;
+    r->header.seed = seed;
+    r->header.numFrames = 0;
+    r->header.timestep = timestep;
+    r->header.numEvents = 0;
+
+    // Placeholder; rewritten with the final counts by `deleteInputRecorder`.
+    fwrite(&r->header, sizeof(InputRecordingHeader), 1, fp);
+
+    input_clock_fixed = true;
+    input_clock_millis = 0;
+
+    return r;
+}
+
+// Input recorder constructor (heap-allocated) for replay mode.
+InputRecorder* initInputReplayer(const char* filename)
+{
+    FILE* fp = fopen(filename, "rb");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error: Unable to open the input recording file \"%s\".\n", filename);
+        return NULL;
+    }
+
+    InputRecorder* r = (InputRecorder *)malloc(sizeof(InputRecorder));
+
+    memset(r, 0, sizeof(InputRecorder));
+
+    r->mode = INPUT_RECORDER_REPLAY;
+    r->filename = strBuild(filename);
+
+    if (fread(&r->header, sizeof(InputRecordingHeader), 1, fp) != 1
+        || memcmp(r->header.magic, INPUT_RECORDING_MAGIC, sizeof(r->header.magic)) != 0
+        || r->header.version != INPUT_RECORDING_VERSION
+        || r->header.timestep <= .0)
+    {
+        fprintf(stderr, "Error: \"%s\" is not a valid input recording.\n", filename);
+        fclose(fp);
+        free(r->filename);
+        free(r);
+        return NULL;
+    }
+
+    r->events = (InputEvent *)malloc((size_t)(r->header.numEvents + 1) * sizeof(InputEvent));
+
+    if (fread(r->events, sizeof(InputEvent), (size_t)r->header.numEvents, fp) != (size_t)r->header.numEvents)
+    {
+        fprintf(stderr, "Error: Input recording \"%s\" is truncated.\n", filename);
+        fclose(fp);
+        free(r->events);
+        free(r->filename);
+        free(r);
+        return NULL;
+    }
+    fclose(fp);
+
+    r->minFrameMicros = UINT64_MAX;
+
+    input_clock_fixed = true;
+    input_clock_millis = 0;
+
+    return r;
+}
+
+void appendInputEvent(InputRecorder* r, InputEventType type, unsigned char key, float x, float y)
+{
+    InputEvent e;
+
+    e.frame = r->frame;
+    e.type = (uint8_t)type;
+    e.key = (uint8_t)key;
+    e.modifiers = (uint8_t)(
+        (shift_key_down ? INPUT_MODIFIER_SHIFT : 0) |
+        (alt_key_down ? INPUT_MODIFIER_ALT : 0) |
+        (ctrl_key_down ? INPUT_MODIFIER_CTRL : 0)
+    );
+    e.reserved = 0;
+    e.x = x;
+    e.y = y;
+
+    fwrite(&e, sizeof(InputEvent), 1, r->file);
+
+    r->header.numEvents += 1;
+}
+
+
+// GLUT callbacks of record mode; they forward the event to the live callbacks and log it.
+
+void callbackRecordKeyboardDown(unsigned char key, int x, int y)
+{
+    bool typed = isTypedCharacter(key);
+
+    callbackKeyboardDown(key, x, y);
+
+    if (typed)
+        appendInputEvent(input_recorder, INPUT_EVENT_TEXT, key, .0f, .0f);
+    else
+        appendInputEvent(input_recorder, INPUT_EVENT_KEY_DOWN, (unsigned char)toupper(key), .0f, .0f);
+}
+
+void callbackRecordKeyboardUp(unsigned char key, int x, int y)
+{
+    callbackKeyboardUp(key, x, y);
+    appendInputEvent(input_recorder, INPUT_EVENT_KEY_UP, (unsigned char)toupper(key), .0f, .0f);
+}
+
+void callbackRecordSpecialKeyboard(int key, int x, int y)
+{
+    callbackSpecialKeyboard(key, x, y);
+    appendInputEvent(input_recorder, INPUT_EVENT_SPECIAL_KEY, (unsigned char)key, .0f, .0f);
+}
+
+void callbackRecordPassiveMotion(int x, int y)
+{
+    callbackPassiveMotion(x, y);
+    appendInputEvent(input_recorder, INPUT_EVENT_MOTION, 0, camera_angle_horizontal, camera_angle_vertical);
+}
+
+void callbackRecordMouse(int button, int state, int x, int y)
+{
+    callbackMouse(button, state, x, y);
+
+    if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN)
+        appendInputEvent(input_recorder, INPUT_EVENT_CLICK, 0, mouse_click_x, mouse_click_y);
+}
+
+void callbackRecordMouseWheel(int button, int dir, int x, int y)
+{
+    callbackMouseWheel(button, dir, x, y);
+    appendInputEvent(input_recorder, INPUT_EVENT_WHEEL, (unsigned char)(dir > 0 ? 1 : 0), .0f, .0f);
+}
+
+
+// Applies the recorded events of the current frame to the input modules' state.
+// Must be called once per rendered frame, before any input state is read.
+void replayInputFrame(InputRecorder* r)
+{
+    while (r->nextEvent < r->header.numEvents && r->events[r->nextEvent].frame <= r->frame)
+    {
+        const InputEvent* e = &r->events[r->nextEvent++];
+
+        switch (e->type)
+        {
+        case INPUT_EVENT_KEY_DOWN:
+            shift_key_down = (e->modifiers & INPUT_MODIFIER_SHIFT) != 0;
+            alt_key_down = (e->modifiers & INPUT_MODIFIER_ALT) != 0;
+            ctrl_key_down = (e->modifiers & INPUT_MODIFIER_CTRL) != 0;
+            keystrokes[e->key] = true;
+            break;
+
+        case INPUT_EVENT_KEY_UP:
+            keystrokes[e->key] = false;
+            break;
+
+        case INPUT_EVENT_SPECIAL_KEY:
+            callbackSpecialKeyboard((int)e->key, 0, 0);
+            break;
+
+        case INPUT_EVENT_MOTION:
+            camera_angle_horizontal = e->x;
+            camera_angle_vertical = e->y;
+            break;
+
+        case INPUT_EVENT_WHEEL:
+            callbackMouseWheel(0, (e->key != 0 ? 1 : -1), 0, 0);
+            break;
+
+        case INPUT_EVENT_CLICK:
+            mouse_click_pending = true;
+            mouse_click_x = e->x;
+            mouse_click_y = e->y;
+            break;
+
+        case INPUT_EVENT_TEXT:
+            typeCharacter(e->key);
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+// Marks the beginning of a rendered frame. Returns false once a replay has run out of frames.
+bool beginInputFrame(InputRecorder* r)
+{
+    if (r->mode == INPUT_RECORDER_REPLAY)
+    {
+        if (r->frame >= r->header.numFrames)
+            return false;
+
+        r->frameStartMicros = getAbsoluteTimeMicros();
+
+        if (r->frame == 0)
+            r->replayStartMicros = r->frameStartMicros;
+
+        replayInputFrame(r);
+    }
+    return true;
+}
+
+// Marks the end of a rendered frame and advances the input clock by one fixed timestep.
+void endInputFrame(InputRecorder* r)
+{
+    if (r->mode == INPUT_RECORDER_REPLAY)
+    {
+        uint64_t frame_micros = getAbsoluteTimeMicros() - r->frameStartMicros;
+
+        if (frame_micros < r->minFrameMicros)
+            r->minFrameMicros = frame_micros;
+        if (frame_micros > r->maxFrameMicros)
+            r->maxFrameMicros = frame_micros;
+    }
+
+    r->frame += 1;
+
+    input_clock_millis = (uint64_t)((double)r->frame * r->header.timestep * 1000.0);
+}
+
+void printInputReplayStatistics(const InputRecorder* r)
+{
+    if (r->mode != INPUT_RECORDER_REPLAY || r->frame == 0)
+        return;
+
+    double total_ms = (double)(getAbsoluteTimeMicros() - r->replayStartMicros) / 1000.0;
+
+    printf(
+        "Replay \"%s\": %u frames in %.3lf ms (avg %.3lf ms, min %.3lf ms, max %.3lf ms per frame)\n",
+        r->filename,
+        r->frame,
+        total_ms,
+        total_ms / (double)r->frame,
+        (double)r->minFrameMicros / 1000.0,
+        (double)r->maxFrameMicros / 1000.0
+    );
+}
+
+// Finalizes a recording (its header is rewritten with the final frame/event counts) and frees the recorder.
+void deleteInputRecorder(InputRecorder* r)
+{
+    if (r == NULL)
+        return;
+
+    if (r->mode == INPUT_RECORDER_RECORD)
+    {
+        r->header.numFrames = r->frame;
+
+        fseek(r->file, 0L, SEEK_SET);
+        fwrite(&r->header, sizeof(InputRecordingHeader), 1, r->file);
+        fclose(r->file);
+
+        printf(
+            "Recorded %u frames and %"PRIu64" input events to \"%s\".\n",
+            r->header.numFrames, r->header.numEvents, r->filename
+        );
+    }
+
+    if (input_recorder == r)
+        input_recorder = NULL;
+
+    input_clock_fixed = false;
+
+    free(r->events);
+    free(r->filename);
+    free(r);
+}
+
+#endif // INPUT_RECORDER_H
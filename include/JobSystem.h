@@ -0,0 +1,689 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <threads.h>
+#include <stdatomic.h>
+
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <unistd.h>
+#endif
+
+
+// Work-stealing job system shared by the simulation, culling and asset loading. Every thread of the
+// system (the workers, and the main thread as worker 0) owns a deque of jobs: it pushes and pops its
+// own jobs at the bottom, while idle threads steal from the top of the others' (Chase-Lev deques).
+// The main thread only runs jobs while waiting for some (see `waitForJobs`), so it takes part in
+// frame work without ever picking up long ones: those go to a separate background queue that only
+// the workers serve (see `submitBackgroundJob`), e.g. image decoding.
+//
+// Completion is tracked with counters (see `JobCounter`): a counter is waited on, or given jobs to
+// start once it reaches zero (see `submitJobsAfter`). Jobs and counters are owned by the caller and
+// must stay alive until the counter is done, e.g. on the stack of the function that waits for them.
+
+// Slots per deque; a power of 2. A thread whose deque is full runs the jobs it submits right away.
+#define JOB_DEQUE_CAPACITY 4096
+
+// Most jobs a range is split into by `parallelFor`.
+#define JOB_PARALLEL_FOR_MAX_JOBS 256
+
+// Times an idle worker looks for jobs before going to sleep.
+#define JOB_WORKER_SPIN_COUNT 64
+
+typedef void (*JobFunction)(void* data);
+
+typedef struct Job
+{
+    JobFunction function;
+
+    void* data;
+
+    // Decremented once the job has run; may be NULL.
+    struct JobCounter* counter;
+
+    // Link in a counter's continuations, or in the background queue.
+    struct Job* next;
+
+} Job;
+
+typedef struct JobCounter
+{
+    // Jobs submitted against the counter that have not run yet.
+    atomic_int pending;
+
+    // Jobs to submit once `pending` drops to zero; `JOB_COUNTER_DONE` while it is zero.
+    _Atomic(Job *) continuations;
+
+} JobCounter;
+
+// Marks a counter with no pending jobs, i.e. done; never dereferenced.
+#define JOB_COUNTER_DONE ((Job *)(uintptr_t)1)
+
+typedef struct JobDeque
+{
+    atomic_llong top;
+
+    // Keeps the thieves' index and the owner's on separate cache lines.
+    char padding[64 - sizeof(atomic_llong)];
+
+    atomic_llong bottom;
+
+    _Atomic(Job *) slots[JOB_DEQUE_CAPACITY];
+
+} JobDeque;
+
+typedef struct JobSystem
+{
+    thrd_t* workers;
+
+    int numWorkers;
+
+    // One per thread: the main thread's first, then the workers' in order.
+    JobDeque* deques;
+
+    mtx_t mutex;
+
+    // Signalled when jobs are submitted while workers sleep, and on shutdown.
+    cnd_t wakeCondition;
+
+    // FIFO queue of background jobs, protected by `mutex`.
+    Job* backgroundHead;
+    Job* backgroundTail;
+
+    // Jobs in the deques and the background queue, jobs in the background queue alone, and workers
+    // asleep (or about to be).
+    atomic_int numQueued;
+    atomic_int numBackground;
+    atomic_int numSleeping;
+
+    bool shuttingDown;
+
+} JobSystem;
+
+// Argument of the jobs of `parallelFor`.
+typedef void (*RangeFunction)(void* data, int begin, int end);
+
+typedef struct JobRange
+{
+    RangeFunction function;
+
+    void* data;
+
+    int begin;
+    int end;
+
+} JobRange;
+
+
+// The program's job system; NULL until initialised, in which case jobs run on the calling thread.
+JobSystem* job_system = NULL;
+
+// Index of the calling thread's deque in its job system, -1 for threads that have none.
+thread_local int job_thread_index = -1;
+
+// State of the calling thread's victim selection (xorshift).
+thread_local uint32_t job_steal_seed = 0;
+
+
+int getProcessorCount(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0 ? (int)count : 1);
+#endif
+}
+
+void initJobCounter(JobCounter* counter)
+{
+    atomic_init(&counter->pending, 0);
+    atomic_init(&counter->continuations, JOB_COUNTER_DONE);
+}
+
+bool isJobCounterDone(JobCounter* counter)
+{
+    return atomic_load(&counter->continuations) == JOB_COUNTER_DONE;
+}
+
+// Only called by the deque's owner. Returns false if the deque is full.
+bool pushJobDeque(JobDeque* d, Job* job)
+{
+    long long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    long long t = atomic_load_explicit(&d->top, memory_order_acquire);
+
+    if (b - t >= JOB_DEQUE_CAPACITY)
+        return false;
+
+    atomic_store_explicit(&d->slots[b & (JOB_DEQUE_CAPACITY - 1)], job, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+
+    return true;
+}
+
+// Only called by the deque's owner; takes the newest job.
+Job* popJobDeque(JobDeque* d)
+{
+    long long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+
+    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    long long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+    if (t > b)
+    {
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    Job* job = atomic_load_explicit(&d->slots[b & (JOB_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+
+    // The last job may be stolen at the same time; whoever moves `top` first gets it.
+    if (t == b)
+    {
+        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+            job = NULL;
+
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+// Called by any thread; takes the oldest job. Returns NULL if the deque is empty or another thread
+// took the job first.
+Job* stealJobDeque(JobDeque* d)
+{
+    long long t = atomic_load_explicit(&d->top, memory_order_acquire);
+
+    atomic_thread_fence(memory_order_seq_cst);
+
+    long long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+    if (t >= b)
+        return NULL;
+
+    Job* job = atomic_load_explicit(&d->slots[t & (JOB_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+
+    if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+
+    return job;
+}
+
+void wakeJobWorkers(JobSystem* js, int num_jobs)
+{
+    if (atomic_load(&js->numSleeping) == 0)
+        return;
+
+    mtx_lock(&js->mutex);
+
+    if (num_jobs == 1)
+        cnd_signal(&js->wakeCondition);
+    else
+        cnd_broadcast(&js->wakeCondition);
+
+    mtx_unlock(&js->mutex);
+}
+
+void runJob(JobSystem* js, Job* job);
+
+// Queues jobs whose counters are already accounted for, in the calling thread's deque or in the
+// background queue. Without workers, runs them.
+void pushJobs(JobSystem* js, Job** jobs, int num_jobs, bool background)
+{
+    int index = job_thread_index;
+
+    if (js->numWorkers == 0)
+    {
+        for (int i = 0; i < num_jobs; ++i)
+            runJob(js, jobs[i]);
+        return;
+    }
+
+    // Threads outside the system (e.g. the reloading thread) hand their jobs to the workers as well.
+    if (background || index < 0)
+    {
+        mtx_lock(&js->mutex);
+
+        for (int i = 0; i < num_jobs; ++i)
+        {
+            jobs[i]->next = NULL;
+
+            if (js->backgroundTail != NULL)
+                js->backgroundTail->next = jobs[i];
+            else
+                js->backgroundHead = jobs[i];
+
+            js->backgroundTail = jobs[i];
+        }
+
+        atomic_fetch_add(&js->numBackground, num_jobs);
+        atomic_fetch_add(&js->numQueued, num_jobs);
+        cnd_broadcast(&js->wakeCondition);
+
+        mtx_unlock(&js->mutex);
+        return;
+    }
+
+    int num_pushed = 0;
+
+    for (int i = 0; i < num_jobs; ++i)
+    {
+        if (pushJobDeque(&js->deques[index], jobs[i]))
+            num_pushed += 1;
+        else
+            runJob(js, jobs[i]);
+    }
+
+    if (num_pushed > 0)
+    {
+        atomic_fetch_add(&js->numQueued, num_pushed);
+        wakeJobWorkers(js, num_pushed);
+    }
+}
+
+void finishJob(JobSystem* js, JobCounter* counter)
+{
+    if (atomic_fetch_sub(&counter->pending, 1) != 1)
+        return;
+
+    // The counter may be released as soon as it reads done, so this is the last access to it.
+    Job* continuation = atomic_exchange(&counter->continuations, JOB_COUNTER_DONE);
+
+    while (continuation != NULL)
+    {
+        Job* next = continuation->next;
+
+        pushJobs(js, &continuation, 1, false);
+
+        continuation = next;
+    }
+}
+
+void runJob(JobSystem* js, Job* job)
+{
+    JobCounter* counter = job->counter;
+
+    job->function(job->data);
+
+    if (counter != NULL)
+        finishJob(js, counter);
+}
+
+void addJobCounterPending(JobCounter* counter, int num_jobs)
+{
+    // A counter going from done to pending opens its list of continuations again.
+    if (atomic_fetch_add(&counter->pending, num_jobs) == 0)
+        atomic_store(&counter->continuations, NULL);
+}
+
+// Looks for a job to run: in the thread's own deque first, then in the others', starting from a
+// random one, and finally (for workers) in the background queue.
+Job* findJob(JobSystem* js, int index, bool background)
+{
+    Job* job = NULL;
+
+    if (index >= 0)
+        job = popJobDeque(&js->deques[index]);
+
+    int num_deques = js->numWorkers + 1;
+
+    if (job == NULL)
+    {
+        uint32_t x = job_steal_seed;
+
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+
+        job_steal_seed = x;
+
+        for (int i = 0; i < num_deques && job == NULL; ++i)
+        {
+            int victim = (int)((x + (uint32_t)i) % (uint32_t)num_deques);
+
+            if (victim != index)
+                job = stealJobDeque(&js->deques[victim]);
+        }
+    }
+
+    if (job == NULL && background && atomic_load(&js->numBackground) > 0)
+    {
+        mtx_lock(&js->mutex);
+
+        job = js->backgroundHead;
+
+        if (job != NULL)
+        {
+            js->backgroundHead = job->next;
+
+            if (js->backgroundHead == NULL)
+                js->backgroundTail = NULL;
+
+            atomic_fetch_sub(&js->numBackground, 1);
+        }
+
+        mtx_unlock(&js->mutex);
+    }
+
+    if (job != NULL)
+        atomic_fetch_sub(&js->numQueued, 1);
+
+    return job;
+}
+
+typedef struct JobWorkerArgs
+{
+    JobSystem* js;
+
+    int index;
+
+} JobWorkerArgs;
+
+int jobWorker(void* arg)
+{
+    JobWorkerArgs args = *(JobWorkerArgs *)arg;
+
+    free(arg);
+
+    JobSystem* js = args.js;
+
+    job_thread_index = args.index;
+    job_steal_seed = 2463534242u * (uint32_t)(args.index + 1);
+
+    for (;;)
+    {
+        Job* job = NULL;
+
+        for (int i = 0; i < JOB_WORKER_SPIN_COUNT && job == NULL; ++i)
+        {
+            job = findJob(js, args.index, true);
+
+            if (job == NULL)
+                thrd_yield();
+        }
+
+        if (job != NULL)
+        {
+            runJob(js, job);
+            continue;
+        }
+
+        mtx_lock(&js->mutex);
+
+        // Announced before checking for jobs, so that submitters either see a sleeper to wake up
+        // or their jobs are seen here.
+        atomic_fetch_add(&js->numSleeping, 1);
+
+        while (atomic_load(&js->numQueued) <= 0 && !js->shuttingDown)
+            cnd_wait(&js->wakeCondition, &js->mutex);
+
+        atomic_fetch_sub(&js->numSleeping, 1);
+
+        bool stop = (js->shuttingDown && atomic_load(&js->numQueued) <= 0);
+
+        mtx_unlock(&js->mutex);
+
+        if (stop)
+            return 0;
+    }
+}
+
+// Job system constructor (heap-allocated), with `num_workers` threads besides the calling one,
+// which becomes the system's main thread; `num_workers` < 0 uses one per additional processor, and
+// at least one so that background jobs still leave the main thread. With no workers, every job
+// runs on the thread that submits it.
+JobSystem* initJobSystem(int num_workers)
+{
+    JobSystem* js = (JobSystem *)malloc(sizeof(JobSystem));
+
+    if (num_workers < 0)
+        num_workers = (getProcessorCount() > 1 ? getProcessorCount() - 1 : 1);
+
+    js->numWorkers = 0;
+    js->workers = (thrd_t *)malloc(((size_t)num_workers + 1) * sizeof(thrd_t));
+
+    js->deques = (JobDeque *)malloc(((size_t)num_workers + 1) * sizeof(JobDeque));
+
+    for (int i = 0; i <= num_workers; ++i)
+    {
+        atomic_init(&js->deques[i].top, 0);
+        atomic_init(&js->deques[i].bottom, 0);
+    }
+
+    js->backgroundHead = js->backgroundTail = NULL;
+
+    atomic_init(&js->numQueued, 0);
+    atomic_init(&js->numBackground, 0);
+    atomic_init(&js->numSleeping, 0);
+
+    js->shuttingDown = false;
+
+    mtx_init(&js->mutex, mtx_plain);
+    cnd_init(&js->wakeCondition);
+
+    job_thread_index = 0;
+    job_steal_seed = 2463534242u;
+
+    for (int i = 0; i < num_workers; ++i)
+    {
+        JobWorkerArgs* args = (JobWorkerArgs *)malloc(sizeof(JobWorkerArgs));
+
+        args->js = js;
+        args->index = js->numWorkers + 1;
+
+        if (thrd_create(&js->workers[js->numWorkers], jobWorker, args) == thrd_success)
+            js->numWorkers += 1;
+        else
+            free(args);
+    }
+
+    if (num_workers > 0 && js->numWorkers == 0)
+        fprintf(stderr, "Warning: Unable to start the job system's worker threads; Jobs will run on the main thread.\n");
+
+    return js;
+}
+
+// Number of threads running jobs, the main thread included.
+int getJobThreadCount(const JobSystem* js)
+{
+    return (js != NULL ? js->numWorkers + 1 : 1);
+}
+
+// Queues `num_jobs` jobs, accounted to `counter` (may be NULL). Without a job system, runs them.
+void submitJobs(JobSystem* js, Job* jobs, int num_jobs, JobCounter* counter)
+{
+    if (js == NULL)
+    {
+        for (int i = 0; i < num_jobs; ++i)
+            jobs[i].function(jobs[i].data);
+        return;
+    }
+
+    if (counter != NULL)
+        addJobCounterPending(counter, num_jobs);
+
+    Job* batch[64];
+
+    for (int i = 0; i < num_jobs; i += 64)
+    {
+        int n = (num_jobs - i < 64 ? num_jobs - i : 64);
+
+        for (int k = 0; k < n; ++k)
+        {
+            jobs[i + k].counter = counter;
+            batch[k] = &jobs[i + k];
+        }
+
+        pushJobs(js, batch, n, false);
+    }
+}
+
+// As `submitJobs`, but the jobs are only queued once `dependency` is done; `counter` accounts for
+// them right away, so waiting on it covers the dependency as well.
+void submitJobsAfter(JobSystem* js, Job* jobs, int num_jobs, JobCounter* counter, JobCounter* dependency)
+{
+    if (js == NULL)
+    {
+        submitJobs(js, jobs, num_jobs, counter);
+        return;
+    }
+
+    if (counter != NULL)
+        addJobCounterPending(counter, num_jobs);
+
+    for (int i = 0; i < num_jobs; ++i)
+    {
+        Job* job = &jobs[i];
+
+        job->counter = counter;
+
+        Job* head = atomic_load(&dependency->continuations);
+
+        do
+        {
+            if (head == JOB_COUNTER_DONE)
+                break;
+
+            job->next = head;
+        }
+        while (!atomic_compare_exchange_weak(&dependency->continuations, &head, job));
+
+        if (head == JOB_COUNTER_DONE)
+            pushJobs(js, &job, 1, false);
+    }
+}
+
+// Queues a long-running job (e.g. decoding a file) for the workers only, in submission order, so
+// that it never delays the main thread's waits. Without workers, runs it.
+void submitBackgroundJob(JobSystem* js, Job* job, JobCounter* counter)
+{
+    if (js == NULL || js->numWorkers == 0)
+    {
+        job->function(job->data);
+        return;
+    }
+
+    job->counter = counter;
+
+    if (counter != NULL)
+        addJobCounterPending(counter, 1);
+
+    pushJobs(js, &job, 1, true);
+}
+
+// Runs queued jobs until `counter` is done. Background jobs are left to the workers.
+void waitForJobs(JobSystem* js, JobCounter* counter)
+{
+    if (js == NULL)
+        return;
+
+    int index = job_thread_index;
+
+    while (!isJobCounterDone(counter))
+    {
+        Job* job = (index >= 0 ? findJob(js, index, false) : NULL);
+
+        if (job != NULL)
+            runJob(js, job);
+        else
+            thrd_yield();
+    }
+}
+
+void runJobRange(void* data)
+{
+    JobRange* range = (JobRange *)data;
+
+    range->function(range->data, range->begin, range->end);
+}
+
+// Calls `function` over [begin, end) split into consecutive ranges of at least `grain` items, in
+// parallel, and returns once every range is done. Ranges too small to be worth splitting are run
+// right away by the calling thread.
+void parallelFor(JobSystem* js, int begin, int end, int grain, RangeFunction function, void* data)
+{
+    int count = end - begin;
+
+    if (grain < 1)
+        grain = 1;
+
+    if (js == NULL || js->numWorkers == 0 || count <= grain)
+    {
+        if (count > 0)
+            function(data, begin, end);
+        return;
+    }
+
+    int num_jobs = (count + grain - 1) / grain;
+
+    if (num_jobs > JOB_PARALLEL_FOR_MAX_JOBS)
+        num_jobs = JOB_PARALLEL_FOR_MAX_JOBS;
+
+    Job jobs[JOB_PARALLEL_FOR_MAX_JOBS];
+    JobRange ranges[JOB_PARALLEL_FOR_MAX_JOBS];
+
+    JobCounter counter;
+    initJobCounter(&counter);
+
+    for (int i = 0; i < num_jobs; ++i)
+    {
+        ranges[i].function = function;
+        ranges[i].data = data;
+        ranges[i].begin = begin + (int)((long long)count * i / num_jobs);
+        ranges[i].end = begin + (int)((long long)count * (i + 1) / num_jobs);
+
+        jobs[i].function = runJobRange;
+        jobs[i].data = &ranges[i];
+    }
+
+    // The calling thread takes the first range itself rather than queueing it.
+    submitJobs(js, jobs + 1, num_jobs - 1, &counter);
+
+    runJobRange(&ranges[0]);
+
+    waitForJobs(js, &counter);
+}
+
+// Waits for the workers to run out of jobs (including background ones) and stops them.
+void deleteJobSystem(JobSystem* js)
+{
+    if (js == NULL)
+        return;
+
+    mtx_lock(&js->mutex);
+
+    js->shuttingDown = true;
+    cnd_broadcast(&js->wakeCondition);
+
+    mtx_unlock(&js->mutex);
+
+    for (int i = 0; i < js->numWorkers; ++i)
+        thrd_join(js->workers[i], NULL);
+
+    if (job_thread_index == 0)
+        job_thread_index = -1;
+
+    cnd_destroy(&js->wakeCondition);
+    mtx_destroy(&js->mutex);
+
+    free(js->deques);
+    free(js->workers);
+    free(js);
+}
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,814 @@
+#ifndef JPEG_IMAGES_H
+#define JPEG_IMAGES_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "CustomTypes.h"
+#include "BitmapImages.h"
+#include "MemoryTracker.h"
+
+
+// Baseline JPEG decoder (sequential Huffman coding, 8-bit samples, grayscale or YCbCr with any
+// power-of-2 chroma subsampling, restart intervals). Progressive and arithmetic-coded images are
+// rejected. The image is decoded one row of MCUs at a time: blocks are dequantized and inverse
+// transformed (AAN floating-point IDCT) into per-component strips, which are then upsampled
+// (nearest neighbour) and converted straight into a `BitmapImage`'s BGR rows, bottom-up.
+
+#define JPEG_FAST_BITS 9
+
+#define JPEG_MAX_COMPONENTS 3
+
+// Natural (row-major) position of each coefficient, in the zigzag order they are stored in.
+const ubyte_t jpeg_zigzag[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// AAN IDCT scale factors: 1 for k = 0, cos(k * pi / 16) * sqrt(2) otherwise.
+const float jpeg_aan_scales[8] = {
+    1.0f, 1.387039845f, 1.306562965f, 1.175875602f, 1.0f, 0.785694958f, 0.541196100f, 0.275899379f
+};
+
+typedef struct JpegHuffman
+{
+    // Code length and symbol for each `JPEG_FAST_BITS`-bit prefix; a length of 0 means a longer code.
+    ubyte_t fastLength[1 << JPEG_FAST_BITS];
+    ubyte_t fastSymbol[1 << JPEG_FAST_BITS];
+
+    // Largest code of each length (-1 if none), and the offset from a code to its symbol's index.
+    int32_t maxCode[17];
+    int32_t valueOffset[17];
+
+    ubyte_t values[256];
+
+    bool defined;
+
+} JpegHuffman;
+
+typedef struct JpegComponent
+{
+    int id;
+
+    // Sampling factors.
+    int h;
+    int v;
+
+    int quantTable;
+    int dcTable;
+    int acTable;
+
+    int dcPrediction;
+
+    // log2 of the horizontal and vertical upsampling ratios.
+    int xShift;
+    int yShift;
+
+    // One row of MCUs worth of samples.
+    ubyte_t* strip;
+
+    size_t stripStride;
+
+} JpegComponent;
+
+typedef struct JpegDecoder
+{
+    const ubyte_t* data;
+
+    size_t size;
+    size_t pos;
+
+    // Bits not yet consumed, most significant first.
+    uint64_t bitBuffer;
+
+    int bitCount;
+
+    // Set once the entropy-coded data runs into a marker; zero bits are then fed instead.
+    bool markerReached;
+
+    // Dequantization tables (natural order), with the IDCT's scale factors folded in.
+    float quant[4][64];
+
+    bool quantDefined[4];
+
+    JpegHuffman dc[4];
+    JpegHuffman ac[4];
+
+    JpegComponent components[JPEG_MAX_COMPONENTS];
+
+    int numComponents;
+
+    unsigned int width;
+    unsigned int height;
+
+    int hMax;
+    int vMax;
+
+    unsigned int restartInterval;
+
+    const char* error;
+
+} JpegDecoder;
+
+
+bool isJpegImage(const ubyte_t* data, size_t size)
+{
+    return (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF);
+}
+
+uint16_t readJpegUint16(const ubyte_t* p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// Builds the decoding tables from a DHT segment's code counts (`counts[i]` codes of length i + 1).
+bool buildJpegHuffman(JpegHuffman* h, const ubyte_t* counts, const ubyte_t* values)
+{
+    int total = 0;
+
+    for (int i = 0; i < 16; ++i)
+        total += counts[i];
+
+    if (total > 256)
+        return false;
+
+    memcpy(h->values, values, (size_t)total);
+    memset(h->fastLength, 0, sizeof(h->fastLength));
+
+    int32_t code = 0;
+    int index = 0;
+
+    for (int len = 1; len <= 16; ++len)
+    {
+        h->valueOffset[len] = index - code;
+
+        for (int k = 0; k < counts[len - 1]; ++k, ++code, ++index)
+        {
+            // Codes are read most significant bit first, so those that fit the fast table fill
+            // every entry that starts with them.
+            if (len <= JPEG_FAST_BITS)
+            {
+                int first = code << (JPEG_FAST_BITS - len);
+
+                for (int i = 0; i < (1 << (JPEG_FAST_BITS - len)); ++i)
+                {
+                    h->fastLength[first + i] = (ubyte_t)len;
+                    h->fastSymbol[first + i] = values[index];
+                }
+            }
+        }
+
+        h->maxCode[len] = (counts[len - 1] > 0 ? code - 1 : -1);
+
+        // A complete code never exceeds `len` bits.
+        if (code > (1 << len))
+            return false;
+
+        code <<= 1;
+    }
+
+    h->defined = true;
+
+    return true;
+}
+
+// Tops up the bit buffer, unstuffing 0xFF00 sequences.
+void fillJpegBits(JpegDecoder* d)
+{
+    while (d->bitCount <= 56)
+    {
+        unsigned int byte = 0;
+
+        if (!d->markerReached)
+        {
+            if (d->pos >= d->size)
+                d->markerReached = true;
+
+            else if (d->data[d->pos] != 0xFF)
+                byte = d->data[d->pos++];
+
+            else if (d->pos + 1 < d->size && d->data[d->pos + 1] == 0x00)
+            {
+                byte = 0xFF;
+                d->pos += 2;
+            }
+            else
+                d->markerReached = true;
+        }
+
+        d->bitBuffer |= (uint64_t)byte << (56 - d->bitCount);
+        d->bitCount += 8;
+    }
+}
+
+unsigned int getJpegBits(JpegDecoder* d, int count)
+{
+    if (count == 0)
+        return 0;
+
+    if (d->bitCount < count)
+        fillJpegBits(d);
+
+    unsigned int value = (unsigned int)(d->bitBuffer >> (64 - count));
+
+    d->bitBuffer <<= count;
+    d->bitCount -= count;
+
+    return value;
+}
+
+// Returns the next Huffman-coded symbol, or -1 on an invalid code.
+int decodeJpegSymbol(JpegDecoder* d, const JpegHuffman* h)
+{
+    if (d->bitCount < 16)
+        fillJpegBits(d);
+
+    unsigned int prefix = (unsigned int)(d->bitBuffer >> (64 - JPEG_FAST_BITS));
+
+    int len = h->fastLength[prefix];
+
+    if (len != 0)
+    {
+        d->bitBuffer <<= len;
+        d->bitCount -= len;
+
+        return h->fastSymbol[prefix];
+    }
+
+    int32_t bits16 = (int32_t)(d->bitBuffer >> 48);
+
+    for (len = JPEG_FAST_BITS + 1; len <= 16; ++len)
+    {
+        int32_t code = bits16 >> (16 - len);
+
+        if (code <= h->maxCode[len])
+        {
+            d->bitBuffer <<= len;
+            d->bitCount -= len;
+
+            return h->values[code + h->valueOffset[len]];
+        }
+    }
+
+    return -1;
+}
+
+// Sign-extends a `size`-bit coefficient magnitude, as coded by JPEG.
+int extendJpegValue(unsigned int value, int size)
+{
+    return (size == 0 || value >= (1u << (size - 1)) ? (int)value : (int)value - (1 << size) + 1);
+}
+
+// 8x8 inverse DCT of dequantized (and AAN-scaled) coefficients, written as level-shifted samples.
+void inverseJpegDCT(const float* in, ubyte_t* out, size_t stride)
+{
+    float workspace[64];
+
+    // Columns.
+    for (int c = 0; c < 8; ++c)
+    {
+        const float* p = in + c;
+        float* w = workspace + c;
+
+        if (p[8] == 0 && p[16] == 0 && p[24] == 0 && p[32] == 0 && p[40] == 0 && p[48] == 0 && p[56] == 0)
+        {
+            for (int r = 0; r < 8; ++r)
+                w[8 * r] = p[0];
+
+            continue;
+        }
+
+        // Even part.
+        float tmp10 = p[0] + p[32];
+        float tmp11 = p[0] - p[32];
+        float tmp13 = p[16] + p[48];
+        float tmp12 = (p[16] - p[48]) * 1.414213562f - tmp13;
+
+        float tmp0 = tmp10 + tmp13;
+        float tmp3 = tmp10 - tmp13;
+        float tmp1 = tmp11 + tmp12;
+        float tmp2 = tmp11 - tmp12;
+
+        // Odd part.
+        float z13 = p[40] + p[24];
+        float z10 = p[40] - p[24];
+        float z11 = p[8] + p[56];
+        float z12 = p[8] - p[56];
+
+        float tmp7 = z11 + z13;
+        float z5 = (z10 + z12) * 1.847759065f;
+
+        tmp11 = (z11 - z13) * 1.414213562f;
+        tmp10 = 1.082392200f * z12 - z5;
+        tmp12 = -2.613125930f * z10 + z5;
+
+        float tmp6 = tmp12 - tmp7;
+        float tmp5 = tmp11 - tmp6;
+        float tmp4 = tmp10 + tmp5;
+
+        w[0] = tmp0 + tmp7;
+        w[56] = tmp0 - tmp7;
+        w[8] = tmp1 + tmp6;
+        w[48] = tmp1 - tmp6;
+        w[16] = tmp2 + tmp5;
+        w[40] = tmp2 - tmp5;
+        w[32] = tmp3 + tmp4;
+        w[24] = tmp3 - tmp4;
+    }
+
+    // Rows.
+    for (int r = 0; r < 8; ++r, out += stride)
+    {
+        const float* w = workspace + 8 * r;
+
+        float result[8];
+
+        float tmp10 = w[0] + w[4];
+        float tmp11 = w[0] - w[4];
+        float tmp13 = w[2] + w[6];
+        float tmp12 = (w[2] - w[6]) * 1.414213562f - tmp13;
+
+        float tmp0 = tmp10 + tmp13;
+        float tmp3 = tmp10 - tmp13;
+        float tmp1 = tmp11 + tmp12;
+        float tmp2 = tmp11 - tmp12;
+
+        float z13 = w[5] + w[3];
+        float z10 = w[5] - w[3];
+        float z11 = w[1] + w[7];
+        float z12 = w[1] - w[7];
+
+        float tmp7 = z11 + z13;
+        float z5 = (z10 + z12) * 1.847759065f;
+
+        tmp11 = (z11 - z13) * 1.414213562f;
+        tmp10 = 1.082392200f * z12 - z5;
+        tmp12 = -2.613125930f * z10 + z5;
+
+        float tmp6 = tmp12 - tmp7;
+        float tmp5 = tmp11 - tmp6;
+        float tmp4 = tmp10 + tmp5;
+
+        result[0] = tmp0 + tmp7;
+        result[7] = tmp0 - tmp7;
+        result[1] = tmp1 + tmp6;
+        result[6] = tmp1 - tmp6;
+        result[2] = tmp2 + tmp5;
+        result[5] = tmp2 - tmp5;
+        result[4] = tmp3 + tmp4;
+        result[3] = tmp3 - tmp4;
+
+        for (int c = 0; c < 8; ++c)
+        {
+            // Level shift by 128, rounding to nearest.
+            int value = (int)(result[c] + 128.5f);
+
+            out[c] = (ubyte_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+        }
+    }
+}
+
+bool decodeJpegBlock(JpegDecoder* d, JpegComponent* c, ubyte_t* out, size_t stride)
+{
+    float coefficients[64];
+
+    const float* quant = d->quant[c->quantTable];
+
+    memset(coefficients, 0, sizeof(coefficients));
+
+    int size = decodeJpegSymbol(d, &d->dc[c->dcTable]);
+
+    if (size < 0 || size > 11)
+        return false;
+
+    c->dcPrediction += extendJpegValue(getJpegBits(d, size), size);
+
+    coefficients[0] = (float)c->dcPrediction * quant[0];
+
+    for (int k = 1; k < 64; )
+    {
+        int symbol = decodeJpegSymbol(d, &d->ac[c->acTable]);
+
+        if (symbol < 0)
+            return false;
+
+        int run = symbol >> 4;
+
+        size = symbol & 15;
+
+        if (size == 0)
+        {
+            // End of block, or a run of 16 zeros.
+            if (run != 15)
+                break;
+
+            k += 16;
+            continue;
+        }
+
+        k += run;
+
+        if (k > 63)
+            return false;
+
+        int position = jpeg_zigzag[k++];
+
+        coefficients[position] = (float)extendJpegValue(getJpegBits(d, size), size) * quant[position];
+    }
+
+    inverseJpegDCT(coefficients, out, stride);
+
+    return true;
+}
+
+// Skips to the restart marker ending the current interval, and resets the decoder's state.
+bool restartJpegDecoder(JpegDecoder* d)
+{
+    d->bitBuffer = 0;
+    d->bitCount = 0;
+    d->markerReached = false;
+
+    while (d->pos + 1 < d->size && !(d->data[d->pos] == 0xFF && d->data[d->pos + 1] >= 0xD0 && d->data[d->pos + 1] <= 0xD7))
+        d->pos += 1;
+
+    if (d->pos + 1 >= d->size)
+        return false;
+
+    d->pos += 2;
+
+    for (int i = 0; i < d->numComponents; ++i)
+        d->components[i].dcPrediction = 0;
+
+    return true;
+}
+
+// Upsamples and color-converts rows [y_begin, y_end) of the image, whose MCU row starts at `y_strip`.
+void storeJpegRows(JpegDecoder* d, BitmapImage* image, unsigned int y_begin, unsigned int y_end, unsigned int y_strip)
+{
+    for (unsigned int y = y_begin; y < y_end; ++y)
+    {
+        ubyte_t* dst = image->buffer + (size_t)(image->height - 1 - y) * image->rowStride;
+
+        const JpegComponent* c = d->components;
+
+        const ubyte_t* luma = c[0].strip + (size_t)((y - y_strip) >> c[0].yShift) * c[0].stripStride;
+
+        if (d->numComponents == 1)
+        {
+            for (unsigned int x = 0; x < d->width; ++x, dst += 3)
+                dst[0] = dst[1] = dst[2] = luma[x];
+
+            continue;
+        }
+
+        const ubyte_t* cb = c[1].strip + (size_t)((y - y_strip) >> c[1].yShift) * c[1].stripStride;
+        const ubyte_t* cr = c[2].strip + (size_t)((y - y_strip) >> c[2].yShift) * c[2].stripStride;
+
+        const int x_shift_y = c[0].xShift, x_shift_cb = c[1].xShift, x_shift_cr = c[2].xShift;
+
+        // YCbCr -> RGB (JFIF), in 16.16 fixed point.
+        for (unsigned int x = 0; x < d->width; ++x, dst += 3)
+        {
+            int Y = luma[x >> x_shift_y] << 16;
+            int Cb = cb[x >> x_shift_cb] - 128;
+            int Cr = cr[x >> x_shift_cr] - 128;
+
+            int r = (Y + 91881 * Cr + 32768) >> 16;
+            int g = (Y - 22554 * Cb - 46802 * Cr + 32768) >> 16;
+            int b = (Y + 116130 * Cb + 32768) >> 16;
+
+            dst[0] = (ubyte_t)(b < 0 ? 0 : (b > 255 ? 255 : b));
+            dst[1] = (ubyte_t)(g < 0 ? 0 : (g > 255 ? 255 : g));
+            dst[2] = (ubyte_t)(r < 0 ? 0 : (r > 255 ? 255 : r));
+        }
+    }
+}
+
+// Decodes the entropy-coded data of the (single, interleaved) scan, starting at `d->pos`.
+BitmapImage* decodeJpegScan(JpegDecoder* d)
+{
+    unsigned int mcu_width = 8 * (unsigned int)d->hMax;
+    unsigned int mcu_height = 8 * (unsigned int)d->vMax;
+
+    unsigned int mcus_x = (d->width + mcu_width - 1) / mcu_width;
+    unsigned int mcus_y = (d->height + mcu_height - 1) / mcu_height;
+
+    BitmapImage* image = allocateBitmapImage(d->width, d->height, 3);
+
+    if (image == NULL)
+    {
+        d->error = "out of memory";
+        return NULL;
+    }
+
+    for (int i = 0; i < d->numComponents; ++i)
+    {
+        JpegComponent* c = &d->components[i];
+
+        c->stripStride = (size_t)mcus_x * c->h * 8;
+        c->strip = (ubyte_t *)trackedMalloc(MEMORY_TAG_IMAGES, c->stripStride * c->v * 8);
+        c->dcPrediction = 0;
+    }
+
+    unsigned int mcu_count = 0;
+
+    for (unsigned int my = 0; my < mcus_y && d->error == NULL; ++my)
+    {
+        for (unsigned int mx = 0; mx < mcus_x && d->error == NULL; ++mx, ++mcu_count)
+        {
+            if (d->restartInterval != 0 && mcu_count != 0 && mcu_count % d->restartInterval == 0 && !restartJpegDecoder(d))
+            {
+                d->error = "missing restart marker";
+                break;
+            }
+
+            for (int i = 0; i < d->numComponents && d->error == NULL; ++i)
+            {
+                JpegComponent* c = &d->components[i];
+
+                for (int by = 0; by < c->v; ++by)
+                {
+                    for (int bx = 0; bx < c->h; ++bx)
+                    {
+                        ubyte_t* out = c->strip + (size_t)by * 8 * c->stripStride + ((size_t)mx * c->h + bx) * 8;
+
+                        if (!decodeJpegBlock(d, c, out, c->stripStride))
+                        {
+                            d->error = "corrupt entropy-coded data";
+                            by = c->v;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (d->error == NULL)
+        {
+            unsigned int y_strip = my * mcu_height;
+            unsigned int y_end = (y_strip + mcu_height < d->height ? y_strip + mcu_height : d->height);
+
+            storeJpegRows(d, image, y_strip, y_end, y_strip);
+        }
+    }
+
+    for (int i = 0; i < d->numComponents; ++i)
+        trackedFree(d->components[i].strip);
+
+    if (d->error != NULL)
+    {
+        deleteBitmapImage(image);
+        return NULL;
+    }
+
+    return image;
+}
+
+bool readJpegQuantTables(JpegDecoder* d, const ubyte_t* p, size_t length)
+{
+    while (length > 0)
+    {
+        int precision = p[0] >> 4, table = p[0] & 15;
+
+        size_t size = 1 + 64 * (precision ? 2 : 1);
+
+        if (table > 3 || precision > 1 || length < size)
+            return false;
+
+        for (int k = 0; k < 64; ++k)
+        {
+            int q = (precision ? readJpegUint16(p + 1 + 2 * k) : p[1 + k]);
+            int n = jpeg_zigzag[k];
+
+            // The IDCT's output is left scaled by 8.
+            d->quant[table][n] = (float)q * jpeg_aan_scales[n / 8] * jpeg_aan_scales[n % 8] / 8.0f;
+        }
+
+        d->quantDefined[table] = true;
+
+        p += size;
+        length -= size;
+    }
+
+    return true;
+}
+
+bool readJpegHuffmanTables(JpegDecoder* d, const ubyte_t* p, size_t length)
+{
+    while (length > 0)
+    {
+        if (length < 17)
+            return false;
+
+        int type = p[0] >> 4, table = p[0] & 15;
+
+        size_t total = 0;
+
+        for (int i = 0; i < 16; ++i)
+            total += p[1 + i];
+
+        if (type > 1 || table > 3 || length < 17 + total)
+            return false;
+
+        if (!buildJpegHuffman(type == 0 ? &d->dc[table] : &d->ac[table], p + 1, p + 17))
+            return false;
+
+        p += 17 + total;
+        length -= 17 + total;
+    }
+
+    return true;
+}
+
+bool readJpegFrame(JpegDecoder* d, const ubyte_t* p, size_t length)
+{
+    if (length < 6 || p[0] != 8)
+        return false;
+
+    d->height = readJpegUint16(p + 1);
+    d->width = readJpegUint16(p + 3);
+    d->numComponents = p[5];
+
+    if (d->width == 0 || d->height == 0 || (d->numComponents != 1 && d->numComponents != 3) ||
+        length < 6 + 3 * (size_t)d->numComponents)
+        return false;
+
+    d->hMax = d->vMax = 1;
+
+    for (int i = 0; i < d->numComponents; ++i)
+    {
+        JpegComponent* c = &d->components[i];
+
+        c->id = p[6 + 3 * i];
+        c->h = p[7 + 3 * i] >> 4;
+        c->v = p[7 + 3 * i] & 15;
+        c->quantTable = p[8 + 3 * i];
+
+        if (c->h < 1 || c->h > 4 || c->v < 1 || c->v > 4 || c->quantTable > 3)
+            return false;
+
+        d->hMax = (c->h > d->hMax ? c->h : d->hMax);
+        d->vMax = (c->v > d->vMax ? c->v : d->vMax);
+    }
+
+    // A single component is always coded one block at a time, whatever its declared sampling.
+    if (d->numComponents == 1)
+        d->components[0].h = d->components[0].v = d->hMax = d->vMax = 1;
+
+    for (int i = 0; i < d->numComponents; ++i)
+    {
+        JpegComponent* c = &d->components[i];
+
+        c->xShift = c->yShift = 0;
+
+        while ((c->h << c->xShift) < d->hMax)
+            c->xShift += 1;
+
+        while ((c->v << c->yShift) < d->vMax)
+            c->yShift += 1;
+
+        // Only power-of-2 subsampling ratios are supported.
+        if ((c->h << c->xShift) != d->hMax || (c->v << c->yShift) != d->vMax)
+            return false;
+    }
+
+    return true;
+}
+
+bool readJpegScanHeader(JpegDecoder* d, const ubyte_t* p, size_t length)
+{
+    if (length < 1 || p[0] != d->numComponents || length < 4 + 2 * (size_t)p[0])
+        return false;
+
+    for (int i = 0; i < d->numComponents; ++i)
+    {
+        JpegComponent* c = &d->components[i];
+
+        if (p[1 + 2 * i] != c->id)
+            return false;
+
+        c->dcTable = p[2 + 2 * i] >> 4;
+        c->acTable = p[2 + 2 * i] & 15;
+
+        if (c->dcTable > 3 || c->acTable > 3 || !d->dc[c->dcTable].defined || !d->ac[c->acTable].defined ||
+            !d->quantDefined[c->quantTable])
+            return false;
+    }
+
+    return true;
+}
+
+// Decodes a JPEG file held in memory. Returns NULL (after printing the reason) for corrupt or
+// unsupported images; `filename` is only used in error messages.
+BitmapImage* decodeJpegImage(const ubyte_t* data, size_t size, const char* filename)
+{
+    JpegDecoder* d = (JpegDecoder *)calloc(1, sizeof(JpegDecoder));
+
+    d->data = data;
+    d->size = size;
+    d->pos = 2;
+
+    bool has_frame = false;
+
+    BitmapImage* image = NULL;
+
+    if (!isJpegImage(data, size))
+        d->error = "missing start of image";
+
+    while (d->error == NULL && image == NULL)
+    {
+        // Markers may be preceded by any number of fill bytes.
+        while (d->pos < d->size && d->data[d->pos] == 0xFF && d->pos + 1 < d->size && d->data[d->pos + 1] == 0xFF)
+            d->pos += 1;
+
+        if (d->size - d->pos < 4 || d->data[d->pos] != 0xFF)
+        {
+            d->error = "truncated or missing marker";
+            break;
+        }
+
+        ubyte_t marker = d->data[d->pos + 1];
+
+        size_t length = readJpegUint16(d->data + d->pos + 2);
+
+        if (length < 2 || d->size - d->pos - 2 < length)
+        {
+            d->error = "truncated segment";
+            break;
+        }
+
+        const ubyte_t* segment = d->data + d->pos + 4;
+
+        length -= 2;
+        d->pos += 4 + length;
+
+        switch (marker)
+        {
+            case 0xDB:
+                if (!readJpegQuantTables(d, segment, length))
+                    d->error = "invalid quantization table";
+                break;
+
+            case 0xC4:
+                if (!readJpegHuffmanTables(d, segment, length))
+                    d->error = "invalid Huffman table";
+                break;
+
+            case 0xDD:
+                if (length < 2)
+                    d->error = "invalid restart interval";
+                else
+                    d->restartInterval = readJpegUint16(segment);
+                break;
+
+            case 0xC0:
+            case 0xC1:
+                if (has_frame || !readJpegFrame(d, segment, length))
+                    d->error = "invalid or unsupported frame";
+
+                has_frame = true;
+                break;
+
+            case 0xDA:
+                if (!has_frame || !readJpegScanHeader(d, segment, length))
+                    d->error = "invalid or unsupported (non-interleaved) scan";
+                else
+                    image = decodeJpegScan(d);
+                break;
+
+            case 0xC2:
+            case 0xC3:
+            case 0xC5: case 0xC6: case 0xC7:
+            case 0xC9: case 0xCA: case 0xCB:
+            case 0xCD: case 0xCE: case 0xCF:
+                d->error = "unsupported progressive, lossless or arithmetic coding";
+                break;
+
+            // Application data, comments, etc.
+            default:
+                break;
+        }
+    }
+
+    if (d->error != NULL)
+        fprintf(stderr, "Error: Invalid JPEG image (%s); Inspect \"%s\".\n", d->error, filename);
+
+    free(d);
+
+    return image;
+}
+
+#endif // JPEG_IMAGES_H
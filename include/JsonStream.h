@@ -0,0 +1,498 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+
+// Streaming (pull-based, SAX-style) JSON tokenizer over an in-memory buffer, e.g. a `MappedFile`.
+// Tokens are produced one at a time and point straight into the buffer, so no document tree is
+// ever built and memory use does not depend on the size of the input. The buffer does not need
+// to be null-terminated; every read is bounds-checked against its end.
+
+typedef enum JsonTokenType
+{
+    JSON_TOKEN_ERROR = 0,
+    JSON_TOKEN_END,
+    JSON_TOKEN_OBJECT_BEGIN,
+    JSON_TOKEN_OBJECT_END,
+    JSON_TOKEN_ARRAY_BEGIN,
+    JSON_TOKEN_ARRAY_END,
+    JSON_TOKEN_KEY,
+    JSON_TOKEN_STRING,
+    JSON_TOKEN_NUMBER,
+    JSON_TOKEN_TRUE,
+    JSON_TOKEN_FALSE,
+    JSON_TOKEN_NULL
+
+} JsonTokenType;
+
+typedef struct JsonToken
+{
+    JsonTokenType type;
+
+    // KEY and STRING tokens: the raw characters between the quotes. Escape sequences are
+    // left as-is; use `decodeJsonString` when `hasEscapes` is set.
+    const char* string;
+
+    size_t length;
+
+    bool hasEscapes;
+
+    // NUMBER tokens only.
+    double number;
+
+} JsonToken;
+
+typedef enum JsonStreamState
+{
+    JSON_EXPECT_VALUE = 0,
+    JSON_EXPECT_VALUE_OR_END,
+    JSON_EXPECT_KEY,
+    JSON_EXPECT_KEY_OR_END,
+    JSON_EXPECT_COMMA_OR_END,
+    JSON_EXPECT_EOF
+
+} JsonStreamState;
+
+#define JSON_STREAM_MAX_DEPTH 64
+
+typedef struct JsonStream
+{
+    const char* begin;
+    const char* cursor;
+    const char* end;
+
+    JsonStreamState state;
+
+    // Number of currently open containers and their opening characters ('{' or '[').
+    int depth;
+
+    char containers[JSON_STREAM_MAX_DEPTH];
+
+    // Set once a JSON_TOKEN_ERROR has been produced.
+    const char* errorMessage;
+    const char* errorPosition;
+
+} JsonStream;
+
+
+void initJsonStream(JsonStream* s, const char* data, size_t size)
+{
+    s->begin = data;
+    s->cursor = data;
+    s->end = data + size;
+    s->state = JSON_EXPECT_VALUE;
+    s->depth = 0;
+    s->errorMessage = NULL;
+    s->errorPosition = NULL;
+}
+
+JsonTokenType failJsonStream(JsonStream* s, JsonToken* t, const char* message)
+{
+    s->errorMessage = message;
+    s->errorPosition = s->cursor;
+    t->type = JSON_TOKEN_ERROR;
+    return JSON_TOKEN_ERROR;
+}
+
+// 1-based line and column of the stream's error (or of its cursor, if no error occurred).
+void getJsonStreamLocation(const JsonStream* s, int* line, int* column)
+{
+    const char* position = (s->errorPosition != NULL ? s->errorPosition : s->cursor);
+
+    *line = 1;
+    *column = 1;
+
+    for (const char* c = s->begin; c < position; ++c)
+    {
+        if (*c == '\n')
+        {
+            *line += 1;
+            *column = 1;
+        }
+        else
+        {
+            *column += 1;
+        }
+    }
+}
+
+void skipJsonWhitespace(JsonStream* s)
+{
+    while (s->cursor < s->end && (*s->cursor == ' ' || *s->cursor == '\n' || *s->cursor == '\r' || *s->cursor == '\t'))
+        ++s->cursor;
+}
+
+// State that follows a complete value, depending on whether it was nested in a container.
+void finishJsonValue(JsonStream* s)
+{
+    s->state = (s->depth == 0 ? JSON_EXPECT_EOF : JSON_EXPECT_COMMA_OR_END);
+}
+
+// Scans the string that starts at the cursor (on its opening quote).
+bool scanJsonString(JsonStream* s, JsonToken* t)
+{
+    const char* c = ++s->cursor;
+
+    t->hasEscapes = false;
+
+    for (;;)
+    {
+        const char* quote = (const char *)memchr(c, '"', (size_t)(s->end - c));
+
+        if (quote == NULL)
+            return false;
+
+        // The quote is escaped if it is preceded by an odd number of backslashes.
+        const char* b = quote;
+
+        while (b > s->cursor && b[-1] == '\\')
+            --b;
+
+        if (((quote - b) & 1) == 0)
+        {
+            t->string = s->cursor;
+            t->length = (size_t)(quote - s->cursor);
+            t->hasEscapes = (memchr(t->string, '\\', t->length) != NULL);
+
+            s->cursor = quote + 1;
+            return true;
+        }
+
+        c = quote + 1;
+    }
+}
+
+bool scanJsonNumber(JsonStream* s, JsonToken* t)
+{
+    char digits[64];
+
+    size_t n = 0;
+
+    const char* c = s->cursor;
+
+    while (c < s->end && ((*c >= '0' && *c <= '9') || *c == '-' || *c == '+' || *c == '.' || *c == 'e' || *c == 'E'))
+    {
+        if (n + 1 >= sizeof(digits))
+            return false;
+
+        digits[n++] = *c++;
+    }
+    digits[n] = '\0';
+
+    char* parsed_end;
+
+    t->number = strtod(digits, &parsed_end);
+
+    if (n == 0 || parsed_end != digits + n)
+        return false;
+
+    s->cursor = c;
+    return true;
+}
+
+bool scanJsonLiteral(JsonStream* s, const char* literal, size_t length)
+{
+    if ((size_t)(s->end - s->cursor) < length || memcmp(s->cursor, literal, length) != 0)
+        return false;
+
+    s->cursor += length;
+    return true;
+}
+
+// Produces the next token of the stream, which is also returned as the function's value.
+JsonTokenType nextJsonToken(JsonStream* s, JsonToken* t)
+{
+    if (s->errorMessage != NULL)
+    {
+        t->type = JSON_TOKEN_ERROR;
+        return JSON_TOKEN_ERROR;
+    }
+
+    for (;;)
+    {
+        skipJsonWhitespace(s);
+
+        if (s->cursor == s->end)
+        {
+            if (s->state != JSON_EXPECT_EOF)
+                return failJsonStream(s, t, "unexpected end of file");
+
+            t->type = JSON_TOKEN_END;
+            return JSON_TOKEN_END;
+        }
+
+        char c = *s->cursor;
+
+        switch (s->state)
+        {
+        case JSON_EXPECT_EOF:
+            return failJsonStream(s, t, "unexpected characters after the end of the document");
+
+        case JSON_EXPECT_COMMA_OR_END:
+            if (c == ',')
+            {
+                ++s->cursor;
+                s->state = (s->containers[s->depth - 1] == '{' ? JSON_EXPECT_KEY : JSON_EXPECT_VALUE);
+                continue;
+            }
+            break;
+
+        case JSON_EXPECT_KEY:
+        case JSON_EXPECT_KEY_OR_END:
+            if (c == '"')
+            {
+                if (!scanJsonString(s, t))
+                    return failJsonStream(s, t, "unterminated string");
+
+                skipJsonWhitespace(s);
+
+                if (s->cursor == s->end || *s->cursor != ':')
+                    return failJsonStream(s, t, "expected ':' after object key");
+
+                ++s->cursor;
+                s->state = JSON_EXPECT_VALUE;
+
+                t->type = JSON_TOKEN_KEY;
+                return JSON_TOKEN_KEY;
+            }
+            if (c != '}' || s->state == JSON_EXPECT_KEY)
+                return failJsonStream(s, t, "expected an object key");
+            break;
+
+        case JSON_EXPECT_VALUE_OR_END:
+            if (c == ']')
+                break;
+            s->state = JSON_EXPECT_VALUE;
+            continue;
+
+        case JSON_EXPECT_VALUE:
+            switch (c)
+            {
+            case '{':
+            case '[':
+                if (s->depth == JSON_STREAM_MAX_DEPTH)
+                    return failJsonStream(s, t, "maximum nesting depth exceeded");
+
+                s->containers[s->depth++] = c;
+                ++s->cursor;
+
+                s->state = (c == '{' ? JSON_EXPECT_KEY_OR_END : JSON_EXPECT_VALUE_OR_END);
+                t->type = (c == '{' ? JSON_TOKEN_OBJECT_BEGIN : JSON_TOKEN_ARRAY_BEGIN);
+                return t->type;
+
+            case '"':
+                if (!scanJsonString(s, t))
+                    return failJsonStream(s, t, "unterminated string");
+                t->type = JSON_TOKEN_STRING;
+                break;
+
+            case 't':
+                if (!scanJsonLiteral(s, "true", 4))
+                    return failJsonStream(s, t, "invalid literal");
+                t->type = JSON_TOKEN_TRUE;
+                break;
+
+            case 'f':
+                if (!scanJsonLiteral(s, "false", 5))
+                    return failJsonStream(s, t, "invalid literal");
+                t->type = JSON_TOKEN_FALSE;
+                break;
+
+            case 'n':
+                if (!scanJsonLiteral(s, "null", 4))
+                    return failJsonStream(s, t, "invalid literal");
+                t->type = JSON_TOKEN_NULL;
+                break;
+
+            default:
+                if (!scanJsonNumber(s, t))
+                    return failJsonStream(s, t, "invalid value");
+                t->type = JSON_TOKEN_NUMBER;
+                break;
+            }
+
+            finishJsonValue(s);
+            return t->type;
+        }
+
+        // Only closing brackets are left at this point.
+        if ((c != '}' && c != ']') || s->depth == 0 || s->containers[s->depth - 1] != (c == '}' ? '{' : '['))
+            return failJsonStream(s, t, "mismatched or unexpected closing bracket");
+
+        ++s->cursor;
+        --s->depth;
+        finishJsonValue(s);
+
+        t->type = (c == '}' ? JSON_TOKEN_OBJECT_END : JSON_TOKEN_ARRAY_END);
+        return t->type;
+    }
+}
+
+// Skips the rest of a value whose first token has just been read (a no-op for scalars).
+bool skipJsonValue(JsonStream* s, const JsonToken* first)
+{
+    if (first->type != JSON_TOKEN_OBJECT_BEGIN && first->type != JSON_TOKEN_ARRAY_BEGIN)
+        return first->type != JSON_TOKEN_ERROR;
+
+    int target_depth = s->depth - 1;
+
+    JsonToken t;
+
+    while (s->depth > target_depth)
+    {
+        if (nextJsonToken(s, &t) == JSON_TOKEN_ERROR)
+            return false;
+    }
+    return true;
+}
+
+// Appends the UTF-8 encoding of `codepoint` to `out`; returns the number of bytes written.
+size_t encodeUTF8(char* out, unsigned long codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        out[0] = (char)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800)
+    {
+        out[0] = (char)(0xC0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint < 0x10000)
+    {
+        out[0] = (char)(0xE0 | (codepoint >> 12));
+        out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (codepoint >> 18));
+    out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+unsigned long parseJsonHex4(const char* c)
+{
+    unsigned long value = 0;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        char h = c[i];
+
+        value <<= 4;
+
+        if (h >= '0' && h <= '9')
+            value |= (unsigned long)(h - '0');
+        else if (h >= 'a' && h <= 'f')
+            value |= (unsigned long)(h - 'a' + 10);
+        else if (h >= 'A' && h <= 'F')
+            value |= (unsigned long)(h - 'A' + 10);
+        else
+            return 0xFFFFFFFFUL;
+    }
+    return value;
+}
+
+// Copies a KEY/STRING token's contents into `*buffer` as a null-terminated string, decoding its
+// escape sequences. The buffer is (re)allocated as needed and may be reused across calls.
+// Returns the decoded length, or (size_t)-1 on a malformed escape sequence.
+size_t decodeJsonString(const JsonToken* t, char** buffer, size_t* capacity)
+{
+    // Decoding never makes a string longer.
+    if (*capacity < t->length + 1)
+    {
+        *capacity = (t->length + 1 > 2 * (*capacity) ? t->length + 1 : 2 * (*capacity));
+        *buffer = (char *)realloc(*buffer, *capacity);
+    }
+
+    if (!t->hasEscapes)
+    {
+        memcpy(*buffer, t->string, t->length);
+        (*buffer)[t->length] = '\0';
+        return t->length;
+    }
+
+    char* out = *buffer;
+
+    const char* c = t->string;
+    const char* end = t->string + t->length;
+
+    while (c < end)
+    {
+        if (*c != '\\')
+        {
+            *out++ = *c++;
+            continue;
+        }
+
+        if (++c == end)
+            return (size_t)-1;
+
+        switch (*c++)
+        {
+        case '"':  *out++ = '"';  break;
+        case '\\': *out++ = '\\'; break;
+        case '/':  *out++ = '/';  break;
+        case 'b':  *out++ = '\b'; break;
+        case 'f':  *out++ = '\f'; break;
+        case 'n':  *out++ = '\n'; break;
+        case 'r':  *out++ = '\r'; break;
+        case 't':  *out++ = '\t'; break;
+
+        case 'u':
+        {
+            if (end - c < 4)
+                return (size_t)-1;
+
+            unsigned long codepoint = parseJsonHex4(c);
+            c += 4;
+
+            // UTF-16 surrogate pair.
+            if (codepoint >= 0xD800 && codepoint <= 0xDBFF && end - c >= 6 && c[0] == '\\' && c[1] == 'u')
+            {
+                unsigned long low = parseJsonHex4(c + 2);
+
+                if (low >= 0xDC00 && low <= 0xDFFF)
+                {
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    c += 6;
+                }
+            }
+
+            if (codepoint > 0x10FFFF)
+                return (size_t)-1;
+
+            out += encodeUTF8(out, codepoint);
+            break;
+        }
+
+        default:
+            return (size_t)-1;
+        }
+    }
+
+    *out = '\0';
+
+    return (size_t)(out - *buffer);
+}
+
+// Compares a KEY/STRING token (without escape sequences) against a null-terminated string.
+bool jsonTokenEquals(const JsonToken* t, const char* string)
+{
+    size_t length = strlen(string);
+
+    return !t->hasEscapes && t->length == length && memcmp(t->string, string, length) == 0;
+}
+
+#endif // JSON_STREAM_H
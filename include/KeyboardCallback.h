@@ -16,6 +16,32 @@ bool alt_key_down;
 
 bool arrow_down_loaded;
 bool arrow_up_loaded;
+bool page_down_loaded;
+bool page_up_loaded;
+bool home_loaded;
+bool end_loaded;
+
+// Size of `typed_characters`; characters typed past it within a frame are dropped.
+#define KEYBOARD_TYPED_CAPACITY 64
+
+// While set (e.g. when a search field has focus), printable characters and backspace ('\b') are
+// queued in `typed_characters` for whoever reads them, instead of being held in `keystrokes`, so
+// that typing does not also move the camera or toggle menus.
+bool keyboard_text_input;
+
+char typed_characters[KEYBOARD_TYPED_CAPACITY];
+int num_typed_characters;
+
+// When set, key cooldowns and toggles are timed by `input_clock_millis`, which is advanced 
+// by a fixed step every frame, instead of by the wall clock (used for recording/replaying input).
+bool input_clock_fixed;
+uint64_t input_clock_millis;
+
+
+uint64_t getInputTimeMillis(void)
+{
+    return (input_clock_fixed ? input_clock_millis : getAbsoluteTimeMillis());
+}
 
 
 void initModuleKeyboardCallback(void)
@@ -26,6 +52,16 @@ void initModuleKeyboardCallback(void)
 
     arrow_down_loaded = false;
     arrow_up_loaded = false;
+    page_down_loaded = false;
+    page_up_loaded = false;
+    home_loaded = false;
+    end_loaded = false;
+
+    keyboard_text_input = false;
+    num_typed_characters = 0;
+
+    input_clock_fixed = false;
+    input_clock_millis = 0;
 
     // Used for keyboard input
     for (int i = 0; i < sizeof(keystrokes) / sizeof(keystrokes[0]); ++i)
@@ -33,8 +69,25 @@ void initModuleKeyboardCallback(void)
 }
 
 
+bool isTypedCharacter(unsigned char key)
+{
+    return keyboard_text_input && (isprint(key) || key == '\b' || key == 127);
+}
+
+void typeCharacter(unsigned char key)
+{
+    if (num_typed_characters < KEYBOARD_TYPED_CAPACITY)
+        typed_characters[num_typed_characters++] = (char)(key == 127 ? '\b' : key);
+}
+
 void callbackKeyboardDown(unsigned char key, int x, int y)
 {
+    if (isTypedCharacter(key))
+    {
+        typeCharacter(key);
+        return;
+    }
+
     int modifiers = glutGetModifiers();
 
     shift_key_down = ((modifiers & GLUT_ACTIVE_SHIFT) != 0 ? true : false);
@@ -57,7 +110,7 @@ void callbackSpecialKeyboard(int key, int x, int y)
     static uint64_t current_ms = 0;
 
 
-    if ((current_ms = getAbsoluteTimeMillis()) - cooldown_ts >= cooldown_ms)
+    if ((current_ms = getInputTimeMillis()) - cooldown_ts >= cooldown_ms)
     {
         cooldown_ts = current_ms;
 
@@ -66,6 +119,18 @@ void callbackSpecialKeyboard(int key, int x, int y)
         
         if (key == GLUT_KEY_UP)
             arrow_up_loaded = true;
+
+        if (key == GLUT_KEY_PAGE_DOWN)
+            page_down_loaded = true;
+
+        if (key == GLUT_KEY_PAGE_UP)
+            page_up_loaded = true;
+
+        if (key == GLUT_KEY_HOME)
+            home_loaded = true;
+
+        if (key == GLUT_KEY_END)
+            end_loaded = true;
     }
 }
 
@@ -84,11 +149,11 @@ void keyToggle(char key, bool* toggle_var, uint64_t timeout_ms)
         initialised = true;
     }
 
-    uint64_t elapsed_ms = getAbsoluteTimeMillis() - timestamp_prev[key];
+    uint64_t elapsed_ms = getInputTimeMillis() - timestamp_prev[key];
 
     if (keystrokes[key] && elapsed_ms >= timeout_ms)
     {
-        timestamp_prev[key] = getAbsoluteTimeMillis();
+        timestamp_prev[key] = getInputTimeMillis();
         *toggle_var = !(*toggle_var);
     }
 }
@@ -0,0 +1,189 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+// `posix_madvise`, which C11 without extensions hides; only if no system header came first.
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#   define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#endif
+
+
+// Read-only memory mapping of a whole file. The pages are loaded lazily by the OS as they are
+// accessed and, being backed by the file itself, can be evicted at any time, so even huge files
+// can be scanned front to back without reading them into heap memory first.
+typedef struct MappedFile
+{
+    // Start of the file's contents; NOT null-terminated. NULL for empty files.
+    const char* data;
+
+    size_t size;
+
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+
+} MappedFile;
+
+
+// Mapped file constructor (heap-allocated). Returns NULL if the file cannot be opened or mapped.
+// `sequential` hints the OS that the file is going to be read front to back.
+MappedFile* openMappedFile(const char* filename, bool sequential)
+{
+    MappedFile* f = (MappedFile *)malloc(sizeof(MappedFile));
+
+    f->data = NULL;
+    f->size = 0;
+
+#if defined(_WIN32)
+
+    f->mapping = NULL;
+    f->file = CreateFileA(
+        filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL), NULL
+    );
+
+    if (f->file == INVALID_HANDLE_VALUE)
+    {
+        free(f);
+        return NULL;
+    }
+
+    LARGE_INTEGER file_size;
+
+    if (!GetFileSizeEx(f->file, &file_size))
+    {
+        CloseHandle(f->file);
+        free(f);
+        return NULL;
+    }
+
+    f->size = (size_t)file_size.QuadPart;
+
+    if (f->size > 0)
+    {
+        f->mapping = CreateFileMappingA(f->file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        if (f->mapping != NULL)
+            f->data = (const char *)MapViewOfFile(f->mapping, FILE_MAP_READ, 0, 0, 0);
+
+        if (f->data == NULL)
+        {
+            if (f->mapping != NULL)
+                CloseHandle(f->mapping);
+            CloseHandle(f->file);
+            free(f);
+            return NULL;
+        }
+    }
+
+#else
+
+    f->fd = open(filename, O_RDONLY);
+
+    if (f->fd < 0)
+    {
+        free(f);
+        return NULL;
+    }
+
+    struct stat st;
+
+    if (fstat(f->fd, &st) != 0)
+    {
+        close(f->fd);
+        free(f);
+        return NULL;
+    }
+
+    f->size = (size_t)st.st_size;
+
+    if (f->size > 0)
+    {
+        void* addr = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, f->fd, 0);
+
+        if (addr == MAP_FAILED)
+        {
+            close(f->fd);
+            free(f);
+            return NULL;
+        }
+
+        if (sequential)
+            posix_madvise(addr, f->size, POSIX_MADV_SEQUENTIAL);
+
+        f->data = (const char *)addr;
+    }
+
+#endif
+
+    return f;
+}
+
+// Touches every page of the mapping, so that the file is read from disk by the calling thread
+// (e.g. a worker) rather than by whichever thread happens to access the data first.
+void prefetchMappedFile(const MappedFile* f)
+{
+    volatile char sink = 0;
+
+    for (size_t i = 0; i < f->size; i += 4096)
+        sink ^= f->data[i];
+
+    (void)sink;
+}
+
+// Size and modification time of a file; false if it does not exist.
+bool getFileStamp(const char* filename, uint64_t* size, int64_t* mtime)
+{
+    struct stat st;
+
+    if (stat(filename, &st) != 0)
+        return false;
+
+    *size = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+
+    return true;
+}
+
+void closeMappedFile(MappedFile* f)
+{
+    if (f == NULL)
+        return;
+
+#if defined(_WIN32)
+    if (f->data != NULL)
+        UnmapViewOfFile((LPCVOID)f->data);
+    if (f->mapping != NULL)
+        CloseHandle(f->mapping);
+    CloseHandle(f->file);
+#else
+    if (f->data != NULL)
+        munmap((void *)f->data, f->size);
+    close(f->fd);
+#endif
+
+    free(f);
+}
+
+#endif // MAPPED_FILE_H
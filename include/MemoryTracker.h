@@ -0,0 +1,230 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+
+// Accounting of the program's memory by subsystem. Heap allocations go through the tracked
+// allocator (`trackedMalloc`, ...), which remembers the size and tag of each block; video memory
+// (textures, buffers) cannot be measured, so its owners report estimates with `trackMemory` and
+// `untrackMemory` instead. Current and peak bytes are kept per tag, and a warning is logged
+// whenever a tag exceeds its budget (see `setMemoryBudget`). Thread-safe.
+
+typedef enum MemoryTag
+{
+    // Bodies, their names, arrays and texture requests.
+    MEMORY_TAG_BODIES = 0,
+    MEMORY_TAG_MENUS,
+    MEMORY_TAG_STARS,
+    // Decoded texture images, until they are uploaded.
+    MEMORY_TAG_IMAGES,
+    // Video memory (estimated): textures, and buffers and display lists.
+    MEMORY_TAG_TEXTURES,
+    MEMORY_TAG_BUFFERS,
+    MEMORY_NUM_TAGS
+
+} MemoryTag;
+
+const char* const memory_tag_names[MEMORY_NUM_TAGS] = {
+    "bodies",
+    "menus",
+    "stars",
+    "images",
+    "textures",
+    "buffers"
+};
+
+// The first tag of video memory; the ones before it are heap memory.
+#define MEMORY_FIRST_VIDEO_TAG MEMORY_TAG_TEXTURES
+
+atomic_size_t memory_current_bytes[MEMORY_NUM_TAGS];
+atomic_size_t memory_peak_bytes[MEMORY_NUM_TAGS];
+
+// 0 for no budget.
+atomic_size_t memory_budget_bytes[MEMORY_NUM_TAGS];
+
+// Set while a tag is over its budget, so that crossing it is only reported once.
+atomic_bool memory_over_budget[MEMORY_NUM_TAGS];
+
+// Precedes every tracked block; padded so that the blocks stay aligned for any type.
+typedef struct MemoryBlockHeader
+{
+    size_t size;
+
+    MemoryTag tag;
+
+} MemoryBlockHeader;
+
+#define MEMORY_BLOCK_HEADER_SIZE \
+    ((sizeof(MemoryBlockHeader) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1))
+
+
+// Returns the tag named `name` (see `memory_tag_names`), or MEMORY_NUM_TAGS if there is none.
+MemoryTag findMemoryTag(const char* name)
+{
+    for (int i = 0; i < MEMORY_NUM_TAGS; ++i)
+    {
+        if (strcmp(memory_tag_names[i], name) == 0)
+            return (MemoryTag)i;
+    }
+    return MEMORY_NUM_TAGS;
+}
+
+void setMemoryBudget(MemoryTag tag, size_t bytes)
+{
+    atomic_store(&memory_budget_bytes[tag], bytes);
+}
+
+void trackMemory(MemoryTag tag, size_t bytes)
+{
+    size_t current = atomic_fetch_add(&memory_current_bytes[tag], bytes) + bytes;
+
+    size_t peak = atomic_load(&memory_peak_bytes[tag]);
+
+    while (current > peak && !atomic_compare_exchange_weak(&memory_peak_bytes[tag], &peak, current))
+        ;
+
+    size_t budget = atomic_load(&memory_budget_bytes[tag]);
+
+    if (budget != 0 && current > budget && !atomic_exchange(&memory_over_budget[tag], true))
+    {
+        fprintf(
+            stderr, "Warning: Memory of the %s (%.2lf MiB) exceeds its budget of %.2lf MiB; Continuing.\n",
+            memory_tag_names[tag], (double)current / (1 << 20), (double)budget / (1 << 20)
+        );
+    }
+}
+
+void untrackMemory(MemoryTag tag, size_t bytes)
+{
+    size_t current = atomic_fetch_sub(&memory_current_bytes[tag], bytes) - bytes;
+
+    if (current <= atomic_load(&memory_budget_bytes[tag]))
+        atomic_store(&memory_over_budget[tag], false);
+}
+
+// `malloc` accounted to `tag`; the block must be released with `trackedFree` (or `trackedRealloc`).
+void* trackedMalloc(MemoryTag tag, size_t size)
+{
+    MemoryBlockHeader* header = (MemoryBlockHeader *)malloc(MEMORY_BLOCK_HEADER_SIZE + size);
+
+    if (header == NULL)
+        return NULL;
+
+    header->size = size;
+    header->tag = tag;
+
+    trackMemory(tag, size);
+
+    return (char *)header + MEMORY_BLOCK_HEADER_SIZE;
+}
+
+void* trackedCalloc(MemoryTag tag, size_t count, size_t size)
+{
+    void* block = trackedMalloc(tag, count * size);
+
+    if (block != NULL)
+        memset(block, 0, count * size);
+
+    return block;
+}
+
+void trackedFree(void* block)
+{
+    if (block == NULL)
+        return;
+
+    MemoryBlockHeader* header = (MemoryBlockHeader *)((char *)block - MEMORY_BLOCK_HEADER_SIZE);
+
+    untrackMemory(header->tag, header->size);
+
+    free(header);
+}
+
+// `realloc` of a tracked block (or NULL), which keeps its tag (`tag` for a new block).
+void* trackedRealloc(MemoryTag tag, void* block, size_t size)
+{
+    if (block == NULL)
+        return trackedMalloc(tag, size);
+
+    MemoryBlockHeader* header = (MemoryBlockHeader *)((char *)block - MEMORY_BLOCK_HEADER_SIZE);
+
+    tag = header->tag;
+
+    size_t old_size = header->size;
+
+    header = (MemoryBlockHeader *)realloc(header, MEMORY_BLOCK_HEADER_SIZE + size);
+
+    if (header == NULL)
+        return NULL;
+
+    header->size = size;
+
+    untrackMemory(tag, old_size);
+    trackMemory(tag, size);
+
+    return (char *)header + MEMORY_BLOCK_HEADER_SIZE;
+}
+
+// `strBuild` accounted to `tag`.
+char* trackedStrBuild(MemoryTag tag, const char* original_string)
+{
+    size_t str_length = strlen(original_string);
+
+    char* copy = (char *)trackedMalloc(tag, str_length + 1);
+
+    memcpy(copy, original_string, str_length + 1);
+
+    return copy;
+}
+
+// Writes the current memory of the heap tags (or of the video ones) on a single line, in MiB;
+// tags over their budget are marked with a '!'.
+void formatMemoryUsage(char* buffer, size_t buffer_size, bool video)
+{
+    int length = snprintf(buffer, buffer_size, "%s", (video ? "Video Memory (est.):" : "Memory:"));
+
+    int first = (video ? MEMORY_FIRST_VIDEO_TAG : 0);
+    int last = (video ? MEMORY_NUM_TAGS : MEMORY_FIRST_VIDEO_TAG);
+
+    for (int i = first; i < last && length >= 0 && (size_t)length < buffer_size; ++i)
+    {
+        length += snprintf(
+            buffer + length, buffer_size - (size_t)length, " %s %.1lf%s%s",
+            memory_tag_names[i], (double)atomic_load(&memory_current_bytes[i]) / (1 << 20),
+            (atomic_load(&memory_over_budget[i]) ? "!" : ""), (i + 1 < last ? "," : " MiB")
+        );
+    }
+}
+
+// Prints the current and peak memory of every tag, along with its budget.
+void printMemoryReport(void)
+{
+    printf("Memory (MiB)    current       peak     budget\n");
+
+    for (int i = 0; i < MEMORY_NUM_TAGS; ++i)
+    {
+        char budget[32] = "-";
+
+        if (atomic_load(&memory_budget_bytes[i]) != 0)
+            snprintf(budget, sizeof(budget), "%.2lf", (double)atomic_load(&memory_budget_bytes[i]) / (1 << 20));
+
+        printf(
+            "%-8s %6s %10.2lf %10.2lf %10s\n",
+            memory_tag_names[i], (i >= MEMORY_FIRST_VIDEO_TAG ? "(est.)" : ""),
+            (double)atomic_load(&memory_current_bytes[i]) / (1 << 20),
+            (double)atomic_load(&memory_peak_bytes[i]) / (1 << 20), budget
+        );
+    }
+}
+
+#endif // MEMORY_TRACKER_H
@@ -1,17 +1,28 @@
 #ifndef MENU_SCREEN_H
 #define MENU_SCREEN_H
 
+#include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <GL/freeglut.h>
 
 #include "Camera.h"
+#include "Profiler.h"
+#include "NameIndex.h"
 #include "CustomTypes.h"
+#include "MemoryTracker.h"
 #include "TextRendering.h"
 #include "KeyboardCallback.h"
 
 
+// Options shown at once; longer menus scroll along with the selection, and only the options in
+// view are rendered.
+#define MENU_SCREEN_MAX_VISIBLE_OPTIONS 15
+
+// Characters of a search, at most.
+#define MENU_SCREEN_SEARCH_CAPACITY 48
+
 typedef struct MenuScreen
 {
     const float* pWindowMatrix;
@@ -23,11 +34,27 @@ typedef struct MenuScreen
 
     char* title;
 
-    char** optionNames;
+    const char** optionNames;
+
+    // Whether the strings of `optionNames` belong to the menu (they are borrowed by `initMenuScreenList`).
+    bool ownsOptionNames;
 
     int charLenTitle;
 
+    // Position of the selected option within the listed ones, and of the first one in view.
     int currentlySelectedOptionIndex;
+    int firstVisibleOptionIndex;
+
+    // Searchable menus only (NULL otherwise): the options sorted by name, and what has been typed.
+    NameIndex* index;
+
+    char search[MENU_SCREEN_SEARCH_CAPACITY + 1];
+    int searchLength;
+
+    // The listed options: all of them, in order, while there is no search; otherwise those that
+    // start with it, in alphabetical order (`index->entries[firstMatch]` onwards).
+    int numListed;
+    int firstMatch;
 
 } MenuScreen;
 
@@ -35,19 +62,28 @@ typedef struct MenuScreen
 // Menu constructor #1 (heap-allocated).
 MenuScreen* initMenuScreen(const char* title, const float* p_window_matrix, const int n_options, ...)
 {
-    MenuScreen* m = (MenuScreen *)malloc(sizeof(MenuScreen));
+    MenuScreen* m = (MenuScreen *)trackedMalloc(MEMORY_TAG_MENUS, sizeof(MenuScreen));
 
     m->pWindowMatrix = p_window_matrix;
 
-    m->title = strBuild(title);
+    m->title = trackedStrBuild(MEMORY_TAG_MENUS, title);
 
     m->charLenTitle = (int)strlen(m->title);
 
     m->numOptions = n_options;
 
-    m->optionNames = (char **)malloc(n_options * sizeof(char *));
+    m->optionNames = (const char **)trackedMalloc(MEMORY_TAG_MENUS, n_options * sizeof(char *));
+    m->ownsOptionNames = true;
 
     m->currentlySelectedOptionIndex = 0;
+    m->firstVisibleOptionIndex = 0;
+
+    m->index = NULL;
+    m->search[0] = '\0';
+    m->searchLength = 0;
+
+    m->numListed = n_options;
+    m->firstMatch = 0;
 
 
     va_list optionStringsArgumentList;
@@ -58,7 +94,7 @@ MenuScreen* initMenuScreen(const char* title, const float* p_window_matrix, cons
     {
         const char* option = va_arg(optionStringsArgumentList, const char*);
 
-        m->optionNames[i] = strBuild(option);
+        m->optionNames[i] = trackedStrBuild(MEMORY_TAG_MENUS, option);
     }
 
     va_end(optionStringsArgumentList);
@@ -69,19 +105,28 @@ MenuScreen* initMenuScreen(const char* title, const float* p_window_matrix, cons
 // Menu constructor #2 (heap-allocated).
 MenuScreen* initMenuScreenEmpty(const char* title, const float* p_window_matrix, int n_options)
 {
-    MenuScreen* m = (MenuScreen *)malloc(sizeof(MenuScreen));
+    MenuScreen* m = (MenuScreen *)trackedMalloc(MEMORY_TAG_MENUS, sizeof(MenuScreen));
 
     m->pWindowMatrix = p_window_matrix;
 
-    m->title = strBuild(title);
+    m->title = trackedStrBuild(MEMORY_TAG_MENUS, title);
 
     m->charLenTitle = (int)strlen(m->title);
 
     m->numOptions = n_options;
 
-    m->optionNames = (char **)malloc(n_options * sizeof(char *));
-    
+    m->optionNames = (const char **)trackedMalloc(MEMORY_TAG_MENUS, n_options * sizeof(char *));
+    m->ownsOptionNames = true;
+
     m->currentlySelectedOptionIndex = 0;
+    m->firstVisibleOptionIndex = 0;
+
+    m->index = NULL;
+    m->search[0] = '\0';
+    m->searchLength = 0;
+
+    m->numListed = n_options;
+    m->firstMatch = 0;
 
 
     for (int i = 0; i < n_options; ++i) 
@@ -92,6 +137,37 @@ MenuScreen* initMenuScreenEmpty(const char* title, const float* p_window_matrix,
     return m;
 }
 
+// Menu constructor #3 (heap-allocated): a searchable list of `n_options` names. The menu takes over
+// the `option_names` array (allocated with `trackedMalloc`), but not the names themselves, which are
+// neither copied nor freed and must outlive it.
+MenuScreen* initMenuScreenList(const char* title, const float* p_window_matrix, const char** option_names, int n_options)
+{
+    MenuScreen* m = (MenuScreen *)trackedMalloc(MEMORY_TAG_MENUS, sizeof(MenuScreen));
+
+    m->pWindowMatrix = p_window_matrix;
+
+    m->title = trackedStrBuild(MEMORY_TAG_MENUS, title);
+
+    m->charLenTitle = (int)strlen(m->title);
+
+    m->numOptions = n_options;
+
+    m->optionNames = option_names;
+    m->ownsOptionNames = false;
+
+    m->currentlySelectedOptionIndex = 0;
+    m->firstVisibleOptionIndex = 0;
+
+    m->index = initNameIndex(MEMORY_TAG_MENUS, (const char* const*)option_names, n_options);
+    m->search[0] = '\0';
+    m->searchLength = 0;
+
+    m->numListed = n_options;
+    m->firstMatch = 0;
+
+    return m;
+}
+
 MenuScreen* setMenuScreenDimensions(MenuScreen* m, int width, int height)
 {
     m->screenWidth = width;
@@ -101,17 +177,23 @@ MenuScreen* setMenuScreenDimensions(MenuScreen* m, int width, int height)
 
 bool assignMenuScreenElement(MenuScreen* m, int idx, const char* option_at_idx)
 {
-    if (idx < 0 || idx > m->numOptions) {
+    if (idx < 0 || idx > m->numOptions || !m->ownsOptionNames) {
         return false;
     }
     if (m->optionNames[idx] != NULL) {
-        free(m->optionNames[idx]);
+        trackedFree((char *)m->optionNames[idx]);
     }
-    m->optionNames[idx] = strBuild(option_at_idx);
+    m->optionNames[idx] = trackedStrBuild(MEMORY_TAG_MENUS, option_at_idx);
 
     return true;
 }
 
+// Index (into `optionNames`) of the listed option at `position`.
+int getMenuScreenOption(const MenuScreen* m, int position)
+{
+    return (m->searchLength > 0 ? m->index->entries[m->firstMatch + position].id : position);
+}
+
 void renderMenuScreen(MenuScreen* m)
 {
     glMatrixMode(GL_PROJECTION);
@@ -125,9 +207,16 @@ void renderMenuScreen(MenuScreen* m)
 
     glColor4f(.3f, .3f, .3f, 0.5f);
 
+    int numVisible = m->numListed - m->firstVisibleOptionIndex;
+
+    if (numVisible > MENU_SCREEN_MAX_VISIBLE_OPTIONS)
+        numVisible = MENU_SCREEN_MAX_VISIBLE_OPTIONS;
 
-    float hiBorder = 0.5f + (m->numOptions / 2.0f + 1.0f) * .05f;
-    float loBorder = 0.5f - (m->numOptions / 2.0f + 1.0f) * .05f;
+    // Searchable menus have a line for the search, and one for a lack of matches.
+    int numLines = (m->index != NULL ? 1 + (numVisible > 0 ? numVisible : 1) : numVisible);
+
+    float hiBorder = 0.5f + (numLines / 2.0f + 1.0f) * .05f;
+    float loBorder = 0.5f - (numLines / 2.0f + 1.0f) * .05f;
 
     glBegin(GL_QUADS);
     {
@@ -146,6 +235,7 @@ void renderMenuScreen(MenuScreen* m)
         glVertex3f(0.40f * m->screenWidth, loBorder * m->screenHeight, .1f);
     }
     glEnd();
+    countDrawCalls(1);
 
     glTranslatef(.0f, .0f, .2f);
 
@@ -157,12 +247,36 @@ void renderMenuScreen(MenuScreen* m)
         (hiBorder - .04f) * m->screenHeight
     );
     glutBitmapString(GLUT_BITMAP_9_BY_15, (unsigned char*)m->title);
-
-    glColor4ub(255, 255, 255, 255);
+    countDrawCalls(1);
 
     float offset = hiBorder - .09f;
 
-    for (int i = 0; i < m->numOptions; ++i)
+    if (m->index != NULL)
+    {
+        static char search_line[MENU_SCREEN_SEARCH_CAPACITY + 64];
+
+        snprintf(search_line, sizeof(search_line), "Find: %s_ (%d/%d)", m->search, m->numListed, m->numOptions);
+
+        glColor4ub(160, 200, 255, 255);
+
+        glRasterPos2f(0.41f * m->screenWidth, offset * m->screenHeight);
+        glutBitmapString(GLUT_BITMAP_9_BY_15, (const unsigned char*)search_line);
+        countDrawCalls(1);
+
+        offset -= .05f;
+
+        if (m->numListed == 0)
+        {
+            glRasterPos2f(0.48f * m->screenWidth, offset * m->screenHeight);
+            glutBitmapString(GLUT_BITMAP_9_BY_15, (const unsigned char*)"(no matches)");
+            countDrawCalls(1);
+        }
+    }
+
+    glColor4ub(255, 255, 255, 255);
+
+    // Only the options in view are rendered, however many there are.
+    for (int i = m->firstVisibleOptionIndex; i < m->firstVisibleOptionIndex + numVisible; ++i)
     {
         if (i == m->currentlySelectedOptionIndex)
         {
@@ -175,8 +289,9 @@ void renderMenuScreen(MenuScreen* m)
         glRasterPos2f(0.48f * m->screenWidth, offset * m->screenHeight);
         glutBitmapString(
             GLUT_BITMAP_9_BY_15, 
-            (const unsigned char*)m->optionNames[i]
+            (const unsigned char*)m->optionNames[getMenuScreenOption(m, i)]
         );
+        countDrawCalls(1);
 
         // Move downwards
         offset -= .05f;
@@ -190,27 +305,112 @@ void renderMenuScreen(MenuScreen* m)
     glPopMatrix();
 }
 
+// Lists the options that start with the search (all of them without one), from the first.
+void filterMenuScreen(MenuScreen* m)
+{
+    if (m->searchLength > 0)
+        m->numListed = findNamePrefix(m->index, m->search, (size_t)m->searchLength, &m->firstMatch);
+    else
+        m->numListed = m->numOptions;
+
+    m->currentlySelectedOptionIndex = 0;
+    m->firstVisibleOptionIndex = 0;
+}
+
+// Forgets the search, listing every option again.
+void clearMenuScreenSearch(MenuScreen* m)
+{
+    m->searchLength = 0;
+    m->search[0] = '\0';
+
+    filterMenuScreen(m);
+}
+
+// Moves the selection by `delta` positions (clamped to the list), scrolling to keep it in view.
+void moveMenuScreenSelection(MenuScreen* m, int delta)
+{
+    int selected = m->currentlySelectedOptionIndex + delta;
+
+    if (selected > m->numListed - 1)
+        selected = m->numListed - 1;
+    if (selected < 0)
+        selected = 0;
+
+    m->currentlySelectedOptionIndex = selected;
+
+    if (selected < m->firstVisibleOptionIndex)
+        m->firstVisibleOptionIndex = selected;
+
+    if (selected >= m->firstVisibleOptionIndex + MENU_SCREEN_MAX_VISIBLE_OPTIONS)
+        m->firstVisibleOptionIndex = selected - MENU_SCREEN_MAX_VISIBLE_OPTIONS + 1;
+}
+
 const char* menuScreenHandler(MenuScreen* m, int* option_id)
 {
+    // Characters typed into a searchable menu narrow its list down (see `keyboard_text_input`).
+    if (m->index != NULL && num_typed_characters > 0)
+    {
+        for (int i = 0; i < num_typed_characters; ++i)
+        {
+            if (typed_characters[i] == '\b')
+            {
+                if (m->searchLength > 0)
+                    m->search[--m->searchLength] = '\0';
+            }
+            else if (m->searchLength < MENU_SCREEN_SEARCH_CAPACITY)
+            {
+                m->search[m->searchLength++] = typed_characters[i];
+                m->search[m->searchLength] = '\0';
+            }
+        }
+        num_typed_characters = 0;
+
+        filterMenuScreen(m);
+    }
+
     if (arrow_down_loaded)
     {
-        if (m->currentlySelectedOptionIndex < m->numOptions - 1)
-            m->currentlySelectedOptionIndex += 1;
+        moveMenuScreenSelection(m, 1);
         arrow_down_loaded = false;
     }
 
     if (arrow_up_loaded)
     {
-        if (m->currentlySelectedOptionIndex > 0)
-            m->currentlySelectedOptionIndex -= 1;
+        moveMenuScreenSelection(m, -1);
         arrow_up_loaded = false;
     }
 
-    if (keystrokes['\n'] || keystrokes['\f'] || keystrokes['\r'])
+    if (page_down_loaded)
+    {
+        moveMenuScreenSelection(m, MENU_SCREEN_MAX_VISIBLE_OPTIONS);
+        page_down_loaded = false;
+    }
+
+    if (page_up_loaded)
     {
+        moveMenuScreenSelection(m, -MENU_SCREEN_MAX_VISIBLE_OPTIONS);
+        page_up_loaded = false;
+    }
+
+    if (end_loaded)
+    {
+        moveMenuScreenSelection(m, m->numListed);
+        end_loaded = false;
+    }
+
+    if (home_loaded)
+    {
+        moveMenuScreenSelection(m, -m->numListed);
+        home_loaded = false;
+    }
+
+    if ((keystrokes['\n'] || keystrokes['\f'] || keystrokes['\r']) && m->numListed > 0)
+    {
+        int option = getMenuScreenOption(m, m->currentlySelectedOptionIndex);
+
         if (option_id != NULL)
-            *option_id = m->currentlySelectedOptionIndex;
-        return m->optionNames[m->currentlySelectedOptionIndex];
+            *option_id = option;
+        return m->optionNames[option];
     }
 
     return NULL;
@@ -218,14 +418,15 @@ const char* menuScreenHandler(MenuScreen* m, int* option_id)
 
 void deleteMenuScreen(MenuScreen* m)
 {
-    for (int i = 0; i < m->numOptions; ++i) 
+    for (int i = 0; i < m->numOptions && m->ownsOptionNames; ++i) 
     {
         if (m->optionNames[i] != NULL)
-            free(m->optionNames[i]);
+            trackedFree((char *)m->optionNames[i]);
     }
-    free(m->optionNames);
-    free(m->title);
-    free(m);
+    deleteNameIndex(m->index);
+    trackedFree(m->optionNames);
+    trackedFree(m->title);
+    trackedFree(m);
 }
 
 #endif // MENU_SCREEN_H
\ No newline at end of file
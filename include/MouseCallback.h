@@ -2,18 +2,38 @@
 #define MOUSE_CALLBACK_H
 
 #include <stdio.h>
+#include <stdbool.h>
 #include <GL/glut.h>
 
 #include "CustomTypes.h"
 
 
+// Distance from the cursor in pixels within which a click still picks a body.
+#define MOUSE_PICK_TOLERANCE_PIXELS 4.0
+
+// Set by a left click, along with its position in the view (both in [-1, 1], from the bottom-left
+// corner); the click is handled, and the flag cleared, by the next frame (see `display`).
+bool mouse_click_pending = false;
+
+float mouse_click_x;
+float mouse_click_y;
+
+
 void callbackMouse(int button, int state, int x, int y)
 {
     char* state_str = strBuild(state == GLUT_UP ? "UP" : "DOWN");
 
     if (button == GLUT_LEFT_BUTTON)
     {
-        printf("LMB %s\n", state_str);
+        if (state == GLUT_DOWN)
+        {
+            int width = glutGet(GLUT_WINDOW_WIDTH);
+            int height = glutGet(GLUT_WINDOW_HEIGHT);
+
+            mouse_click_pending = true;
+            mouse_click_x = (width > 0 ? 2.0f * (float)x / (float)width - 1.0f : .0f);
+            mouse_click_y = (height > 0 ? 1.0f - 2.0f * (float)y / (float)height : .0f);
+        }
     }
     else if (button == GLUT_RIGHT_BUTTON)
     {
@@ -0,0 +1,153 @@
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "MemoryTracker.h"
+
+
+// Case-insensitive sorted index over a list of names, for incremental (type-ahead) search: the
+// names starting with a given prefix are contiguous in the sorted order, so each search is a pair
+// of binary searches, O(log n) however many names there are. The names are not copied and must
+// outlive the index.
+
+typedef struct NameIndexEntry
+{
+    // The name's first 8 characters, lowercased, as a big-endian integer, so that most comparisons
+    // while sorting are settled without reading the name itself.
+    uint64_t key;
+
+    const char* name;
+
+    // Position of the name in the list the index was built from.
+    int id;
+
+} NameIndexEntry;
+
+typedef struct NameIndex
+{
+    // Sorted by lowercased name, then by id.
+    NameIndexEntry* entries;
+
+    int count;
+
+} NameIndex;
+
+
+uint64_t getNameIndexKey(const char* name)
+{
+    uint64_t key = 0;
+
+    // Each character into its own byte, from the most significant one, so that shorter names are
+    // padded with zeros (and the empty name is 0).
+    for (int i = 0; i < 8 && name[i] != '\0'; ++i)
+        key |= (uint64_t)(uint8_t)tolower((unsigned char)name[i]) << (8 * (7 - i));
+
+    return key;
+}
+
+// Compares at most `length` characters of `a` and `b`, ignoring case (like `strncasecmp`).
+int compareNamesIgnoringCase(const char* a, const char* b, size_t length)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        int ca = tolower((unsigned char)a[i]);
+        int cb = tolower((unsigned char)b[i]);
+
+        if (ca != cb || ca == '\0')
+            return ca - cb;
+    }
+    return 0;
+}
+
+int compareNameIndexEntries(const void* a, const void* b)
+{
+    const NameIndexEntry* x = (const NameIndexEntry *)a;
+    const NameIndexEntry* y = (const NameIndexEntry *)b;
+
+    if (x->key != y->key)
+        return (x->key < y->key ? -1 : 1);
+
+    // Equal keys with a terminator in them are equal names (up to case).
+    int order = ((x->key & 0xFF) != 0 ? compareNamesIgnoringCase(x->name + 8, y->name + 8, SIZE_MAX) : 0);
+
+    if (order != 0)
+        return order;
+
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Name index constructor (heap-allocated) over `names[0]` to `names[count - 1]`, accounted to `tag`.
+NameIndex* initNameIndex(MemoryTag tag, const char* const* names, int count)
+{
+    NameIndex* x = (NameIndex *)trackedMalloc(tag, sizeof(NameIndex));
+
+    x->count = count;
+    x->entries = (NameIndexEntry *)trackedMalloc(tag, ((size_t)count + 1) * sizeof(NameIndexEntry));
+
+    for (int i = 0; i < count; ++i)
+    {
+        x->entries[i].key = getNameIndexKey(names[i]);
+        x->entries[i].name = names[i];
+        x->entries[i].id = i;
+    }
+
+    qsort(x->entries, (size_t)count, sizeof(NameIndexEntry), compareNameIndexEntries);
+
+    return x;
+}
+
+// Finds the names that start with the first `length` characters of `prefix` (ignoring case): they
+// are `entries[*first]` to `entries[*first + n - 1]`, where `n` is returned.
+int findNamePrefix(const NameIndex* x, const char* prefix, size_t length, int* first)
+{
+    // First name not before the prefix.
+    int lo = 0;
+    int hi = x->count;
+
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+
+        if (compareNamesIgnoringCase(x->entries[mid].name, prefix, length) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *first = lo;
+
+    // First name after every one that starts with the prefix.
+    hi = x->count;
+
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+
+        if (compareNamesIgnoringCase(x->entries[mid].name, prefix, length) == 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo - *first;
+}
+
+void deleteNameIndex(NameIndex* x)
+{
+    if (x == NULL)
+        return;
+
+    trackedFree(x->entries);
+    trackedFree(x);
+}
+
+#endif // NAME_INDEX_H
@@ -0,0 +1,205 @@
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+
+// Interned string table: every distinct name is stored once, in a single growing character
+// pool, and is identified by a dense integer id (0, 1, 2, ... in order of first appearance).
+// Lookups go through an open-addressing (linear probing) hash index of FNV-1a hashes, so
+// resolving a name costs O(1) on average regardless of the number of names.
+
+typedef struct NameTable
+{
+    // Null-terminated names, back to back.
+    char* pool;
+
+    size_t poolSize;
+    size_t poolCapacity;
+
+    // Offset into `pool` and hash of each name, indexed by id.
+    size_t* offsets;
+    uint32_t* hashes;
+
+    int count;
+    int capacity;
+
+    // Hash index: id + 1 of the name stored in each slot, 0 for empty slots.
+    // The number of slots is a power of 2 and is kept at least twice the number of names.
+    int* slots;
+
+    size_t numSlots;
+
+} NameTable;
+
+
+uint32_t hashNameFNV1a(const char* name, size_t length)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Name table constructor (heap-allocated); `expected_count` is only a sizing hint.
+NameTable* initNameTable(int expected_count)
+{
+    NameTable* t = (NameTable *)malloc(sizeof(NameTable));
+
+    t->capacity = (expected_count > 16 ? expected_count : 16);
+    t->count = 0;
+
+    t->offsets = (size_t *)malloc((size_t)t->capacity * sizeof(size_t));
+    t->hashes = (uint32_t *)malloc((size_t)t->capacity * sizeof(uint32_t));
+
+    t->poolCapacity = (size_t)t->capacity * 16;
+    t->poolSize = 0;
+    t->pool = (char *)malloc(t->poolCapacity);
+
+    t->numSlots = 32;
+
+    while (t->numSlots < 2 * (size_t)t->capacity)
+        t->numSlots *= 2;
+
+    t->slots = (int *)calloc(t->numSlots, sizeof(int));
+
+    return t;
+}
+
+const char* getName(const NameTable* t, int id)
+{
+    return t->pool + t->offsets[id];
+}
+
+// Returns the id of the given name, or -1 if it has not been interned.
+int findNameN(const NameTable* t, const char* name, size_t length)
+{
+    uint32_t hash = hashNameFNV1a(name, length);
+
+    size_t mask = t->numSlots - 1;
+
+    for (size_t slot = hash & mask; t->slots[slot] != 0; slot = (slot + 1) & mask)
+    {
+        int id = t->slots[slot] - 1;
+
+        if (t->hashes[id] != hash)
+            continue;
+
+        const char* candidate = getName(t, id);
+
+        if (strncmp(candidate, name, length) == 0 && candidate[length] == '\0')
+            return id;
+    }
+    return -1;
+}
+
+int findName(const NameTable* t, const char* name)
+{
+    return findNameN(t, name, strlen(name));
+}
+
+// Doubles the hash index and reinserts every name.
+void growNameTableIndex(NameTable* t)
+{
+    free(t->slots);
+
+    t->numSlots *= 2;
+    t->slots = (int *)calloc(t->numSlots, sizeof(int));
+
+    size_t mask = t->numSlots - 1;
+
+    for (int id = 0; id < t->count; ++id)
+    {
+        size_t slot = t->hashes[id] & mask;
+
+        while (t->slots[slot] != 0)
+            slot = (slot + 1) & mask;
+
+        t->slots[slot] = id + 1;
+    }
+}
+
+// Returns the id of the given name, adding it to the table if it is not already there.
+// `inserted` (optional) reports whether the name was new.
+int internNameN(NameTable* t, const char* name, size_t length, bool* inserted)
+{
+    int id = findNameN(t, name, length);
+
+    if (inserted != NULL)
+        *inserted = (id < 0);
+
+    if (id >= 0)
+        return id;
+
+    if (t->count == t->capacity)
+    {
+        t->capacity *= 2;
+        t->offsets = (size_t *)realloc(t->offsets, (size_t)t->capacity * sizeof(size_t));
+        t->hashes = (uint32_t *)realloc(t->hashes, (size_t)t->capacity * sizeof(uint32_t));
+    }
+
+    if (t->poolSize + length + 1 > t->poolCapacity)
+    {
+        while (t->poolSize + length + 1 > t->poolCapacity)
+            t->poolCapacity *= 2;
+
+        t->pool = (char *)realloc(t->pool, t->poolCapacity);
+    }
+
+    id = t->count++;
+
+    t->offsets[id] = t->poolSize;
+    t->hashes[id] = hashNameFNV1a(name, length);
+
+    memcpy(t->pool + t->poolSize, name, length);
+    t->pool[t->poolSize + length] = '\0';
+    t->poolSize += length + 1;
+
+    if (2 * (size_t)t->count > t->numSlots)
+    {
+        growNameTableIndex(t);
+    }
+    else
+    {
+        size_t mask = t->numSlots - 1;
+        size_t slot = t->hashes[id] & mask;
+
+        while (t->slots[slot] != 0)
+            slot = (slot + 1) & mask;
+
+        t->slots[slot] = id + 1;
+    }
+
+    return id;
+}
+
+int internName(NameTable* t, const char* name, bool* inserted)
+{
+    return internNameN(t, name, strlen(name), inserted);
+}
+
+void deleteNameTable(NameTable* t)
+{
+    if (t == NULL)
+        return;
+
+    free(t->pool);
+    free(t->offsets);
+    free(t->hashes);
+    free(t->slots);
+    free(t);
+}
+
+#endif // NAME_TABLE_H
@@ -0,0 +1,408 @@
+#ifndef ORBIT_TRAILS_H
+#define ORBIT_TRAILS_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <GL/glut.h>
+
+#include "Profiler.h"
+#include "Transform.h"
+#include "JobSystem.h"
+#include "CustomTypes.h"
+#include "MemoryTracker.h"
+#include "StellarObject.h"
+
+
+// The paths the bodies actually travelled, as opposed to the ideal circles of their trajectories
+// around their parents: e.g. the Moon's loops along the Earth's orbit around the Sun. Every body's
+// recent positions are kept in a ring buffer of `ORBIT_TRAIL_CAPACITY` samples, all of them slots of
+// a single pool that is allocated once per set of bodies, so memory does not grow with time. A new
+// sample is only recorded once the body's path has turned by `ORBIT_TRAIL_TURN_ANGLE` since the last
+// one: straight stretches take few samples and tight turns many, and a trail covers as many turns
+// of its body's path, however fast the simulation runs.
+//
+// The trails are drawn as lines from each sample to the next and on to the body, fading out towards
+// the oldest sample, all of them with a single draw call.
+
+// Samples per body.
+#define ORBIT_TRAIL_CAPACITY 128
+
+// Turn (degrees) of a body's path between two samples.
+#define ORBIT_TRAIL_TURN_ANGLE 2.0
+
+// Opacity of the trails at their bodies, out of 255.
+#define ORBIT_TRAIL_ALPHA 160
+
+// Bodies per job of `recordOrbitTrails` and `renderOrbitTrails`.
+#define ORBIT_TRAIL_GRAIN 256
+
+typedef struct OrbitTrail
+{
+    // Ring buffer slot of the newest sample, and number of samples.
+    int head;
+    int count;
+
+    // The newest sample, at full precision, and the direction (normalized) the body left it in; all
+    // zero until the body has moved away from it.
+    vector3r last;
+    vector3r direction;
+
+} OrbitTrail;
+
+typedef struct OrbitTrailVertex
+{
+    float position[3];
+
+    GLubyte color[4];
+
+} OrbitTrailVertex;
+
+typedef struct OrbitTrails
+{
+    // The recorded bodies (not owned), copied: the trails must be rebuilt whenever the bodies change,
+    // by which time their array may be gone.
+    StellarObject** bodies;
+
+    int numBodies;
+
+    OrbitTrail* trails;
+
+    // `ORBIT_TRAIL_CAPACITY` samples per body, in the order of `bodies`.
+    vector3f* samples;
+
+    // Line vertices of the trails in view, as of the last rendering: each trail's lines start at
+    // `firstVertices[i]`, and `firstVertices[numBodies]` is the total. `vertices` only grows, up to
+    // two per sample.
+    OrbitTrailVertex* vertices;
+
+    int* firstVertices;
+
+    int vertexCapacity;
+
+    vector4f planes[6];
+
+} OrbitTrails;
+
+
+void clearOrbitTrail(OrbitTrail* trail)
+{
+    trail->head = -1;
+    trail->count = 0;
+
+    memset(trail->last, 0, sizeof(trail->last));
+    memset(trail->direction, 0, sizeof(trail->direction));
+}
+
+void deleteOrbitTrails(OrbitTrails* t)
+{
+    if (t == NULL)
+        return;
+
+    trackedFree(t->vertices);
+    trackedFree(t->firstVertices);
+    trackedFree(t->samples);
+    trackedFree(t->trails);
+    trackedFree(t->bodies);
+    trackedFree(t);
+}
+
+// Allocates a trail for every body, carrying those of `previous` over for the bodies it shares with
+// them (e.g. when a system is reloaded or paged in), which it then deletes. `previous` may be NULL.
+OrbitTrails* initOrbitTrails(StellarObject* const* bodies, int num_bodies, OrbitTrails* previous)
+{
+    OrbitTrails* t = (OrbitTrails *)trackedMalloc(MEMORY_TAG_BODIES, sizeof(OrbitTrails));
+
+    t->bodies = (StellarObject **)trackedMalloc(MEMORY_TAG_BODIES, ((size_t)num_bodies + 1) * sizeof(StellarObject *));
+    t->numBodies = num_bodies;
+
+    memcpy(t->bodies, bodies, (size_t)num_bodies * sizeof(StellarObject *));
+
+    t->trails = (OrbitTrail *)trackedMalloc(MEMORY_TAG_BODIES, ((size_t)num_bodies + 1) * sizeof(OrbitTrail));
+    t->samples = (vector3f *)trackedMalloc(MEMORY_TAG_BODIES, ((size_t)num_bodies * ORBIT_TRAIL_CAPACITY + 1) * sizeof(vector3f));
+    t->firstVertices = (int *)trackedCalloc(MEMORY_TAG_BODIES, (size_t)num_bodies + 1, sizeof(int));
+
+    t->vertices = NULL;
+    t->vertexCapacity = 0;
+
+    for (int i = 0; i < num_bodies; ++i)
+    {
+        StellarObject* p = bodies[i];
+
+        int j = p->trailIndex;
+
+        // Bodies know their slot in the previous trails, as long as it was them that had it.
+        if (previous != NULL && j >= 0 && j < previous->numBodies && previous->bodies[j] == p)
+        {
+            t->trails[i] = previous->trails[j];
+
+            memcpy(
+                &t->samples[(size_t)i * ORBIT_TRAIL_CAPACITY],
+                &previous->samples[(size_t)j * ORBIT_TRAIL_CAPACITY],
+                ORBIT_TRAIL_CAPACITY * sizeof(vector3f)
+            );
+        }
+        else
+        {
+            clearOrbitTrail(&t->trails[i]);
+        }
+
+        p->trailIndex = i;
+    }
+
+    deleteOrbitTrails(previous);
+
+    return t;
+}
+
+void pushOrbitTrailSample(OrbitTrails* t, int i, const vector3r position)
+{
+    OrbitTrail* trail = &t->trails[i];
+
+    trail->head = (trail->head + 1) % ORBIT_TRAIL_CAPACITY;
+
+    if (trail->count < ORBIT_TRAIL_CAPACITY)
+        trail->count += 1;
+
+    float* sample = t->samples[(size_t)i * ORBIT_TRAIL_CAPACITY + (size_t)trail->head];
+
+    for (int a = 0; a < 3; ++a)
+        sample[a] = (float)position[a];
+
+    memcpy(trail->last, position, sizeof(vector3r));
+    memset(trail->direction, 0, sizeof(trail->direction));
+}
+
+// Records the body's position if its path has turned far enough since the last sample.
+void recordOrbitTrail(OrbitTrails* t, int i)
+{
+    const StellarObject* p = t->bodies[i];
+
+    OrbitTrail* trail = &t->trails[i];
+
+    // Bodies without a parent do not move.
+    if (p->parent == NULL)
+        return;
+
+    if (trail->count == 0)
+    {
+        pushOrbitTrailSample(t, i, p->position);
+        return;
+    }
+
+    vector3r offset;
+
+    for (int a = 0; a < 3; ++a)
+        offset[a] = p->position[a] - trail->last[a];
+
+    real_t length = (real_t)sqrt((double)(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]));
+
+    if (length == (real_t).0)
+        return;
+
+    for (int a = 0; a < 3; ++a)
+        offset[a] /= length;
+
+    // The direction the body left the last sample in is that of its first move away from it.
+    if (trail->direction[0] == (real_t).0 && trail->direction[1] == (real_t).0 && trail->direction[2] == (real_t).0)
+    {
+        memcpy(trail->direction, offset, sizeof(vector3r));
+        return;
+    }
+
+    // The chord from the last sample turns half as much as the path itself does.
+    real_t cos_turn = offset[0] * trail->direction[0] + offset[1] * trail->direction[1] + offset[2] * trail->direction[2];
+
+    if (cos_turn < (real_t)cos(ORBIT_TRAIL_TURN_ANGLE * (M_PI / 360.0)))
+        pushOrbitTrailSample(t, i, p->position);
+}
+
+void recordOrbitTrailRange(void* data, int begin, int end)
+{
+    OrbitTrails* t = (OrbitTrails *)data;
+
+    for (int i = begin; i < end; ++i)
+        recordOrbitTrail(t, i);
+}
+
+// Samples the bodies' paths, in parallel. Must follow the bodies' update.
+void recordOrbitTrails(JobSystem* js, OrbitTrails* t)
+{
+    parallelFor(js, 0, t->numBodies, ORBIT_TRAIL_GRAIN, recordOrbitTrailRange, t);
+}
+
+// Moves every trail along with the world's origin (see `updateUniverse`), so that they stay where
+// their bodies were.
+void shiftOrbitTrails(OrbitTrails* t, const vector3r shift)
+{
+    if (shift[0] == (real_t).0 && shift[1] == (real_t).0 && shift[2] == (real_t).0)
+        return;
+
+    for (int i = 0; i < t->numBodies; ++i)
+    {
+        OrbitTrail* trail = &t->trails[i];
+
+        for (int a = 0; a < 3; ++a)
+            trail->last[a] -= shift[a];
+    }
+
+    // Slots not in use are written before they are read, so they may as well move too.
+    for (size_t k = 0; k < (size_t)t->numBodies * ORBIT_TRAIL_CAPACITY; ++k)
+    {
+        for (int a = 0; a < 3; ++a)
+            t->samples[k][a] = (float)((real_t)t->samples[k][a] - shift[a]);
+    }
+}
+
+// Sample `k` of trail `i`, from its oldest (0) to its newest (count - 1).
+const float* getOrbitTrailSample(const OrbitTrails* t, int i, int k)
+{
+    const OrbitTrail* trail = &t->trails[i];
+
+    int slot = (trail->head - (trail->count - 1) + k + ORBIT_TRAIL_CAPACITY) % ORBIT_TRAIL_CAPACITY;
+
+    return t->samples[(size_t)i * ORBIT_TRAIL_CAPACITY + (size_t)slot];
+}
+
+// Whether the box around the trail's samples and its body may be in view.
+bool isOrbitTrailVisible(const OrbitTrails* t, int i)
+{
+    const OrbitTrail* trail = &t->trails[i];
+
+    float lo[3], hi[3];
+
+    for (int a = 0; a < 3; ++a)
+        lo[a] = hi[a] = (float)t->bodies[i]->position[a];
+
+    for (int k = 0; k < trail->count; ++k)
+    {
+        const float* sample = getOrbitTrailSample(t, i, k);
+
+        for (int a = 0; a < 3; ++a)
+        {
+            lo[a] = fminf(lo[a], sample[a]);
+            hi[a] = fmaxf(hi[a], sample[a]);
+        }
+    }
+
+    float half[3] = { .5f * (hi[0] - lo[0]), .5f * (hi[1] - lo[1]), .5f * (hi[2] - lo[2]) };
+
+    return isSphereInFrustum(
+        t->planes, lo[0] + half[0], lo[1] + half[1], lo[2] + half[2],
+        sqrtf(half[0] * half[0] + half[1] * half[1] + half[2] * half[2])
+    );
+}
+
+void countOrbitTrailVertexRange(void* data, int begin, int end)
+{
+    OrbitTrails* t = (OrbitTrails *)data;
+
+    // The counts are shifted by one, into the slot that the prefix sum turns into the next start.
+    for (int i = begin; i < end; ++i)
+        t->firstVertices[i + 1] = (t->trails[i].count > 0 && isOrbitTrailVisible(t, i) ? 2 * t->trails[i].count : 0);
+}
+
+void fillOrbitTrailVertexRange(void* data, int begin, int end)
+{
+    OrbitTrails* t = (OrbitTrails *)data;
+
+    for (int i = begin; i < end; ++i)
+    {
+        int count = (t->firstVertices[i + 1] - t->firstVertices[i]) / 2;
+
+        if (count == 0)
+            continue;
+
+        const StellarObject* p = t->bodies[i];
+
+        OrbitTrailVertex* v = &t->vertices[t->firstVertices[i]];
+
+        // A line per sample, to the next one or to the body, fading out from the body backwards.
+        for (int k = 0; k < count; ++k, v += 2)
+        {
+            const float* from = getOrbitTrailSample(t, i, k);
+
+            memcpy(v[0].position, from, sizeof(vector3f));
+
+            if (k + 1 < count)
+            {
+                memcpy(v[1].position, getOrbitTrailSample(t, i, k + 1), sizeof(vector3f));
+            }
+            else
+            {
+                for (int a = 0; a < 3; ++a)
+                    v[1].position[a] = (float)p->position[a];
+            }
+
+            for (int e = 0; e < 2; ++e)
+            {
+                memcpy(v[e].color, p->color, sizeof(vector3ub));
+                v[e].color[3] = (GLubyte)(ORBIT_TRAIL_ALPHA * (k + e) / count);
+            }
+        }
+    }
+}
+
+// Draws the trails that may be within the view of `view_projection`, with a single draw call. The
+// camera's view-projection matrix is expected to be loaded into GL_PROJECTION already.
+void renderOrbitTrails(JobSystem* js, OrbitTrails* t, const matrix4f view_projection)
+{
+    extractFrustumPlanes4f(t->planes, view_projection);
+
+    t->firstVertices[0] = 0;
+
+    parallelFor(js, 0, t->numBodies, ORBIT_TRAIL_GRAIN, countOrbitTrailVertexRange, t);
+
+    for (int i = 0; i < t->numBodies; ++i)
+        t->firstVertices[i + 1] += t->firstVertices[i];
+
+    int num_vertices = t->firstVertices[t->numBodies];
+
+    if (num_vertices == 0)
+        return;
+
+    if (num_vertices > t->vertexCapacity)
+    {
+        t->vertexCapacity = num_vertices;
+        t->vertices = (OrbitTrailVertex *)trackedRealloc(MEMORY_TAG_BODIES, t->vertices, (size_t)t->vertexCapacity * sizeof(OrbitTrailVertex));
+    }
+
+    parallelFor(js, 0, t->numBodies, ORBIT_TRAIL_GRAIN, fillOrbitTrailVertexRange, t);
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    // Lines are blended over what is behind them, without hiding what is drawn after them.
+    glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    glVertexPointer(3, GL_FLOAT, sizeof(OrbitTrailVertex), t->vertices[0].position);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(OrbitTrailVertex), t->vertices[0].color);
+
+    glDrawArrays(GL_LINES, 0, num_vertices);
+    countDrawCalls(1);
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    glPopAttrib();
+
+    glPopMatrix();
+}
+
+#endif // ORBIT_TRAILS_H
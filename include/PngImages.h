@@ -0,0 +1,465 @@
+#ifndef PNG_IMAGES_H
+#define PNG_IMAGES_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "Inflate.h"
+#include "CustomTypes.h"
+#include "BitmapImages.h"
+#include "MemoryTracker.h"
+
+
+// PNG decoder. Supports every standard color type and bit depth (16-bit samples are truncated to
+// 8 bits) as well as Adam7 interlacing. The image data is inflated in one go (see `Inflate.h`),
+// then each row is unfiltered in place and written straight into a `BitmapImage`, i.e. bottom-up
+// and in BGR(A) order. Palette transparency (tRNS) yields BGRA pixels; color-key transparency for
+// grayscale and truecolor images is ignored.
+
+#define PNG_COLOR_GRAY 0
+#define PNG_COLOR_RGB 2
+#define PNG_COLOR_PALETTE 3
+#define PNG_COLOR_GRAY_ALPHA 4
+#define PNG_COLOR_RGBA 6
+
+const ubyte_t png_signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+// Origin (x, y) and spacing (dx, dy) of the pixels of each Adam7 pass.
+const unsigned int png_adam7_passes[7][4] = {
+    { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+};
+
+typedef struct PngHeader
+{
+    unsigned int width;
+    unsigned int height;
+
+    unsigned int bitDepth;
+    unsigned int colorType;
+    unsigned int interlace;
+
+    // Samples per pixel, and bytes per pixel as far as filtering is concerned (at least 1).
+    unsigned int channels;
+    unsigned int filterStride;
+
+    // Palette entries (RGBA), for indexed images.
+    ubyte_t palette[256][4];
+
+    unsigned int paletteSize;
+
+    bool hasAlpha;
+
+} PngHeader;
+
+
+uint32_t readPngUint32(const ubyte_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+bool isPngImage(const ubyte_t* data, size_t size)
+{
+    return (size >= sizeof(png_signature) && memcmp(data, png_signature, sizeof(png_signature)) == 0);
+}
+
+// Bytes per row of a pass (or of the whole image), without the filter type byte.
+size_t getPngRowSize(const PngHeader* h, unsigned int width)
+{
+    return ((size_t)width * h->channels * h->bitDepth + 7) / 8;
+}
+
+void getPngPassSize(const PngHeader* h, int pass, unsigned int* width, unsigned int* height)
+{
+    if (h->interlace == 0)
+    {
+        *width = h->width;
+        *height = h->height;
+        return;
+    }
+
+    const unsigned int* p = png_adam7_passes[pass];
+
+    *width = (h->width > p[0] ? (h->width - p[0] + p[2] - 1) / p[2] : 0);
+    *height = (h->height > p[1] ? (h->height - p[1] + p[3] - 1) / p[3] : 0);
+}
+
+ubyte_t paethPredictor(int a, int b, int c)
+{
+    int p = a + b - c;
+
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+
+    if (pa <= pb && pa <= pc)
+        return (ubyte_t)a;
+
+    return (ubyte_t)(pb <= pc ? b : c);
+}
+
+// Reverses the filter of one row in place; `previous` is NULL for the first row of a pass.
+bool unfilterPngRow(ubyte_t* row, const ubyte_t* previous, size_t size, unsigned int stride, unsigned int filter)
+{
+    switch (filter)
+    {
+        case 0:
+            break;
+
+        case 1:
+            for (size_t i = stride; i < size; ++i)
+                row[i] = (ubyte_t)(row[i] + row[i - stride]);
+            break;
+
+        case 2:
+            if (previous != NULL)
+                for (size_t i = 0; i < size; ++i)
+                    row[i] = (ubyte_t)(row[i] + previous[i]);
+            break;
+
+        case 3:
+            for (size_t i = 0; i < size; ++i)
+            {
+                int left = (i >= stride ? row[i - stride] : 0);
+                int up = (previous != NULL ? previous[i] : 0);
+
+                row[i] = (ubyte_t)(row[i] + ((left + up) >> 1));
+            }
+            break;
+
+        case 4:
+            for (size_t i = 0; i < size; ++i)
+            {
+                int left = (i >= stride ? row[i - stride] : 0);
+                int up = (previous != NULL ? previous[i] : 0);
+                int corner = (i >= stride && previous != NULL ? previous[i - stride] : 0);
+
+                row[i] = (ubyte_t)(row[i] + paethPredictor(left, up, corner));
+            }
+            break;
+
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+// Returns the `index`-th sample of an unfiltered row, scaled to 8 bits.
+unsigned int getPngSample(const PngHeader* h, const ubyte_t* row, size_t index)
+{
+    switch (h->bitDepth)
+    {
+        case 8:
+            return row[index];
+
+        case 16:
+            return row[2 * index];
+
+        default:
+        {
+            size_t bit = index * h->bitDepth;
+
+            unsigned int value = (row[bit / 8] >> (8 - h->bitDepth - bit % 8)) & ((1u << h->bitDepth) - 1);
+
+            // Palette indices are not scaled.
+            return (h->colorType == PNG_COLOR_PALETTE ? value : value * 255 / ((1u << h->bitDepth) - 1));
+        }
+    }
+}
+
+// Writes an unfiltered row of `width` pixels into the image, starting at column `x0` and then every `dx` pixels.
+void storePngRow(const PngHeader* h, const ubyte_t* row, unsigned int width, ubyte_t* dst, unsigned int x0, unsigned int dx, unsigned int bpp)
+{
+    dst += (size_t)x0 * bpp;
+
+    // The common case: 8-bit truecolor, RGB(A) -> BGR(A).
+    if (h->bitDepth == 8 && (h->colorType == PNG_COLOR_RGB || h->colorType == PNG_COLOR_RGBA))
+    {
+        const unsigned int channels = h->channels;
+
+        for (unsigned int x = 0; x < width; ++x, row += channels, dst += (size_t)dx * bpp)
+        {
+            dst[0] = row[2];
+            dst[1] = row[1];
+            dst[2] = row[0];
+
+            if (bpp == 4)
+                dst[3] = row[3];
+        }
+        return;
+    }
+
+    for (unsigned int x = 0; x < width; ++x, dst += (size_t)dx * bpp)
+    {
+        size_t sample = (size_t)x * h->channels;
+
+        unsigned int r, g, b, a = 255;
+
+        switch (h->colorType)
+        {
+            case PNG_COLOR_GRAY:
+                r = g = b = getPngSample(h, row, sample);
+                break;
+
+            case PNG_COLOR_GRAY_ALPHA:
+                r = g = b = getPngSample(h, row, sample);
+                a = getPngSample(h, row, sample + 1);
+                break;
+
+            case PNG_COLOR_PALETTE:
+            {
+                unsigned int index = getPngSample(h, row, sample);
+
+                // Out-of-range indices are rendered black rather than rejected.
+                if (index < h->paletteSize)
+                {
+                    r = h->palette[index][0];
+                    g = h->palette[index][1];
+                    b = h->palette[index][2];
+                    a = h->palette[index][3];
+                }
+                else
+                    r = g = b = 0;
+                break;
+            }
+
+            default:
+                r = getPngSample(h, row, sample);
+                g = getPngSample(h, row, sample + 1);
+                b = getPngSample(h, row, sample + 2);
+                a = (h->channels == 4 ? getPngSample(h, row, sample + 3) : 255);
+                break;
+        }
+
+        dst[0] = (ubyte_t)b;
+        dst[1] = (ubyte_t)g;
+        dst[2] = (ubyte_t)r;
+
+        if (bpp == 4)
+            dst[3] = (ubyte_t)a;
+    }
+}
+
+bool readPngHeader(PngHeader* h, const ubyte_t* ihdr, uint32_t length)
+{
+    if (length != 13)
+        return false;
+
+    h->width = readPngUint32(ihdr);
+    h->height = readPngUint32(ihdr + 4);
+    h->bitDepth = ihdr[8];
+    h->colorType = ihdr[9];
+    h->interlace = ihdr[12];
+
+    const unsigned int channels[7] = { 1, 0, 3, 1, 2, 0, 4 };
+
+    h->channels = (h->colorType < 7 ? channels[h->colorType] : 0);
+
+    unsigned int d = h->bitDepth;
+
+    bool valid_depth = (
+        (h->colorType == PNG_COLOR_GRAY && (d == 1 || d == 2 || d == 4 || d == 8 || d == 16)) ||
+        (h->colorType == PNG_COLOR_PALETTE && (d == 1 || d == 2 || d == 4 || d == 8)) ||
+        ((h->colorType == PNG_COLOR_RGB || h->colorType == PNG_COLOR_GRAY_ALPHA || h->colorType == PNG_COLOR_RGBA) &&
+            (d == 8 || d == 16))
+    );
+
+    h->filterStride = (h->channels * d + 7) / 8;
+    h->paletteSize = 0;
+    h->hasAlpha = (h->colorType == PNG_COLOR_GRAY_ALPHA || h->colorType == PNG_COLOR_RGBA);
+
+    // Limit the dimensions so that sizes cannot overflow.
+    return (
+        valid_depth && h->width > 0 && h->height > 0 && h->width <= (1u << 24) && h->height <= (1u << 24) &&
+        ihdr[10] == 0 && ihdr[11] == 0 && h->interlace <= 1
+    );
+}
+
+// Decodes a PNG file held in memory. Returns NULL (after printing the reason) for corrupt or
+// unsupported images; `filename` is only used in error messages.
+BitmapImage* decodePngImage(const ubyte_t* data, size_t size, const char* filename)
+{
+    PngHeader h;
+
+    const char* error = NULL;
+
+    size_t compressed_size = 0;
+
+    bool has_header = false, has_end = false;
+
+    if (!isPngImage(data, size))
+        error = "missing signature";
+
+    // First pass over the chunks: the header, the palette and the total size of the image data.
+    for (size_t pos = sizeof(png_signature); error == NULL && !has_end; )
+    {
+        if (size - pos < 12 || size - pos - 12 < readPngUint32(data + pos))
+        {
+            error = "truncated chunk";
+            break;
+        }
+
+        uint32_t length = readPngUint32(data + pos);
+
+        const ubyte_t* type = data + pos + 4;
+        const ubyte_t* body = data + pos + 8;
+
+        if (!has_header && memcmp(type, "IHDR", 4) != 0)
+            error = "missing header";
+
+        else if (memcmp(type, "IHDR", 4) == 0)
+        {
+            has_header = readPngHeader(&h, body, length);
+
+            if (!has_header)
+                error = "invalid or unsupported header";
+        }
+        else if (memcmp(type, "PLTE", 4) == 0)
+        {
+            h.paletteSize = (length / 3 <= 256 ? length / 3 : 256);
+
+            for (unsigned int i = 0; i < h.paletteSize; ++i)
+            {
+                memcpy(h.palette[i], body + 3 * i, 3);
+                h.palette[i][3] = 255;
+            }
+        }
+        else if (memcmp(type, "tRNS", 4) == 0 && h.colorType == PNG_COLOR_PALETTE)
+        {
+            for (uint32_t i = 0; i < length && i < h.paletteSize; ++i)
+                h.palette[i][3] = body[i];
+
+            h.hasAlpha = true;
+        }
+        else if (memcmp(type, "IDAT", 4) == 0)
+            compressed_size += length;
+
+        else if (memcmp(type, "IEND", 4) == 0)
+            has_end = true;
+
+        pos += 12 + (size_t)length;
+    }
+
+    if (error == NULL && h.colorType == PNG_COLOR_PALETTE && h.paletteSize == 0)
+        error = "missing palette";
+
+    if (error == NULL && compressed_size == 0)
+        error = "missing image data";
+
+    if (error != NULL)
+    {
+        fprintf(stderr, "Error: Invalid PNG image (%s); Inspect \"%s\".\n", error, filename);
+        return NULL;
+    }
+
+    // The image data may be split across several chunks; they form a single zlib stream.
+    ubyte_t* compressed = (ubyte_t *)trackedMalloc(MEMORY_TAG_IMAGES, compressed_size);
+
+    compressed_size = 0;
+
+    for (size_t pos = sizeof(png_signature); pos < size; )
+    {
+        uint32_t length = readPngUint32(data + pos);
+
+        if (memcmp(data + pos + 4, "IDAT", 4) == 0)
+        {
+            memcpy(compressed + compressed_size, data + pos + 8, length);
+            compressed_size += length;
+        }
+        else if (memcmp(data + pos + 4, "IEND", 4) == 0)
+            break;
+
+        pos += 12 + (size_t)length;
+    }
+
+    int num_passes = (h.interlace ? 7 : 1);
+
+    size_t raw_size = 0;
+
+    for (int pass = 0; pass < num_passes; ++pass)
+    {
+        unsigned int width, height;
+
+        getPngPassSize(&h, pass, &width, &height);
+
+        if (width > 0 && height > 0)
+            raw_size += (size_t)height * (1 + getPngRowSize(&h, width));
+    }
+
+    ubyte_t* raw = (ubyte_t *)trackedMalloc(MEMORY_TAG_IMAGES, raw_size);
+
+    BitmapImage* image = allocateBitmapImage(h.width, h.height, (h.hasAlpha ? 4 : 3));
+
+    if (raw == NULL || image == NULL)
+    {
+        error = "out of memory";
+    }
+    else if (inflateZlib(compressed, compressed_size, raw, raw_size, &error) != raw_size && error == NULL)
+    {
+        error = "not enough image data";
+    }
+
+    // Unfilter each row in place and store it, bottom-up.
+    ubyte_t* row = raw;
+
+    for (int pass = 0; pass < num_passes && error == NULL; ++pass)
+    {
+        unsigned int width, height;
+
+        getPngPassSize(&h, pass, &width, &height);
+
+        if (width == 0 || height == 0)
+            continue;
+
+        unsigned int x0 = 0, y0 = 0, dx = 1, dy = 1;
+
+        if (h.interlace)
+        {
+            x0 = png_adam7_passes[pass][0];
+            y0 = png_adam7_passes[pass][1];
+            dx = png_adam7_passes[pass][2];
+            dy = png_adam7_passes[pass][3];
+        }
+
+        size_t row_size = getPngRowSize(&h, width);
+
+        const ubyte_t* previous = NULL;
+
+        for (unsigned int y = 0; y < height; ++y)
+        {
+            if (!unfilterPngRow(row + 1, previous, row_size, h.filterStride, row[0]))
+            {
+                error = "invalid filter type";
+                break;
+            }
+
+            unsigned int image_y = h.height - 1 - (y0 + y * dy);
+
+            storePngRow(&h, row + 1, width, image->buffer + (size_t)image_y * image->rowStride, x0, dx, image->bytesPerPixel);
+
+            previous = row + 1;
+            row += 1 + row_size;
+        }
+    }
+
+    trackedFree(compressed);
+    trackedFree(raw);
+
+    if (error != NULL)
+    {
+        fprintf(stderr, "Error: Invalid PNG image (%s); Inspect \"%s\".\n", error, filename);
+        deleteBitmapImage(image);
+        return NULL;
+    }
+
+    return image;
+}
+
+#endif // PNG_IMAGES_H
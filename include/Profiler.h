@@ -0,0 +1,115 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(_WIN32)
+#   include <windows.h>
+#   include <psapi.h>
+#   if defined(_MSC_VER)
+#       pragma comment(lib, "psapi.lib")
+#   endif
+#else
+#   include <sys/resource.h>
+#endif
+
+#include "Timer.h"
+
+
+// Lightweight per-frame instrumentation: wall clock time spent in each stage of `display()`
+// and the number of draw submissions (one per `gluSphere`, display list call or string).
+
+typedef enum ProfilerStage
+{
+    PROFILER_STAGE_TEXTURES = 0,
+    PROFILER_STAGE_SIMULATION,
+    PROFILER_STAGE_CAMERA,
+    PROFILER_STAGE_BODIES,
+    PROFILER_STAGE_MENUS,
+    PROFILER_STAGE_SKYBOX,
+    PROFILER_STAGE_HUD,
+    PROFILER_STAGE_SWAP,
+    PROFILER_NUM_STAGES
+
+} ProfilerStage;
+
+const char* const profiler_stage_names[PROFILER_NUM_STAGES] = {
+    "textures",
+    "simulation",
+    "camera",
+    "bodies",
+    "menus",
+    "skybox",
+    "hud",
+    "swap"
+};
+
+// Timings of the last completed frame, in microseconds.
+uint64_t profiler_stage_micros[PROFILER_NUM_STAGES];
+uint64_t profiler_frame_micros;
+
+// Draw submissions issued since the beginning of the current frame.
+unsigned long profiler_draw_calls;
+
+uint64_t profiler_frame_begin_ts;
+uint64_t profiler_stage_begin_ts;
+
+
+void beginProfilerFrame(void)
+{
+    for (int i = 0; i < PROFILER_NUM_STAGES; ++i)
+        profiler_stage_micros[i] = 0;
+
+    profiler_draw_calls = 0;
+    profiler_frame_begin_ts = getAbsoluteTimeMicros();
+}
+
+void beginProfilerStage(void)
+{
+    profiler_stage_begin_ts = getAbsoluteTimeMicros();
+}
+
+// Adds the time elapsed since the last `beginProfilerStage` to the given stage.
+void endProfilerStage(ProfilerStage stage)
+{
+    profiler_stage_micros[stage] += getAbsoluteTimeMicros() - profiler_stage_begin_ts;
+}
+
+void endProfilerFrame(void)
+{
+    profiler_frame_micros = getAbsoluteTimeMicros() - profiler_frame_begin_ts;
+}
+
+void countDrawCalls(unsigned long n)
+{
+    profiler_draw_calls += n;
+}
+
+// Peak resident memory of the process so far, in bytes (0 if unavailable).
+size_t getPeakMemoryBytes(void)
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (size_t)counters.PeakWorkingSetSize;
+
+    return 0;
+#else
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#   if defined(__APPLE__) || defined(__MACH__)
+    // Reported in bytes on Mac OS X ...
+    return (size_t)usage.ru_maxrss;
+#   else
+    // ... and in kilobytes on Linux.
+    return (size_t)usage.ru_maxrss * 1024;
+#   endif
+#endif
+}
+
+#endif // PROFILER_H
@@ -0,0 +1,464 @@
+#ifndef STAR_CATALOG_H
+#define STAR_CATALOG_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#if defined(_MSC_VER) && !defined(_USE_MATH_DEFINES)
+#   define _USE_MATH_DEFINES
+#endif
+
+#include <math.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MemoryTracker.h"
+
+
+// Catalog of real stars, read from a CSV file in the layout of the HYG database: a header line
+// naming the columns, of which `ra` (right ascension, in hours), `dec` (declination, in degrees),
+// `mag` (apparent magnitude) and `ci` (B-V color index, optional) are used, in any order. The file
+// is memory-mapped and split in chunks of whole lines that are parsed in parallel, as jobs of
+// `JobSystem.h`. Stars are kept quantized, 8 bytes each: their direction on the sky in the frame of
+// the scene (y towards the ecliptic north pole, as the bodies' orbits), their magnitude and color.
+
+// Bytes of the file per chunk.
+#define STAR_CATALOG_CHUNK_SIZE ((size_t)1 << 20)
+
+// Magnitudes are quantized in steps of 1/16 from the brightest of them (Sirius is about -1.5);
+// fainter stars than the last step are clamped to it. Brighter objects, such as the Sun (the first
+// entry of HYG), are not stars of the night sky and are skipped.
+#define STAR_CATALOG_MIN_MAGNITUDE -2.0f
+#define STAR_CATALOG_MAGNITUDE_STEPS 16.0f
+
+// Color indices are quantized in steps of 1/100 from -0.5; stars without one are given the Sun's.
+#define STAR_CATALOG_MIN_COLOR_INDEX -0.5f
+#define STAR_CATALOG_COLOR_INDEX_STEPS 100.0f
+#define STAR_CATALOG_DEFAULT_COLOR_INDEX 0.65f
+
+// Obliquity of the ecliptic (J2000), in radians.
+#define STAR_CATALOG_OBLIQUITY 0.40909280f
+
+typedef struct PackedStar
+{
+    // Unit direction, as signed normalized 16-bit integers.
+    int16_t direction[3];
+
+    uint8_t magnitude;
+    uint8_t colorIndex;
+
+} PackedStar;
+
+typedef struct StarCatalog
+{
+    PackedStar* stars;
+
+    int count;
+
+} StarCatalog;
+
+
+float getPackedStarMagnitude(const PackedStar* s)
+{
+    return STAR_CATALOG_MIN_MAGNITUDE + (float)s->magnitude / STAR_CATALOG_MAGNITUDE_STEPS;
+}
+
+float getPackedStarColorIndex(const PackedStar* s)
+{
+    return STAR_CATALOG_MIN_COLOR_INDEX + (float)s->colorIndex / STAR_CATALOG_COLOR_INDEX_STEPS;
+}
+
+void getPackedStarDirection(const PackedStar* s, float direction[3])
+{
+    for (int a = 0; a < 3; ++a)
+        direction[a] = (float)s->direction[a] / 32767.0f;
+}
+
+// Approximate color of a star of the given B-V index, normalized so that its largest component is 1:
+// the index gives the star's temperature (Ballesteros' formula), and the temperature its color as a
+// black body (fit of Tanner Helland's).
+void getStarColor(float color_index, float rgb[3])
+{
+    float bv = fminf(fmaxf(color_index, -0.4f), 2.0f);
+
+    float t = 4600.0f * (1.0f / (0.92f * bv + 1.7f) + 1.0f / (0.92f * bv + 0.62f)) / 100.0f;
+
+    float r = (t <= 66.0f ? 255.0f : 329.7f * powf(t - 60.0f, -0.1332f));
+    float g = (t <= 66.0f ? 99.47f * logf(t) - 161.12f : 288.12f * powf(t - 60.0f, -0.0755f));
+    float b = (t >= 66.0f ? 255.0f : (t <= 19.0f ? 0.0f : 138.52f * logf(t - 10.0f) - 305.04f));
+
+    r = fminf(fmaxf(r, 0.0f), 255.0f);
+    g = fminf(fmaxf(g, 0.0f), 255.0f);
+    b = fminf(fmaxf(b, 0.0f), 255.0f);
+
+    float m = fmaxf(r, fmaxf(g, b));
+
+    rgb[0] = r / m;
+    rgb[1] = g / m;
+    rgb[2] = b / m;
+}
+
+// Parses a decimal number (with optional sign, fraction and exponent) from `*c`, up to `end`, and
+// advances `*c` past it. Returns false, leaving `*c` where it was, if there is none.
+bool parseStarCatalogNumber(const char** c, const char* end, float* value)
+{
+    const char* p = *c;
+
+    double sign = 1.0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        sign = (*p == '-' ? -1.0 : 1.0);
+        ++p;
+    }
+
+    double number = 0.0;
+    bool digits = false;
+
+    for (; p < end && isdigit((unsigned char)*p); ++p, digits = true)
+        number = number * 10.0 + (*p - '0');
+
+    if (p < end && *p == '.')
+    {
+        double scale = 0.1;
+
+        for (++p; p < end && isdigit((unsigned char)*p); ++p, digits = true, scale *= 0.1)
+            number += (*p - '0') * scale;
+    }
+
+    if (!digits)
+        return false;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+
+        int exponent_sign = 1;
+        int exponent = 0;
+
+        if (q < end && (*q == '-' || *q == '+'))
+            exponent_sign = (*q++ == '-' ? -1 : 1);
+
+        if (q < end && isdigit((unsigned char)*q))
+        {
+            for (; q < end && isdigit((unsigned char)*q); ++q)
+                exponent = (exponent < 1000 ? exponent * 10 + (*q - '0') : exponent);
+
+            number *= pow(10.0, (double)(exponent_sign * exponent));
+            p = q;
+        }
+    }
+
+    *value = (float)(sign * number);
+    *c = p;
+
+    return true;
+}
+
+// Returns the end of the CSV field starting at `c` (the comma or line break after it, or `end`);
+// quoted fields may contain commas.
+const char* skipStarCatalogField(const char* c, const char* end)
+{
+    if (c < end && *c == '"')
+    {
+        for (++c; c < end; ++c)
+        {
+            if (*c == '"')
+            {
+                if (c + 1 < end && c[1] == '"')
+                    ++c;
+                else
+                    break;
+            }
+        }
+    }
+
+    while (c < end && *c != ',' && *c != '\n' && *c != '\r')
+        ++c;
+
+    return c;
+}
+
+// Columns of the catalog's fields, -1 if absent.
+typedef struct StarCatalogColumns
+{
+    int ra;
+    int dec;
+    int magnitude;
+    int colorIndex;
+
+    // Number of columns up to the last one that is used.
+    int count;
+
+} StarCatalogColumns;
+
+bool matchStarCatalogColumn(const char* field, const char* field_end, const char* name)
+{
+    size_t length = strlen(name);
+
+    if (field < field_end && *field == '"' && field_end - field >= 2)
+    {
+        ++field;
+        --field_end;
+    }
+
+    if ((size_t)(field_end - field) != length)
+        return false;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (tolower((unsigned char)field[i]) != name[i])
+            return false;
+    }
+    return true;
+}
+
+// Quantizes a star, given its right ascension (hours), declination (degrees), magnitude and color index.
+void packStar(PackedStar* s, float ra, float dec, float magnitude, float color_index)
+{
+    double a = (double)ra * (M_PI / 12.0);
+    double d = (double)dec * (M_PI / 180.0);
+
+    // Equatorial coordinates (z towards the celestial north pole) ...
+    double x = cos(d) * cos(a);
+    double y = cos(d) * sin(a);
+    double z = sin(d);
+
+    // ... turned into ecliptic ones, then into the scene's axes (y up, right-handed).
+    double c = cos((double)STAR_CATALOG_OBLIQUITY);
+    double n = sin((double)STAR_CATALOG_OBLIQUITY);
+
+    double scene[3] = { x, -n * y + c * z, -(c * y + n * z) };
+
+    for (int i = 0; i < 3; ++i)
+        s->direction[i] = (int16_t)lrint(scene[i] * 32767.0);
+
+    float m = (magnitude - STAR_CATALOG_MIN_MAGNITUDE) * STAR_CATALOG_MAGNITUDE_STEPS;
+    float ci = (color_index - STAR_CATALOG_MIN_COLOR_INDEX) * STAR_CATALOG_COLOR_INDEX_STEPS;
+
+    s->magnitude = (uint8_t)fminf(fmaxf(m + 0.5f, 0.0f), 255.0f);
+    s->colorIndex = (uint8_t)fminf(fmaxf(ci + 0.5f, 0.0f), 255.0f);
+}
+
+typedef struct StarCatalogChunk
+{
+    const char* begin;
+    const char* end;
+
+    const StarCatalogColumns* columns;
+
+    // Where the chunk's stars go: room for one per line; `count` of them are written.
+    PackedStar* stars;
+    int first;
+    int lines;
+    int count;
+
+} StarCatalogChunk;
+
+int countStarCatalogLines(const char* begin, const char* end)
+{
+    int lines = 0;
+
+    for (const char* c = begin; c < end; ++lines)
+    {
+        const char* eol = (const char *)memchr(c, '\n', (size_t)(end - c));
+
+        c = (eol != NULL ? eol + 1 : end);
+    }
+    return lines;
+}
+
+void countStarCatalogChunks(void* data, int begin, int end)
+{
+    StarCatalogChunk* chunks = (StarCatalogChunk *)data;
+
+    for (int i = begin; i < end; ++i)
+        chunks[i].lines = countStarCatalogLines(chunks[i].begin, chunks[i].end);
+}
+
+void parseStarCatalogChunk(StarCatalogChunk* chunk)
+{
+    const StarCatalogColumns* columns = chunk->columns;
+
+    PackedStar* out = chunk->stars + chunk->first;
+
+    const char* c = chunk->begin;
+    const char* end = chunk->end;
+
+    while (c < end)
+    {
+        float values[4] = { NAN, NAN, NAN, NAN };
+
+        for (int column = 0; column < columns->count && c < end && *c != '\n' && *c != '\r'; ++column)
+        {
+            const char* field_end = skipStarCatalogField(c, end);
+
+            int slot = (column == columns->ra ? 0 : column == columns->dec ? 1 : column == columns->magnitude ? 2 : column == columns->colorIndex ? 3 : -1);
+
+            if (slot >= 0)
+            {
+                const char* p = c;
+
+                if (!parseStarCatalogNumber(&p, field_end, &values[slot]) || p != field_end)
+                    values[slot] = NAN;
+            }
+
+            c = (field_end < end && *field_end == ',' ? field_end + 1 : field_end);
+        }
+
+        const char* eol = (const char *)memchr(c, '\n', (size_t)(end - c));
+
+        c = (eol != NULL ? eol + 1 : end);
+
+        // Rows without a position or magnitude are skipped, as are the Sun and the like.
+        if (isnan(values[0]) || isnan(values[1]) || isnan(values[2]) || values[2] < STAR_CATALOG_MIN_MAGNITUDE)
+            continue;
+
+        packStar(
+            &out[chunk->count++], values[0], values[1], values[2],
+            (isnan(values[3]) ? STAR_CATALOG_DEFAULT_COLOR_INDEX : values[3])
+        );
+    }
+}
+
+void parseStarCatalogChunks(void* data, int begin, int end)
+{
+    StarCatalogChunk* chunks = (StarCatalogChunk *)data;
+
+    for (int i = begin; i < end; ++i)
+        parseStarCatalogChunk(&chunks[i]);
+}
+
+// Star catalog constructor (heap-allocated), from a CSV file (see above), parsed by the job system
+// (`js`, or by the calling thread alone if NULL). Returns NULL if the file cannot be read or lacks a column.
+StarCatalog* loadStarCatalog(JobSystem* js, const char* filename)
+{
+    MappedFile* file = openMappedFile(filename, true);
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: Unable to open the star catalog; Inspect \"%s\".\n", filename);
+        return NULL;
+    }
+
+    const char* data = file->data;
+    const char* end = file->data + file->size;
+
+    // The header names the columns.
+    StarCatalogColumns columns = { -1, -1, -1, -1, 0 };
+
+    const char* c = data;
+
+    for (int column = 0; c < end && *c != '\n' && *c != '\r'; ++column)
+    {
+        const char* field_end = skipStarCatalogField(c, end);
+
+        if (matchStarCatalogColumn(c, field_end, "ra"))
+            columns.ra = column;
+        else if (matchStarCatalogColumn(c, field_end, "dec"))
+            columns.dec = column;
+        else if (matchStarCatalogColumn(c, field_end, "mag"))
+            columns.magnitude = column;
+        else if (matchStarCatalogColumn(c, field_end, "ci"))
+            columns.colorIndex = column;
+
+        c = (field_end < end && *field_end == ',' ? field_end + 1 : field_end);
+    }
+
+    if (columns.ra < 0 || columns.dec < 0 || columns.magnitude < 0)
+    {
+        fprintf(stderr, "Error: The star catalog lacks a \"ra\", \"dec\" or \"mag\" column; Inspect \"%s\".\n", filename);
+        closeMappedFile(file);
+        return NULL;
+    }
+
+    columns.count = 1 + columns.ra;
+
+    if (columns.dec + 1 > columns.count)
+        columns.count = columns.dec + 1;
+    if (columns.magnitude + 1 > columns.count)
+        columns.count = columns.magnitude + 1;
+    if (columns.colorIndex + 1 > columns.count)
+        columns.count = columns.colorIndex + 1;
+
+    const char* eol = (c < end ? (const char *)memchr(c, '\n', (size_t)(end - c)) : NULL);
+
+    c = (eol != NULL ? eol + 1 : end);
+
+    // Chunks of whole lines, each counted and then parsed by its own job.
+    int num_chunks = (int)((size_t)(end - c) / STAR_CATALOG_CHUNK_SIZE) + 1;
+
+    StarCatalogChunk* chunks = (StarCatalogChunk *)malloc((size_t)num_chunks * sizeof(StarCatalogChunk));
+
+    for (int i = 0; i < num_chunks; ++i)
+    {
+        const char* chunk_end = (i + 1 < num_chunks ? c + STAR_CATALOG_CHUNK_SIZE : end);
+
+        eol = (chunk_end < end ? (const char *)memchr(chunk_end, '\n', (size_t)(end - chunk_end)) : NULL);
+
+        chunk_end = (eol != NULL ? eol + 1 : end);
+
+        chunks[i].begin = c;
+        chunks[i].end = chunk_end;
+        chunks[i].columns = &columns;
+        chunks[i].stars = NULL;
+        chunks[i].first = 0;
+        chunks[i].lines = 0;
+        chunks[i].count = 0;
+
+        c = chunk_end;
+    }
+
+    parallelFor(js, 0, num_chunks, 1, countStarCatalogChunks, chunks);
+
+    int num_lines = 0;
+
+    for (int i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].first = num_lines;
+        num_lines += chunks[i].lines;
+    }
+
+    StarCatalog* catalog = (StarCatalog *)trackedMalloc(MEMORY_TAG_STARS, sizeof(StarCatalog));
+
+    catalog->stars = (PackedStar *)trackedMalloc(MEMORY_TAG_STARS, ((size_t)num_lines + 1) * sizeof(PackedStar));
+
+    for (int i = 0; i < num_chunks; ++i)
+        chunks[i].stars = catalog->stars;
+
+    parallelFor(js, 0, num_chunks, 1, parseStarCatalogChunks, chunks);
+
+    // The skipped rows leave gaps at the end of each chunk's range.
+    catalog->count = 0;
+
+    for (int i = 0; i < num_chunks; ++i)
+    {
+        memmove(&catalog->stars[catalog->count], &catalog->stars[chunks[i].first], (size_t)chunks[i].count * sizeof(PackedStar));
+        catalog->count += chunks[i].count;
+    }
+
+    catalog->stars = (PackedStar *)trackedRealloc(MEMORY_TAG_STARS, catalog->stars, ((size_t)catalog->count + 1) * sizeof(PackedStar));
+
+    free(chunks);
+    closeMappedFile(file);
+
+    return catalog;
+}
+
+void deleteStarCatalog(StarCatalog* catalog)
+{
+    if (catalog == NULL)
+        return;
+
+    trackedFree(catalog->stars);
+    trackedFree(catalog);
+}
+
+#endif // STAR_CATALOG_H
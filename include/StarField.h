@@ -0,0 +1,515 @@
+#ifndef STAR_FIELD_H
+#define STAR_FIELD_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#if defined(_MSC_VER) && !defined(_USE_MATH_DEFINES)
+#   define _USE_MATH_DEFINES
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "Timer.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "CustomTypes.h"
+#include "StarCatalog.h"
+#include "MemoryTracker.h"
+
+
+// The star field of the sky, baked once into the six faces of a cube map: either the stars of a
+// catalog (see `StarCatalog.h`) or procedural ones, scattered over the sky by a counter-based random
+// generator, so that they are generated in parallel and are the same for a given seed however the
+// work is split. Each face is baked in bands of rows, as jobs of `JobSystem.h`, by splatting the
+// stars that fall on it with the same profile, size and brightness as the sprites of `AmbientStars.h`.
+//
+// The faces are cached in the system's directory (`starfield.cache`) and only baked again when the
+// seed, the density or the resolution change, or when the catalog is modified. Layout (native byte
+// order): a StarFieldCacheHeader, then the faces' RGB texels, in the order and orientation of
+// OpenGL's cube map faces (+x, -x, +y, -y, +z, -z), rows top-down and tightly packed.
+
+#define STAR_FIELD_CACHE_MAGIC "SSKY"
+#define STAR_FIELD_CACHE_VERSION 1
+#define STAR_FIELD_CACHE_BYTE_ORDER 0x01020304u
+
+#define STAR_FIELD_CACHE_FILENAME "starfield.cache"
+
+#define STAR_FIELD_DEFAULT_SEED 1u
+#define STAR_FIELD_DEFAULT_RESOLUTION 1024
+#define STAR_FIELD_MIN_RESOLUTION 16
+
+// Procedural stars per square degree of sky (about 10000 of them, as many as the naked eye sees).
+#define STAR_FIELD_DEFAULT_DENSITY 0.25f
+#define STAR_FIELD_SQUARE_DEGREES 41252.96f
+
+// Procedural magnitudes are drawn so that the number of stars brighter than `m` grows as
+// 10^(slope * m), as it roughly does in the night sky, down to the faintest magnitude.
+#define STAR_FIELD_FAINTEST_MAGNITUDE 6.5f
+#define STAR_FIELD_MAGNITUDE_SLOPE 0.5f
+
+// Stars are drawn as round spots whose size and brightness follow their magnitude: half-widths (in
+// radians) of the faintest and brightest, and the magnitude that is drawn at full size and brightness.
+#define STAR_FIELD_MIN_SIZE 0.0012f
+#define STAR_FIELD_MAX_SIZE 0.0060f
+#define STAR_FIELD_REFERENCE_MAGNITUDE 0.0f
+
+// Brightness of the faintest stars, however faint.
+#define STAR_FIELD_MIN_BRIGHTNESS 0.05f
+
+// Rows of a face baked by each job.
+#define STAR_FIELD_BAND_ROWS 32
+
+typedef struct StarFieldSettings
+{
+    // Seed of the procedural stars.
+    uint32_t seed;
+
+    // Texels per side of each face.
+    int resolution;
+
+    // Procedural stars per square degree.
+    float density;
+
+} StarFieldSettings;
+
+typedef struct StarFieldCacheHeader
+{
+    char magic[4];
+
+    uint32_t version;
+
+    // STAR_FIELD_CACHE_BYTE_ORDER as written; tells apart files of another endianness.
+    uint32_t byteOrder;
+
+    uint32_t resolution;
+
+    // Seed and number of the procedural stars; both 0 for a catalog.
+    uint32_t seed;
+    uint32_t numStars;
+
+    // Size and modification time of the catalog; both 0 for procedural stars.
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+
+} StarFieldCacheHeader;
+
+typedef struct StarFieldImage
+{
+    int resolution;
+
+    // The six faces, one after the other (see the layout above).
+    const ubyte_t* pixels;
+
+    // The cache's mapping, if the faces were read from it; NULL if they were baked (and are owned).
+    MappedFile* file;
+
+} StarFieldImage;
+
+// A star as seen on one face: its centre and half-width in texels, and its color times its brightness.
+typedef struct StarFieldSplat
+{
+    float x;
+    float y;
+
+    float radius;
+
+    float color[3];
+
+} StarFieldSplat;
+
+typedef struct StarFieldBake
+{
+    int resolution;
+
+    StarFieldSplat* splats[6];
+    int numSplats[6];
+
+    ubyte_t* pixels;
+
+} StarFieldBake;
+
+
+void initStarFieldSettings(StarFieldSettings* settings)
+{
+    settings->seed = STAR_FIELD_DEFAULT_SEED;
+    settings->resolution = STAR_FIELD_DEFAULT_RESOLUTION;
+    settings->density = STAR_FIELD_DEFAULT_DENSITY;
+}
+
+int getStarFieldSize(const StarFieldSettings* settings)
+{
+    return (int)fminf(fmaxf(settings->density, 0.0f) * STAR_FIELD_SQUARE_DEGREES + 0.5f, (float)(INT32_MAX / 4));
+}
+
+// SplitMix64's finalizer.
+uint64_t mixRandomBits(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+    return z ^ (z >> 31);
+}
+
+// Counter-based random numbers: the `counter`-th number of the stream of `seed` is a hash of both,
+// so that any of them can be drawn independently of the others (and from any thread).
+uint64_t getCounterRandom(uint64_t seed, uint64_t counter)
+{
+    return mixRandomBits(mixRandomBits(seed) + (counter + 1) * 0x9E3779B97F4A7C15ull);
+}
+
+// Uniform in [0, 1), from the top 24 bits of `bits`.
+float getRandomFloat(uint64_t bits)
+{
+    return (float)(bits >> 40) * (1.0f / 16777216.0f);
+}
+
+// The `i`-th procedural star of the stream of `seed`: a uniform direction on the sky, a magnitude
+// (see STAR_FIELD_MAGNITUDE_SLOPE) and a color index around the Sun's.
+void generateStar(uint32_t seed, int i, PackedStar* s)
+{
+    uint64_t counter = 4 * (uint64_t)i;
+
+    float ra = 24.0f * getRandomFloat(getCounterRandom(seed, counter));
+    float dec = (float)(asin(2.0 * getRandomFloat(getCounterRandom(seed, counter + 1)) - 1.0) * (180.0 / M_PI));
+
+    float magnitude = STAR_FIELD_FAINTEST_MAGNITUDE + log10f(1.0f - getRandomFloat(getCounterRandom(seed, counter + 2))) / STAR_FIELD_MAGNITUDE_SLOPE;
+
+    uint64_t bits = getCounterRandom(seed, counter + 3);
+
+    float color_index = -0.3f + getRandomFloat(bits) + getRandomFloat(bits << 24);
+
+    packStar(s, ra, dec, fmaxf(magnitude, -1.5f), color_index);
+}
+
+void generateStarsRange(void* data, int begin, int end)
+{
+    const void** args = (const void **)data;
+
+    const StarFieldSettings* settings = (const StarFieldSettings *)args[0];
+    PackedStar* stars = (PackedStar *)args[1];
+
+    for (int i = begin; i < end; ++i)
+        generateStar(settings->seed, i, &stars[i]);
+}
+
+// Procedural stars of the given settings, generated in parallel, in the form of a catalog.
+StarCatalog* generateStarField(JobSystem* js, const StarFieldSettings* settings)
+{
+    StarCatalog* field = (StarCatalog *)trackedMalloc(MEMORY_TAG_STARS, sizeof(StarCatalog));
+
+    field->count = getStarFieldSize(settings);
+    field->stars = (PackedStar *)trackedMalloc(MEMORY_TAG_STARS, ((size_t)field->count + 1) * sizeof(PackedStar));
+
+    const void* args[2] = { settings, field->stars };
+
+    parallelFor(js, 0, field->count, 4096, generateStarsRange, (void *)args);
+
+    return field;
+}
+
+// Half-width (in radians), brightness and color of a star, following its magnitude and color index.
+void getStarAppearance(const PackedStar* star, float* size, float* brightness, float rgb[3])
+{
+    // Flux relative to the reference magnitude; the star's width goes as its square root.
+    float flux = powf(10.0f, -0.4f * (getPackedStarMagnitude(star) - STAR_FIELD_REFERENCE_MAGNITUDE));
+    float scale = fminf(sqrtf(flux), 1.0f);
+
+    *size = STAR_FIELD_MIN_SIZE + (STAR_FIELD_MAX_SIZE - STAR_FIELD_MIN_SIZE) * scale;
+    *brightness = fmaxf(fminf(3.0f * scale, 1.0f), STAR_FIELD_MIN_BRIGHTNESS);
+
+    getStarColor(getPackedStarColorIndex(star), rgb);
+}
+
+// Projects a direction on a face of a cube map, by OpenGL's rules: returns false if it points away
+// from the face, and otherwise its coordinates on the face's plane, (-1, -1) to (1, 1) within it.
+bool projectOnCubeFace(const float d[3], int face, float* s, float* t)
+{
+    // Per face: the major axis, and the axes of s and t, each with its sign.
+    static const int axes[6][3][2] = {
+        { { 0,  1 }, { 2, -1 }, { 1, -1 } },
+        { { 0, -1 }, { 2,  1 }, { 1, -1 } },
+        { { 1,  1 }, { 0,  1 }, { 2,  1 } },
+        { { 1, -1 }, { 0,  1 }, { 2, -1 } },
+        { { 2,  1 }, { 0,  1 }, { 1, -1 } },
+        { { 2, -1 }, { 0, -1 }, { 1, -1 } }
+    };
+
+    float m = (float)axes[face][0][1] * d[axes[face][0][0]];
+
+    // Far enough past the face's edges (at 45 degrees) that no star reaches into it.
+    if (m < 0.1f)
+        return false;
+
+    *s = (float)axes[face][1][1] * d[axes[face][1][0]] / m;
+    *t = (float)axes[face][2][1] * d[axes[face][2][0]] / m;
+
+    return true;
+}
+
+// Adds a star to the splats of every face it shows on, including those that its edge overlaps.
+void addStarFieldSplats(StarFieldBake* bake, const PackedStar* star, int* capacities)
+{
+    float d[3];
+    getPackedStarDirection(star, d);
+
+    float size, brightness, rgb[3];
+    getStarAppearance(star, &size, &brightness, rgb);
+
+    float half = 0.5f * (float)bake->resolution;
+
+    for (int f = 0; f < 6; ++f)
+    {
+        float s, t;
+
+        if (!projectOnCubeFace(d, f, &s, &t))
+            continue;
+
+        // Texels per radian around the star, which grows towards the face's corners. At least a
+        // texel wide, so that faint stars do not fall between texels.
+        float density = half * powf(1.0f + s * s + t * t, 0.75f);
+
+        StarFieldSplat splat;
+
+        splat.x = (s + 1.0f) * half;
+        splat.y = (t + 1.0f) * half;
+        splat.radius = fmaxf(size * density, 1.0f);
+
+        if (splat.x + splat.radius < 0.0f || splat.x - splat.radius > (float)bake->resolution ||
+            splat.y + splat.radius < 0.0f || splat.y - splat.radius > (float)bake->resolution)
+            continue;
+
+        for (int c = 0; c < 3; ++c)
+            splat.color[c] = rgb[c] * brightness;
+
+        if (bake->numSplats[f] == capacities[f])
+        {
+            capacities[f] = (capacities[f] > 0 ? 2 * capacities[f] : 1024);
+            bake->splats[f] = (StarFieldSplat *)trackedRealloc(MEMORY_TAG_STARS, bake->splats[f], (size_t)capacities[f] * sizeof(StarFieldSplat));
+        }
+
+        bake->splats[f][bake->numSplats[f]++] = splat;
+    }
+}
+
+// Bakes bands of rows, `STAR_FIELD_BAND_ROWS` each, numbered across the faces.
+void bakeStarFieldBands(void* data, int begin, int end)
+{
+    StarFieldBake* bake = (StarFieldBake *)data;
+
+    int resolution = bake->resolution;
+    int bands_per_face = (resolution + STAR_FIELD_BAND_ROWS - 1) / STAR_FIELD_BAND_ROWS;
+
+    float* texels = (float *)malloc((size_t)STAR_FIELD_BAND_ROWS * resolution * 3 * sizeof(float));
+
+    for (int b = begin; b < end; ++b)
+    {
+        int face = b / bands_per_face;
+        int y0 = (b % bands_per_face) * STAR_FIELD_BAND_ROWS;
+        int y1 = (y0 + STAR_FIELD_BAND_ROWS < resolution ? y0 + STAR_FIELD_BAND_ROWS : resolution);
+
+        memset(texels, 0, (size_t)(y1 - y0) * resolution * 3 * sizeof(float));
+
+        for (int i = 0; i < bake->numSplats[face]; ++i)
+        {
+            const StarFieldSplat* s = &bake->splats[face][i];
+
+            if (s->y + s->radius < (float)y0 || s->y - s->radius > (float)y1)
+                continue;
+
+            int x_begin = (int)fmaxf(floorf(s->x - s->radius), 0.0f);
+            int x_end = (int)fminf(ceilf(s->x + s->radius), (float)resolution);
+            int y_begin = (int)fmaxf(floorf(s->y - s->radius), (float)y0);
+            int y_end = (int)fminf(ceilf(s->y + s->radius), (float)y1);
+
+            float scale = 1.0f / (s->radius * s->radius);
+
+            // The profile of the sprites of `AmbientStars.h`.
+            for (int y = y_begin; y < y_end; ++y)
+            {
+                float dy = (float)y + 0.5f - s->y;
+
+                for (int x = x_begin; x < x_end; ++x)
+                {
+                    float dx = (float)x + 0.5f - s->x;
+                    float r2 = (dx * dx + dy * dy) * scale;
+
+                    if (r2 >= 1.0f)
+                        continue;
+
+                    float w = expf(-4.0f * r2) * (1.0f - r2);
+                    float* texel = &texels[((size_t)(y - y0) * resolution + x) * 3];
+
+                    texel[0] += s->color[0] * w;
+                    texel[1] += s->color[1] * w;
+                    texel[2] += s->color[2] * w;
+                }
+            }
+        }
+
+        ubyte_t* row = bake->pixels + ((size_t)face * resolution + y0) * resolution * 3;
+
+        for (size_t i = 0; i < (size_t)(y1 - y0) * resolution * 3; ++i)
+            row[i] = (ubyte_t)(fminf(texels[i], 1.0f) * 255.0f + 0.5f);
+    }
+
+    free(texels);
+}
+
+// Bakes the faces of a star field of the given resolution.
+StarFieldImage* bakeStarField(JobSystem* js, const StarCatalog* stars, int resolution)
+{
+    StarFieldBake bake;
+
+    memset(&bake, 0, sizeof(bake));
+
+    bake.resolution = resolution;
+
+    int capacities[6] = { 0 };
+
+    for (int i = 0; i < stars->count; ++i)
+        addStarFieldSplats(&bake, &stars->stars[i], capacities);
+
+    bake.pixels = (ubyte_t *)trackedMalloc(MEMORY_TAG_STARS, 6 * (size_t)resolution * resolution * 3);
+
+    int bands_per_face = (resolution + STAR_FIELD_BAND_ROWS - 1) / STAR_FIELD_BAND_ROWS;
+
+    parallelFor(js, 0, 6 * bands_per_face, 1, bakeStarFieldBands, &bake);
+
+    for (int f = 0; f < 6; ++f)
+        trackedFree(bake.splats[f]);
+
+    StarFieldImage* image = (StarFieldImage *)trackedMalloc(MEMORY_TAG_STARS, sizeof(StarFieldImage));
+
+    image->resolution = resolution;
+    image->pixels = bake.pixels;
+    image->file = NULL;
+
+    return image;
+}
+
+void deleteStarFieldImage(StarFieldImage* image)
+{
+    if (image == NULL)
+        return;
+
+    if (image->file != NULL)
+        closeMappedFile(image->file);
+    else
+        trackedFree((void *)image->pixels);
+
+    trackedFree(image);
+}
+
+// The cache header a star field of the given settings (and catalog, if not NULL) is stored under.
+void getStarFieldCacheHeader(const StarFieldSettings* settings, const char* catalog_filename, StarFieldCacheHeader* h)
+{
+    memset(h, 0, sizeof(*h));
+    memcpy(h->magic, STAR_FIELD_CACHE_MAGIC, 4);
+
+    h->version = STAR_FIELD_CACHE_VERSION;
+    h->byteOrder = STAR_FIELD_CACHE_BYTE_ORDER;
+    h->resolution = (uint32_t)settings->resolution;
+
+    if (catalog_filename == NULL)
+    {
+        h->seed = settings->seed;
+        h->numStars = (uint32_t)getStarFieldSize(settings);
+    }
+    else if (!getFileStamp(catalog_filename, &h->sourceSize, &h->sourceMtime))
+    {
+        h->sourceSize = 0;
+        h->sourceMtime = 0;
+    }
+}
+
+// Maps the cached faces if they were baked under the same header. Returns NULL otherwise.
+StarFieldImage* openStarFieldCache(const char* filename, const StarFieldCacheHeader* header)
+{
+    MappedFile* file = openMappedFile(filename, true);
+
+    if (file == NULL)
+        return NULL;
+
+    size_t bytes = 6 * (size_t)header->resolution * header->resolution * 3;
+
+    if (file->size != sizeof(StarFieldCacheHeader) + bytes || memcmp(file->data, header, sizeof(StarFieldCacheHeader)) != 0)
+    {
+        closeMappedFile(file);
+        return NULL;
+    }
+
+    StarFieldImage* image = (StarFieldImage *)trackedMalloc(MEMORY_TAG_STARS, sizeof(StarFieldImage));
+
+    image->resolution = (int)header->resolution;
+    image->pixels = (const ubyte_t *)file->data + sizeof(StarFieldCacheHeader);
+    image->file = file;
+
+    return image;
+}
+
+bool writeStarFieldCache(const char* filename, const StarFieldCacheHeader* header, const StarFieldImage* image)
+{
+    FILE* fp = fopen(filename, "wb");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Warning: Unable to create the star field cache \"%s\"; The sky will be baked again next time.\n", filename);
+        return false;
+    }
+
+    size_t bytes = 6 * (size_t)image->resolution * image->resolution * 3;
+
+    bool ok = (fwrite(header, sizeof(StarFieldCacheHeader), 1, fp) == 1 && fwrite(image->pixels, 1, bytes, fp) == bytes);
+
+    ok = (fclose(fp) == 0) && ok;
+
+    if (!ok)
+    {
+        fprintf(stderr, "Warning: Unable to write the star field cache \"%s\"; The sky will be baked again next time.\n", filename);
+        remove(filename);
+    }
+    return ok;
+}
+
+// The star field of a catalog, or procedural if `catalog_filename` is NULL: read from the cache at
+// `cache_filename` if it is up to date, and otherwise baked and cached. Returns NULL if the catalog
+// cannot be loaded.
+StarFieldImage* loadStarField(JobSystem* js, const StarFieldSettings* settings, const char* catalog_filename, const char* cache_filename)
+{
+    StarFieldCacheHeader header;
+    getStarFieldCacheHeader(settings, catalog_filename, &header);
+
+    StarFieldImage* image = openStarFieldCache(cache_filename, &header);
+
+    if (image != NULL)
+        return image;
+
+    uint64_t start = getAbsoluteTimeMicros();
+
+    StarCatalog* stars = (catalog_filename != NULL ? loadStarCatalog(js, catalog_filename) : generateStarField(js, settings));
+
+    if (stars == NULL)
+        return NULL;
+
+    image = bakeStarField(js, stars, settings->resolution);
+
+    printf(
+        "Baked %d stars into a %dx%d star field in %.1f ms.\n",
+        stars->count, settings->resolution, settings->resolution, (double)(getAbsoluteTimeMicros() - start) / 1000.0
+    );
+
+    deleteStarCatalog(stars);
+
+    writeStarFieldCache(cache_filename, &header, image);
+
+    return image;
+}
+
+#endif // STAR_FIELD_H
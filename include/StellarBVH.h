@@ -0,0 +1,674 @@
+#ifndef STELLAR_BVH_H
+#define STELLAR_BVH_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "Transform.h"
+#include "JobSystem.h"
+#include "CustomTypes.h"
+#include "MemoryTracker.h"
+#include "StellarObject.h"
+
+
+// Bounding volume hierarchy over the bodies, for the queries that would otherwise visit all of
+// them: picking a body under the cursor (`pickStellarObject`), finding the bodies nearest to a point
+// (`findNearestStellarObjects`) and frustum culling (`cullStellarObjectsWithBVH`). The tree is built
+// once per set of bodies by median splits, and its boxes are refit to the moving bodies every frame
+// (`refitStellarBVH`) rather than rebuilt: orbits keep the bodies of a subtree close together, so
+// the boxes only loosen slowly, and the tree is only rebuilt once they have. Each box holds its
+// bodies' spheres along with their name tags.
+
+// Bodies per leaf at most.
+#define STELLAR_BVH_LEAF_SIZE 4
+
+// Deepest a tree may get, which bounds the traversal stacks; median splits keep it to about
+// log2(number of leaves).
+#define STELLAR_BVH_MAX_DEPTH 64
+
+// Leaves per job of `refitStellarBVH`.
+#define STELLAR_BVH_REFIT_GRAIN 1024
+
+// How much the boxes may grow (in total surface area) through refits before the tree is rebuilt,
+// as bodies on different orbits drift apart and their shared boxes get too loose to prune anything.
+#define STELLAR_BVH_REBUILD_RATIO 2.0
+
+// What `cullStellarObjectsWithBVH` last made of a node's bodies.
+#define STELLAR_BVH_CULLED_UNKNOWN 0
+#define STELLAR_BVH_CULLED_INSIDE 1
+#define STELLAR_BVH_CULLED_OUTSIDE 2
+#define STELLAR_BVH_CULLED_PARTIAL 3
+
+typedef struct StellarBVHNode
+{
+    float min[3];
+    float max[3];
+
+    // The node's bodies, `indices[first]` to `indices[first + count - 1]`.
+    int first;
+    int count;
+
+    // Index of the second child; the first one follows the node. 0 for leaves.
+    int right;
+
+    // `STELLAR_BVH_CULLED_*` as of the last culling that reached the node, so that bodies already
+    // marked in bulk are not marked again; only meaningful below a partially visible parent.
+    int culled;
+
+} StellarBVHNode;
+
+typedef struct StellarBVH
+{
+    // The indexed bodies (not owned); the tree must be rebuilt whenever the array changes.
+    StellarObject* const* bodies;
+
+    int numBodies;
+
+    // Indices into `bodies`, grouped by leaf.
+    int* indices;
+
+    // Depth-first order: every node precedes its children.
+    StellarBVHNode* nodes;
+
+    int numNodes;
+
+    int* leaves;
+
+    int numLeaves;
+
+    // Total surface area of the internal boxes, as of the last refit and right after building.
+    double area;
+    double builtArea;
+
+} StellarBVH;
+
+
+// A body's centre and index, sorted in place while building.
+typedef struct StellarBVHItem
+{
+    float centre[3];
+
+    int index;
+
+} StellarBVHItem;
+
+// Reorders `items` so that the one at `k` is the one that would be there if they were sorted along
+// `axis`, with no greater one before it and no smaller one after it.
+void selectStellarBVHMedian(StellarBVHItem* items, int axis, int begin, int end, int k)
+{
+    while (end - begin > 1)
+    {
+        float pivot = items[begin + (end - begin) / 2].centre[axis];
+
+        int i = begin;
+        int j = end - 1;
+
+        while (i <= j)
+        {
+            while (items[i].centre[axis] < pivot)
+                ++i;
+            while (items[j].centre[axis] > pivot)
+                --j;
+
+            if (i <= j)
+            {
+                StellarBVHItem tmp = items[i];
+                items[i] = items[j];
+                items[j] = tmp;
+
+                ++i;
+                --j;
+            }
+        }
+
+        if (k <= j)
+            end = j + 1;
+        else if (k >= i)
+            begin = i;
+        else
+            return;
+    }
+}
+
+int buildStellarBVHNode(StellarBVH* bvh, StellarBVHItem* items, int begin, int end, int depth)
+{
+    int index = bvh->numNodes++;
+
+    StellarBVHNode* node = &bvh->nodes[index];
+
+    node->first = begin;
+    node->count = end - begin;
+    node->right = 0;
+    node->culled = STELLAR_BVH_CULLED_UNKNOWN;
+
+    if (end - begin <= STELLAR_BVH_LEAF_SIZE || depth + 1 >= STELLAR_BVH_MAX_DEPTH)
+    {
+        for (int i = begin; i < end; ++i)
+            bvh->indices[i] = items[i].index;
+
+        bvh->leaves[bvh->numLeaves++] = index;
+        return index;
+    }
+
+    // Split at the median along the axis the centres spread the most.
+    float lo[3] = { INFINITY, INFINITY, INFINITY };
+    float hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+    for (int i = begin; i < end; ++i)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            lo[a] = fminf(lo[a], items[i].centre[a]);
+            hi[a] = fmaxf(hi[a], items[i].centre[a]);
+        }
+    }
+
+    int axis = 0;
+
+    if (hi[1] - lo[1] > hi[axis] - lo[axis])
+        axis = 1;
+    if (hi[2] - lo[2] > hi[axis] - lo[axis])
+        axis = 2;
+
+    int middle = begin + (end - begin) / 2;
+
+    selectStellarBVHMedian(items, axis, begin, end, middle);
+
+    buildStellarBVHNode(bvh, items, begin, middle, depth + 1);
+
+    // `bvh->nodes` is not reallocated while building, so `node` is still valid.
+    node->right = buildStellarBVHNode(bvh, items, middle, end, depth + 1);
+
+    return index;
+}
+
+void refitStellarBVHLeaves(void* data, int begin, int end)
+{
+    StellarBVH* bvh = (StellarBVH *)data;
+
+    for (int l = begin; l < end; ++l)
+    {
+        StellarBVHNode* node = &bvh->nodes[bvh->leaves[l]];
+
+        real_t lo[3] = { (real_t)INFINITY, (real_t)INFINITY, (real_t)INFINITY };
+        real_t hi[3] = { -(real_t)INFINITY, -(real_t)INFINITY, -(real_t)INFINITY };
+
+        for (int i = node->first; i < node->first + node->count; ++i)
+        {
+            const StellarObject* p = bvh->bodies[bvh->indices[i]];
+
+            for (int a = 0; a < 3; ++a)
+            {
+                if (p->position[a] - p->radius < lo[a])
+                    lo[a] = p->position[a] - p->radius;
+                if (p->position[a] + p->radius > hi[a])
+                    hi[a] = p->position[a] + p->radius;
+            }
+
+            // The name tag is anchored above the sphere (see `renderStellarObject`).
+            if (p->position[1] + p->radius * (real_t)1.1 > hi[1])
+                hi[1] = p->position[1] + p->radius * (real_t)1.1;
+        }
+
+        // Rounded outwards, so that the boxes never cut into what they bound.
+        for (int a = 0; a < 3; ++a)
+        {
+            node->min[a] = nextafterf((float)lo[a], -INFINITY);
+            node->max[a] = nextafterf((float)hi[a], INFINITY);
+        }
+    }
+}
+
+// Fits the boxes to the bodies' current positions, and returns their total surface area.
+double fitStellarBVH(JobSystem* js, StellarBVH* bvh)
+{
+    parallelFor(js, 0, bvh->numLeaves, STELLAR_BVH_REFIT_GRAIN, refitStellarBVHLeaves, bvh);
+
+    double area = 0.0;
+
+    // Children follow their parent, so going backwards visits them first.
+    for (int i = bvh->numNodes - 1; i >= 0; --i)
+    {
+        StellarBVHNode* node = &bvh->nodes[i];
+
+        if (node->right == 0)
+            continue;
+
+        const StellarBVHNode* l = &bvh->nodes[i + 1];
+        const StellarBVHNode* r = &bvh->nodes[node->right];
+
+        for (int a = 0; a < 3; ++a)
+        {
+            node->min[a] = fminf(l->min[a], r->min[a]);
+            node->max[a] = fmaxf(l->max[a], r->max[a]);
+        }
+
+        double dx = (double)node->max[0] - node->min[0];
+        double dy = (double)node->max[1] - node->min[1];
+        double dz = (double)node->max[2] - node->min[2];
+
+        area += dx * dy + dy * dz + dz * dx;
+    }
+    return area;
+}
+
+// (Re)builds the tree over the bodies' current positions. Median splits make its shape depend on the
+// number of bodies only, so the arrays are reused as they are.
+void buildStellarBVH(JobSystem* js, StellarBVH* bvh)
+{
+    StellarBVHItem* items = (StellarBVHItem *)malloc(((size_t)bvh->numBodies + 1) * sizeof(StellarBVHItem));
+
+    for (int i = 0; i < bvh->numBodies; ++i)
+    {
+        items[i].index = i;
+
+        for (int a = 0; a < 3; ++a)
+            items[i].centre[a] = (float)bvh->bodies[i]->position[a];
+    }
+
+    bvh->numNodes = 0;
+    bvh->numLeaves = 0;
+
+    if (bvh->numBodies > 0)
+        buildStellarBVHNode(bvh, items, 0, bvh->numBodies, 0);
+
+    free(items);
+
+    bvh->area = fitStellarBVH(js, bvh);
+    bvh->builtArea = bvh->area;
+}
+
+// Fits the boxes to the bodies' current positions; to be called once the bodies have moved. The
+// tree is rebuilt instead if the boxes have grown too loose (see `STELLAR_BVH_REBUILD_RATIO`).
+void refitStellarBVH(JobSystem* js, StellarBVH* bvh)
+{
+    bvh->area = fitStellarBVH(js, bvh);
+
+    if (bvh->area > STELLAR_BVH_REBUILD_RATIO * bvh->builtArea)
+        buildStellarBVH(js, bvh);
+}
+
+// BVH constructor (heap-allocated) over the bodies, fit to their current positions.
+StellarBVH* initStellarBVH(JobSystem* js, StellarObject* const* bodies, int num_bodies)
+{
+    StellarBVH* bvh = (StellarBVH *)trackedMalloc(MEMORY_TAG_BODIES, sizeof(StellarBVH));
+
+    bvh->bodies = bodies;
+    bvh->numBodies = num_bodies;
+
+    // Median splits leave at least half a leaf's worth of bodies per leaf, hence at most
+    // `num_bodies` / (LEAF_SIZE / 2) leaves, and one node fewer than that above them.
+    size_t max_nodes = 2 * ((size_t)num_bodies / (STELLAR_BVH_LEAF_SIZE / 2) + 1);
+
+    bvh->indices = (int *)trackedMalloc(MEMORY_TAG_BODIES, ((size_t)num_bodies + 1) * sizeof(int));
+    bvh->nodes = (StellarBVHNode *)trackedMalloc(MEMORY_TAG_BODIES, max_nodes * sizeof(StellarBVHNode));
+    bvh->leaves = (int *)trackedMalloc(MEMORY_TAG_BODIES, max_nodes * sizeof(int));
+
+    buildStellarBVH(js, bvh);
+
+    bvh->nodes = (StellarBVHNode *)trackedRealloc(MEMORY_TAG_BODIES, bvh->nodes, ((size_t)bvh->numNodes + 1) * sizeof(StellarBVHNode));
+    bvh->leaves = (int *)trackedRealloc(MEMORY_TAG_BODIES, bvh->leaves, ((size_t)bvh->numLeaves + 1) * sizeof(int));
+
+    return bvh;
+}
+
+// Distance along the ray (`direction` normalized) at which it enters the node's box, grown by
+// `margin`; INFINITY if it misses.
+real_t intersectStellarBVHNode(const StellarBVHNode* node, const vector3r origin, const vector3r inverse_direction, real_t margin)
+{
+    real_t t_near = (real_t)0;
+    real_t t_far = (real_t)INFINITY;
+
+    for (int a = 0; a < 3; ++a)
+    {
+        real_t t0 = ((real_t)node->min[a] - margin - origin[a]) * inverse_direction[a];
+        real_t t1 = ((real_t)node->max[a] + margin - origin[a]) * inverse_direction[a];
+
+        if (t0 > t1)
+        {
+            real_t tmp = t0;
+            t0 = t1;
+            t1 = tmp;
+        }
+
+        // Also covers a ray parallel to the slab, for which both are infinite or NaN.
+        if (!(t0 <= t_far && t1 >= t_near))
+            return (real_t)INFINITY;
+
+        if (t0 > t_near)
+            t_near = t0;
+        if (t1 < t_far)
+            t_far = t1;
+    }
+    return t_near;
+}
+
+// Farthest any point of the node's box lies from `point`.
+real_t getStellarBVHNodeReach(const StellarBVHNode* node, const vector3r point)
+{
+    real_t sum = (real_t)0;
+
+    for (int a = 0; a < 3; ++a)
+    {
+        real_t d = fmax(fabs(point[a] - (real_t)node->min[a]), fabs(point[a] - (real_t)node->max[a]));
+
+        sum += d * d;
+    }
+    return (real_t)sqrt((double)sum);
+}
+
+// Returns the index of the first body hit by the ray from `origin` along `direction` (normalized),
+// and its distance, or -1 if there is none. Each body's sphere is widened by `slope` per unit of
+// distance from the origin, so that far away bodies can be picked within a few pixels of the cursor.
+int pickStellarObject(const StellarBVH* bvh, const vector3r origin, const vector3r direction, real_t slope, real_t* distance)
+{
+    int best = -1;
+    real_t best_t = (real_t)INFINITY;
+
+    if (bvh->numNodes == 0)
+        return -1;
+
+    vector3r inverse_direction = {
+        (real_t)1 / direction[0], (real_t)1 / direction[1], (real_t)1 / direction[2]
+    };
+
+    int stack[STELLAR_BVH_MAX_DEPTH];
+    int top = 0;
+
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const StellarBVHNode* node = &bvh->nodes[stack[--top]];
+
+        real_t margin = slope * getStellarBVHNodeReach(node, origin);
+
+        if (intersectStellarBVHNode(node, origin, inverse_direction, margin) >= best_t)
+            continue;
+
+        if (node->right != 0)
+        {
+            int l = (int)(node - bvh->nodes) + 1;
+            int r = node->right;
+
+            // The nearer child is visited first, so that it prunes the other.
+            real_t tl = intersectStellarBVHNode(&bvh->nodes[l], origin, inverse_direction, margin);
+            real_t tr = intersectStellarBVHNode(&bvh->nodes[r], origin, inverse_direction, margin);
+
+            if (tl > tr)
+            {
+                int tmp = l;
+                l = r;
+                r = tmp;
+            }
+
+            stack[top++] = r;
+            stack[top++] = l;
+            continue;
+        }
+
+        for (int i = node->first; i < node->first + node->count; ++i)
+        {
+            const StellarObject* p = bvh->bodies[bvh->indices[i]];
+
+            vector3r v = {
+                p->position[0] - origin[0], p->position[1] - origin[1], p->position[2] - origin[2]
+            };
+
+            real_t t = v[0] * direction[0] + v[1] * direction[1] + v[2] * direction[2];
+
+            if (t < -p->radius)
+                continue;
+
+            real_t perpendicular = v[0] * v[0] + v[1] * v[1] + v[2] * v[2] - t * t;
+            real_t reach = p->radius + slope * (t > (real_t)0 ? t : (real_t)0);
+
+            if (perpendicular > reach * reach)
+                continue;
+
+            // Where the ray enters the sphere, or where it passes closest to it if it only hits the margin.
+            real_t hit = (perpendicular < p->radius * p->radius ? t - (real_t)sqrt((double)(p->radius * p->radius - perpendicular)) : t);
+
+            if (hit < (real_t)0)
+                hit = (real_t)0;
+
+            if (hit < best_t)
+            {
+                best_t = hit;
+                best = bvh->indices[i];
+            }
+        }
+    }
+
+    if (distance != NULL)
+        *distance = best_t;
+
+    return best;
+}
+
+// Squared distance from `point` to the node's box; 0 inside of it.
+real_t getStellarBVHNodeDistanceSquared(const StellarBVHNode* node, const vector3r point)
+{
+    real_t sum = (real_t)0;
+
+    for (int a = 0; a < 3; ++a)
+    {
+        real_t d = (real_t)0;
+
+        if (point[a] < (real_t)node->min[a])
+            d = (real_t)node->min[a] - point[a];
+        else if (point[a] > (real_t)node->max[a])
+            d = point[a] - (real_t)node->max[a];
+
+        sum += d * d;
+    }
+    return sum;
+}
+
+// Finds the (at most) `k` bodies whose surfaces are nearest to `point`, writing their indices and
+// distances (0 from within a body) in increasing order of distance; returns how many there are.
+int findNearestStellarObjects(const StellarBVH* bvh, const vector3r point, int k, int* indices, real_t* distances)
+{
+    int found = 0;
+
+    if (bvh->numNodes == 0 || k <= 0)
+        return 0;
+
+    int stack[STELLAR_BVH_MAX_DEPTH];
+    int top = 0;
+
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const StellarBVHNode* node = &bvh->nodes[stack[--top]];
+
+        // Bodies lie within their boxes, so a box can only hold nearer ones if it is nearer itself.
+        if (found == k)
+        {
+            real_t worst = distances[k - 1];
+
+            if (getStellarBVHNodeDistanceSquared(node, point) > worst * worst)
+                continue;
+        }
+
+        if (node->right != 0)
+        {
+            int l = (int)(node - bvh->nodes) + 1;
+            int r = node->right;
+
+            if (getStellarBVHNodeDistanceSquared(&bvh->nodes[l], point) > getStellarBVHNodeDistanceSquared(&bvh->nodes[r], point))
+            {
+                int tmp = l;
+                l = r;
+                r = tmp;
+            }
+
+            stack[top++] = r;
+            stack[top++] = l;
+            continue;
+        }
+
+        for (int i = node->first; i < node->first + node->count; ++i)
+        {
+            const StellarObject* p = bvh->bodies[bvh->indices[i]];
+
+            real_t dx = p->position[0] - point[0];
+            real_t dy = p->position[1] - point[1];
+            real_t dz = p->position[2] - point[2];
+
+            real_t d = (real_t)sqrt((double)(dx * dx + dy * dy + dz * dz)) - p->radius;
+
+            if (d < (real_t)0)
+                d = (real_t)0;
+
+            if (found == k && d >= distances[k - 1])
+                continue;
+
+            // Insertion into the sorted results, dropping the farthest when full.
+            int j = (found < k ? found++ : k - 1);
+
+            while (j > 0 && distances[j - 1] > d)
+            {
+                distances[j] = distances[j - 1];
+                indices[j] = indices[j - 1];
+                --j;
+            }
+
+            distances[j] = d;
+            indices[j] = bvh->indices[i];
+        }
+    }
+    return found;
+}
+
+void markStellarBVHNode(const StellarBVH* bvh, const StellarBVHNode* node, bool visible)
+{
+    for (int i = node->first; i < node->first + node->count; ++i)
+    {
+        StellarObject* p = bvh->bodies[bvh->indices[i]];
+
+        p->visible = visible;
+        p->labelVisible = visible;
+    }
+}
+
+void cullStellarObjectTrajectoryRange(void* data, int begin, int end)
+{
+    const StellarCullArgs* args = (const StellarCullArgs *)data;
+
+    for (int i = begin; i < end; ++i)
+        cullStellarObjectTrajectory(args->bodies[i], args->planes);
+}
+
+// `cullStellarObjects` through the tree: the bounding sphere of each box is tested against the
+// frustum, and the bodies of a box that lies wholly outside (or inside) of it are culled (or kept)
+// without being tested one by one, nor even touched if they already were the last time. Trajectories,
+// which the boxes do not bound, are still culled in parallel. The tree must be fit to the bodies'
+// current positions, and be the only one culling them.
+void cullStellarObjectsWithBVH(JobSystem* js, StellarBVH* bvh, const matrix4f view_projection)
+{
+    StellarCullArgs args;
+
+    args.bodies = bvh->bodies;
+
+    extractFrustumPlanes4f(args.planes, view_projection);
+
+    parallelFor(js, 0, bvh->numBodies, STELLAR_CULL_GRAIN, cullStellarObjectTrajectoryRange, &args);
+
+    if (bvh->numNodes == 0)
+        return;
+
+    // Along with each node, how its bodies were left: what the node was last time, unless its parent
+    // was wholly inside or outside, in which case the node was not reached and they were left as that.
+    int stack[STELLAR_BVH_MAX_DEPTH];
+    int previous[STELLAR_BVH_MAX_DEPTH];
+    int top = 0;
+
+    stack[top] = 0;
+    previous[top++] = bvh->nodes[0].culled;
+
+    while (top > 0)
+    {
+        --top;
+
+        StellarBVHNode* node = &bvh->nodes[stack[top]];
+
+        int culled = previous[top];
+
+        float x = .5f * (node->min[0] + node->max[0]);
+        float y = .5f * (node->min[1] + node->max[1]);
+        float z = .5f * (node->min[2] + node->max[2]);
+
+        float dx = .5f * (node->max[0] - node->min[0]);
+        float dy = .5f * (node->max[1] - node->min[1]);
+        float dz = .5f * (node->max[2] - node->min[2]);
+
+        float radius = sqrtf(dx * dx + dy * dy + dz * dz);
+
+        node->culled = STELLAR_BVH_CULLED_INSIDE;
+
+        for (int i = 0; i < 6; ++i)
+        {
+            float d = args.planes[i][0] * x + args.planes[i][1] * y + args.planes[i][2] * z + args.planes[i][3];
+
+            if (d < -radius)
+            {
+                node->culled = STELLAR_BVH_CULLED_OUTSIDE;
+                break;
+            }
+            else if (d < radius)
+                node->culled = STELLAR_BVH_CULLED_PARTIAL;
+        }
+
+        if (node->culled != STELLAR_BVH_CULLED_PARTIAL)
+        {
+            if (node->culled != culled)
+                markStellarBVHNode(bvh, node, node->culled == STELLAR_BVH_CULLED_INSIDE);
+        }
+        else if (node->right != 0)
+        {
+            int l = (int)(node - bvh->nodes) + 1;
+
+            stack[top] = node->right;
+            previous[top++] = (culled == STELLAR_BVH_CULLED_PARTIAL ? bvh->nodes[node->right].culled : culled);
+
+            stack[top] = l;
+            previous[top++] = (culled == STELLAR_BVH_CULLED_PARTIAL ? bvh->nodes[l].culled : culled);
+        }
+        else
+        {
+            for (int i = node->first; i < node->first + node->count; ++i)
+                cullStellarObject(bvh->bodies[bvh->indices[i]], args.planes);
+        }
+    }
+}
+
+void printStellarBVHStatistics(const StellarBVH* bvh)
+{
+    printf(
+        "BVH: %d bodies in %d nodes (%d leaves), %.2lf MiB.\n",
+        bvh->numBodies, bvh->numNodes, bvh->numLeaves,
+        (double)((size_t)bvh->numNodes * sizeof(StellarBVHNode) + (size_t)(bvh->numBodies + bvh->numLeaves) * sizeof(int)) / (1 << 20)
+    );
+}
+
+void deleteStellarBVH(StellarBVH* bvh)
+{
+    if (bvh == NULL)
+        return;
+
+    trackedFree(bvh->leaves);
+    trackedFree(bvh->nodes);
+    trackedFree(bvh->indices);
+    trackedFree(bvh);
+}
+
+#endif // STELLAR_BVH_H
@@ -0,0 +1,580 @@
+#ifndef STELLAR_CATALOG_H
+#define STELLAR_CATALOG_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "NameTable.h"
+#include "JsonStream.h"
+#include "MappedFile.h"
+#include "CustomTypes.h"
+
+
+// The astronomical objects of a system as described by its `data.json`, validated and with their
+// parents resolved, but not yet turned into renderable `StellarObject`s. Parsing the catalog does
+// not depend on OpenGL, so that it can be shared by the program and the offline tools.
+
+// Fields of an "Astronomical Objects" entry.
+typedef enum StellarObjectField
+{
+    STELLAR_FIELD_NAME = 0,
+    STELLAR_FIELD_RADIUS,
+    STELLAR_FIELD_ORBIT_PERIOD,
+    STELLAR_FIELD_PARENT,
+    STELLAR_FIELD_PARENT_DIST,
+    STELLAR_FIELD_SOLAR_TILT,
+    STELLAR_FIELD_COLOR,
+    STELLAR_FIELD_DAY_PERIOD,
+    STELLAR_NUM_FIELDS
+
+} StellarObjectField;
+
+const char* const stellar_field_names[STELLAR_NUM_FIELDS] = {
+    "name",
+    "radius",
+    "orbit_period",
+    "parent",
+    "parent_dist",
+    "solar_tilt",
+    "color",
+    "day_period"
+};
+
+// Type of a field's value as seen by the streaming parser.
+typedef enum StellarFieldType
+{
+    STELLAR_FIELD_MISSING = 0,
+    STELLAR_FIELD_NULL,
+    STELLAR_FIELD_NUMBER,
+    STELLAR_FIELD_STRING,
+    STELLAR_FIELD_COLOR_ARRAY,
+    STELLAR_FIELD_OTHER
+
+} StellarFieldType;
+
+// A single "Astronomical Objects" entry, as it is read from the file. The string buffers are
+// reused from one entry to the next, so parsing the catalog allocates nothing per entry.
+typedef struct StellarObjectRecord
+{
+    StellarFieldType types[STELLAR_NUM_FIELDS];
+
+    double numbers[STELLAR_NUM_FIELDS];
+
+    double color[3];
+
+    char* name;
+    size_t nameCapacity;
+
+    char* parent;
+    size_t parentCapacity;
+
+} StellarObjectRecord;
+
+
+// Reads the `color` value, whose first token has already been consumed, into the record.
+bool readStellarObjectColor(JsonStream* s, const JsonToken* first, StellarObjectRecord* record)
+{
+    if (first->type != JSON_TOKEN_ARRAY_BEGIN)
+    {
+        record->types[STELLAR_FIELD_COLOR] = STELLAR_FIELD_OTHER;
+        return skipJsonValue(s, first);
+    }
+
+    JsonToken t;
+
+    int n = 0;
+
+    bool valid = true;
+
+    while (nextJsonToken(s, &t) != JSON_TOKEN_ARRAY_END)
+    {
+        if (t.type == JSON_TOKEN_ERROR)
+            return false;
+
+        if (t.type == JSON_TOKEN_NUMBER && n < 3)
+            record->color[n] = t.number;
+        else
+            valid = false;
+
+        ++n;
+
+        if (!skipJsonValue(s, &t))
+            return false;
+    }
+
+    record->types[STELLAR_FIELD_COLOR] = (valid && n == 3 ? STELLAR_FIELD_COLOR_ARRAY : STELLAR_FIELD_OTHER);
+    return true;
+}
+
+// Reads the members of an entry up to (and including) its closing brace.
+bool readStellarObjectRecord(JsonStream* s, StellarObjectRecord* record)
+{
+    for (int f = 0; f < STELLAR_NUM_FIELDS; ++f)
+        record->types[f] = STELLAR_FIELD_MISSING;
+
+    JsonToken key, value;
+
+    while (nextJsonToken(s, &key) != JSON_TOKEN_OBJECT_END)
+    {
+        if (key.type != JSON_TOKEN_KEY || nextJsonToken(s, &value) == JSON_TOKEN_ERROR)
+            return false;
+
+        int f = 0;
+
+        while (f < STELLAR_NUM_FIELDS && !jsonTokenEquals(&key, stellar_field_names[f]))
+            ++f;
+
+        // Unknown members and duplicates of an already-read field are ignored.
+        if (f == STELLAR_NUM_FIELDS || record->types[f] != STELLAR_FIELD_MISSING)
+        {
+            if (!skipJsonValue(s, &value))
+                return false;
+            continue;
+        }
+
+        if (f == STELLAR_FIELD_COLOR)
+        {
+            if (!readStellarObjectColor(s, &value, record))
+                return false;
+            continue;
+        }
+
+        switch (value.type)
+        {
+        case JSON_TOKEN_NULL:
+            record->types[f] = STELLAR_FIELD_NULL;
+            break;
+
+        case JSON_TOKEN_NUMBER:
+            record->types[f] = STELLAR_FIELD_NUMBER;
+            record->numbers[f] = value.number;
+            break;
+
+        case JSON_TOKEN_STRING:
+            record->types[f] = STELLAR_FIELD_STRING;
+
+            if (f == STELLAR_FIELD_NAME || f == STELLAR_FIELD_PARENT)
+            {
+                size_t length = (
+                    f == STELLAR_FIELD_NAME ?
+                    decodeJsonString(&value, &record->name, &record->nameCapacity) :
+                    decodeJsonString(&value, &record->parent, &record->parentCapacity)
+                );
+
+                if (length == (size_t)-1)
+                    record->types[f] = STELLAR_FIELD_OTHER;
+            }
+            break;
+
+        default:
+            record->types[f] = STELLAR_FIELD_OTHER;
+
+            if (!skipJsonValue(s, &value))
+                return false;
+            break;
+        }
+    }
+    return true;
+}
+
+// Returns the name of the first invalid field of the record, or NULL if all of them are valid.
+const char* validateStellarObjectRecord(const StellarObjectRecord* record)
+{
+    const StellarFieldType* type = record->types;
+
+    if (type[STELLAR_FIELD_NAME] != STELLAR_FIELD_STRING)
+        return "name";
+
+    if (type[STELLAR_FIELD_RADIUS] != STELLAR_FIELD_NUMBER)
+        return "radius";
+
+    if (type[STELLAR_FIELD_ORBIT_PERIOD] != STELLAR_FIELD_NUMBER && type[STELLAR_FIELD_ORBIT_PERIOD] != STELLAR_FIELD_NULL)
+        return "orbit_period";
+
+    if (type[STELLAR_FIELD_PARENT] != STELLAR_FIELD_STRING && type[STELLAR_FIELD_PARENT] != STELLAR_FIELD_NULL)
+        return "parent";
+
+    if (type[STELLAR_FIELD_PARENT_DIST] != STELLAR_FIELD_NUMBER && type[STELLAR_FIELD_PARENT_DIST] != STELLAR_FIELD_NULL)
+        return "parent_dist";
+
+    if (type[STELLAR_FIELD_SOLAR_TILT] != STELLAR_FIELD_NUMBER)
+        return "solar_tilt";
+
+    if (type[STELLAR_FIELD_COLOR] != STELLAR_FIELD_COLOR_ARRAY)
+        return "color";
+
+    if (type[STELLAR_FIELD_DAY_PERIOD] != STELLAR_FIELD_NUMBER)
+        return "day_period";
+
+    return NULL;
+}
+
+// A validated catalog entry. Names are stored as ids of the catalog's `NameTable`.
+typedef struct StellarCatalogEntry
+{
+    int nameId;
+
+    // -1 for bodies without a parent.
+    int parentNameId;
+
+    real_t radius;
+    real_t orbitPeriod;
+    real_t parentDistance;
+    real_t solarTilt;
+    real_t dayPeriod;
+
+    vector3ub color;
+
+} StellarCatalogEntry;
+
+
+void stageStellarCatalogEntry(const StellarObjectRecord* record, NameTable* names, StellarCatalogEntry* entry)
+{
+    const StellarFieldType* type = record->types;
+    const double* number = record->numbers;
+
+    entry->nameId = internName(names, record->name, NULL);
+    entry->parentNameId = (type[STELLAR_FIELD_PARENT] == STELLAR_FIELD_STRING ? internName(names, record->parent, NULL) : -1);
+
+    entry->radius = (real_t)number[STELLAR_FIELD_RADIUS];
+    entry->orbitPeriod = (type[STELLAR_FIELD_ORBIT_PERIOD] == STELLAR_FIELD_NULL ? (real_t)1.0 : (real_t)number[STELLAR_FIELD_ORBIT_PERIOD]);
+    entry->parentDistance = (type[STELLAR_FIELD_PARENT_DIST] == STELLAR_FIELD_NULL ? (real_t)0.0 : (real_t)number[STELLAR_FIELD_PARENT_DIST]);
+    entry->solarTilt = (real_t)number[STELLAR_FIELD_SOLAR_TILT];
+    entry->dayPeriod = (real_t)number[STELLAR_FIELD_DAY_PERIOD];
+
+    for (int i = 0; i < 3; ++i)
+        entry->color[i] = (ubyte_t)(int)record->color[i];
+}
+
+
+// Resolves the parent of every entry and computes an order in which every parent precedes
+// its children. The order follows the file wherever the file already satisfies this, and otherwise
+// pulls each parent right before its first child. Returns false if the parent references form a cycle.
+bool sortStellarCatalogEntries(
+    const StellarCatalogEntry* entries, int n, const NameTable* names, const char* json_filename,
+    int* parent_index, int* order
+)
+{
+    // Index of the (first) entry of each name, -1 for names that are only used as parents.
+    int* name_index = (int *)malloc((size_t)(names->count > 0 ? names->count : 1) * sizeof(int));
+
+    for (int id = 0; id < names->count; ++id)
+        name_index[id] = -1;
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (name_index[entries[i].nameId] < 0)
+        {
+            name_index[entries[i].nameId] = i;
+        }
+        else
+        {
+            fprintf(
+                stderr, "Warning: %s is declared more than once; Parent references resolve to its first declaration. Inspect \"%s\".\n",
+                getName(names, entries[i].nameId), json_filename
+            );
+        }
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        parent_index[i] = (entries[i].parentNameId < 0 ? -1 : name_index[entries[i].parentNameId]);
+
+        if (entries[i].parentNameId >= 0 && parent_index[i] < 0)
+        {
+            fprintf(
+                stderr,
+                "Warning: %s was declared as %s's planetary anchor but this StellarObject is not found and will thus not render.\n"
+                "         Inspect JSON file \"%s\"\n",
+                getName(names, entries[i].parentNameId),
+                getName(names, entries[i].nameId),
+                json_filename
+            );
+        }
+    }
+
+    free(name_index);
+
+    // 0: not visited yet, 1: on the current ancestor chain, 2: placed.
+    char* state = (char *)calloc((size_t)n + 1, sizeof(char));
+    int* chain = (int *)malloc(((size_t)n + 1) * sizeof(int));
+
+    int placed = 0;
+
+    bool acyclic = true;
+
+    for (int i = 0; i < n && acyclic; ++i)
+    {
+        int length = 0;
+        int j = i;
+
+        // Walk up the ancestors until a placed one (or a root) is reached ...
+        while (j >= 0 && state[j] == 0)
+        {
+            state[j] = 1;
+            chain[length++] = j;
+            j = parent_index[j];
+        }
+
+        if (j >= 0 && state[j] == 1)
+        {
+            fprintf(
+                stderr, "Error: %s is its own ancestor (cyclic `parent` references); Inspect \"%s\".\n",
+                getName(names, entries[j].nameId), json_filename
+            );
+            acyclic = false;
+            break;
+        }
+
+        // ... and place them from the top down.
+        while (length > 0)
+        {
+            int k = chain[--length];
+
+            state[k] = 2;
+            order[placed++] = k;
+        }
+    }
+
+    free(chain);
+    free(state);
+
+    return acyclic;
+}
+
+
+typedef struct StellarCatalog
+{
+    NameTable* names;
+
+    // Sorted so that every parent precedes its children.
+    StellarCatalogEntry* entries;
+
+    // Index of each entry's parent within `entries`; -1 for bodies without a (resolvable) parent.
+    int* parents;
+
+    int count;
+
+} StellarCatalog;
+
+
+// Invoked for every entry as soon as it has been read and validated, e.g. to start loading its
+// assets while the rest of the file is still being parsed. `name_id` identifies the name within
+// the catalog's `NameTable` (entries sharing a name share it).
+typedef void (*StellarCatalogCallback)(const char* name, int name_id, void* user);
+
+// Streams the "Astronomical Objects" array of the given JSON file into a catalog (heap-allocated).
+// Returns NULL, after reporting the problem, if the file is missing or invalid.
+// `on_entry` is optional.
+StellarCatalog* parseStellarCatalog(const char* json_filename, StellarCatalogCallback on_entry, void* user)
+{
+    MappedFile* file = openMappedFile(json_filename, true);
+
+    if (file == NULL) 
+    { 
+        fprintf(stderr, "Error: Unable to open the JSON file \"%s\".\n", json_filename); 
+        return NULL;
+    } 
+
+    JsonStream stream;
+    JsonToken t;
+
+    initJsonStream(&stream, file->data, file->size);
+
+    StellarObjectRecord record;
+
+    memset(&record, 0, sizeof(record));
+
+    NameTable* names = initNameTable(256);
+
+    int count = 0;
+
+    size_t capacity = 256;
+
+    StellarCatalogEntry* entries = (StellarCatalogEntry *)malloc(capacity * sizeof(StellarCatalogEntry));
+
+    bool found = false;
+    bool failed = (nextJsonToken(&stream, &t) != JSON_TOKEN_OBJECT_BEGIN);
+
+    if (failed && t.type != JSON_TOKEN_ERROR)
+        fprintf(stderr, "Error: The root of \"%s\" should be a JSON object.\n", json_filename);
+
+    // Look for the "Astronomical Objects" member, skipping over any other.
+    while (!failed && !found && nextJsonToken(&stream, &t) == JSON_TOKEN_KEY)
+    {
+        bool is_catalog = jsonTokenEquals(&t, "Astronomical Objects");
+
+        if (nextJsonToken(&stream, &t) == JSON_TOKEN_ERROR)
+            failed = true;
+
+        else if (!is_catalog)
+            failed = !skipJsonValue(&stream, &t);
+
+        else if (t.type != JSON_TOKEN_ARRAY_BEGIN)
+        {
+            fprintf(
+                stderr, 
+                "Error: Astronomical Objects should be an array of objects; Inspect \"%s\".\n", 
+                json_filename
+            );
+            failed = true;
+        }
+        else
+        {
+            found = true;
+        }
+    }
+
+    if (!failed && !found && t.type != JSON_TOKEN_ERROR)
+    {
+        fprintf(stderr, "Error: Astronomical Objects array not found; Inspect \"%s\".\n", json_filename);
+        failed = true;
+    }
+
+    // First pass: validate the entries.
+    while (!failed && found && nextJsonToken(&stream, &t) != JSON_TOKEN_ARRAY_END)
+    {
+        if (t.type == JSON_TOKEN_ERROR)
+        {
+            failed = true;
+            break;
+        }
+
+        if (t.type != JSON_TOKEN_OBJECT_BEGIN)
+        {
+            fprintf(
+                stderr,
+                "Error: Astronomical Objects should only contain JSON objects; Inspect arrray item idx.#%d in \"%s\".\n", 
+                count, json_filename
+            );
+            failed = true;
+            break;
+        }
+
+        if (!readStellarObjectRecord(&stream, &record))
+        {
+            failed = true;
+            break;
+        }
+
+        const char* error_field = validateStellarObjectRecord(&record);
+
+        if (error_field != NULL)
+        {
+            fprintf(
+                stderr, "Error: JSON array idx.#%d - StellarObject's `%s` field is invalid; Inspect \"%s\".\n",
+                count, error_field, json_filename
+            );
+            failed = true;
+            break;
+        }
+
+        if (
+            record.types[STELLAR_FIELD_PARENT] != STELLAR_FIELD_NULL && 
+            (record.types[STELLAR_FIELD_PARENT_DIST] != STELLAR_FIELD_NUMBER || record.types[STELLAR_FIELD_ORBIT_PERIOD] != STELLAR_FIELD_NUMBER)
+        )
+        {
+            fprintf(
+                stderr, 
+                "Error: %s's parent was declared non-null but dependent fields are invalid; Inspect \"%s\".\n",
+                record.name, 
+                json_filename
+            );
+            failed = true;
+            break;
+        }
+
+        if ((size_t)count == capacity)
+        {
+            capacity *= 2;
+            entries = (StellarCatalogEntry *)realloc(entries, capacity * sizeof(StellarCatalogEntry));
+        }
+
+        stageStellarCatalogEntry(&record, names, &entries[count]);
+
+        if (on_entry != NULL)
+            on_entry(record.name, entries[count].nameId, user);
+
+        count += 1;
+    }
+
+    // Syntax errors are reported along with their location in the file.
+    if (stream.errorMessage != NULL)
+    {
+        int line, column;
+
+        getJsonStreamLocation(&stream, &line, &column);
+
+        fprintf(
+            stderr, "Error: Malformed JSON (%s) at line %d, column %d; Inspect \"%s\".\n",
+            stream.errorMessage, line, column, json_filename
+        );
+    }
+    else if (!failed && found && count == 0)
+    {
+        fprintf(stderr, "Warning: No astronomical objects were found in \"%s\".\n", json_filename);
+    }
+
+    free(record.name);
+    free(record.parent);
+
+    closeMappedFile(file);
+
+    int* parent_index = (int *)malloc(((size_t)count + 1) * sizeof(int));
+    int* order = (int *)malloc(((size_t)count + 1) * sizeof(int));
+
+    // Second pass: resolve the parents and sort the entries, parents first.
+    if (failed || !sortStellarCatalogEntries(entries, count, names, json_filename, parent_index, order))
+    {
+        free(order);
+        free(parent_index);
+        free(entries);
+        deleteNameTable(names);
+        return NULL;
+    }
+
+    StellarCatalog* c = (StellarCatalog *)malloc(sizeof(StellarCatalog));
+
+    c->names = names;
+    c->count = count;
+    c->entries = (StellarCatalogEntry *)malloc(((size_t)count + 1) * sizeof(StellarCatalogEntry));
+    c->parents = (int *)malloc(((size_t)count + 1) * sizeof(int));
+
+    // Sorted position of each entry, for remapping the parent indices.
+    int* position = (int *)malloc(((size_t)count + 1) * sizeof(int));
+
+    for (int k = 0; k < count; ++k)
+    {
+        c->entries[k] = entries[order[k]];
+        position[order[k]] = k;
+    }
+
+    for (int k = 0; k < count; ++k)
+        c->parents[k] = (parent_index[order[k]] < 0 ? -1 : position[parent_index[order[k]]]);
+
+    free(position);
+    free(order);
+    free(parent_index);
+    free(entries);
+
+    return c;
+}
+
+void deleteStellarCatalog(StellarCatalog* c)
+{
+    if (c == NULL)
+        return;
+
+    deleteNameTable(c->names);
+    free(c->entries);
+    free(c->parents);
+    free(c);
+}
+
+#endif // STELLAR_CATALOG_H
@@ -1,28 +1,49 @@
 #ifndef STELLAR_OBJECT_H
 #define STELLAR_OBJECT_H
 
-#include <cJSON.h>
+#include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdatomic.h>
 #include <GL/freeglut.h>
 
+#include "Arena.h"
 #include "Textures.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "Transform.h"
+#include "MemoryTracker.h"
+#include "TextureLoader.h"
 #include "CustomTypes.h"
+#include "SystemBinary.h"
+#include "StellarCatalog.h"
 #include "TextRendering.h"
 #include "KeyboardCallback.h"
 
 
-typedef struct StellarObject
+// Destination of a body's texture. Textures are requested as soon as the bodies' names are known,
+// which is before the bodies themselves are constructed, so `body` is filled in afterwards.
+typedef struct StellarTextureTarget
 {
     char* name;
 
-    GLUquadric* quad;
+    struct StellarObject* body;
+
+} StellarTextureTarget;
+
+typedef struct StellarObject
+{
+    char* name;
 
     // The centre of the body's rotation.
     struct StellarObject* parent;
 
     vector3r position;
 
+    // For bodies without a parent, the centre of their orbit: their system's position in the world
+    // (see `Universe.h`), zero otherwise.
+    vector3r origin;
+
     real_t radius;
 
     // The body's linear velocity along its trajectory in rad/h.
@@ -56,8 +77,154 @@ typedef struct StellarObject
     // The body's OpenGL texture ID
     GLuint texture; 
 
+    // The request of the body's texture while it is still loading (see `TextureLoader.h`), NULL otherwise.
+    StellarTextureTarget* pendingTexture;
+
+    // Cached world matrix of the body's sphere: translation to `position`, followed
+    // by the axial tilt and the rotation around its own axis.
+    matrix4f modelMatrix;
+
+    // Cached world matrix of the unit circle display list that draws the trajectory.
+    matrix4f trajectoryMatrix;
+
+    // Forces the cached matrices to be rebuilt on the next update (e.g. after re-parenting).
+    bool transformDirty;
+
+    // Incremented every time the cached matrices are rebuilt. Children compare it against
+    // `parentTransformVersion` to find out whether their parent moved since their last update.
+    unsigned int transformVersion;
+
+    unsigned int parentTransformVersion;
+
+    // Temporal level of detail (see `updateStellarObjects`): the body is advanced every 2^updateTier
+    // frames, and follows its parent in between. `pendingTime` is the simulated time (in hours) it
+    // has yet to be advanced by, and `localPosition` its offset from its parent (or its origin).
+    int updateTier;
+
+    real_t pendingTime;
+
+    vector3r localPosition;
+
+    // Slot of the body's trail (see `OrbitTrails.h`), -1 until it has one.
+    int trailIndex;
+
+    // Set by `cullStellarObjects` for the frame: whether the body's sphere, its name tag and its
+    // trajectory may be within the camera's view.
+    bool visible;
+    bool labelVisible;
+    bool trajectoryVisible;
+
 } StellarObject;
 
+// Update tiers of the temporal level of detail: tier `t` is updated every 2^t frames.
+#define STELLAR_UPDATE_TIERS 4
+
+// The bodies in the order they are updated in (see `updateStellarObjects`): grouped by their depth
+// in the hierarchy, the roots first, then their satellites, and so on, so that all the bodies of a
+// group can be updated in parallel once the previous group is done.
+typedef struct StellarUpdateOrder
+{
+    StellarObject** bodies;
+
+    int numBodies;
+
+    // Start of each group within `bodies`, followed by the end of the last one.
+    int* groupStarts;
+
+    int numGroups;
+
+    // Updates so far, which staggers the lower tiers' bodies over the frames.
+    unsigned int frame;
+
+    // Bodies per update tier, as of the last update.
+    atomic_int tierCounts[STELLAR_UPDATE_TIERS];
+
+} StellarUpdateOrder;
+
+// What the bodies are seen from, which decides how often each of them is updated.
+typedef struct StellarUpdateView
+{
+    vector3r viewpoint;
+
+    // The body the camera is anchored to, NULL if none.
+    const StellarObject* anchor;
+
+    // Pixels on screen per radian of the field of view.
+    real_t pixelsPerRadian;
+
+} StellarUpdateView;
+
+
+// Owner of the bodies of the loaded system, along with their names and texture requests (see
+// `Arena.h`), all released at once when the system is unloaded; NULL until initialised, in which
+// case each of them is allocated on the heap separately. Either way, they are accounted to
+// `MEMORY_TAG_BODIES`. Must not change between set and unset while bodies exist (a universe swaps
+// in each system's own arena while loading or unloading it, see `Universe.h`).
+Arena* stellar_arena = NULL;
+
+// Quadrics shared by all bodies, untextured and textured (see `getStellarObjectQuadric`).
+GLUquadric* stellar_quadrics[2] = { NULL, NULL };
+
+
+void* allocStellarData(size_t size)
+{
+    return (stellar_arena != NULL ? arenaAlloc(stellar_arena, size) : trackedMalloc(MEMORY_TAG_BODIES, size));
+}
+
+char* buildStellarString(const char* original_string)
+{
+    return (stellar_arena != NULL ? arenaStrBuild(stellar_arena, original_string) : trackedStrBuild(MEMORY_TAG_BODIES, original_string));
+}
+
+// Arena allocations are only released along with the arena.
+void freeStellarData(void* data)
+{
+    if (stellar_arena == NULL)
+        trackedFree(data);
+}
+
+// Concatenates `data_dir` and `name` into a temporary filename, to be given back right after use
+// (with nothing else allocated in between) by `releaseStellarFilename`.
+char* buildStellarFilename(const char* data_dir, const char* name, ArenaMark* mark)
+{
+    if (stellar_arena == NULL)
+        return strCat(2, data_dir, name);
+
+    *mark = getArenaMark(stellar_arena);
+
+    return arenaStrCat(stellar_arena, 2, data_dir, name);
+}
+
+void releaseStellarFilename(char* filename, ArenaMark mark)
+{
+    if (stellar_arena == NULL)
+        free(filename);
+    else
+        rewindArena(stellar_arena, mark);
+}
+
+GLUquadric* getStellarObjectQuadric(bool textured)
+{
+    if (stellar_quadrics[textured] == NULL)
+    {
+        stellar_quadrics[textured] = gluNewQuadric();
+
+        gluQuadricTexture(stellar_quadrics[textured], (textured ? GL_TRUE : GL_FALSE));
+        gluQuadricDrawStyle(stellar_quadrics[textured], GLU_FILL);
+    }
+    return stellar_quadrics[textured];
+}
+
+void deleteStellarObjectQuadrics(void)
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        if (stellar_quadrics[i] != NULL)
+            gluDeleteQuadric(stellar_quadrics[i]);
+
+        stellar_quadrics[i] = NULL;
+    }
+}
 
 StellarObject* initStellarObject(
     const char* name, 
@@ -74,9 +241,9 @@ StellarObject* initStellarObject(
 #ifdef PROJ_DEBUG
     printf("Creating StellarObject of radius %.2f\n", radius);
 #endif
-    StellarObject* p = (StellarObject*)malloc(sizeof(StellarObject));
+    StellarObject* p = (StellarObject *)allocStellarData(sizeof(StellarObject));
 
-    p->name = strBuild(name);
+    p->name = buildStellarString(name);
 
     p->radius = AUtoR(radius);
 
@@ -89,8 +256,6 @@ StellarObject* initStellarObject(
     p->cosGlobalSolarTilt = (real_t)cos((double)p->globalSolarTilt * (M_PI / 180.0));
     p->sinGlobalSolarTilt = (real_t)sin((double)p->globalSolarTilt * (M_PI / 180.0));
 
-    p->quad = gluNewQuadric();
-
     p->parametricAngle = -M_PI;
 
     p->selfParametricAngle = -M_PI;
@@ -103,6 +268,8 @@ StellarObject* initStellarObject(
 
     p->hasTexture = has_texture;
 
+    p->pendingTexture = NULL;
+
     p->selfAngularVelocity = (real_t)1.0 / day_period;
 
 
@@ -122,11 +289,23 @@ StellarObject* initStellarObject(
 
     memset(p->color, (int)0xFF, sizeof(p->color));
     memset(p->position, (int).0, sizeof(p->position));
+    memset(p->origin, (int).0, sizeof(p->origin));
+    memset(p->localPosition, (int).0, sizeof(p->localPosition));
+
+    p->updateTier = 0;
+    p->pendingTime = (real_t).0;
+    p->trailIndex = -1;
 
-    if (has_texture)
-        gluQuadricTexture(p->quad, GL_TRUE);
+    matrixIdentity4f(p->modelMatrix);
+    matrixIdentity4f(p->trajectoryMatrix);
 
-    gluQuadricDrawStyle(p->quad, GLU_FILL);
+    p->transformDirty = true;
+    p->transformVersion = 0;
+    p->parentTransformVersion = 0;
+
+    p->visible = true;
+    p->labelVisible = true;
+    p->trajectoryVisible = true;
 
     return p;
 }
@@ -153,24 +332,114 @@ void deleteStellarObject(StellarObject* p)
 {
     if (p != NULL)
     {
-        gluDeleteQuadric(p->quad);
-        free(p->name);
-        glDeleteTextures(1, &p->texture);
-        free(p);
+        // A texture still loading is discarded once it arrives.
+        if (p->pendingTexture != NULL)
+            p->pendingTexture->body = NULL;
+
+        deleteTextures(1, &p->texture);
+
+        // Within an arena, the body stays allocated (unused) until the whole system is unloaded.
+        freeStellarData(p->name);
+        freeStellarData(p);
     }
 }
 
-void updateStellarObject(StellarObject* p, real_t speed_factor, real_t dt)
+// Deletes all the bodies of a system (e.g. as returned by `loadAllStellarObjects`), along with
+// their array. Their textures are deleted in one go, and the bodies themselves are left to be
+// released along with the `stellar_arena`, if any.
+void deleteStellarObjects(StellarObject** bodies, int num_bodies)
+{
+    GLuint* textures = (GLuint *)malloc(((size_t)num_bodies + 1) * sizeof(GLuint));
+
+    int num_textures = 0;
+
+    for (int i = 0; i < num_bodies; ++i)
+    {
+        StellarObject* p = bodies[i];
+
+        if (p->pendingTexture != NULL)
+            p->pendingTexture->body = NULL;
+
+        if (p->texture != 0)
+            textures[num_textures++] = p->texture;
+
+        freeStellarData(p->name);
+        freeStellarData(p);
+    }
+
+    deleteTextures(num_textures, textures);
+
+    free(textures);
+    trackedFree(bodies);
+}
+
+// Rebuilds the body's cached world matrices from its current position and angles.
+void updateStellarObjectTransform(StellarObject* p)
 {
-    p->parametricAngle += speed_factor * p->angularVelocity * dt;
-    p->selfParametricAngle += speed_factor * p->selfAngularVelocity * dt;
+    float c = (float)cos((double)p->selfParametricAngle);
+    float s = (float)sin((double)p->selfParametricAngle);
+
+    float ct = (float)cos(((double)p->solarTilt - 90.0) * (M_PI / 180.0));
+    float st = (float)sin(((double)p->solarTilt - 90.0) * (M_PI / 180.0));
+
+    // T(position) * Rx(solarTilt - 90) * Rz(selfParametricAngle), written out explicitly.
+    float* m = p->modelMatrix;
+
+    m[0] = c;       m[4] = -s;      m[8]  = .0f;    m[12] = (float)p->position[0];
+    m[1] = ct * s;  m[5] = ct * c;  m[9]  = -st;    m[13] = (float)p->position[1];
+    m[2] = st * s;  m[6] = st * c;  m[10] = ct;     m[14] = (float)p->position[2];
+    m[3] = .0f;     m[7] = .0f;     m[11] = .0f;    m[15] = 1.0f;
+
+    if (p->parent != NULL)
+    {
+        // T(parent position) * Rz(globalSolarTilt) * S(parentDistance).
+        float d = (float)p->parentDistance;
+        float cg = (float)p->cosGlobalSolarTilt;
+        float sg = (float)p->sinGlobalSolarTilt;
+
+        m = p->trajectoryMatrix;
+
+        m[0] = d * cg;  m[4] = -d * sg; m[8]  = .0f;    m[12] = (float)p->parent->position[0];
+        m[1] = d * sg;  m[5] = d * cg;  m[9]  = .0f;    m[13] = (float)p->parent->position[1];
+        m[2] = .0f;     m[6] = .0f;     m[10] = d;      m[14] = (float)p->parent->position[2];
+        m[3] = .0f;     m[7] = .0f;     m[11] = .0f;    m[15] = 1.0f;
 
-    if (p->parametricAngle >= (real_t)M_PI) {
-        p->parametricAngle -= (real_t)(2. * M_PI);
+        p->parentTransformVersion = p->parent->transformVersion;
     }
-    if (p->selfParametricAngle >= (real_t)M_PI) {
-        p->selfParametricAngle -= (real_t)(2. * M_PI);
+
+    p->transformVersion += 1;
+    p->transformDirty = false;
+}
+
+// Brings an angle past pi back into [-pi, pi), however many turns past it is.
+real_t wrapStellarAngle(real_t angle)
+{
+    if (angle >= (real_t)M_PI) {
+        angle -= (real_t)(2. * M_PI * floor(((double)angle + M_PI) / (2. * M_PI)));
     }
+    return angle;
+}
+
+// Advances the body along its trajectory, by `dt` along with the time it was skipped for (see
+// `skipStellarObject`): its angles are linear in time, so they are caught up with exactly, in a
+// single step. Position and cached matrices are only recomputed when one of its angles changed or
+// its parent moved, so parents must be updated before children.
+void updateStellarObject(StellarObject* p, real_t speed_factor, real_t dt)
+{
+    real_t elapsed = p->pendingTime + speed_factor * dt;
+
+    p->pendingTime = (real_t).0;
+
+    real_t d_angle = p->angularVelocity * elapsed;
+    real_t d_self_angle = p->selfAngularVelocity * elapsed;
+
+    bool parent_moved = (p->parent != NULL && p->parent->transformVersion != p->parentTransformVersion);
+
+    if (d_angle == (real_t).0 && d_self_angle == (real_t).0 && !parent_moved && !p->transformDirty)
+        return;
+
+    p->parametricAngle = wrapStellarAngle(p->parametricAngle + d_angle);
+    p->selfParametricAngle = wrapStellarAngle(p->selfParametricAngle + d_self_angle);
 
     // Parametric position along its 2D (circular) trajectory.
     real_t parametricX = (real_t)(cos((double)p->parametricAngle) * (double)p->parentDistance);
@@ -181,6 +450,8 @@ void updateStellarObject(StellarObject* p, real_t speed_factor, real_t dt)
     p->position[1] = parametricX * p->sinGlobalSolarTilt;
     p->position[2] = parametricZ;
 
+    memcpy(p->localPosition, p->position, sizeof(vector3r));
+
     if (p->parent != NULL)
     {
         // Add parent's apparent coordinates to get 3D position with respect to the global coordinate system.
@@ -188,118 +459,329 @@ void updateStellarObject(StellarObject* p, real_t speed_factor, real_t dt)
         p->position[1] += p->parent->position[1];
         p->position[2] += p->parent->position[2];
     }
+    else
+    {
+        p->position[0] += p->origin[0];
+        p->position[1] += p->origin[1];
+        p->position[2] += p->origin[2];
+    }
+
+    updateStellarObjectTransform(p);
 }
 
-// Returns an array of the body's system centre of rotation, along with 
-// each subsequent system's centre of rotation, recursively. 
-//
-// E.g:
-//  - Earth returns [The Sun]
-//  - Venus returns [The Sun]
-//  - Moon returns  [Earth, The Sun]
-StellarObject** getStellarObjectAncestors(StellarObject* p, int* n_ancestors)
+// Leaves the body where it is along its trajectory for the frame, to be caught up with on its next
+// update, but carries it along with its parent if that one moved.
+void skipStellarObject(StellarObject* p, real_t speed_factor, real_t dt)
 {
-    StellarObject* cntr_ptr = p->parent;
+    p->pendingTime += speed_factor * dt;
 
-    *n_ancestors = 0;
+    if (p->parent == NULL || p->parent->transformVersion == p->parentTransformVersion)
+        return;
 
-    while (cntr_ptr != NULL)
+    for (int a = 0; a < 3; ++a)
     {
-        *n_ancestors += 1;
-        cntr_ptr = cntr_ptr->parent;
+        p->position[a] = p->parent->position[a] + p->localPosition[a];
+
+        p->modelMatrix[12 + a] = (float)p->position[a];
+        p->trajectoryMatrix[12 + a] = (float)p->parent->position[a];
     }
-    if (*n_ancestors == 0) {
-        return NULL;
+
+    p->parentTransformVersion = p->parent->transformVersion;
+    p->transformVersion += 1;
+}
+
+// Skipped bodies lag behind by this many pixels on screen at most.
+#define STELLAR_UPDATE_LAG_PIXELS 1.0
+
+// Update tier of the body as seen from `view`: the lowest one (the least often updated) in which it
+// would not lag by more than `STELLAR_UPDATE_LAG_PIXELS`, judging by the larger of its size on screen
+// and the distance it covers on screen per frame. The camera's anchor and the bodies it orbits,
+// which the camera follows, are always updated.
+int getStellarObjectUpdateTier(const StellarObject* p, const StellarUpdateView* view, real_t frame_time)
+{
+    for (const StellarObject* q = view->anchor; q != NULL; q = q->parent)
+    {
+        if (q == p)
+            return 0;
     }
 
-    StellarObject** ancestors = (StellarObject **)malloc(*n_ancestors * sizeof(StellarObject *));
+    vector3r d = {
+        p->position[0] - view->viewpoint[0],
+        p->position[1] - view->viewpoint[1],
+        p->position[2] - view->viewpoint[2]
+    };
 
-    cntr_ptr = p->parent;
+    real_t distance = vectorLength3rv(d);
+    real_t step = (real_t)fabs((double)(p->angularVelocity * frame_time)) * p->parentDistance;
+    real_t extent = (p->radius > step ? p->radius : step);
 
-    for (int i = 0; i < *n_ancestors; ++i)
+    if (distance <= extent)
+        return 0;
+
+    double pixels = (double)(extent / distance * view->pixelsPerRadian);
+
+    int tier = 0;
+
+    while (tier + 1 < STELLAR_UPDATE_TIERS && pixels * (double)(2 << tier) <= STELLAR_UPDATE_LAG_PIXELS)
+        tier += 1;
+
+    return tier;
+}
+
+// Bodies per job of `updateStellarObjects` and of `cullStellarObjects`.
+#define STELLAR_UPDATE_GRAIN 512
+#define STELLAR_CULL_GRAIN 1024
+
+// Update order constructor (heap-allocated) of the bodies, to be rebuilt whenever they change.
+StellarUpdateOrder* initStellarUpdateOrder(StellarObject* const* bodies, int num_bodies)
+{
+    StellarUpdateOrder* o = (StellarUpdateOrder *)trackedMalloc(MEMORY_TAG_BODIES, sizeof(StellarUpdateOrder));
+
+    o->bodies = (StellarObject **)trackedMalloc(MEMORY_TAG_BODIES, ((size_t)num_bodies + 1) * sizeof(StellarObject *));
+    o->numBodies = num_bodies;
+    o->numGroups = 0;
+
+    int* depths = (int *)malloc(((size_t)num_bodies + 1) * sizeof(int));
+
+    for (int i = 0; i < num_bodies; ++i)
     {
-        ancestors[i] = cntr_ptr;
-        cntr_ptr = cntr_ptr->parent;
+        depths[i] = 0;
+
+        for (const StellarObject* q = bodies[i]->parent; q != NULL; q = q->parent)
+            depths[i] += 1;
+
+        if (depths[i] + 1 > o->numGroups)
+            o->numGroups = depths[i] + 1;
     }
-    return ancestors;
+
+    o->frame = 0;
+
+    for (int t = 0; t < STELLAR_UPDATE_TIERS; ++t)
+        atomic_init(&o->tierCounts[t], 0);
+
+    o->groupStarts = (int *)trackedCalloc(MEMORY_TAG_BODIES, (size_t)o->numGroups + 1, sizeof(int));
+
+    // Counting sort by depth, which keeps the bodies' order within each group.
+    for (int i = 0; i < num_bodies; ++i)
+        o->groupStarts[depths[i] + 1] += 1;
+
+    for (int g = 0; g < o->numGroups; ++g)
+        o->groupStarts[g + 1] += o->groupStarts[g];
+
+    int* next = (int *)malloc(((size_t)o->numGroups + 1) * sizeof(int));
+
+    memcpy(next, o->groupStarts, ((size_t)o->numGroups + 1) * sizeof(int));
+
+    for (int i = 0; i < num_bodies; ++i)
+        o->bodies[next[depths[i]]++] = bodies[i];
+
+    free(next);
+    free(depths);
+
+    return o;
 }
 
-void renderStellarObject(
-    StellarObject* p, 
-    bool render_trajectory, 
-    unsigned int trajectory_list_id
-)
+void deleteStellarUpdateOrder(StellarUpdateOrder* o)
 {
-    glMatrixMode(GL_MODELVIEW);
+    if (o == NULL)
+        return;
 
-    glPushMatrix();
+    trackedFree(o->groupStarts);
+    trackedFree(o->bodies);
+    trackedFree(o);
+}
 
-    glLoadIdentity();
+typedef struct StellarUpdateArgs
+{
+    StellarUpdateOrder* order;
 
+    const StellarUpdateView* view;
 
-    glTranslatef(
-        (float)p->position[0],
-        (float)p->position[1],
-        (float)p->position[2]
-    );
+    real_t speedFactor;
+    real_t dt;
+
+} StellarUpdateArgs;
+
+void updateStellarObjectRange(void* data, int begin, int end)
+{
+    const StellarUpdateArgs* args = (const StellarUpdateArgs *)data;
+
+    int counts[STELLAR_UPDATE_TIERS] = { 0 };
 
-    if (p->hasTexture)
+    for (int i = begin; i < end; ++i)
     {
-        // Textured astronomical objects must be white so that their texture gets rendered properly.
-        glColor3f(1.0f, 1.0f, 1.0f);
-        glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, p->texture);
+        StellarObject* p = args->order->bodies[i];
+
+        int tier = (args->view != NULL ? getStellarObjectUpdateTier(p, args->view, args->speedFactor * args->dt) : 0);
+
+        // The bodies of a tier take turns, so that each frame updates about as many of them. A body
+        // just promoted to a higher tier is caught up with right away.
+        unsigned int period_mask = (1u << tier) - 1u;
+
+        if (tier < p->updateTier || p->transformDirty || ((args->order->frame + (unsigned int)i) & period_mask) == 0)
+            updateStellarObject(p, args->speedFactor, args->dt);
+        else
+            skipStellarObject(p, args->speedFactor, args->dt);
+
+        p->updateTier = tier;
+        counts[tier] += 1;
     }
-    else
+
+    for (int t = 0; t < STELLAR_UPDATE_TIERS; ++t)
     {
-        glColor3ubv(p->color);
+        if (counts[t] > 0)
+            atomic_fetch_add(&args->order->tierCounts[t], counts[t]);
     }
+}
 
-    glPushMatrix();
+// Updates the bodies, spread over the job system one group at a time. Each body is assigned the
+// update tier its relevance to `view` allows (see `getStellarObjectUpdateTier`) and is skipped on the
+// frames that are not its turn; with no view, every body is updated every frame.
+void updateStellarObjects(JobSystem* js, StellarUpdateOrder* o, const StellarUpdateView* view, real_t speed_factor, real_t dt)
+{
+    StellarUpdateArgs args = { o, view, speed_factor, dt };
 
-    glRotatef((float)p->solarTilt - 90.0f, 1.0f, .0f, .0f);
-    // Animation for rotation around axis.
-    glRotatef((float)(p->selfParametricAngle * (real_t)(180.0 / M_PI)), .0f, .0f, 1.0f);
-    // Render planet.
-    gluSphere(p->quad, (double)p->radius, 64, 32);
+    for (int t = 0; t < STELLAR_UPDATE_TIERS; ++t)
+        atomic_store(&o->tierCounts[t], 0);
 
-    glPopMatrix();
+    for (int g = 0; g < o->numGroups; ++g)
+        parallelFor(js, o->groupStarts[g], o->groupStarts[g + 1], STELLAR_UPDATE_GRAIN, updateStellarObjectRange, &args);
+
+    o->frame += 1;
+}
+
+// Formats the HUD's line about the update tiers: how many bodies each of them had in the last update.
+void formatStellarUpdateTiers(const StellarUpdateOrder* o, char* buffer, size_t size)
+{
+    int length = snprintf(buffer, size, "Bodies updated every");
 
-    if (p->hasTexture)
+    for (int t = 0; t < STELLAR_UPDATE_TIERS && length >= 0 && (size_t)length < size; ++t)
     {
-        glDisable(GL_TEXTURE_2D);
+        length += snprintf(
+            buffer + length, size - (size_t)length, " %d frame%s: %d%s",
+            1 << t, (t > 0 ? "s" : ""), atomic_load(&o->tierCounts[t]), (t + 1 < STELLAR_UPDATE_TIERS ? "," : "")
+        );
     }
+}
 
-    // Render planet's nametag
-    renderStringInWorld(
-        .0f, (float)(p->radius * (real_t)1.1), .0f,
-        GLUT_BITMAP_9_BY_15, p->name,
-        0xFF, 0xFF, 0xFF
+typedef struct StellarCullArgs
+{
+    StellarObject* const* bodies;
+
+    vector4f planes[6];
+
+} StellarCullArgs;
+
+// Sets whether the body's sphere and name tag may be within the frustum of `planes`.
+void cullStellarObject(StellarObject* p, const vector4f planes[6])
+{
+    float x = (float)p->position[0];
+    float y = (float)p->position[1];
+    float z = (float)p->position[2];
+
+    p->visible = isSphereInFrustum(planes, x, y, z, (float)p->radius);
+
+    // OpenGL drops the whole name tag when its raster position is clipped (see `renderStringInWorld`).
+    p->labelVisible = isSphereInFrustum(planes, x, (float)(p->position[1] + p->radius * (real_t)1.1), z, .0f);
+}
+
+void cullStellarObjectTrajectory(StellarObject* p, const vector4f planes[6])
+{
+    p->trajectoryVisible = (
+        p->parent != NULL &&
+        isSphereInFrustum(
+            planes,
+            (float)p->parent->position[0], (float)p->parent->position[1], (float)p->parent->position[2],
+            (float)p->parentDistance
+        )
     );
+}
 
-    glPopMatrix();
+void cullStellarObjectRange(void* data, int begin, int end)
+{
+    const StellarCullArgs* args = (const StellarCullArgs *)data;
+
+    for (int i = begin; i < end; ++i)
+    {
+        cullStellarObject(args->bodies[i], args->planes);
+        cullStellarObjectTrajectory(args->bodies[i], args->planes);
+    }
+}
+
+// Finds out which bodies, name tags and trajectories may be within the view of `view_projection`,
+// in parallel, so that `renderStellarObject` skips the others. Must follow the bodies' update.
+void cullStellarObjects(JobSystem* js, StellarObject* const* bodies, int num_bodies, const matrix4f view_projection)
+{
+    StellarCullArgs args;
+
+    args.bodies = bodies;
+
+    extractFrustumPlanes4f(args.planes, view_projection);
+
+    parallelFor(js, 0, num_bodies, STELLAR_CULL_GRAIN, cullStellarObjectRange, &args);
+}
+
+// Renders the body using its cached world matrices (see `updateStellarObjectTransform`), leaving out
+// whatever was culled (see `cullStellarObjects`).
+// The camera's view-projection matrix is expected to be loaded into GL_PROJECTION already.
+void renderStellarObject(
+    StellarObject* p, 
+    bool render_trajectory, 
+    unsigned int trajectory_list_id
+)
+{
+    glMatrixMode(GL_MODELVIEW);
 
     glPushMatrix();
 
-    if (render_trajectory && p->parent != NULL)
+    if (p->visible)
     {
-        glColor4ub(p->color[0], p->color[1], p->color[2], 38);
+        glLoadMatrixf(p->modelMatrix);
 
-        glTranslatef(
-            (float)p->parent->position[0],
-            (float)p->parent->position[1],
-            (float)p->parent->position[2]
-        );
+        if (p->hasTexture)
+        {
+            // Textured astronomical objects must be white so that their texture gets rendered properly.
+            glColor3f(1.0f, 1.0f, 1.0f);
+            glEnable(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, p->texture);
+        }
+        else
+        {
+            glColor3ubv(p->color);
+        }
 
-        glRotatef((float)p->globalSolarTilt, .0f, .0f, 1.0f);
+        // Render planet.
+        gluSphere(getStellarObjectQuadric(p->hasTexture), (double)p->radius, 64, 32);
+        countDrawCalls(1);
 
-        glScalef(
-            (float)p->parentDistance, 
-            (float)p->parentDistance, 
-            (float)p->parentDistance
+        if (p->hasTexture)
+        {
+            glDisable(GL_TEXTURE_2D);
+        }
+    }
+
+    glLoadIdentity();
+
+    // Render planet's nametag
+    if (p->labelVisible)
+    {
+        renderStringInWorld(
+            (float)p->position[0], 
+            (float)(p->position[1] + p->radius * (real_t)1.1), 
+            (float)p->position[2],
+            GLUT_BITMAP_9_BY_15, p->name,
+            0xFF, 0xFF, 0xFF
         );
+    }
+
+    if (render_trajectory && p->trajectoryVisible && p->parent != NULL)
+    {
+        glColor4ub(p->color[0], p->color[1], p->color[2], 38);
+
+        glLoadMatrixf(p->trajectoryMatrix);
 
         glCallList(trajectory_list_id);
+        countDrawCalls(1);
     }
     glPopMatrix();
 }
@@ -308,246 +790,556 @@ unsigned int generateStellarObjectTrajectoryDisplayList()
 {
     unsigned int listId = glGenLists(1);
 
+    size_t num_vertices = 0;
+
     glNewList(listId, GL_COMPILE);
     {
         glBegin(GL_LINE_LOOP);
         {
-            for (float theta = (float)(-M_PI); theta < (float)M_PI; theta += (float)M_PI / 3000.0f)
+            for (float theta = (float)(-M_PI); theta < (float)M_PI; theta += (float)M_PI / 3000.0f, ++num_vertices)
                 glVertex3f(cosf(theta), .0f, sinf(theta));
         }
         glEnd();
     }
     glEndList();
 
+    // The list is kept for the whole run; drivers store its vertices as they are.
+    trackMemory(MEMORY_TAG_BUFFERS, num_vertices * sizeof(vector3f));
+
     return listId;
 }
 
-// Returns an array of the astronomical objects, along with its size.
-// The `data_dir` function parameter is specified by the `/planets:*` program argument.
-StellarObject** loadAllStellarObjects(int* arraySize, const char* data_dir)
+StellarObject* buildStellarObject(const char* name, const StellarCatalogEntry* entry, StellarObject* parent)
 {
-    StellarObject** destArray;
+    return (
+
+        coloriseStellarObject3ub(
+
+            initStellarObject(
+                name,
+                entry->radius,
+                entry->orbitPeriod,
+                parent,
+                entry->parentDistance,
+                entry->solarTilt,
+                0,
+                false,
+                entry->dayPeriod
+            ),
+
+            entry->color[0], entry->color[1], entry->color[2]
+        )
+    );
+}
 
-    *arraySize = 0;
+// The parameters of a body, as derived from its catalog entry (see `initStellarObject`).
+typedef struct StellarObjectParameters
+{
+    real_t radius;
+    real_t parentDistance;
+    real_t orbitalPeriod;
+    real_t angularVelocity;
+    real_t selfAngularVelocity;
+    real_t solarTilt;
+    real_t globalSolarTilt;
 
-    // The stellarObjects' JSON data file.
-    char* json_filename = strCat(2, data_dir, "data.json");
+    vector3ub color;
 
-    // open the JSON file 
-    FILE *fp = fopen(json_filename, "r"); 
+} StellarObjectParameters;
 
-    if (fp == NULL) 
-    { 
-        fprintf(stderr, "Error: Unable to open the JSON file \"%s\".\n", json_filename); 
-        return NULL;
-    } 
 
-    // Read the file contents into a string 
-    const size_t JSON_BUFFER_SIZE = 1024 * 1024;
+// `parent_global_solar_tilt` is 0 for bodies without a parent.
+void getStellarObjectParameters(const StellarCatalogEntry* entry, real_t parent_global_solar_tilt, StellarObjectParameters* q)
+{
+    q->radius = AUtoR(entry->radius);
+    q->parentDistance = AUtoR(entry->parentDistance);
+    q->orbitalPeriod = entry->orbitPeriod;
+    q->selfAngularVelocity = (real_t)1.0 / entry->dayPeriod;
+    q->solarTilt = entry->solarTilt;
+    q->globalSolarTilt = entry->solarTilt + parent_global_solar_tilt;
 
-    char* buffer = (char *)malloc(JSON_BUFFER_SIZE * sizeof(char));
+    q->angularVelocity = (real_t).0;
 
-    size_t len = fread(buffer, sizeof(char), JSON_BUFFER_SIZE, fp);
+    if (entry->orbitPeriod != (real_t).0)
+        q->angularVelocity = (real_t)(2.0 * M_PI / ((double)entry->orbitPeriod * 24.0));
 
-    fclose(fp); 
+    memcpy(q->color, entry->color, sizeof(q->color));
+}
 
-    // parse the JSON data 
-    cJSON *json = cJSON_Parse(buffer); 
+bool hasStellarObjectParameters(const StellarObject* p, const StellarObjectParameters* q)
+{
+    return (
+        p->radius == q->radius && p->parentDistance == q->parentDistance &&
+        p->orbitalPeriod == q->orbitalPeriod && p->angularVelocity == q->angularVelocity &&
+        p->selfAngularVelocity == q->selfAngularVelocity && p->solarTilt == q->solarTilt &&
+        p->globalSolarTilt == q->globalSolarTilt && memcmp(p->color, q->color, sizeof(p->color)) == 0
+    );
+}
 
-    if (json == NULL) 
-    { 
-        const char *error_ptr = cJSON_GetErrorPtr(); 
-        if (error_ptr != NULL) { 
-            fprintf(stderr, "Error: %s\n", error_ptr); 
-        }
-        cJSON_Delete(json);
-        free(buffer);
-        return NULL; 
-    }
+// Applies new parameters to an existing body, keeping its texture, its quadric and its progress
+// along its orbit.
+void setStellarObjectParameters(StellarObject* p, const StellarObjectParameters* q, StellarObject* parent)
+{
+    p->parent = parent;
+    p->radius = q->radius;
+    p->parentDistance = q->parentDistance;
+    p->orbitalPeriod = q->orbitalPeriod;
+    p->angularVelocity = q->angularVelocity;
+    p->selfAngularVelocity = q->selfAngularVelocity;
 
-    const cJSON *iterator = NULL;
-    const cJSON *allStellarObjects = NULL;
+    p->solarTilt = q->solarTilt;
+    p->globalSolarTilt = q->globalSolarTilt;
 
-    allStellarObjects = cJSON_GetObjectItemCaseSensitive(json, "Astronomical Objects");
+    p->cosGlobalSolarTilt = (real_t)cos((double)p->globalSolarTilt * (M_PI / 180.0));
+    p->sinGlobalSolarTilt = (real_t)sin((double)p->globalSolarTilt * (M_PI / 180.0));
+
+    memcpy(p->color, q->color, sizeof(p->color));
 
-    if (!cJSON_IsArray(allStellarObjects))
+    p->transformDirty = true;
+}
+
+void setStellarObjectTexture(StellarObject* p, GLuint texture)
+{
+    p->texture = texture;
+    p->hasTexture = true;
+}
+
+// The texture requests of a system being loaded, indexed by name id.
+typedef struct StellarTextureRequests
+{
+    const char* dataDir;
+
+    StellarTextureTarget** targets;
+
+    int capacity;
+
+} StellarTextureRequests;
+
+
+// Called on the GL thread once the texture of a body has been loaded (or has failed to).
+void callbackStellarObjectTexture(void* user, GLuint texture, bool loaded)
+{
+    StellarTextureTarget* target = (StellarTextureTarget *)user;
+
+    if (target->body != NULL)
+        target->body->pendingTexture = NULL;
+
+    if (!loaded)
     {
         fprintf(
             stderr, 
-            "Error: %s should be an array of objects; Inspect \"%s\"", 
-            allStellarObjects->string, json_filename
+            "Warning: Could not load texture for %s; Continuing with `glColor*`.\n", 
+            target->name
         );
-        return NULL;
     }
+    else if (target->body != NULL)
+    {
+        setStellarObjectTexture(target->body, texture);
+    }
+    else
+    {
+        deleteTextures(1, &texture);
+    }
+
+    freeStellarData(target->name);
+    freeStellarData(target);
+}
+
+// Requests the texture of a body, once per name (a `StellarCatalogCallback`). With a `texture_loader`,
+// the texture starts loading on its workers right away.
+void requestStellarObjectTexture(const char* name, int name_id, void* user)
+{
+    StellarTextureRequests* r = (StellarTextureRequests *)user;
+
+    if (name_id >= r->capacity)
+    {
+        int capacity = (2 * r->capacity > name_id + 1 ? 2 * r->capacity : name_id + 1);
+
+        r->targets = (StellarTextureTarget **)trackedRealloc(MEMORY_TAG_BODIES, r->targets, (size_t)capacity * sizeof(StellarTextureTarget *));
+
+        for (int i = r->capacity; i < capacity; ++i)
+            r->targets[i] = NULL;
+
+        r->capacity = capacity;
+    }
+
+    if (r->targets[name_id] != NULL)
+        return;
+
+    StellarTextureTarget* target = (StellarTextureTarget *)allocStellarData(sizeof(StellarTextureTarget));
+
+    target->name = buildStellarString(name);
+    target->body = NULL;
 
-    destArray = (StellarObject **)malloc(cJSON_GetArraySize(allStellarObjects) * sizeof(StellarObject *));
+    r->targets[name_id] = target;
 
-    cJSON_ArrayForEach(iterator, allStellarObjects)
+    if (texture_loader != NULL)
     {
-        if (!cJSON_IsObject(iterator))
+        ArenaMark mark;
+
+        char* texture_filename = buildStellarFilename(r->dataDir, name, &mark);
+
+        submitTexture(texture_loader, texture_filename, callbackStellarObjectTexture, target);
+
+        releaseStellarFilename(texture_filename, mark);
+    }
+}
+
+// Points the requests to the constructed bodies (`name_ids[i]` being the name id of `bodies[i]`)
+// and releases them. Without a `texture_loader`, the textures are loaded here, one after the other.
+void bindStellarObjectTextures(StellarTextureRequests* r, StellarObject** bodies, const int* name_ids, int num_bodies)
+{
+    for (int i = 0; i < num_bodies; ++i)
+    {
+        StellarTextureTarget* target = (name_ids[i] < r->capacity ? r->targets[name_ids[i]] : NULL);
+
+        // Bodies with duplicate names are left untextured.
+        if (target != NULL && target->body == NULL)
         {
-            fprintf(
-                stderr,
-                "Error: %s should only contain JSON objects; Inspect arrray item idx.#%d in \"%s\"", 
-                allStellarObjects->string, *arraySize, json_filename
-            );
-
-            for (int i = 0; i < *arraySize; ++i)
-                deleteStellarObject(destArray[i]);
-
-            free(destArray);
-            
-            return NULL;
+            target->body = bodies[i];
+            bodies[i]->pendingTexture = target;
         }
+    }
+
+    for (int id = 0; id < r->capacity && texture_loader == NULL; ++id)
+    {
+        if (r->targets[id] == NULL)
+            continue;
+
+        GLuint texture;
 
-        static const char* error_field_message = "Error: JSON array idx.#%d - StellarObject's `%s` field is invalid; Inspect \"%s\".\n";
-        char* error_field = NULL;
+        ArenaMark mark;
 
+        char* texture_filename = buildStellarFilename(r->dataDir, r->targets[id]->name, &mark);
 
-        cJSON *name = cJSON_GetObjectItemCaseSensitive(iterator, "name");
-        cJSON *radius = cJSON_GetObjectItemCaseSensitive(iterator, "radius");
-        cJSON *orbit_period = cJSON_GetObjectItemCaseSensitive(iterator, "orbit_period");
-        cJSON *parent = cJSON_GetObjectItemCaseSensitive(iterator, "parent");
-        cJSON *parent_dist = cJSON_GetObjectItemCaseSensitive(iterator, "parent_dist");
-        cJSON *solar_tilt = cJSON_GetObjectItemCaseSensitive(iterator, "solar_tilt");
-        cJSON *color = cJSON_GetObjectItemCaseSensitive(iterator, "color");
-        cJSON *day_period = cJSON_GetObjectItemCaseSensitive(iterator, "day_period");
+        bool loaded = registerTexture(texture_filename, &texture);
 
+        releaseStellarFilename(texture_filename, mark);
 
-        if (!cJSON_IsString(name) || name->valuestring == NULL)
-            error_field = strBuild("name");
+        callbackStellarObjectTexture(r->targets[id], texture, loaded);
+    }
 
-        else if (!cJSON_IsNumber(radius))
-            error_field = strBuild("radius");
+    trackedFree(r->targets);
 
-        else if (!cJSON_IsNumber(orbit_period) && !cJSON_IsNull(orbit_period))
-            error_field = strBuild("orbit_period");
+    r->targets = NULL;
+    r->capacity = 0;
+}
 
-        else if (!cJSON_IsString(parent) && !cJSON_IsNull(parent))
-            error_field = strBuild("parent");
+// Constructs the bodies straight from the arrays of a mapped system binary file.
+StellarObject** loadStellarObjectsFromBinary(const SystemBinary* b, StellarTextureRequests* textures)
+{
+    StellarObject** destArray = (StellarObject **)trackedMalloc(MEMORY_TAG_BODIES, ((size_t)b->numObjects + 1) * sizeof(StellarObject *));
 
-        else if (!cJSON_IsNumber(parent_dist) && !cJSON_IsNull(parent_dist))
-            error_field = strBuild("parent_dist");
+    int* name_ids = (int *)malloc(((size_t)b->numObjects + 1) * sizeof(int));
 
-        else if (!cJSON_IsNumber(solar_tilt))
-            error_field = strBuild("solar_tilt");
+    // Names are already known, so all textures can be requested up front.
+    for (int i = 0; i < b->numObjects; ++i)
+    {
+        name_ids[i] = i;
+        requestStellarObjectTexture(getSystemBinaryName(b, i), i, textures);
+    }
 
-        else if (!cJSON_IsArray(color) || (cJSON_GetArraySize(color) != 3))
-            error_field = strBuild("color");
+    StellarCatalogEntry entry;
 
-        else if (!cJSON_IsNumber(day_period))
-            error_field = strBuild("day_period");
+    for (int i = 0; i < b->numObjects; ++i)
+    {
+        entry.radius = b->radius[i];
+        entry.orbitPeriod = b->orbitPeriod[i];
+        entry.parentDistance = b->parentDistance[i];
+        entry.solarTilt = b->solarTilt[i];
+        entry.dayPeriod = b->dayPeriod[i];
 
+        memcpy(entry.color, &b->color[4 * i], sizeof(vector3ub));
 
-        if (error_field != NULL)
+        // Parents always precede their children in the file.
+        destArray[i] = buildStellarObject(
+            getSystemBinaryName(b, i), &entry, (b->parent[i] >= 0 ? destArray[b->parent[i]] : NULL)
+        );
+    }
+
+    bindStellarObjectTextures(textures, destArray, name_ids, b->numObjects);
+
+    free(name_ids);
+
+    return destArray;
+}
+
+// Constructs the bodies of a parsed catalog. Textures that were not requested while it was being
+// parsed (see `requestStellarObjectTexture`) are requested here.
+StellarObject** loadStellarObjectsFromCatalog(const StellarCatalog* catalog, StellarTextureRequests* textures)
+{
+    StellarObject** destArray = (StellarObject **)trackedMalloc(MEMORY_TAG_BODIES, ((size_t)catalog->count + 1) * sizeof(StellarObject *));
+
+    int* name_ids = (int *)malloc(((size_t)catalog->count + 1) * sizeof(int));
+
+    for (int i = 0; i < catalog->count; ++i)
+    {
+        const StellarCatalogEntry* entry = &catalog->entries[i];
+
+        name_ids[i] = entry->nameId;
+
+        requestStellarObjectTexture(getName(catalog->names, entry->nameId), entry->nameId, textures);
+
+        destArray[i] = buildStellarObject(
+            getName(catalog->names, entry->nameId), entry,
+            (catalog->parents[i] >= 0 ? destArray[catalog->parents[i]] : NULL)
+        );
+    }
+
+    bindStellarObjectTextures(textures, destArray, name_ids, catalog->count);
+
+    free(name_ids);
+
+    return destArray;
+}
+
+// Returns an array of the astronomical objects, along with its size.
+// The `data_dir` function parameter is specified by the `/planets:*` program argument.
+//
+// If the directory contains an up-to-date `data.bin` (see `SystemBinary.h`), the bodies are built
+// from it directly. Otherwise `data.json` is streamed into a `StellarCatalog` (see `StellarCatalog.h`),
+// which resolves the parents by name, allowing them to be declared after their children, and sorts
+// the bodies so that they are constructed with every parent ahead of its children.
+//
+// If `texture_loader` is set, each body's texture is submitted to it as soon as the body's entry has
+// been read, so that images are decoded in parallel while the rest of the catalog is parsed. The
+// bodies are then returned untextured (rendered with their color); their textures are attached as
+// they get uploaded by `streamTextureUploads` or `finishTextureLoads`.
+StellarObject** loadAllStellarObjects(int* arraySize, const char* data_dir)
+{
+    *arraySize = 0;
+
+    // The stellarObjects' JSON data file and its compiled counterpart.
+    char* json_filename = strCat(2, data_dir, "data.json");
+    char* binary_filename = strCat(2, data_dir, "data.bin");
+
+    StellarObject** destArray = NULL;
+
+    StellarTextureRequests textures = { data_dir, NULL, 0 };
+
+    SystemBinary* binary = openSystemBinary(binary_filename, json_filename);
+
+    if (binary != NULL)
+    {
+        destArray = loadStellarObjectsFromBinary(binary, &textures);
+        *arraySize = binary->numObjects;
+
+        closeSystemBinary(binary);
+    }
+    else
+    {
+        StellarCatalog* catalog = parseStellarCatalog(json_filename, requestStellarObjectTexture, &textures);
+
+        if (catalog != NULL)
         {
-            fprintf(stderr, error_field_message, *arraySize, error_field, json_filename);
-            free(destArray);
-            free(error_field);
-            return NULL;
-        }
+            destArray = loadStellarObjectsFromCatalog(catalog, &textures);
+            *arraySize = catalog->count;
 
-        if (!cJSON_IsNull(parent) && (!cJSON_IsNumber(parent_dist) || !cJSON_IsNumber(orbit_period)))
+            deleteStellarCatalog(catalog);
+        }
+        else
         {
-            fprintf(
-                stderr, 
-                "Error: %s's parent was declared non-null but dependent fields are invalid; Inspect \"%s\".\n",
-                name->valuestring, 
-                json_filename
-            );
-            free(destArray);
-            free(error_field);
-            return NULL;
+            // Requests already submitted are discarded once they complete.
+            bindStellarObjectTextures(&textures, NULL, NULL, 0);
         }
+    }
+
+    free(binary_filename);
+    free(json_filename);
 
-        StellarObject* parentRaw = NULL;
+    return destArray;
+}
 
-        if (!cJSON_IsNull(parent))
-        {
-            int i;
+// How a re-parsed catalog maps onto the live bodies, as computed by `planStellarObjectsReload`.
+typedef struct StellarReloadPlan
+{
+    // Per catalog entry: the live body matched with it (NULL for a new body), and whether the
+    // body's parameters or parent differ from the entry's.
+    StellarObject** matched;
+    bool* changed;
 
-            for (i = 0; i < *arraySize; ++i)
-            {
-                if (strcmp(parent->valuestring, destArray[i]->name) != 0)
-                    continue;
-                
-                parentRaw = destArray[i];
-                break;
-            }
+    // The live bodies missing from the catalog.
+    StellarObject** removed;
+    int numRemoved;
 
-            if (i == *arraySize)
-            {
-                fprintf(
-                    stderr,
-                    "Warning: %s was declared as %s's planetary anchor but this StellarObject is not found and will thus not render.\n"
-                    "         Inspect JSON file \"%s\"\n"
-                    "         If %s does exist within the file, reorder it so that it's above %s\n",
-                    parent->valuestring,
-                    name->valuestring,
-                    json_filename,
-                    parent->valuestring,
-                    name->valuestring
-                );
-            }
-        }
+} StellarReloadPlan;
+
+// Outcome of `reloadStellarObjects`.
+typedef struct StellarReloadStats
+{
+    int added;
+    int removed;
+    int changed;
+    int unchanged;
+
+    // Whether the bodies' order changed, or bodies were added or removed.
+    bool reordered;
 
-        real_t orbitPeriodRaw = (cJSON_IsNull(orbit_period) ? (real_t)1.0 : (real_t)orbit_period->valuedouble);
-        real_t parentDistanceRaw = (cJSON_IsNull(parent_dist) ? (real_t)0.0 : (real_t)parent_dist->valuedouble);
+} StellarReloadStats;
 
-        cJSON* r = cJSON_GetArrayItem(color, 0);
-        cJSON* g = cJSON_GetArrayItem(color, 1);
-        cJSON* b = cJSON_GetArrayItem(color, 2);
 
+// Matches the live bodies with a re-parsed catalog by name (bodies sharing a name are matched in
+// order) and finds out which of them changed (heap-allocated). It only reads the bodies' names and
+// parameters, which nothing but `reloadStellarObjects` modifies, so it may run on another thread
+// while the GL thread goes on rendering, as long as the bodies are not reloaded in the meantime.
+StellarReloadPlan* planStellarObjectsReload(StellarObject* const* bodies, int num_bodies, const StellarCatalog* catalog)
+{
+    StellarReloadPlan* plan = (StellarReloadPlan *)trackedMalloc(MEMORY_TAG_BODIES, sizeof(StellarReloadPlan));
+
+    int num_names = catalog->names->count;
 
-        GLuint textureId;
+    plan->matched = (StellarObject **)trackedCalloc(MEMORY_TAG_BODIES, (size_t)catalog->count + 1, sizeof(StellarObject *));
+    plan->changed = (bool *)trackedMalloc(MEMORY_TAG_BODIES, ((size_t)catalog->count + 1) * sizeof(bool));
+    plan->removed = (StellarObject **)trackedMalloc(MEMORY_TAG_BODIES, ((size_t)num_bodies + 1) * sizeof(StellarObject *));
+    plan->numRemoved = 0;
 
-        char* texture_filename = strCat(3, data_dir, name->valuestring, ".bmp");
+    // The catalog's entries of each name, in order: the first one, then a chain through `next_entry`.
+    int* first_entry = (int *)malloc(((size_t)num_names + 1) * sizeof(int));
+    int* next_entry = (int *)malloc(((size_t)catalog->count + 1) * sizeof(int));
 
-        bool has_texture = registerTexture(texture_filename, &textureId);
+    for (int id = 0; id < num_names; ++id)
+        first_entry[id] = -1;
+
+    for (int i = catalog->count - 1; i >= 0; --i)
+    {
+        next_entry[i] = first_entry[catalog->entries[i].nameId];
+        first_entry[catalog->entries[i].nameId] = i;
+    }
+
+    for (int j = 0; j < num_bodies; ++j)
+    {
+        int id = findName(catalog->names, bodies[j]->name);
 
-        // Load Textures
-        if (!has_texture)
+        if (id >= 0 && first_entry[id] >= 0)
         {
-            fprintf(
-                stderr, 
-                "Warning: Could not load texture for %s; Continuing with `glColor*`.\n", 
-                name->valuestring
-            );
+            plan->matched[first_entry[id]] = bodies[j];
+            first_entry[id] = next_entry[first_entry[id]];
         }
+        else
+        {
+            plan->removed[plan->numRemoved++] = bodies[j];
+        }
+    }
+
+    // Tilts accumulate from parent to child; parents precede their children in the catalog.
+    real_t* global_solar_tilts = (real_t *)malloc(((size_t)catalog->count + 1) * sizeof(real_t));
+
+    for (int i = 0; i < catalog->count; ++i)
+    {
+        int parent = catalog->parents[i];
 
-        free(texture_filename);
+        StellarObjectParameters q;
 
-        destArray[*arraySize] = (
+        getStellarObjectParameters(&catalog->entries[i], (parent >= 0 ? global_solar_tilts[parent] : (real_t).0), &q);
 
-            coloriseStellarObject3ub(
+        global_solar_tilts[i] = q.globalSolarTilt;
 
-                initStellarObject(
-                    name->valuestring,
-                    (real_t)radius->valuedouble,
-                    orbitPeriodRaw,
-                    parentRaw,
-                    parentDistanceRaw,
-                    (real_t)solar_tilt->valuedouble,
-                    textureId,
-                    has_texture,
-                    (real_t)day_period->valuedouble
-                ),
+        StellarObject* body = plan->matched[i];
 
-                (ubyte_t)r->valueint, (ubyte_t)g->valueint, (ubyte_t)b->valueint
-            )
+        plan->changed[i] = (
+            body != NULL && 
+            (body->parent != (parent >= 0 ? plan->matched[parent] : NULL) || !hasStellarObjectParameters(body, &q))
         );
+    }
+
+    free(global_solar_tilts);
+    free(next_entry);
+    free(first_entry);
+
+    return plan;
+}
+
+void deleteStellarReloadPlan(StellarReloadPlan* plan)
+{
+    if (plan == NULL)
+        return;
+
+    trackedFree(plan->removed);
+    trackedFree(plan->changed);
+    trackedFree(plan->matched);
+    trackedFree(plan);
+}
+
+// Applies a re-parsed catalog to the live bodies (`*bodies`, `*num_bodies`) as planned by
+// `planStellarObjectsReload`: changed bodies are updated in place (see `setStellarObjectParameters`),
+// unchanged ones are left untouched, new ones are built, with their textures requested as at
+// startup, and the rest are deleted, `*anchor` being reset to NULL if it is one of them. `*bodies`
+// is reallocated in the catalog's order, so that parents keep preceding their children.
+StellarReloadStats reloadStellarObjects(
+    StellarObject*** bodies, int* num_bodies, const StellarCatalog* catalog, const StellarReloadPlan* plan,
+    const char* data_dir, StellarObject** anchor
+)
+{
+    StellarReloadStats stats = { 0, plan->numRemoved, 0, 0, (catalog->count != *num_bodies) };
+
+    StellarObject** destArray = (StellarObject **)trackedMalloc(MEMORY_TAG_BODIES, ((size_t)catalog->count + 1) * sizeof(StellarObject *));
+
+    StellarObject** new_bodies = (StellarObject **)malloc(((size_t)catalog->count + 1) * sizeof(StellarObject *));
+    int* new_name_ids = (int *)malloc(((size_t)catalog->count + 1) * sizeof(int));
 
-        *arraySize += 1;
+    StellarTextureRequests textures = { data_dir, NULL, 0 };
+
+    for (int i = 0; i < catalog->count; ++i)
+    {
+        const StellarCatalogEntry* entry = &catalog->entries[i];
+
+        StellarObject* parent = (catalog->parents[i] >= 0 ? destArray[catalog->parents[i]] : NULL);
+
+        if (plan->matched[i] != NULL)
+        {
+            destArray[i] = plan->matched[i];
+
+            if (plan->changed[i])
+            {
+                StellarObjectParameters q;
+
+                getStellarObjectParameters(entry, (parent != NULL ? parent->globalSolarTilt : (real_t).0), &q);
+                setStellarObjectParameters(destArray[i], &q, parent);
+
+                stats.changed += 1;
+            }
+            else
+            {
+                stats.unchanged += 1;
+            }
+        }
+        else
+        {
+            const char* name = getName(catalog->names, entry->nameId);
+
+            destArray[i] = buildStellarObject(name, entry, parent);
+
+            requestStellarObjectTexture(name, entry->nameId, &textures);
+
+            new_bodies[stats.added] = destArray[i];
+            new_name_ids[stats.added] = entry->nameId;
+
+            stats.added += 1;
+        }
+
+        if (!stats.reordered && destArray[i] != (*bodies)[i])
+            stats.reordered = true;
     }
 
+    bindStellarObjectTextures(&textures, new_bodies, new_name_ids, stats.added);
 
-    cJSON_Delete(json);
+    for (int j = 0; j < plan->numRemoved; ++j)
+    {
+        if (*anchor == plan->removed[j])
+            *anchor = NULL;
 
-    free(buffer);
+        deleteStellarObject(plan->removed[j]);
+    }
 
-    free(json_filename);
+    trackedFree(*bodies);
 
-    return destArray;
+    *bodies = destArray;
+    *num_bodies = catalog->count;
+
+    free(new_name_ids);
+    free(new_bodies);
+
+    return stats;
 }
 
-#endif // STELLAR_OBJECT_H
\ No newline at end of file
+#endif // STELLAR_OBJECT_H
@@ -0,0 +1,351 @@
+#ifndef SYSTEM_BINARY_H
+#define SYSTEM_BINARY_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "MappedFile.h"
+#include "CustomTypes.h"
+#include "StellarCatalog.h"
+
+
+// Compiled form of a system's `data.json` (`data.bin`, written by the `convert_system` tool).
+// The file is memory-mapped and its arrays are used in place: there is nothing to parse, no
+// field to validate and no parent to look up by name, since all of it was done at conversion.
+//
+// Layout (native byte order, every section aligned to SYSTEM_BINARY_ALIGNMENT bytes):
+//
+//     SystemBinaryHeader
+//     real_t   radius[n]            (AU)
+//     real_t   orbitPeriod[n]       (days)
+//     real_t   parentDistance[n]    (AU)
+//     real_t   solarTilt[n]         (deg)
+//     real_t   dayPeriod[n]         (h)
+//     ubyte_t  color[n][4]          (RGB, padded)
+//     int32_t  parent[n]            (index of the parent, always < own index; -1 for none)
+//     uint32_t nameOffset[n]        (into the string table)
+//     char     strings[]            (null-terminated names)
+//
+// The bodies are stored in the catalog's order, i.e. every parent precedes its children.
+
+#define SYSTEM_BINARY_MAGIC "SSYB"
+#define SYSTEM_BINARY_VERSION 1
+#define SYSTEM_BINARY_BYTE_ORDER 0x01020304u
+#define SYSTEM_BINARY_ALIGNMENT 16
+
+typedef enum SystemBinarySection
+{
+    SYSTEM_SECTION_RADIUS = 0,
+    SYSTEM_SECTION_ORBIT_PERIOD,
+    SYSTEM_SECTION_PARENT_DISTANCE,
+    SYSTEM_SECTION_SOLAR_TILT,
+    SYSTEM_SECTION_DAY_PERIOD,
+    SYSTEM_SECTION_COLOR,
+    SYSTEM_SECTION_PARENT,
+    SYSTEM_SECTION_NAME_OFFSET,
+    SYSTEM_SECTION_STRINGS,
+    SYSTEM_NUM_SECTIONS
+
+} SystemBinarySection;
+
+typedef struct SystemBinaryHeader
+{
+    char magic[4];
+
+    uint32_t version;
+
+    // SYSTEM_BINARY_BYTE_ORDER as written by the converter; tells apart files of another endianness.
+    uint32_t byteOrder;
+
+    uint32_t numObjects;
+
+    // Size and modification time of the `data.json` the file was converted from.
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+
+    uint64_t sectionOffsets[SYSTEM_NUM_SECTIONS];
+    uint64_t sectionSizes[SYSTEM_NUM_SECTIONS];
+
+} SystemBinaryHeader;
+
+typedef struct SystemBinary
+{
+    MappedFile* file;
+
+    int numObjects;
+
+    // Pointers into the mapping.
+    const real_t* radius;
+    const real_t* orbitPeriod;
+    const real_t* parentDistance;
+    const real_t* solarTilt;
+    const real_t* dayPeriod;
+
+    const ubyte_t* color;
+
+    const int32_t* parent;
+
+    const uint32_t* nameOffsets;
+
+    const char* strings;
+
+} SystemBinary;
+
+
+// Element size of each section (1 for the string table).
+size_t getSystemBinaryElementSize(SystemBinarySection section)
+{
+    switch (section)
+    {
+    case SYSTEM_SECTION_COLOR:          return 4 * sizeof(ubyte_t);
+    case SYSTEM_SECTION_PARENT:         return sizeof(int32_t);
+    case SYSTEM_SECTION_NAME_OFFSET:    return sizeof(uint32_t);
+    case SYSTEM_SECTION_STRINGS:        return sizeof(char);
+    default:                            return sizeof(real_t);
+    }
+}
+
+void closeSystemBinary(SystemBinary* b)
+{
+    if (b == NULL)
+        return;
+
+    closeMappedFile(b->file);
+    free(b);
+}
+
+// Maps the binary system file. Returns NULL if it does not exist or if it is not usable, i.e. it is
+// malformed, of another version, or out of date with respect to `source_filename` (when that exists).
+SystemBinary* openSystemBinary(const char* filename, const char* source_filename)
+{
+    MappedFile* file = openMappedFile(filename, false);
+
+    if (file == NULL)
+        return NULL;
+
+    const SystemBinaryHeader* h = (const SystemBinaryHeader *)file->data;
+
+    if (
+        file->size < sizeof(SystemBinaryHeader) || memcmp(h->magic, SYSTEM_BINARY_MAGIC, 4) != 0 ||
+        h->byteOrder != SYSTEM_BINARY_BYTE_ORDER
+    )
+    {
+        fprintf(stderr, "Warning: \"%s\" is not a system binary file; Ignoring it.\n", filename);
+        closeMappedFile(file);
+        return NULL;
+    }
+
+    if (h->version != SYSTEM_BINARY_VERSION)
+    {
+        fprintf(
+            stderr, "Warning: \"%s\" is of version %u (expected %d); Ignoring it, re-run convert_system to update it.\n",
+            filename, (unsigned int)h->version, SYSTEM_BINARY_VERSION
+        );
+        closeMappedFile(file);
+        return NULL;
+    }
+
+    uint64_t source_size;
+    int64_t source_mtime;
+
+    if (
+        source_filename != NULL && getFileStamp(source_filename, &source_size, &source_mtime) &&
+        (source_size != h->sourceSize || source_mtime != h->sourceMtime)
+    )
+    {
+        fprintf(
+            stderr, "Warning: \"%s\" is out of date with \"%s\"; Loading the latter instead, re-run convert_system to update it.\n",
+            filename, source_filename
+        );
+        closeMappedFile(file);
+        return NULL;
+    }
+
+    size_t n = (size_t)h->numObjects;
+
+    bool valid = true;
+
+    for (int s = 0; s < SYSTEM_NUM_SECTIONS && valid; ++s)
+    {
+        uint64_t offset = h->sectionOffsets[s];
+        uint64_t size = h->sectionSizes[s];
+
+        valid = (
+            offset % SYSTEM_BINARY_ALIGNMENT == 0 && offset >= sizeof(SystemBinaryHeader) &&
+            offset <= file->size && size <= file->size - offset &&
+            (s == SYSTEM_SECTION_STRINGS || size == n * getSystemBinaryElementSize((SystemBinarySection)s))
+        );
+    }
+
+    SystemBinary* b = (SystemBinary *)malloc(sizeof(SystemBinary));
+
+    b->file = file;
+    b->numObjects = (int)n;
+
+    if (valid)
+    {
+        const char* base = file->data;
+        const uint64_t* offsets = h->sectionOffsets;
+
+        b->radius = (const real_t *)(base + offsets[SYSTEM_SECTION_RADIUS]);
+        b->orbitPeriod = (const real_t *)(base + offsets[SYSTEM_SECTION_ORBIT_PERIOD]);
+        b->parentDistance = (const real_t *)(base + offsets[SYSTEM_SECTION_PARENT_DISTANCE]);
+        b->solarTilt = (const real_t *)(base + offsets[SYSTEM_SECTION_SOLAR_TILT]);
+        b->dayPeriod = (const real_t *)(base + offsets[SYSTEM_SECTION_DAY_PERIOD]);
+        b->color = (const ubyte_t *)(base + offsets[SYSTEM_SECTION_COLOR]);
+        b->parent = (const int32_t *)(base + offsets[SYSTEM_SECTION_PARENT]);
+        b->nameOffsets = (const uint32_t *)(base + offsets[SYSTEM_SECTION_NAME_OFFSET]);
+        b->strings = base + offsets[SYSTEM_SECTION_STRINGS];
+
+        uint64_t strings_size = h->sectionSizes[SYSTEM_SECTION_STRINGS];
+
+        // Guard the references that the runtime follows blindly.
+        valid = (strings_size > 0 && b->strings[strings_size - 1] == '\0') || n == 0;
+
+        for (size_t i = 0; i < n && valid; ++i)
+            valid = (b->parent[i] >= -1 && b->parent[i] < (int32_t)i && b->nameOffsets[i] < strings_size);
+    }
+
+    if (!valid)
+    {
+        fprintf(stderr, "Warning: \"%s\" is corrupted; Ignoring it.\n", filename);
+        closeSystemBinary(b);
+        return NULL;
+    }
+
+    return b;
+}
+
+const char* getSystemBinaryName(const SystemBinary* b, int i)
+{
+    return b->strings + b->nameOffsets[i];
+}
+
+// Pads the file with zeros up to the next section boundary.
+void alignSystemBinaryFile(FILE* fp, uint64_t* offset)
+{
+    static const char zeros[SYSTEM_BINARY_ALIGNMENT] = { 0 };
+
+    size_t padding = (size_t)((SYSTEM_BINARY_ALIGNMENT - *offset % SYSTEM_BINARY_ALIGNMENT) % SYSTEM_BINARY_ALIGNMENT);
+
+    fwrite(zeros, 1, padding, fp);
+
+    *offset += padding;
+}
+
+// Writes the catalog in the binary format, stamped with the size and mtime of `source_filename`.
+bool writeSystemBinary(const StellarCatalog* c, const char* filename, const char* source_filename)
+{
+    FILE* fp = fopen(filename, "wb");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error: Unable to create the system binary file \"%s\".\n", filename);
+        return false;
+    }
+
+    size_t n = (size_t)c->count;
+
+    SystemBinaryHeader h;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SYSTEM_BINARY_MAGIC, 4);
+
+    h.version = SYSTEM_BINARY_VERSION;
+    h.byteOrder = SYSTEM_BINARY_BYTE_ORDER;
+    h.numObjects = (uint32_t)n;
+
+    if (!getFileStamp(source_filename, &h.sourceSize, &h.sourceMtime))
+    {
+        h.sourceSize = 0;
+        h.sourceMtime = 0;
+    }
+
+    // Gather the sections' contents.
+    real_t* reals = (real_t *)malloc((5 * n + 1) * sizeof(real_t));
+    ubyte_t* colors = (ubyte_t *)calloc(4 * n + 1, sizeof(ubyte_t));
+    int32_t* parents = (int32_t *)malloc((n + 1) * sizeof(int32_t));
+    uint32_t* name_offsets = (uint32_t *)malloc((n + 1) * sizeof(uint32_t));
+
+    size_t strings_size = 0;
+
+    for (size_t i = 0; i < n; ++i)
+        strings_size += strlen(getName(c->names, c->entries[i].nameId)) + 1;
+
+    char* strings = (char *)malloc(strings_size + 1);
+
+    strings_size = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const StellarCatalogEntry* e = &c->entries[i];
+
+        reals[0 * n + i] = e->radius;
+        reals[1 * n + i] = e->orbitPeriod;
+        reals[2 * n + i] = e->parentDistance;
+        reals[3 * n + i] = e->solarTilt;
+        reals[4 * n + i] = e->dayPeriod;
+
+        memcpy(&colors[4 * i], e->color, 3);
+
+        parents[i] = (int32_t)c->parents[i];
+
+        const char* name = getName(c->names, e->nameId);
+        size_t length = strlen(name) + 1;
+
+        name_offsets[i] = (uint32_t)strings_size;
+        memcpy(strings + strings_size, name, length);
+        strings_size += length;
+    }
+
+    const void* contents[SYSTEM_NUM_SECTIONS] = {
+        reals, reals + n, reals + 2 * n, reals + 3 * n, reals + 4 * n,
+        colors, parents, name_offsets, strings
+    };
+
+    // The header is written last, once the offsets are known.
+    uint64_t offset = sizeof(SystemBinaryHeader);
+
+    fseek(fp, (long)offset, SEEK_SET);
+
+    for (int s = 0; s < SYSTEM_NUM_SECTIONS; ++s)
+    {
+        alignSystemBinaryFile(fp, &offset);
+
+        h.sectionOffsets[s] = offset;
+        h.sectionSizes[s] = (s == SYSTEM_SECTION_STRINGS ? strings_size : n * getSystemBinaryElementSize((SystemBinarySection)s));
+
+        fwrite(contents[s], 1, (size_t)h.sectionSizes[s], fp);
+
+        offset += h.sectionSizes[s];
+    }
+
+    rewind(fp);
+    fwrite(&h, sizeof(h), 1, fp);
+
+    bool ok = !ferror(fp);
+
+    ok = (fclose(fp) == 0) && ok;
+
+    free(strings);
+    free(name_offsets);
+    free(parents);
+    free(colors);
+    free(reals);
+
+    if (!ok)
+        fprintf(stderr, "Error: Failed writing the system binary file \"%s\".\n", filename);
+
+    return ok;
+}
+
+#endif // SYSTEM_BINARY_H
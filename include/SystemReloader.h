@@ -0,0 +1,196 @@
+#ifndef SYSTEM_RELOADER_H
+#define SYSTEM_RELOADER_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <threads.h>
+
+#include "CustomTypes.h"
+#include "FileWatcher.h"
+#include "StellarObject.h"
+#include "StellarCatalog.h"
+
+
+// Hot reload of a system's `data.json`. Changes are picked up by a `FileWatcher`; the file is then
+// re-parsed and matched against the live bodies on a background thread (see
+// `planStellarObjectsReload`), so that the GL thread only has to apply the differences (see
+// `reloadStellarObjects`), however large the catalog.
+
+typedef struct SystemReloader
+{
+    FileWatcher* watcher;
+
+    char* jsonFilename;
+
+    thrd_t thread;
+
+    // The live bodies when the reload started (a copy of the array), which must not be reloaded
+    // until the thread is done.
+    StellarObject** bodies;
+    int numBodies;
+
+    // Whether `thread` has been started and not yet joined. Only accessed by the GL thread.
+    bool parsing;
+
+    // Set when the file changes again while being parsed, so that it is parsed once more.
+    bool stale;
+
+    mtx_t mutex;
+
+    // Set by `thread` once it is done, along with `catalog` (NULL if the file is invalid) and `plan`.
+    bool parsed;
+
+    StellarCatalog* catalog;
+
+    StellarReloadPlan* plan;
+
+} SystemReloader;
+
+
+int systemReloaderThread(void* arg)
+{
+    SystemReloader* r = (SystemReloader *)arg;
+
+    StellarCatalog* catalog = parseStellarCatalog(r->jsonFilename, NULL, NULL);
+
+    StellarReloadPlan* plan = (catalog != NULL ? planStellarObjectsReload(r->bodies, r->numBodies, catalog) : NULL);
+
+    mtx_lock(&r->mutex);
+
+    r->catalog = catalog;
+    r->plan = plan;
+    r->parsed = true;
+
+    mtx_unlock(&r->mutex);
+
+    return 0;
+}
+
+// System reloader constructor (heap-allocated), watching `data.json` within `data_dir`.
+SystemReloader* initSystemReloader(const char* data_dir)
+{
+    SystemReloader* r = (SystemReloader *)malloc(sizeof(SystemReloader));
+
+    r->watcher = initFileWatcher(data_dir, "data.json");
+    r->jsonFilename = strBuild(r->watcher->filename);
+
+    r->parsing = false;
+    r->stale = false;
+    r->parsed = false;
+    r->catalog = NULL;
+    r->plan = NULL;
+
+    r->bodies = NULL;
+    r->numBodies = 0;
+
+    mtx_init(&r->mutex, mtx_plain);
+
+    return r;
+}
+
+void startSystemReload(SystemReloader* r, StellarObject* const* bodies, int num_bodies)
+{
+    r->parsed = false;
+    r->catalog = NULL;
+    r->plan = NULL;
+
+    r->bodies = (StellarObject **)trackedRealloc(MEMORY_TAG_BODIES, r->bodies, ((size_t)num_bodies + 1) * sizeof(StellarObject *));
+    r->numBodies = num_bodies;
+
+    memcpy(r->bodies, bodies, (size_t)num_bodies * sizeof(StellarObject *));
+
+    if (thrd_create(&r->thread, systemReloaderThread, r) == thrd_success)
+    {
+        r->parsing = true;
+        return;
+    }
+
+    fprintf(stderr, "Warning: Unable to start the reloading thread; Parsing \"%s\" right away.\n", r->jsonFilename);
+
+    systemReloaderThread(r);
+}
+
+// Returns the catalog of `data.json` (heap-allocated) once it has been re-parsed after a change,
+// along with its `*plan` against `bodies` (heap-allocated), to be applied with `reloadStellarObjects`
+// right away; NULL otherwise (including when the new file is invalid, which is reported). Never
+// blocks. Must be called regularly (e.g. once per frame) from the GL thread, with the live bodies.
+StellarCatalog* pollSystemReloader(SystemReloader* r, StellarObject* const* bodies, int num_bodies, StellarReloadPlan** plan)
+{
+    *plan = NULL;
+
+    if (hasFileChanged(r->watcher))
+    {
+        if (r->parsing)
+            r->stale = true;
+        else
+            startSystemReload(r, bodies, num_bodies);
+    }
+
+    mtx_lock(&r->mutex);
+
+    bool parsed = r->parsed;
+
+    mtx_unlock(&r->mutex);
+
+    if (!parsed)
+        return NULL;
+
+    if (r->parsing)
+    {
+        thrd_join(r->thread, NULL);
+        r->parsing = false;
+    }
+
+    StellarCatalog* catalog = r->catalog;
+
+    *plan = r->plan;
+
+    r->parsed = false;
+    r->catalog = NULL;
+    r->plan = NULL;
+
+    // The catalog is already out of date; only the latest version is applied.
+    if (r->stale)
+    {
+        r->stale = false;
+
+        deleteStellarReloadPlan(*plan);
+        deleteStellarCatalog(catalog);
+
+        *plan = NULL;
+
+        startSystemReload(r, bodies, num_bodies);
+
+        return NULL;
+    }
+
+    return catalog;
+}
+
+void deleteSystemReloader(SystemReloader* r)
+{
+    if (r == NULL)
+        return;
+
+    if (r->parsing)
+        thrd_join(r->thread, NULL);
+
+    deleteStellarReloadPlan(r->plan);
+    deleteStellarCatalog(r->catalog);
+
+    mtx_destroy(&r->mutex);
+
+    deleteFileWatcher(r->watcher);
+
+    trackedFree(r->bodies);
+    free(r->jsonFilename);
+    free(r);
+}
+
+#endif // SYSTEM_RELOADER_H
@@ -0,0 +1,421 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+// `shm_open` and `ftruncate`, which C11 without extensions hides; only if no system header came first.
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#   define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if defined(_WIN32)
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#endif
+
+#include "CustomTypes.h"
+
+
+// Live simulation state for other processes on the same machine: every frame, the simulation
+// publishes the frame's statistics and the bodies' positions into a named shared memory segment
+// (`-telemetry <NAME>`), which readers map and read in place, without any call into the simulation
+// and without ever blocking it (see `src/telemetry_reader.c`).
+//
+// The segment holds a `TelemetryHeader` followed by `capacity` records of `TelemetryBody`, all in
+// the machine's byte order:
+//
+//      offset  size
+//           0     4  magic ("STLM")
+//           4     4  version (1)
+//           8     4  header size (128), the offset of the first record
+//          12     4  record size (64)
+//          16     4  capacity: records the segment has room for
+//          20     4  records in use
+//          24     4  bodies in the simulation; more than the records in use if they did not fit
+//          28     4  bodies version: changes whenever the bodies' names or radii may have
+//                    changed
+//          32     8  sequence (see below)
+//          40     8  frame number
+//          48     8  simulated time, in seconds since the start
+//          56     8  real time, in seconds since the start
+//          64     8  duration of the frame, in seconds
+//          72     8  simulation speed
+//          80    48  reserved (zero)
+//
+//      record  size
+//           0    24  position (x, y, z), in AU
+//          24     8  radius, in AU
+//          32    32  name, null-terminated (truncated to 31 bytes)
+//
+// The fields from the records in use onwards are guarded by a sequence lock: the writer makes the
+// sequence odd before it changes them and even again once it is done. A reader reads the sequence,
+// copies what it needs if it was even, and reads the sequence again: if it did not change, the copy
+// is consistent, and otherwise it is torn and must be retried (see `readTelemetrySnapshot`). The
+// writer never waits for readers, and readers only ever retry for as long as a write overlaps them.
+// The fields before the records in use never change, but for the magic number: when more bodies
+// are loaded than the segment has room for, the writer clears it (within a write) and replaces the
+// segment by a larger one of the same name, which readers must then open again (see
+// `resizeTelemetry`).
+
+#define TELEMETRY_MAGIC 0x4D4C5453u
+
+#define TELEMETRY_VERSION 1
+
+#define TELEMETRY_NAME_SIZE 32
+
+// Records of a segment at least, so that systems paged in later (see `Universe.h`) fit as well.
+#define TELEMETRY_MIN_CAPACITY 4096
+
+// How long the writer waits for readers to let go of a segment it replaces, in milliseconds (see
+// `resizeTelemetry`).
+#define TELEMETRY_RESIZE_TIMEOUT 1000
+
+typedef struct TelemetryHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    uint32_t capacity;
+
+    uint32_t numBodies;
+    uint32_t totalBodies;
+    uint32_t bodiesVersion;
+
+    atomic_uint_least64_t sequence;
+
+    uint64_t frame;
+
+    double simulationTime;
+    double realTime;
+    double frameTime;
+    double simulationSpeed;
+
+    uint64_t reserved[6];
+
+} TelemetryHeader;
+
+typedef struct TelemetryBody
+{
+    double position[3];
+
+    double radius;
+
+    char name[TELEMETRY_NAME_SIZE];
+
+} TelemetryBody;
+
+// A mapping of a segment, either writable by the simulation or read-only.
+typedef struct Telemetry
+{
+    TelemetryHeader* header;
+
+    // The records, right after the header.
+    TelemetryBody* bodies;
+
+    size_t size;
+
+    bool writer;
+
+#if defined(_WIN32)
+    HANDLE mapping;
+#else
+    // The segment's name, which the writer unlinks when it closes it.
+    char* name;
+#endif
+
+} Telemetry;
+
+
+// The platform's name of the segment (heap-allocated).
+char* buildTelemetrySegmentName(const char* name)
+{
+#if defined(_WIN32)
+    return strCat(2, "Local\\", name);
+#else
+    return strCat(2, "/", name);
+#endif
+}
+
+// Maps the segment called `name`: a new one of `capacity` records for the writer, which replaces any
+// left over from an earlier run, or an existing one for readers. Returns NULL if it cannot be mapped.
+Telemetry* openTelemetry(const char* name, bool writer, uint32_t capacity)
+{
+    Telemetry* t = (Telemetry *)malloc(sizeof(Telemetry));
+
+    char* segment_name = buildTelemetrySegmentName(name);
+
+    t->writer = writer;
+    t->size = sizeof(TelemetryHeader) + (size_t)capacity * sizeof(TelemetryBody);
+
+    void* addr = NULL;
+
+#if defined(_WIN32)
+
+    if (writer)
+    {
+        t->mapping = CreateFileMappingA(
+            INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+            (DWORD)((uint64_t)t->size >> 32), (DWORD)(t->size & 0xFFFFFFFFu), segment_name
+        );
+
+        // A mapping of that name that readers still hold keeps its size, which may be too small.
+        if (t->mapping != NULL && GetLastError() == ERROR_ALREADY_EXISTS)
+        {
+            CloseHandle(t->mapping);
+            t->mapping = NULL;
+        }
+    }
+    else
+    {
+        t->mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, segment_name);
+    }
+
+    if (t->mapping != NULL)
+        addr = MapViewOfFile(t->mapping, (writer ? FILE_MAP_WRITE : FILE_MAP_READ), 0, 0, 0);
+
+    MEMORY_BASIC_INFORMATION info;
+
+    // Readers map the whole segment, whatever its size.
+    if (addr != NULL && !writer && VirtualQuery(addr, &info, sizeof(info)) != 0)
+        t->size = (size_t)info.RegionSize;
+
+    if (addr == NULL && t->mapping != NULL)
+        CloseHandle(t->mapping);
+
+    free(segment_name);
+
+#else
+
+    t->name = segment_name;
+
+    if (writer)
+        shm_unlink(segment_name);
+
+    int fd = (writer ? shm_open(segment_name, O_RDWR | O_CREAT | O_EXCL, 0644) : shm_open(segment_name, O_RDONLY, 0));
+
+    if (fd >= 0)
+    {
+        struct stat st;
+
+        bool sized = (writer ? ftruncate(fd, (off_t)t->size) == 0 : fstat(fd, &st) == 0);
+
+        if (!writer && sized)
+            t->size = (size_t)st.st_size;
+
+        // Readers find out about the layout from the header, so it has to be there at least.
+        if (sized && t->size >= sizeof(TelemetryHeader))
+        {
+            addr = mmap(NULL, t->size, (writer ? PROT_READ | PROT_WRITE : PROT_READ), MAP_SHARED, fd, 0);
+
+            if (addr == MAP_FAILED)
+                addr = NULL;
+        }
+
+        close(fd);
+    }
+
+    if (addr == NULL)
+    {
+        if (writer && fd >= 0)
+            shm_unlink(segment_name);
+
+        free(segment_name);
+    }
+
+#endif
+
+    if (addr == NULL)
+    {
+        fprintf(stderr, "Error: Could not %s the telemetry segment; Inspect \"%s\".\n", (writer ? "create" : "open"), name);
+        free(t);
+        return NULL;
+    }
+
+    t->header = (TelemetryHeader *)addr;
+    t->bodies = (TelemetryBody *)((char *)addr + sizeof(TelemetryHeader));
+
+    if (writer)
+    {
+        // New segments are zeroed, hence an even sequence and no records in use.
+        t->header->version = TELEMETRY_VERSION;
+        t->header->headerSize = (uint32_t)sizeof(TelemetryHeader);
+        t->header->recordSize = (uint32_t)sizeof(TelemetryBody);
+        t->header->capacity = capacity;
+
+        // Readers check the magic number last, once the rest of the layout is there.
+        atomic_thread_fence(memory_order_release);
+        t->header->magic = TELEMETRY_MAGIC;
+    }
+
+    return t;
+}
+
+// Unmaps the segment, which the writer also removes: readers that still have it mapped keep it, but
+// no new ones can open it.
+void closeTelemetry(Telemetry* t)
+{
+    if (t == NULL)
+        return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(t->header);
+    CloseHandle(t->mapping);
+#else
+    munmap(t->header, t->size);
+
+    if (t->writer)
+        shm_unlink(t->name);
+
+    free(t->name);
+#endif
+
+    free(t);
+}
+
+// Whether a reader's segment has the layout of this version, with room for its records.
+bool checkTelemetryLayout(const Telemetry* t)
+{
+    const TelemetryHeader* h = t->header;
+
+    return (
+        h->magic == TELEMETRY_MAGIC &&
+        h->version == TELEMETRY_VERSION &&
+        h->headerSize == (uint32_t)sizeof(TelemetryHeader) &&
+        h->recordSize == (uint32_t)sizeof(TelemetryBody) &&
+        sizeof(TelemetryHeader) + (size_t)h->capacity * sizeof(TelemetryBody) <= t->size
+    );
+}
+
+// Starts changing the guarded fields; readers retry until `endTelemetryWrite`.
+void beginTelemetryWrite(Telemetry* t)
+{
+    uint64_t sequence = atomic_load_explicit(&t->header->sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&t->header->sequence, sequence + 1, memory_order_relaxed);
+
+    // The odd sequence is visible before any of the changes.
+    atomic_thread_fence(memory_order_release);
+}
+
+void endTelemetryWrite(Telemetry* t)
+{
+    uint64_t sequence = atomic_load_explicit(&t->header->sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&t->header->sequence, sequence + 1, memory_order_release);
+}
+
+// Replaces the writer's segment by one of `capacity` records under the same name: the old one's magic
+// number is cleared, so that readers know to open the new one, which continues its frames with a new
+// bodies version. On Windows, readers that do not let go of the old one within
+// `TELEMETRY_RESIZE_TIMEOUT` make it fail. Returns the new segment, or NULL (after reporting the problem) if it cannot be
+// mapped; the old one is closed either way.
+Telemetry* resizeTelemetry(Telemetry* t, const char* name, uint32_t capacity)
+{
+    beginTelemetryWrite(t);
+    t->header->magic = 0;
+    endTelemetryWrite(t);
+
+    uint64_t frame = t->header->frame;
+    uint32_t bodies_version = t->header->bodiesVersion;
+
+    closeTelemetry(t);
+
+#if defined(_WIN32)
+    // The mapping lasts as long as any reader holds it, and cannot be created anew until then.
+    char* segment_name = buildTelemetrySegmentName(name);
+
+    for (int waited = 0; waited < TELEMETRY_RESIZE_TIMEOUT; waited += 10)
+    {
+        HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, segment_name);
+
+        if (mapping == NULL)
+            break;
+
+        CloseHandle(mapping);
+        Sleep(10);
+    }
+
+    free(segment_name);
+#endif
+
+    t = openTelemetry(name, true, capacity);
+
+    if (t == NULL)
+        return NULL;
+
+    beginTelemetryWrite(t);
+    t->header->frame = frame;
+    t->header->bodiesVersion = bodies_version + 1;
+    endTelemetryWrite(t);
+
+    return t;
+}
+
+// Sets what a record says about its body besides its position. Between `beginTelemetryWrite` and
+// `endTelemetryWrite` only.
+void setTelemetryBody(Telemetry* t, uint32_t i, const char* name, double radius)
+{
+    TelemetryBody* body = &t->bodies[i];
+
+    body->radius = radius;
+
+    strncpy(body->name, name, TELEMETRY_NAME_SIZE - 1);
+    body->name[TELEMETRY_NAME_SIZE - 1] = '\0';
+}
+
+// Copies a consistent snapshot of the guarded fields: the header, and up to `max_bodies` records
+// into `bodies` (which may be NULL). Gives up after `max_attempts` torn copies, returning false.
+// `attempts` (if not NULL) is set to the number of copies it took.
+bool readTelemetrySnapshot(const Telemetry* t, TelemetryHeader* header, TelemetryBody* bodies, uint32_t max_bodies, int max_attempts, int* attempts)
+{
+    for (int attempt = 1; attempt <= max_attempts; ++attempt)
+    {
+        if (attempts != NULL)
+            *attempts = attempt;
+
+        uint64_t before = atomic_load_explicit(&t->header->sequence, memory_order_acquire);
+
+        // Odd while the writer is at it.
+        if (before & 1)
+            continue;
+
+        // The copy may be torn by a concurrent write, which the sequence catches; it is never used
+        // before then, only its size is bounded by the capacity, which does not change.
+        memcpy(header, t->header, sizeof(TelemetryHeader));
+
+        uint32_t count = (header->numBodies < max_bodies ? header->numBodies : max_bodies);
+
+        if (count > t->header->capacity)
+            count = t->header->capacity;
+
+        if (bodies != NULL && count > 0)
+            memcpy(bodies, t->bodies, (size_t)count * sizeof(TelemetryBody));
+
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&t->header->sequence, memory_order_relaxed) == before)
+        {
+            atomic_store_explicit(&header->sequence, before, memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#endif // TELEMETRY_H
@@ -4,6 +4,7 @@
 #include <GL/glut.h>
 #include <GL/freeglut.h>
 
+#include "Profiler.h"
 #include "CustomTypes.h"
 
 
@@ -28,6 +29,7 @@ void renderStringOnScreen(
             glRasterPos2f(x, y);
 
             glutBitmapString(font, (const unsigned char*)string);
+            countDrawCalls(1);
             //glEnable(GL_LIGHTING);
         }
         glPopMatrix();
@@ -45,6 +47,7 @@ void renderStringInWorld(
     glRasterPos3f(x, y, z);
     for (int i = 0; string[i] != '\0'; ++i)
         glutBitmapCharacter(font, string[i]);
+    countDrawCalls(1);
 }
 
 
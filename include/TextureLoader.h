@@ -0,0 +1,523 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <threads.h>
+#include <GL/glut.h>
+
+#include "Textures.h"
+#include "JobSystem.h"
+#include "CustomTypes.h"
+#include "BitmapImages.h"
+#include "ImageFormats.h"
+
+
+// Asynchronous texture loading. Requests are read and decoded as background jobs of the job system
+// (see `JobSystem.h`), while the GL thread goes on with other work (e.g. parsing the catalog or rendering); decoded images are
+// then handed back through a completion queue, and only their upload to OpenGL happens on the GL
+// thread. Uploads are streamed a slice of rows at a time, through a pixel buffer object, under a
+// per-frame budget (see `streamTextureUploads`), so that large textures never stall a frame.
+// Textures found in the `texture_pack` skip the workers altogether, as they need no decoding.
+
+// Called on the GL thread once a request is over; `loaded` is false if the image could not be
+// read, in which case `texture` is 0.
+typedef void (*TextureCallback)(void* user, GLuint texture, bool loaded);
+
+typedef struct TextureRequest
+{
+    char* filename;
+
+    TextureCallback callback;
+
+    void* user;
+
+    // Set by the worker; NULL if decoding failed.
+    BitmapImage* image;
+
+    // Set on submission for baked textures.
+    const PackedTexture* packed;
+
+    // Decodes the request, then releases it once uploaded (see `releaseTextureRequest`).
+    Job job;
+
+    struct TextureLoader* loader;
+
+    struct TextureRequest* next;
+
+} TextureRequest;
+
+typedef struct TextureLoader
+{
+    // NULL to decode synchronously, as when the job system has no workers.
+    JobSystem* jobSystem;
+
+    // The loader's jobs that have not run yet, decoding and releasing requests.
+    JobCounter jobs;
+
+    mtx_t mutex;
+
+    // Signalled when a request has been decoded.
+    cnd_t completedCondition;
+
+    // FIFO queue of decoded requests waiting for upload.
+    TextureRequest* completedHead;
+    TextureRequest* completedTail;
+
+    // Requests submitted but not yet uploaded. Only accessed by the GL thread.
+    int numInFlight;
+
+    // Request being streamed to OpenGL, if any, and its texture. Only accessed by the GL thread.
+    TextureRequest* streaming;
+    GLuint streamingTexture;
+
+    // Position reached in the streamed texture: its mip level, and the next row within that level
+    // (see `TextureLevelLayout`).
+    unsigned int streamingLevel;
+    unsigned int streamingRow;
+
+    // Pixel unpack buffer the slices are staged in; 0 until the first slice, or if unsupported.
+    GLuint pixelBuffer;
+
+    // Size of the pixel buffer's current storage, accounted to `MEMORY_TAG_BUFFERS`.
+    size_t pixelBufferSize;
+
+} TextureLoader;
+
+// One mip level of a request's texture as laid out in memory: `numRows` rows of `rowSize` bytes,
+// bottom row first. A row holds `rowHeight` rows of texels (4 for DXT1 blocks, 1 otherwise).
+typedef struct TextureLevelLayout
+{
+    const ubyte_t* data;
+
+    unsigned int width;
+    unsigned int height;
+
+    unsigned int rowHeight;
+    unsigned int numRows;
+
+    size_t rowSize;
+
+} TextureLevelLayout;
+
+// Bytes uploaded at a time while waiting for every texture (see `finishTextureLoads`).
+#define TEXTURE_FINISH_SLICE_SIZE ((size_t)16 << 20)
+
+// The program's texture loader; NULL until initialised, in which case textures load synchronously.
+TextureLoader* texture_loader = NULL;
+
+
+void pushTextureRequest(TextureRequest** head, TextureRequest** tail, TextureRequest* request)
+{
+    request->next = NULL;
+
+    if (*tail != NULL)
+        (*tail)->next = request;
+    else
+        *head = request;
+
+    *tail = request;
+}
+
+TextureRequest* popTextureRequest(TextureRequest** head, TextureRequest** tail)
+{
+    TextureRequest* request = *head;
+
+    if (request != NULL)
+    {
+        *head = request->next;
+
+        if (*head == NULL)
+            *tail = NULL;
+    }
+    return request;
+}
+
+void deleteTextureRequest(TextureRequest* request)
+{
+    deleteBitmapImage(request->image);
+    free(request->filename);
+    free(request);
+}
+
+void deleteTextureRequestJob(void* data)
+{
+    deleteTextureRequest((TextureRequest *)data);
+}
+
+void decodeTextureRequestJob(void* data)
+{
+    TextureRequest* request = (TextureRequest *)data;
+
+    TextureLoader* loader = request->loader;
+
+    request->image = loadImage(request->filename);
+
+    // Read the whole bitmap now, rather than page by page during the upload.
+    if (request->image != NULL && request->image->file != NULL && request->image->buffer == NULL)
+        prefetchMappedFile(request->image->file);
+
+    mtx_lock(&loader->mutex);
+
+    pushTextureRequest(&loader->completedHead, &loader->completedTail, request);
+    cnd_signal(&loader->completedCondition);
+
+    mtx_unlock(&loader->mutex);
+}
+
+// Texture loader constructor (heap-allocated), decoding on the workers of `js` (may be NULL).
+TextureLoader* initTextureLoader(JobSystem* js)
+{
+    TextureLoader* loader = (TextureLoader *)malloc(sizeof(TextureLoader));
+
+    loader->jobSystem = (js != NULL && js->numWorkers > 0 ? js : NULL);
+
+    initJobCounter(&loader->jobs);
+
+    loader->completedHead = loader->completedTail = NULL;
+
+    loader->numInFlight = 0;
+
+    loader->streaming = NULL;
+    loader->streamingTexture = 0;
+    loader->streamingLevel = loader->streamingRow = 0;
+
+    loader->pixelBuffer = 0;
+    loader->pixelBufferSize = 0;
+
+    mtx_init(&loader->mutex, mtx_plain);
+    cnd_init(&loader->completedCondition);
+
+    if (loader->jobSystem == NULL)
+        fprintf(stderr, "Warning: No worker threads to load textures with; Textures will load synchronously.\n");
+
+    return loader;
+}
+
+// Queues the image for decoding; `callback` is invoked from `streamTextureUploads`/`finishTextureLoads`.
+void submitTexture(TextureLoader* loader, const char* filename, TextureCallback callback, void* user)
+{
+    TextureRequest* request = (TextureRequest *)malloc(sizeof(TextureRequest));
+
+    request->filename = strBuild(filename);
+    request->callback = callback;
+    request->user = user;
+    request->image = NULL;
+    request->loader = loader;
+    request->packed = (texture_pack != NULL ? findPackedTexture(texture_pack, filename) : NULL);
+
+    // Baked textures the driver cannot take are decoded by the workers like any other.
+    if (request->packed != NULL && !isPackedTextureSupported(request->packed))
+        request->packed = NULL;
+
+    loader->numInFlight += 1;
+
+    // Without workers, the request is decoded right away and simply waits for its upload.
+    if (loader->jobSystem == NULL)
+    {
+        if (request->packed == NULL)
+            request->image = loadImage(filename);
+
+        pushTextureRequest(&loader->completedHead, &loader->completedTail, request);
+        return;
+    }
+
+    if (request->packed == NULL)
+    {
+        request->job.function = decodeTextureRequestJob;
+        request->job.data = request;
+
+        submitBackgroundJob(loader->jobSystem, &request->job, &loader->jobs);
+        return;
+    }
+
+    mtx_lock(&loader->mutex);
+
+    pushTextureRequest(&loader->completedHead, &loader->completedTail, request);
+    cnd_signal(&loader->completedCondition);
+
+    mtx_unlock(&loader->mutex);
+}
+
+unsigned int getTextureRequestLevels(const TextureRequest* request)
+{
+    return (request->packed != NULL ? request->packed->numLevels : 1);
+}
+
+void getTextureRequestLevel(const TextureRequest* request, unsigned int level, TextureLevelLayout* layout)
+{
+    const PackedTexture* t = request->packed;
+
+    if (t != NULL)
+    {
+        layout->data = (const ubyte_t *)texture_pack->file->data + t->levelOffsets[level];
+        layout->width = getMipLevelDimension(t->width, level);
+        layout->height = getMipLevelDimension(t->height, level);
+        layout->rowHeight = (t->format == PACKED_FORMAT_DXT1 ? 4 : 1);
+    }
+    else
+    {
+        layout->data = request->image->pixels;
+        layout->width = request->image->width;
+        layout->height = request->image->height;
+        layout->rowHeight = 1;
+    }
+
+    layout->numRows = (layout->height + layout->rowHeight - 1) / layout->rowHeight;
+
+    layout->rowSize = (t != NULL ? (size_t)t->levelSizes[level] / layout->numRows : request->image->rowStride);
+}
+
+// Releases a request once its texture is uploaded. Unmapping or freeing a large image takes
+// milliseconds, so it is left to the workers rather than done on the GL thread.
+void releaseTextureRequest(TextureLoader* loader, TextureRequest* request)
+{
+    if (request->image == NULL || loader->jobSystem == NULL)
+    {
+        deleteTextureRequest(request);
+        return;
+    }
+
+    request->job.function = deleteTextureRequestJob;
+    request->job.data = request;
+
+    submitBackgroundJob(loader->jobSystem, &request->job, &loader->jobs);
+}
+
+// Creates the texture of a decoded request, with storage for all its levels but no contents yet.
+void beginTextureUpload(TextureLoader* loader, TextureRequest* request)
+{
+    const PackedTexture* t = request->packed;
+
+    unsigned int num_levels = getTextureRequestLevels(request);
+
+    glGenTextures(1, &loader->streamingTexture);
+    glBindTexture(GL_TEXTURE_2D, loader->streamingTexture);
+
+    size_t bytes = 0;
+
+    for (unsigned int l = 0; l < num_levels; ++l)
+    {
+        TextureLevelLayout layout;
+        getTextureRequestLevel(request, l, &layout);
+
+        bytes += estimateTextureLevelBytes(layout.width, layout.height, t != NULL && t->format == PACKED_FORMAT_DXT1);
+
+        if (t != NULL && t->format == PACKED_FORMAT_DXT1)
+        {
+            getCompressedTexImage2D()(
+                GL_TEXTURE_2D, (GLint)l, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, (GLsizei)layout.width, (GLsizei)layout.height, 
+                0, (GLsizei)t->levelSizes[l], NULL
+            );
+        }
+        else
+        {
+            glTexImage2D(
+                GL_TEXTURE_2D, (GLint)l, GL_RGB, (GLsizei)layout.width, (GLsizei)layout.height, 0, 
+                GL_BGR, GL_UNSIGNED_BYTE, NULL
+            );
+        }
+    }
+
+    setTextureSampling(num_levels);
+
+    // The storage of every level is allocated up front.
+    trackTextureMemory(loader->streamingTexture, bytes);
+
+    loader->streaming = request;
+    loader->streamingLevel = loader->streamingRow = 0;
+}
+
+// Uploads the next rows of the streamed texture, as many as fit in `budget` bytes (one at least),
+// and hands the texture over once it is complete. Returns the number of bytes uploaded.
+size_t uploadTextureSlice(TextureLoader* loader, size_t budget)
+{
+    TextureRequest* request = loader->streaming;
+
+    TextureLevelLayout layout;
+    getTextureRequestLevel(request, loader->streamingLevel, &layout);
+
+    size_t num_rows = budget / layout.rowSize;
+
+    if (num_rows < 1)
+        num_rows = 1;
+
+    if (num_rows > layout.numRows - loader->streamingRow)
+        num_rows = layout.numRows - loader->streamingRow;
+
+    size_t size = num_rows * layout.rowSize;
+
+    const void* pixels = layout.data + (size_t)loader->streamingRow * layout.rowSize;
+
+    glBindTexture(GL_TEXTURE_2D, loader->streamingTexture);
+
+    // The slice is copied into a pixel buffer, from which the driver transfers it asynchronously;
+    // without one, it is uploaded straight from memory.
+    const PixelBufferProcs* pbo = getPixelBufferProcs();
+
+    bool staged = false;
+
+    if (pbo != NULL)
+    {
+        if (loader->pixelBuffer == 0)
+            pbo->genBuffers(1, &loader->pixelBuffer);
+
+        pbo->bindBuffer(GL_PIXEL_UNPACK_BUFFER, loader->pixelBuffer);
+
+        // Orphans the storage of the previous slice, which may still be in transfer.
+        pbo->bufferData(GL_PIXEL_UNPACK_BUFFER, (ptrdiff_t)size, NULL, GL_STREAM_DRAW);
+
+        untrackMemory(MEMORY_TAG_BUFFERS, loader->pixelBufferSize);
+        trackMemory(MEMORY_TAG_BUFFERS, size);
+
+        loader->pixelBufferSize = size;
+
+        void* staging = pbo->mapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+
+        if (staging != NULL)
+        {
+            memcpy(staging, pixels, size);
+            staged = (pbo->unmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE);
+        }
+
+        if (!staged)
+            pbo->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    GLint y = (GLint)(loader->streamingRow * layout.rowHeight);
+    GLsizei height = (GLsizei)(num_rows * layout.rowHeight);
+
+    if (y + height > (GLint)layout.height)
+        height = (GLsizei)layout.height - y;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (request->packed != NULL && request->packed->format == PACKED_FORMAT_DXT1)
+    {
+        getCompressedTexSubImage2D()(
+            GL_TEXTURE_2D, (GLint)loader->streamingLevel, 0, y, (GLsizei)layout.width, height, 
+            GL_COMPRESSED_RGB_S3TC_DXT1_EXT, (GLsizei)size, (staged ? NULL : pixels)
+        );
+    }
+    else
+    {
+        GLenum format = (request->image != NULL && request->image->bytesPerPixel == 4 ? GL_BGRA : GL_BGR);
+
+        glTexSubImage2D(
+            GL_TEXTURE_2D, (GLint)loader->streamingLevel, 0, y, (GLsizei)layout.width, height, 
+            format, GL_UNSIGNED_BYTE, (staged ? NULL : pixels)
+        );
+    }
+
+    if (staged)
+        pbo->bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    loader->streamingRow += (unsigned int)num_rows;
+
+    if (loader->streamingRow == layout.numRows)
+    {
+        loader->streamingLevel += 1;
+        loader->streamingRow = 0;
+    }
+
+    if (loader->streamingLevel == getTextureRequestLevels(request))
+    {
+        request->callback(request->user, loader->streamingTexture, true);
+
+        releaseTextureRequest(loader, request);
+
+        loader->streaming = NULL;
+        loader->streamingTexture = 0;
+        loader->numInFlight -= 1;
+    }
+
+    return size;
+}
+
+// Uploads the textures decoded so far, spread over successive calls: each call uploads about
+// `budget` bytes at most (a single row at least), resuming where the previous one stopped, and
+// never waits for decoding. A texture's callback is invoked once it is complete. Returns the
+// number of requests still in flight. Must be called from the GL thread, e.g. once per frame.
+int streamTextureUploads(TextureLoader* loader, size_t budget)
+{
+    size_t uploaded = 0;
+
+    while (uploaded < budget)
+    {
+        if (loader->streaming == NULL)
+        {
+            mtx_lock(&loader->mutex);
+
+            TextureRequest* request = popTextureRequest(&loader->completedHead, &loader->completedTail);
+
+            mtx_unlock(&loader->mutex);
+
+            if (request == NULL)
+                break;
+
+            // Images that could not be loaded have nothing to upload.
+            if (request->packed == NULL && request->image == NULL)
+            {
+                request->callback(request->user, 0, false);
+
+                deleteTextureRequest(request);
+
+                loader->numInFlight -= 1;
+                continue;
+            }
+
+            beginTextureUpload(loader, request);
+        }
+
+        uploaded += uploadTextureSlice(loader, budget - uploaded);
+    }
+
+    return loader->numInFlight;
+}
+
+// Uploads every submitted texture, as soon as each one is decoded. Must be called from the GL thread.
+void finishTextureLoads(TextureLoader* loader)
+{
+    while (streamTextureUploads(loader, TEXTURE_FINISH_SLICE_SIZE) > 0)
+    {
+        if (loader->streaming != NULL)
+            continue;
+
+        mtx_lock(&loader->mutex);
+
+        while (loader->completedHead == NULL)
+            cnd_wait(&loader->completedCondition, &loader->mutex);
+
+        mtx_unlock(&loader->mutex);
+    }
+}
+
+void deleteTextureLoader(TextureLoader* loader)
+{
+    if (loader == NULL)
+        return;
+
+    finishTextureLoads(loader);
+
+    // Requests being released.
+    waitForJobs(loader->jobSystem, &loader->jobs);
+
+    if (loader->pixelBuffer != 0)
+        getPixelBufferProcs()->deleteBuffers(1, &loader->pixelBuffer);
+
+    untrackMemory(MEMORY_TAG_BUFFERS, loader->pixelBufferSize);
+
+    cnd_destroy(&loader->completedCondition);
+    mtx_destroy(&loader->mutex);
+
+    free(loader);
+}
+
+#endif // TEXTURE_LOADER_H
@@ -0,0 +1,653 @@
+#ifndef TEXTURE_PACK_H
+#define TEXTURE_PACK_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "MappedFile.h"
+#include "CustomTypes.h"
+#include "BitmapImages.h"
+
+
+// Baked textures of a system (`textures.pack`, written by the `bake_textures` tool). Every texture
+// is stored with its full mip chain, already in the format it is uploaded in, so at runtime the
+// file is memory-mapped and each level is handed to OpenGL straight from the mapping (see
+// `uploadPackedTexture` in `Textures.h`): nothing is decoded, converted or copied.
+//
+// Layout (native byte order, every level aligned to TEXTURE_PACK_ALIGNMENT bytes):
+//
+//     TexturePackHeader
+//     PackedTexture textures[n]   (sorted by name)
+//     char          strings[]     (null-terminated names and source file names)
+//     ubyte_t       levels[]      (mip levels of each texture, largest first)
+//
+// Levels are either S3TC DXT1 blocks (4x4 texels in 8 bytes) or BGR rows padded to 4 bytes, both
+// bottom-up, like `BitmapImage`. A texture is ignored as soon as its source image is modified.
+
+#define TEXTURE_PACK_MAGIC "STXP"
+#define TEXTURE_PACK_VERSION 1
+#define TEXTURE_PACK_BYTE_ORDER 0x01020304u
+#define TEXTURE_PACK_ALIGNMENT 16
+#define TEXTURE_PACK_MAX_LEVELS 16
+
+#define TEXTURE_PACK_FILENAME "textures.pack"
+
+typedef enum PackedTextureFormat
+{
+    PACKED_FORMAT_BGR8 = 0,
+    PACKED_FORMAT_DXT1 = 1
+
+} PackedTextureFormat;
+
+typedef struct TexturePackHeader
+{
+    char magic[4];
+
+    uint32_t version;
+
+    // TEXTURE_PACK_BYTE_ORDER as written by the baker; tells apart files of another endianness.
+    uint32_t byteOrder;
+
+    uint32_t numTextures;
+
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+
+} TexturePackHeader;
+
+typedef struct PackedTexture
+{
+    // Offsets into the string table of the texture's name (as requested, e.g. "Earth") and of the
+    // file name of the image it was baked from (e.g. "Earth.jpg").
+    uint32_t nameOffset;
+    uint32_t sourceOffset;
+
+    // Size and modification time of the source image.
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+
+    uint32_t format;
+
+    uint32_t width;
+    uint32_t height;
+
+    uint32_t numLevels;
+
+    uint64_t levelOffsets[TEXTURE_PACK_MAX_LEVELS];
+    uint64_t levelSizes[TEXTURE_PACK_MAX_LEVELS];
+
+} PackedTexture;
+
+typedef struct TexturePack
+{
+    MappedFile* file;
+
+    // The system directory, prefix of the texture paths that are looked up.
+    char* directory;
+
+    int numTextures;
+
+    // Pointers into the mapping.
+    const PackedTexture* textures;
+
+    const char* strings;
+
+} TexturePack;
+
+// The program's texture pack; NULL if the system has none, in which case images are decoded.
+TexturePack* texture_pack = NULL;
+
+
+const char* getPackedTextureName(const TexturePack* pack, const PackedTexture* t)
+{
+    return pack->strings + t->nameOffset;
+}
+
+const char* getPackedTextureSource(const TexturePack* pack, const PackedTexture* t)
+{
+    return pack->strings + t->sourceOffset;
+}
+
+unsigned int getMipLevelDimension(unsigned int size, unsigned int level)
+{
+    size >>= level;
+
+    return (size > 0 ? size : 1);
+}
+
+size_t getPackedLevelSize(PackedTextureFormat format, unsigned int width, unsigned int height)
+{
+    if (format == PACKED_FORMAT_DXT1)
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+
+    return (((size_t)width * 3 + 3) & ~(size_t)3) * height;
+}
+
+void closeTexturePack(TexturePack* pack)
+{
+    if (pack == NULL)
+        return;
+
+    closeMappedFile(pack->file);
+    free(pack->directory);
+    free(pack);
+}
+
+// Maps the texture pack of a system directory. Returns NULL if there is none, or if it is not
+// usable (malformed or of another version).
+TexturePack* openTexturePack(const char* directory)
+{
+    char* filename = strCat(2, directory, TEXTURE_PACK_FILENAME);
+
+    MappedFile* file = openMappedFile(filename, false);
+
+    if (file == NULL)
+    {
+        free(filename);
+        return NULL;
+    }
+
+    const TexturePackHeader* h = (const TexturePackHeader *)file->data;
+
+    bool valid = (
+        file->size >= sizeof(TexturePackHeader) && memcmp(h->magic, TEXTURE_PACK_MAGIC, 4) == 0 &&
+        h->byteOrder == TEXTURE_PACK_BYTE_ORDER
+    );
+
+    if (valid && h->version != TEXTURE_PACK_VERSION)
+    {
+        fprintf(
+            stderr, "Warning: \"%s\" is of version %u (expected %d); Ignoring it, re-run bake_textures to update it.\n",
+            filename, (unsigned int)h->version, TEXTURE_PACK_VERSION
+        );
+        closeMappedFile(file);
+        free(filename);
+        return NULL;
+    }
+
+    valid = valid && (
+        h->numTextures <= (file->size - sizeof(TexturePackHeader)) / sizeof(PackedTexture) &&
+        h->stringsOffset <= file->size && h->stringsSize <= file->size - h->stringsOffset &&
+        h->stringsSize > 0 && file->data[h->stringsOffset + h->stringsSize - 1] == '\0'
+    );
+
+    TexturePack* pack = (TexturePack *)malloc(sizeof(TexturePack));
+
+    pack->file = file;
+    pack->directory = strBuild(directory);
+    pack->numTextures = (valid ? (int)h->numTextures : 0);
+    pack->textures = (const PackedTexture *)(file->data + sizeof(TexturePackHeader));
+    pack->strings = (valid ? file->data + h->stringsOffset : NULL);
+
+    // Guard the references that uploads follow blindly.
+    for (int i = 0; i < pack->numTextures && valid; ++i)
+    {
+        const PackedTexture* t = &pack->textures[i];
+
+        valid = (
+            t->nameOffset < h->stringsSize && t->sourceOffset < h->stringsSize &&
+            t->format <= PACKED_FORMAT_DXT1 && t->width > 0 && t->height > 0 &&
+            t->numLevels > 0 && t->numLevels <= TEXTURE_PACK_MAX_LEVELS
+        );
+
+        for (unsigned int l = 0; l < t->numLevels && valid; ++l)
+        {
+            valid = (
+                t->levelOffsets[l] <= file->size && t->levelSizes[l] <= file->size - t->levelOffsets[l] &&
+                t->levelSizes[l] == getPackedLevelSize(
+                    (PackedTextureFormat)t->format, getMipLevelDimension(t->width, l), getMipLevelDimension(t->height, l)
+                )
+            );
+        }
+    }
+
+    if (!valid)
+    {
+        fprintf(stderr, "Warning: \"%s\" is corrupted; Ignoring it.\n", filename);
+        closeTexturePack(pack);
+        free(filename);
+        return NULL;
+    }
+
+    free(filename);
+
+    return pack;
+}
+
+// Looks up a texture by the path it would otherwise be loaded from (the pack's directory followed
+// by the texture's name). Returns NULL if the pack does not have it, or if its source image has
+// been modified since it was baked.
+const PackedTexture* findPackedTexture(const TexturePack* pack, const char* filename)
+{
+    size_t prefix = strlen(pack->directory);
+
+    const char* name = (strncmp(filename, pack->directory, prefix) == 0 ? filename + prefix : filename);
+
+    int low = 0, high = pack->numTextures - 1;
+
+    while (low <= high)
+    {
+        int middle = low + (high - low) / 2;
+
+        const PackedTexture* t = &pack->textures[middle];
+
+        int order = strcmp(name, getPackedTextureName(pack, t));
+
+        if (order < 0)
+            high = middle - 1;
+        else if (order > 0)
+            low = middle + 1;
+        else
+        {
+            char* source = strCat(2, pack->directory, getPackedTextureSource(pack, t));
+
+            uint64_t size;
+            int64_t mtime;
+
+            bool stale = (getFileStamp(source, &size, &mtime) && (size != t->sourceSize || mtime != t->sourceMtime));
+
+            if (stale)
+                fprintf(stderr, "Warning: Baked texture \"%s\" is out of date; Loading \"%s\" instead, re-run bake_textures to update it.\n", name, source);
+
+            free(source);
+
+            return (stale ? NULL : t);
+        }
+    }
+
+    return NULL;
+}
+
+
+// ---------------------------------- Baking ---------------------------------- //
+
+// Halves an image (each dimension down to 1), averaging blocks of up to 2x2 pixels.
+BitmapImage* downsampleBitmapImage(const BitmapImage* src)
+{
+    unsigned int width = getMipLevelDimension(src->width, 1);
+    unsigned int height = getMipLevelDimension(src->height, 1);
+
+    const unsigned int bpp = src->bytesPerPixel;
+
+    BitmapImage* dst = allocateBitmapImage(width, height, bpp);
+
+    if (dst == NULL)
+        return NULL;
+
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        const ubyte_t* row0 = src->pixels + (size_t)(2 * y) * src->rowStride;
+        const ubyte_t* row1 = (2 * y + 1 < src->height ? row0 + src->rowStride : row0);
+
+        ubyte_t* out = dst->buffer + (size_t)y * dst->rowStride;
+
+        for (unsigned int x = 0; x < width; ++x)
+        {
+            size_t x0 = (size_t)(2 * x) * bpp;
+            size_t x1 = (2 * x + 1 < src->width ? x0 + bpp : x0);
+
+            for (unsigned int c = 0; c < bpp; ++c)
+                out[x * bpp + c] = (ubyte_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+        }
+    }
+
+    return dst;
+}
+
+uint16_t packColor565(const int* bgr)
+{
+    return (uint16_t)(((bgr[2] * 31 + 127) / 255) << 11 | ((bgr[1] * 63 + 127) / 255) << 5 | ((bgr[0] * 31 + 127) / 255));
+}
+
+void unpackColor565(uint16_t color, int* bgr)
+{
+    int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+
+    bgr[0] = (b << 3) | (b >> 2);
+    bgr[1] = (g << 2) | (g >> 4);
+    bgr[2] = (r << 3) | (r >> 2);
+}
+
+// Encodes 16 BGR texels (row by row) as a DXT1 block. The endpoints are the texels lying furthest
+// apart along the principal axis of the block's colors, which follows gradients much better than
+// the corners of their bounding box.
+void encodeDXT1Block(const int texels[16][3], ubyte_t* block)
+{
+    double mean[3] = { 0.0, 0.0, 0.0 };
+
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+            mean[c] += texels[i][c] / 16.0;
+
+    double covariance[3][3] = { { 0.0 } };
+
+    for (int i = 0; i < 16; ++i)
+        for (int a = 0; a < 3; ++a)
+            for (int b = 0; b < 3; ++b)
+                covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+
+    // Principal axis by power iteration.
+    double axis[3] = { 1.0, 1.0, 1.0 };
+
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        double next[3];
+
+        for (int a = 0; a < 3; ++a)
+            next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+
+        double norm = sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+
+        if (norm < 1e-9)
+            break;
+
+        for (int a = 0; a < 3; ++a)
+            axis[a] = next[a] / norm;
+    }
+
+    int lowest = 0, highest = 0;
+
+    double low = INFINITY, high = -INFINITY;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        double projection = texels[i][0] * axis[0] + texels[i][1] * axis[1] + texels[i][2] * axis[2];
+
+        if (projection < low)
+        {
+            low = projection;
+            lowest = i;
+        }
+        if (projection > high)
+        {
+            high = projection;
+            highest = i;
+        }
+    }
+
+    uint16_t color0 = packColor565(texels[highest]);
+    uint16_t color1 = packColor565(texels[lowest]);
+
+    // color0 > color1 selects the 4-color mode.
+    if (color0 < color1)
+    {
+        uint16_t swap = color0;
+        color0 = color1;
+        color1 = swap;
+    }
+
+    int palette[4][3];
+
+    unpackColor565(color0, palette[0]);
+    unpackColor565(color1, palette[1]);
+
+    for (int c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    uint32_t indices = 0;
+
+    if (color0 != color1)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, best_distance = INT32_MAX;
+
+            for (int p = 0; p < 4; ++p)
+            {
+                int db = texels[i][0] - palette[p][0];
+                int dg = texels[i][1] - palette[p][1];
+                int dr = texels[i][2] - palette[p][2];
+
+                int distance = db * db + dg * dg + dr * dr;
+
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best = p;
+                }
+            }
+
+            indices |= (uint32_t)best << (2 * i);
+        }
+    }
+
+    block[0] = (ubyte_t)(color0 & 0xFF);
+    block[1] = (ubyte_t)(color0 >> 8);
+    block[2] = (ubyte_t)(color1 & 0xFF);
+    block[3] = (ubyte_t)(color1 >> 8);
+    block[4] = (ubyte_t)(indices & 0xFF);
+    block[5] = (ubyte_t)((indices >> 8) & 0xFF);
+    block[6] = (ubyte_t)((indices >> 16) & 0xFF);
+    block[7] = (ubyte_t)(indices >> 24);
+}
+
+// Encodes a whole image as DXT1 blocks into `out` (see `getPackedLevelSize`). Blocks that overhang
+// the image repeat its last row and column.
+void compressDXT1(const BitmapImage* image, ubyte_t* out)
+{
+    int texels[16][3];
+
+    for (unsigned int by = 0; by < image->height; by += 4)
+    {
+        for (unsigned int bx = 0; bx < image->width; bx += 4, out += 8)
+        {
+            for (unsigned int i = 0; i < 16; ++i)
+            {
+                unsigned int x = bx + i % 4, y = by + i / 4;
+
+                x = (x < image->width ? x : image->width - 1);
+                y = (y < image->height ? y : image->height - 1);
+
+                const ubyte_t* p = image->pixels + (size_t)y * image->rowStride + (size_t)x * image->bytesPerPixel;
+
+                texels[i][0] = p[0];
+                texels[i][1] = p[1];
+                texels[i][2] = p[2];
+            }
+
+            encodeDXT1Block(texels, out);
+        }
+    }
+}
+
+// Writes a level in the given format, padding the file to the next level boundary first.
+bool writePackedLevel(FILE* fp, uint64_t* offset, const BitmapImage* image, PackedTextureFormat format, uint64_t* level_offset, uint64_t* level_size)
+{
+    static const char zeros[TEXTURE_PACK_ALIGNMENT] = { 0 };
+
+    size_t padding = (size_t)((TEXTURE_PACK_ALIGNMENT - *offset % TEXTURE_PACK_ALIGNMENT) % TEXTURE_PACK_ALIGNMENT);
+
+    fwrite(zeros, 1, padding, fp);
+
+    *offset += padding;
+    *level_offset = *offset;
+    *level_size = getPackedLevelSize(format, image->width, image->height);
+
+    if (format == PACKED_FORMAT_DXT1)
+    {
+        ubyte_t* blocks = (ubyte_t *)malloc((size_t)*level_size);
+
+        compressDXT1(image, blocks);
+        fwrite(blocks, 1, (size_t)*level_size, fp);
+
+        free(blocks);
+    }
+    else
+    {
+        // BGR(A) -> BGR, keeping the 4-byte row alignment.
+        size_t stride = ((size_t)image->width * 3 + 3) & ~(size_t)3;
+
+        ubyte_t* row = (ubyte_t *)calloc(stride, 1);
+
+        for (unsigned int y = 0; y < image->height; ++y)
+        {
+            const ubyte_t* src = image->pixels + (size_t)y * image->rowStride;
+
+            for (unsigned int x = 0; x < image->width; ++x)
+                memcpy(row + 3 * (size_t)x, src + (size_t)x * image->bytesPerPixel, 3);
+
+            fwrite(row, 1, stride, fp);
+        }
+
+        free(row);
+    }
+
+    *offset += *level_size;
+
+    return !ferror(fp);
+}
+
+// A texture to be baked: its name, the path of its source image and the decoded image.
+typedef struct TexturePackInput
+{
+    const char* name;
+    const char* sourceFilename;
+
+    const BitmapImage* image;
+
+} TexturePackInput;
+
+// The part of a path after its last directory separator.
+const char* getPathFileName(const char* path)
+{
+    const char* name = path;
+
+    for (const char* p = path; *p != '\0'; ++p)
+    {
+        if (*p == '/' || *p == '\\')
+            name = p + 1;
+    }
+    return name;
+}
+
+int compareTexturePackInputs(const void* a, const void* b)
+{
+    return strcmp(((const TexturePackInput *)a)->name, ((const TexturePackInput *)b)->name);
+}
+
+// Bakes the textures into a pack: generates each one's mip chain and encodes every level.
+// The inputs are sorted by name in the process.
+bool writeTexturePack(const char* filename, TexturePackInput* inputs, int count, PackedTextureFormat format)
+{
+    FILE* fp = fopen(filename, "wb");
+
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error: Unable to create the texture pack \"%s\".\n", filename);
+        return false;
+    }
+
+    qsort(inputs, (size_t)count, sizeof(TexturePackInput), compareTexturePackInputs);
+
+    TexturePackHeader h;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, TEXTURE_PACK_MAGIC, 4);
+
+    h.version = TEXTURE_PACK_VERSION;
+    h.byteOrder = TEXTURE_PACK_BYTE_ORDER;
+    h.numTextures = (uint32_t)count;
+
+    PackedTexture* textures = (PackedTexture *)calloc((size_t)count + 1, sizeof(PackedTexture));
+
+    // String table: each name followed by its source's file name (without the directory).
+    size_t strings_size = 0;
+
+    for (int i = 0; i < count; ++i)
+        strings_size += strlen(inputs[i].name) + strlen(getPathFileName(inputs[i].sourceFilename)) + 2;
+
+    char* strings = (char *)malloc(strings_size + 1);
+
+    strings_size = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const char* source = getPathFileName(inputs[i].sourceFilename);
+
+        textures[i].nameOffset = (uint32_t)strings_size;
+        strcpy(strings + strings_size, inputs[i].name);
+        strings_size += strlen(inputs[i].name) + 1;
+
+        textures[i].sourceOffset = (uint32_t)strings_size;
+        strcpy(strings + strings_size, source);
+        strings_size += strlen(source) + 1;
+
+        if (!getFileStamp(inputs[i].sourceFilename, &textures[i].sourceSize, &textures[i].sourceMtime))
+        {
+            textures[i].sourceSize = 0;
+            textures[i].sourceMtime = 0;
+        }
+    }
+
+    h.stringsOffset = sizeof(TexturePackHeader) + (uint64_t)count * sizeof(PackedTexture);
+    h.stringsSize = strings_size;
+
+    uint64_t offset = h.stringsOffset + h.stringsSize;
+
+    fseek(fp, (long)h.stringsOffset, SEEK_SET);
+    fwrite(strings, 1, strings_size, fp);
+
+    bool ok = true;
+
+    for (int i = 0; i < count && ok; ++i)
+    {
+        PackedTexture* t = &textures[i];
+
+        t->format = (uint32_t)format;
+        t->width = inputs[i].image->width;
+        t->height = inputs[i].image->height;
+
+        // Down to 1x1.
+        t->numLevels = 1;
+
+        while (t->numLevels < TEXTURE_PACK_MAX_LEVELS && (t->width >> t->numLevels > 0 || t->height >> t->numLevels > 0))
+            t->numLevels += 1;
+
+        const BitmapImage* level = inputs[i].image;
+
+        for (unsigned int l = 0; l < t->numLevels && ok; ++l)
+        {
+            ok = writePackedLevel(fp, &offset, level, format, &t->levelOffsets[l], &t->levelSizes[l]);
+
+            BitmapImage* next = (ok && l + 1 < t->numLevels ? downsampleBitmapImage(level) : NULL);
+
+            if (level != inputs[i].image)
+                deleteBitmapImage((BitmapImage *)level);
+
+            level = next;
+
+            ok = ok && (next != NULL || l + 1 == t->numLevels);
+        }
+
+        if (level != NULL && level != inputs[i].image)
+            deleteBitmapImage((BitmapImage *)level);
+    }
+
+    rewind(fp);
+    fwrite(&h, sizeof(h), 1, fp);
+    fwrite(textures, sizeof(PackedTexture), (size_t)count, fp);
+
+    ok = !ferror(fp) && ok;
+    ok = (fclose(fp) == 0) && ok;
+
+    free(strings);
+    free(textures);
+
+    if (!ok)
+        fprintf(stderr, "Error: Failed writing the texture pack \"%s\".\n", filename);
+
+    return ok;
+}
+
+#endif // TEXTURE_PACK_H
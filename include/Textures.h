@@ -1,36 +1,131 @@
 #ifndef TEXTURES_H
 #define TEXTURES_H
 
+#include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <GL/glut.h>
+#include <GL/freeglut_ext.h>
 
 #include "CustomTypes.h"
+#include "MemoryTracker.h"
 #include "BitmapImages.h"
+#include "ImageFormats.h"
+#include "TexturePack.h"
 
 
-bool registerTexture(const char* filename, GLuint* textureID)
+// Not defined by OpenGL 1.1 headers (e.g. Windows' gl.h), although supported by any driver since 1.2.
+#ifndef GL_BGR
+#   define GL_BGR 0x80E0
+#endif
+#ifndef GL_BGRA
+#   define GL_BGRA 0x80E1
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#   define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#   define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#   define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#   define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_WRITE_ONLY
+#   define GL_WRITE_ONLY 0x88B9
+#endif
+#ifndef APIENTRY
+#   define APIENTRY
+#endif
+
+// glCompressedTex(Sub)Image2D (OpenGL 1.3), fetched at runtime since Windows only exports OpenGL 1.1.
+typedef void (APIENTRY *CompressedTexImage2DProc)(GLenum, GLint, GLenum, GLsizei, GLsizei, GLint, GLsizei, const void*);
+typedef void (APIENTRY *CompressedTexSubImage2DProc)(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLsizei, const void*);
+
+// Buffer objects (OpenGL 1.5), used as pixel unpack buffers (OpenGL 2.1) to stream texture uploads.
+typedef struct PixelBufferProcs
 {
-    unsigned int width;
-    unsigned int height;
+    void (APIENTRY *genBuffers)(GLsizei, GLuint*);
+    void (APIENTRY *deleteBuffers)(GLsizei, const GLuint*);
+    void (APIENTRY *bindBuffer)(GLenum, GLuint);
+    void (APIENTRY *bufferData)(GLenum, ptrdiff_t, const void*, GLenum);
+    void* (APIENTRY *mapBuffer)(GLenum, GLenum);
+    GLboolean (APIENTRY *unmapBuffer)(GLenum);
 
-    ubyte_t* image = loadBitmapToRGBArray(filename, &width, &height, false);
+} PixelBufferProcs;
 
-    // TODO: improve error handling
-    if (image == NULL) 
+// Estimated video memory of each texture, indexed by texture name (see `trackTextureMemory`).
+size_t* texture_memory_bytes = NULL;
+size_t texture_memory_capacity = 0;
+
+
+// Estimated video memory of a texture level: DXT1 textures take 8 bytes per block of 4x4 texels,
+// and drivers usually pad uncompressed RGB texels to 4 bytes.
+size_t estimateTextureLevelBytes(unsigned int width, unsigned int height, bool compressed)
+{
+    if (compressed)
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 8;
+
+    return (size_t)width * height * 4;
+}
+
+// Accounts the video memory of a texture just created to `MEMORY_TAG_TEXTURES`, until it is
+// deleted by `deleteTextures`. Must be called from the GL thread.
+void trackTextureMemory(GLuint texture, size_t bytes)
+{
+    if (texture >= texture_memory_capacity)
     {
-        *textureID = 0;
-        return false;
+        size_t capacity = (2 * texture_memory_capacity > (size_t)texture + 1 ? 2 * texture_memory_capacity : (size_t)texture + 1);
+
+        texture_memory_bytes = (size_t *)realloc(texture_memory_bytes, capacity * sizeof(size_t));
+
+        memset(texture_memory_bytes + texture_memory_capacity, 0, (capacity - texture_memory_capacity) * sizeof(size_t));
+
+        texture_memory_capacity = capacity;
+    }
+
+    untrackMemory(MEMORY_TAG_TEXTURES, texture_memory_bytes[texture]);
+    trackMemory(MEMORY_TAG_TEXTURES, bytes);
+
+    texture_memory_bytes[texture] = bytes;
+}
+
+// `glDeleteTextures`, which also releases the textures' accounted memory. Must be called from the GL thread.
+void deleteTextures(GLsizei n, const GLuint* textures)
+{
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        if (textures[i] < texture_memory_capacity)
+        {
+            untrackMemory(MEMORY_TAG_TEXTURES, texture_memory_bytes[textures[i]]);
+            texture_memory_bytes[textures[i]] = 0;
+        }
     }
 
+    glDeleteTextures(n, textures);
+}
+
+
+// Uploads a decoded image to a new texture object. Must be called from the GL thread.
+void uploadBitmapTexture(const BitmapImage* image, GLuint* textureID)
+{
     // Enable 2D texturing.
     glEnable(GL_TEXTURE_2D);
     // Generate a texture ID.
     glGenTextures(1, textureID); // Generate a texture ID
     // Bind the texture.
     glBindTexture(GL_TEXTURE_2D, *textureID);
-    // Upload the texture data.
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+    // Image rows are padded to 4 bytes, exactly like OpenGL expects them by default.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // Upload the pixels as they are (in place for bitmaps); the driver swaps the channels.
+    glTexImage2D(
+        GL_TEXTURE_2D, 0, GL_RGB, image->width, image->height, 0,
+        (image->bytesPerPixel == 4 ? GL_BGRA : GL_BGR), GL_UNSIGNED_BYTE, image->pixels
+    );
     // Set texture filtering to linear.
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -39,8 +134,200 @@ bool registerTexture(const char* filename, GLuint* textureID)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     // Bind the texture.
     glBindTexture(GL_TEXTURE_2D, *textureID);
-    // Deallocated the image after upload.
-    free(image);
+
+    trackTextureMemory(*textureID, estimateTextureLevelBytes(image->width, image->height, false));
+}
+
+// Returns glCompressedTexImage2D if the driver supports DXT1 textures, NULL otherwise.
+// Must be called from the GL thread (with a current context).
+CompressedTexImage2DProc getCompressedTexImage2D(void)
+{
+    static bool resolved = false;
+    static CompressedTexImage2DProc proc = NULL;
+
+    if (!resolved)
+    {
+        const char* extensions = (const char *)glGetString(GL_EXTENSIONS);
+
+        if (extensions != NULL && strstr(extensions, "GL_EXT_texture_compression_s3tc") != NULL)
+            proc = (CompressedTexImage2DProc)glutGetProcAddress("glCompressedTexImage2D");
+
+        if (proc == NULL)
+            fprintf(stderr, "Warning: S3TC texture compression is unsupported; Baked textures are decoded from their source images instead.\n");
+
+        resolved = true;
+    }
+    return proc;
+}
+
+// Returns glCompressedTexSubImage2D, or NULL if DXT1 textures are unsupported (see `getCompressedTexImage2D`).
+CompressedTexSubImage2DProc getCompressedTexSubImage2D(void)
+{
+    static bool resolved = false;
+    static CompressedTexSubImage2DProc proc = NULL;
+
+    if (!resolved)
+    {
+        if (getCompressedTexImage2D() != NULL)
+            proc = (CompressedTexSubImage2DProc)glutGetProcAddress("glCompressedTexSubImage2D");
+
+        resolved = true;
+    }
+    return proc;
+}
+
+// Returns the buffer object entry points if the driver supports pixel buffer objects, NULL otherwise.
+// Must be called from the GL thread (with a current context).
+const PixelBufferProcs* getPixelBufferProcs(void)
+{
+    static bool resolved = false;
+    static PixelBufferProcs procs;
+    static const PixelBufferProcs* supported = NULL;
+
+    if (!resolved)
+    {
+        const char* version = (const char *)glGetString(GL_VERSION);
+        const char* extensions = (const char *)glGetString(GL_EXTENSIONS);
+
+        int major = 0, minor = 0;
+
+        if (version != NULL)
+            sscanf(version, "%d.%d", &major, &minor);
+
+        bool available = (major > 2 || (major == 2 && minor >= 1));
+
+        if (!available && extensions != NULL)
+            available = (strstr(extensions, "GL_ARB_pixel_buffer_object") != NULL);
+
+        if (available)
+        {
+            // Through a prototyped function pointer, which converts to any other without a warning
+            // (unlike `GLUTproc`, which is unprototyped on some platforms).
+            procs.genBuffers = (void (APIENTRY *)(GLsizei, GLuint*))(void (*)(void))glutGetProcAddress("glGenBuffers");
+            procs.deleteBuffers = (void (APIENTRY *)(GLsizei, const GLuint*))(void (*)(void))glutGetProcAddress("glDeleteBuffers");
+            procs.bindBuffer = (void (APIENTRY *)(GLenum, GLuint))(void (*)(void))glutGetProcAddress("glBindBuffer");
+            procs.bufferData = (void (APIENTRY *)(GLenum, ptrdiff_t, const void*, GLenum))(void (*)(void))glutGetProcAddress("glBufferData");
+            procs.mapBuffer = (void* (APIENTRY *)(GLenum, GLenum))(void (*)(void))glutGetProcAddress("glMapBuffer");
+            procs.unmapBuffer = (GLboolean (APIENTRY *)(GLenum))(void (*)(void))glutGetProcAddress("glUnmapBuffer");
+
+            if (procs.genBuffers != NULL && procs.deleteBuffers != NULL && procs.bindBuffer != NULL &&
+                procs.bufferData != NULL && procs.mapBuffer != NULL && procs.unmapBuffer != NULL)
+                supported = &procs;
+        }
+
+        resolved = true;
+    }
+    return supported;
+}
+
+// Whether the driver supports cube map textures (OpenGL 1.3). Must be called from the GL thread.
+bool isCubeMapSupported(void)
+{
+    static bool resolved = false;
+    static bool supported = false;
+
+    if (!resolved)
+    {
+        const char* version = (const char *)glGetString(GL_VERSION);
+        const char* extensions = (const char *)glGetString(GL_EXTENSIONS);
+
+        int major = 0, minor = 0;
+
+        if (version != NULL)
+            sscanf(version, "%d.%d", &major, &minor);
+
+        supported = (major > 1 || (major == 1 && minor >= 3));
+
+        if (!supported && extensions != NULL)
+            supported = (strstr(extensions, "GL_ARB_texture_cube_map") != NULL);
+
+        resolved = true;
+    }
+    return supported;
+}
+
+// Sets the sampling of the bound texture: trilinear filtering over its mip chain if it has one,
+// linear filtering otherwise, and repeated wrapping.
+void setTextureSampling(unsigned int num_levels)
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)num_levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (num_levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+// Whether the driver supports the baked texture's format, whether uploaded at once or streamed.
+// Must be called from the GL thread.
+bool isPackedTextureSupported(const PackedTexture* t)
+{
+    return (t->format != PACKED_FORMAT_DXT1 || getCompressedTexSubImage2D() != NULL);
+}
+
+// Uploads a baked texture with all its mip levels, straight from the pack's mapping. Returns false
+// (creating no texture) if its format is not supported by the driver. Must be called from the GL thread.
+bool uploadPackedTexture(const TexturePack* pack, const PackedTexture* t, GLuint* textureID)
+{
+    if (!isPackedTextureSupported(t))
+    {
+        *textureID = 0;
+        return false;
+    }
+
+    CompressedTexImage2DProc compressedTexImage2D = getCompressedTexImage2D();
+
+    glEnable(GL_TEXTURE_2D);
+    glGenTextures(1, textureID);
+    glBindTexture(GL_TEXTURE_2D, *textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    size_t bytes = 0;
+
+    for (unsigned int l = 0; l < t->numLevels; ++l)
+    {
+        const void* data = pack->file->data + t->levelOffsets[l];
+
+        GLsizei width = (GLsizei)getMipLevelDimension(t->width, l);
+        GLsizei height = (GLsizei)getMipLevelDimension(t->height, l);
+
+        if (t->format == PACKED_FORMAT_DXT1)
+            compressedTexImage2D(GL_TEXTURE_2D, (GLint)l, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, width, height, 0, (GLsizei)t->levelSizes[l], data);
+        else
+            glTexImage2D(GL_TEXTURE_2D, (GLint)l, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
+
+        bytes += estimateTextureLevelBytes((unsigned int)width, (unsigned int)height, t->format == PACKED_FORMAT_DXT1);
+    }
+
+    setTextureSampling(t->numLevels);
+
+    trackTextureMemory(*textureID, bytes);
+
+    return true;
+}
+
+// Uploads a texture synchronously, from the `texture_pack` if it has it, or else by loading its
+// image (see `loadImage`); see `TextureLoader.h` for the asynchronous counterpart.
+bool registerTexture(const char* filename, GLuint* textureID)
+{
+    // Baked textures come first.
+    const PackedTexture* packed = (texture_pack != NULL ? findPackedTexture(texture_pack, filename) : NULL);
+
+    if (packed != NULL && uploadPackedTexture(texture_pack, packed, textureID))
+        return true;
+
+    BitmapImage* image = loadImage(filename);
+
+    // TODO: improve error handling
+    if (image == NULL) 
+    {
+        *textureID = 0;
+        return false;
+    }
+
+    uploadBitmapTexture(image, textureID);
+
+    // Release the pixels (or unmap the bitmap) after upload.
+    deleteBitmapImage(image);
 
     return true;
 }
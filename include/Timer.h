@@ -37,6 +37,19 @@ uint64_t getAbsoluteTimeMillis()
     return sec + ms;
 }
 
+// Microsecond resolution counterpart of `getAbsoluteTimeMillis`, used for profiling frames.
+uint64_t getAbsoluteTimeMicros()
+{
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+
+    uint64_t sec = ((uint64_t)(ts.tv_sec)) * 1000000;
+    uint64_t us = ((uint64_t)(ts.tv_nsec)) / 1000;
+
+    return sec + us;
+}
+
 
 Timer* initTimer(const char* name)
 {
@@ -0,0 +1,205 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#if defined(_MSC_VER) && !defined(_USE_MATH_DEFINES)
+#   define _USE_MATH_DEFINES
+#endif
+
+#include <math.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "CustomTypes.h"
+
+
+// All matrices are 4x4, stored in column-major order so that they can be handed
+// to `glLoadMatrixf` directly. The functions mirror their fixed-function counterparts
+// (`glTranslatef`, `glRotatef`, `gluPerspective`, `gluLookAt`), but write into plain
+// arrays instead of OpenGL's matrix stack, so that the results can be cached.
+
+
+void matrixIdentity4f(matrix4f m)
+{
+    static const matrix4f identity = {
+        1.0f, .0f, .0f, .0f,
+        .0f, 1.0f, .0f, .0f,
+        .0f, .0f, 1.0f, .0f,
+        .0f, .0f, .0f, 1.0f
+    };
+    memcpy(m, identity, sizeof(matrix4f));
+}
+
+// prod = A * B; `prod` may alias neither A nor B.
+void matrixMultiply4f(matrix4f prod, const matrix4f A, const matrix4f B)
+{
+    for (int col = 0; col < 4; ++col)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            prod[4 * col + row] =
+                A[4 * 0 + row] * B[4 * col + 0] +
+                A[4 * 1 + row] * B[4 * col + 1] +
+                A[4 * 2 + row] * B[4 * col + 2] +
+                A[4 * 3 + row] * B[4 * col + 3];
+        }
+    }
+}
+
+void matrixTranslation4f(matrix4f m, float x, float y, float z)
+{
+    matrixIdentity4f(m);
+    m[12] = x;
+    m[13] = y;
+    m[14] = z;
+}
+
+// Equivalent of `glRotatef`; the angle is in degrees and (x, y, z) need not be normalized.
+void matrixRotation4f(matrix4f m, float degrees, float x, float y, float z)
+{
+    float len = sqrtf(x * x + y * y + z * z);
+
+    matrixIdentity4f(m);
+
+    if (len == .0f)
+        return;
+
+    x /= len;
+    y /= len;
+    z /= len;
+
+    float c = (float)cos((double)degrees * (M_PI / 180.0));
+    float s = (float)sin((double)degrees * (M_PI / 180.0));
+    float t = 1.0f - c;
+
+    m[0] = x * x * t + c;
+    m[1] = y * x * t + z * s;
+    m[2] = x * z * t - y * s;
+
+    m[4] = x * y * t - z * s;
+    m[5] = y * y * t + c;
+    m[6] = y * z * t + x * s;
+
+    m[8] = x * z * t + y * s;
+    m[9] = y * z * t - x * s;
+    m[10] = z * z * t + c;
+}
+
+void matrixScaling4f(matrix4f m, float x, float y, float z)
+{
+    matrixIdentity4f(m);
+    m[0] = x;
+    m[5] = y;
+    m[10] = z;
+}
+
+// Equivalent of `gluPerspective`; `fovy` is in degrees.
+void matrixPerspective4f(matrix4f m, double fovy, double aspect, double z_near, double z_far)
+{
+    double f = 1.0 / tan(fovy * (M_PI / 360.0));
+
+    memset(m, 0, sizeof(matrix4f));
+
+    m[0] = (float)(f / aspect);
+    m[5] = (float)f;
+    m[10] = (float)((z_far + z_near) / (z_near - z_far));
+    m[11] = -1.0f;
+    m[14] = (float)((2.0 * z_far * z_near) / (z_near - z_far));
+}
+
+// Equivalent of `gluLookAt`. Computed in double precision, since the eye
+// may lie far away from the origin of the global coordinate system.
+void matrixLookAt4f(matrix4f m, const vector3r eye, const vector3r centre, const vector3r up)
+{
+    double f[3] = {
+        (double)(centre[0] - eye[0]),
+        (double)(centre[1] - eye[1]),
+        (double)(centre[2] - eye[2])
+    };
+    double len = sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+
+    f[0] /= len;
+    f[1] /= len;
+    f[2] /= len;
+
+    // s = f x up
+    double s[3] = {
+        f[1] * (double)up[2] - f[2] * (double)up[1],
+        f[2] * (double)up[0] - f[0] * (double)up[2],
+        f[0] * (double)up[1] - f[1] * (double)up[0]
+    };
+    len = sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+
+    s[0] /= len;
+    s[1] /= len;
+    s[2] /= len;
+
+    // u = s x f
+    double u[3] = {
+        s[1] * f[2] - s[2] * f[1],
+        s[2] * f[0] - s[0] * f[2],
+        s[0] * f[1] - s[1] * f[0]
+    };
+
+    m[0] = (float)s[0];
+    m[4] = (float)s[1];
+    m[8] = (float)s[2];
+
+    m[1] = (float)u[0];
+    m[5] = (float)u[1];
+    m[9] = (float)u[2];
+
+    m[2] = (float)(-f[0]);
+    m[6] = (float)(-f[1]);
+    m[10] = (float)(-f[2]);
+
+    m[3] = .0f;
+    m[7] = .0f;
+    m[11] = .0f;
+
+    m[12] = (float)(-(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]));
+    m[13] = (float)(-(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]));
+    m[14] = (float)(f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2]);
+    m[15] = 1.0f;
+}
+
+// Extracts the six clipping planes (left, right, bottom, top, near, far) of a view-projection
+// matrix, normalized and facing inwards: (a, b, c, d) such that a*x + b*y + c*z + d >= 0 inside.
+void extractFrustumPlanes4f(vector4f planes[6], const matrix4f m)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int k = 0; k < 4; ++k)
+        {
+            // Row 3 of the matrix plus (or minus) row i.
+            planes[2 * i + 0][k] = m[4 * k + 3] + m[4 * k + i];
+            planes[2 * i + 1][k] = m[4 * k + 3] - m[4 * k + i];
+        }
+    }
+
+    for (int i = 0; i < 6; ++i)
+    {
+        float len = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+
+        if (len > .0f)
+        {
+            planes[i][0] /= len;
+            planes[i][1] /= len;
+            planes[i][2] /= len;
+            planes[i][3] /= len;
+        }
+    }
+}
+
+// Returns false if the sphere lies entirely outside one of the planes (see `extractFrustumPlanes4f`);
+// conservative near the frustum's corners.
+bool isSphereInFrustum(const vector4f planes[6], float x, float y, float z, float radius)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        if (planes[i][0] * x + planes[i][1] * y + planes[i][2] * z + planes[i][3] < -radius)
+            return false;
+    }
+    return true;
+}
+
+#endif // TRANSFORM_H
@@ -0,0 +1,682 @@
+#ifndef UNIVERSE_H
+#define UNIVERSE_H
+
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <cJSON.h>
+#include <GL/glut.h>
+
+#include "Arena.h"
+#include "Camera.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "CustomTypes.h"
+#include "SystemBinary.h"
+#include "StellarObject.h"
+#include "StellarCatalog.h"
+#include "TextRendering.h"
+
+
+// Several systems at once, placed at interstellar distances from each other by a universe file:
+//
+//     {
+//         "activation_radius" : <float_value>,
+//         "systems" : [
+//             { "directory" : <string_value>, "position" : [ <x>, <y>, <z> ], "color" : [ <r>, <g>, <b> ] },
+//             ...
+//         ]
+//     }
+//
+// Positions and the activation radius are in light-years; directories, unless absolute, are relative
+// to the universe file; the color (of the system's point, 0 to 255) is optional. Only the systems within the
+// activation radius of the camera are loaded and simulated, each in an arena of its own: a system is
+// parsed on a worker of the job system as soon as the camera comes close enough, its bodies are then
+// built on the GL thread with their textures streamed in like any other (see `TextureLoader.h`), and
+// it is released once the camera has moved away. The rest are drawn as points on the sky.
+//
+// Coordinates of the world are relative to the system that the camera is nearest to (the origin is
+// moved along with the camera, see `updateUniverse`), so that single-precision matrices stay precise
+// however far from the first system the camera is.
+
+// Astronomical units per light-year.
+#define UNIVERSE_LIGHT_YEAR_AU 63241.077
+
+#define UNIVERSE_DEFAULT_ACTIVATION_RADIUS 0.5
+
+// Loaded systems are released past this multiple of the activation radius, so that one at the
+// boundary is not paged in and out as the camera hovers around it.
+#define UNIVERSE_DEACTIVATION_FACTOR 1.25
+
+// Pixels across the point of a system that is not loaded.
+#define UNIVERSE_POINT_SIZE 4.0f
+
+typedef enum UniverseSystemState
+{
+    UNIVERSE_SYSTEM_UNLOADED = 0,
+
+    // Being parsed by a worker.
+    UNIVERSE_SYSTEM_LOADING,
+
+    UNIVERSE_SYSTEM_LOADED,
+
+    // Out of the simulation, released once its last textures have arrived.
+    UNIVERSE_SYSTEM_RETIRING
+
+} UniverseSystemState;
+
+typedef struct UniverseSystem
+{
+    // The directory, as named in the universe file.
+    char* name;
+
+    // The directory, followed by a separator, as expected by `loadAllStellarObjects`.
+    char* dataDir;
+
+    // Position in the universe, in world units.
+    vector3r position;
+
+    vector3ub color;
+
+    UniverseSystemState state;
+
+    // Set if the system could not be loaded, so that it is not attempted again.
+    bool failed;
+
+    // The parsing job, and its result: the system's binary file if it has an up-to-date one, its
+    // catalog otherwise (both NULL if neither could be read).
+    Job job;
+    JobCounter loading;
+
+    SystemBinary* binary;
+    StellarCatalog* catalog;
+
+    // The bodies, their names and texture requests, while the system is loaded or retiring.
+    Arena* arena;
+
+    StellarObject** bodies;
+    int numBodies;
+
+} UniverseSystem;
+
+typedef struct Universe
+{
+    UniverseSystem* systems;
+    int numSystems;
+
+    // In world units.
+    real_t activationRadius;
+
+    // Position in the universe of the world's origin, which is that of the system `originSystem`.
+    vector3r origin;
+    int originSystem;
+
+    JobSystem* jobSystem;
+
+    // Whether systems are loaded right away when the camera comes close enough, instead of over the
+    // following frames (e.g. so that recordings replay identically).
+    bool synchronous;
+
+    // The bodies of the loaded systems, in the order of the systems; rebuilt whenever one of them
+    // is loaded or released.
+    StellarObject** bodies;
+    int numBodies;
+
+    int numLoaded;
+    int numLoading;
+
+} Universe;
+
+
+bool readUniverseVector(const cJSON* array, real_t* v)
+{
+    if (!cJSON_IsArray(array) || cJSON_GetArraySize(array) != 3)
+        return false;
+
+    for (int a = 0; a < 3; ++a)
+    {
+        const cJSON* item = cJSON_GetArrayItem(array, a);
+
+        if (!cJSON_IsNumber(item))
+            return false;
+
+        v[a] = (real_t)item->valuedouble;
+    }
+    return true;
+}
+
+// Whether a universe file is given instead of a system directory.
+bool isUniverseFilename(const char* path)
+{
+    size_t length = strlen(path);
+
+    return (length >= 5 && strcmp(path + length - 5, ".json") == 0);
+}
+
+// Universe constructor (heap-allocated), from the given universe file; no system is loaded yet (see
+// `updateUniverse`). Returns NULL, after reporting the problem, if the file is missing or invalid.
+Universe* loadUniverse(const char* filename, JobSystem* js)
+{
+    MappedFile* file = openMappedFile(filename, true);
+
+    if (file == NULL || file->size == 0)
+    {
+        fprintf(stderr, "Error: Unable to open the universe file \"%s\".\n", filename);
+        closeMappedFile(file);
+        return NULL;
+    }
+
+    cJSON* json = cJSON_ParseWithLength(file->data, file->size);
+
+    closeMappedFile(file);
+
+    if (json == NULL)
+    {
+        const char *error_ptr = cJSON_GetErrorPtr();
+        if (error_ptr != NULL) {
+            fprintf(stderr, "Error: %s\n", error_ptr);
+        }
+        return NULL;
+    }
+
+    const cJSON* activation_radius = cJSON_GetObjectItemCaseSensitive(json, "activation_radius");
+    const cJSON* systems = cJSON_GetObjectItemCaseSensitive(json, "systems");
+
+    if (!cJSON_IsArray(systems) || cJSON_GetArraySize(systems) < 1)
+    {
+        fprintf(stderr, "Error: `systems` should be an array of at least 1 object; Inspect \"%s\".\n", filename);
+        cJSON_Delete(json);
+        return NULL;
+    }
+
+    Universe* u = (Universe *)malloc(sizeof(Universe));
+
+    u->numSystems = 0;
+    u->systems = (UniverseSystem *)calloc((size_t)cJSON_GetArraySize(systems), sizeof(UniverseSystem));
+
+    double radius = (cJSON_IsNumber(activation_radius) && activation_radius->valuedouble > .0 ? activation_radius->valuedouble : UNIVERSE_DEFAULT_ACTIVATION_RADIUS);
+
+    u->activationRadius = AUtoR((real_t)(radius * UNIVERSE_LIGHT_YEAR_AU));
+    u->jobSystem = js;
+    u->synchronous = false;
+    u->bodies = NULL;
+    u->numBodies = 0;
+    u->numLoaded = 0;
+    u->numLoading = 0;
+
+    // Directories are relative to the universe file's.
+    const char* base_end = filename + strlen(filename);
+
+    while (base_end > filename && base_end[-1] != '/' && base_end[-1] != '\\')
+        --base_end;
+
+    char* base = strBuild(filename);
+    base[base_end - filename] = '\0';
+
+    static const char* error_field_message = "Error: Universe system idx.#%d - `%s` field is invalid; Inspect \"%s\".\n";
+
+    const cJSON* iterator = NULL;
+
+    cJSON_ArrayForEach(iterator, systems)
+    {
+        UniverseSystem* s = &u->systems[u->numSystems];
+
+        const cJSON* directory = cJSON_GetObjectItemCaseSensitive(iterator, "directory");
+        const cJSON* position = cJSON_GetObjectItemCaseSensitive(iterator, "position");
+        const cJSON* color = cJSON_GetObjectItemCaseSensitive(iterator, "color");
+
+        vector3r rgb = { (real_t)255, (real_t)255, (real_t)255 };
+
+        const char* error_field = NULL;
+
+        if (!cJSON_IsString(directory) || directory->valuestring == NULL || directory->valuestring[0] == '\0')
+            error_field = "directory";
+
+        else if (!readUniverseVector(position, s->position))
+            error_field = "position";
+
+        else if (color != NULL && !readUniverseVector(color, rgb))
+            error_field = "color";
+
+        if (error_field != NULL)
+        {
+            fprintf(stderr, error_field_message, u->numSystems, error_field, filename);
+
+            for (int i = 0; i < u->numSystems; ++i)
+            {
+                free(u->systems[i].name);
+                free(u->systems[i].dataDir);
+            }
+
+            cJSON_Delete(json);
+            free(base);
+            free(u->systems);
+            free(u);
+            return NULL;
+        }
+
+        const char* name = directory->valuestring;
+        size_t length = strlen(name);
+
+        bool separated = (name[length - 1] == '/' || name[length - 1] == '\\');
+        bool absolute = (name[0] == '/' || name[0] == '\\' || (length > 1 && name[1] == ':'));
+
+        s->name = strBuild(name);
+        s->dataDir = strCat(3, (absolute ? "" : base), name, (separated ? "" : "/"));
+
+        for (int a = 0; a < 3; ++a)
+        {
+            s->position[a] = AUtoR((real_t)(s->position[a] * UNIVERSE_LIGHT_YEAR_AU));
+            s->color[a] = (ubyte_t)fmin(fmax((double)rgb[a], 0.0), 255.0);
+        }
+
+        s->state = UNIVERSE_SYSTEM_UNLOADED;
+        s->failed = false;
+
+        initJobCounter(&s->loading);
+
+        u->numSystems += 1;
+    }
+
+    cJSON_Delete(json);
+    free(base);
+
+    // The world starts out centred on the first system.
+    u->originSystem = 0;
+    memcpy(u->origin, u->systems[0].position, sizeof(vector3r));
+
+    return u;
+}
+
+// Distance of a system from a point of the world.
+real_t getUniverseSystemDistance(const Universe* u, const UniverseSystem* s, const vector3r point)
+{
+    vector3r d;
+
+    for (int a = 0; a < 3; ++a)
+        d[a] = s->position[a] - u->origin[a] - point[a];
+
+    return vectorLength3rv(d);
+}
+
+// Parses a system (a job, on a worker).
+void loadUniverseSystemJob(void* data)
+{
+    UniverseSystem* s = (UniverseSystem *)data;
+
+    char* json_filename = strCat(2, s->dataDir, "data.json");
+    char* binary_filename = strCat(2, s->dataDir, "data.bin");
+
+    s->binary = openSystemBinary(binary_filename, json_filename);
+    s->catalog = (s->binary == NULL ? parseStellarCatalog(json_filename, NULL, NULL) : NULL);
+
+    free(binary_filename);
+    free(json_filename);
+}
+
+void beginUniverseSystemLoad(Universe* u, UniverseSystem* s)
+{
+    s->state = UNIVERSE_SYSTEM_LOADING;
+    s->binary = NULL;
+    s->catalog = NULL;
+
+    s->job.function = loadUniverseSystemJob;
+    s->job.data = s;
+
+    submitBackgroundJob(u->jobSystem, &s->job, &s->loading);
+
+    u->numLoading += 1;
+}
+
+// Places the roots of a system's bodies around its position in the world.
+void placeUniverseSystem(const Universe* u, UniverseSystem* s)
+{
+    for (int i = 0; i < s->numBodies; ++i)
+    {
+        StellarObject* p = s->bodies[i];
+
+        if (p->parent != NULL)
+            continue;
+
+        for (int a = 0; a < 3; ++a)
+            p->origin[a] = s->position[a] - u->origin[a];
+
+        p->transformDirty = true;
+    }
+}
+
+// Builds the bodies of a parsed system, in an arena of its own, and requests their textures. Must
+// be called from the GL thread.
+void finishUniverseSystemLoad(Universe* u, UniverseSystem* s)
+{
+    u->numLoading -= 1;
+
+    s->bodies = NULL;
+    s->numBodies = 0;
+
+    if (s->binary != NULL || s->catalog != NULL)
+    {
+        Arena* arena = stellar_arena;
+
+        s->arena = initArena(MEMORY_TAG_BODIES, 0);
+        stellar_arena = s->arena;
+
+        StellarTextureRequests textures = { s->dataDir, NULL, 0 };
+
+        if (s->binary != NULL)
+        {
+            s->bodies = loadStellarObjectsFromBinary(s->binary, &textures);
+            s->numBodies = s->binary->numObjects;
+        }
+        else
+        {
+            s->bodies = loadStellarObjectsFromCatalog(s->catalog, &textures);
+            s->numBodies = s->catalog->count;
+        }
+
+        stellar_arena = arena;
+    }
+
+    closeSystemBinary(s->binary);
+    deleteStellarCatalog(s->catalog);
+
+    s->binary = NULL;
+    s->catalog = NULL;
+
+    if (s->bodies == NULL)
+    {
+        fprintf(stderr, "Warning: Could not load the system \"%s\"; Showing it as a point.\n", s->name);
+
+        s->state = UNIVERSE_SYSTEM_UNLOADED;
+        s->failed = true;
+        return;
+    }
+
+    placeUniverseSystem(u, s);
+
+    s->state = UNIVERSE_SYSTEM_LOADED;
+    u->numLoaded += 1;
+
+    printf("Loaded %d bodies of \"%s\".\n", s->numBodies, s->name);
+}
+
+// Whether none of a system's textures are still loading, i.e. whether it can be released.
+bool isUniverseSystemSettled(const UniverseSystem* s)
+{
+    for (int i = 0; i < s->numBodies; ++i)
+    {
+        if (s->bodies[i]->pendingTexture != NULL)
+            return false;
+    }
+    return true;
+}
+
+// Releases a system's bodies, their textures and their arena. Must be called from the GL thread.
+void unloadUniverseSystem(UniverseSystem* s)
+{
+    Arena* arena = stellar_arena;
+
+    stellar_arena = s->arena;
+
+    deleteStellarObjects(s->bodies, s->numBodies);
+    deleteArena(s->arena);
+
+    stellar_arena = arena;
+
+    s->arena = NULL;
+    s->bodies = NULL;
+    s->numBodies = 0;
+    s->state = UNIVERSE_SYSTEM_UNLOADED;
+}
+
+// Pages systems in and out as the camera moves, and moves the world's origin to the loaded system
+// nearest to the camera (moving the camera along). Returns true if the set of loaded bodies changed
+// (`bodies` has been rebuilt), in which case whatever refers to them must be rebuilt too. A camera
+// anchored to a body that is released is set free. `shift` (if not NULL) is set to how far the
+// origin moved, which whatever else holds world positions must subtract from them; zero if it did
+// not. Must be called once per frame, from the GL thread, before the bodies are updated.
+bool updateUniverse(Universe* u, Camera* camera, vector3r shift)
+{
+    bool changed = false;
+
+    if (shift != NULL)
+        memset(shift, 0, sizeof(vector3r));
+
+    for (int i = 0; i < u->numSystems; ++i)
+    {
+        UniverseSystem* s = &u->systems[i];
+
+        real_t distance = getUniverseSystemDistance(u, s, camera->position);
+
+        bool inside = (distance <= u->activationRadius);
+        bool outside = (distance > u->activationRadius * (real_t)UNIVERSE_DEACTIVATION_FACTOR);
+
+        if (s->state == UNIVERSE_SYSTEM_UNLOADED && inside && !s->failed)
+        {
+            beginUniverseSystemLoad(u, s);
+
+            if (u->synchronous)
+                waitForJobs(u->jobSystem, &s->loading);
+        }
+
+        if (s->state == UNIVERSE_SYSTEM_LOADING && isJobCounterDone(&s->loading))
+        {
+            if (!outside)
+            {
+                finishUniverseSystemLoad(u, s);
+                changed = true;
+            }
+            else
+            {
+                // The camera has already moved on.
+                closeSystemBinary(s->binary);
+                deleteStellarCatalog(s->catalog);
+
+                s->binary = NULL;
+                s->catalog = NULL;
+                s->state = UNIVERSE_SYSTEM_UNLOADED;
+
+                u->numLoading -= 1;
+            }
+        }
+        else if (s->state == UNIVERSE_SYSTEM_LOADED && outside)
+        {
+            for (int j = 0; j < s->numBodies && camera->anchor != NULL; ++j)
+            {
+                if (camera->anchor == s->bodies[j])
+                    camera->anchor = NULL;
+            }
+
+            s->state = UNIVERSE_SYSTEM_RETIRING;
+            u->numLoaded -= 1;
+            changed = true;
+        }
+        else if (s->state == UNIVERSE_SYSTEM_RETIRING)
+        {
+            if (!outside)
+            {
+                placeUniverseSystem(u, s);
+
+                s->state = UNIVERSE_SYSTEM_LOADED;
+                u->numLoaded += 1;
+                changed = true;
+            }
+            else if (isUniverseSystemSettled(s))
+            {
+                unloadUniverseSystem(s);
+            }
+        }
+    }
+
+    // The world's origin follows the camera from one loaded system to the next.
+    int nearest = -1;
+    real_t nearest_distance = (real_t)INFINITY;
+
+    for (int i = 0; i < u->numSystems; ++i)
+    {
+        real_t distance = getUniverseSystemDistance(u, &u->systems[i], camera->position);
+
+        if (u->systems[i].state == UNIVERSE_SYSTEM_LOADED && distance < nearest_distance)
+        {
+            nearest = i;
+            nearest_distance = distance;
+        }
+    }
+
+    if (nearest >= 0 && nearest != u->originSystem)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            real_t d = u->systems[nearest].position[a] - u->origin[a];
+
+            if (shift != NULL)
+                shift[a] = d;
+
+            u->origin[a] = u->systems[nearest].position[a];
+            camera->position[a] -= d;
+        }
+
+        u->originSystem = nearest;
+
+        for (int i = 0; i < u->numSystems; ++i)
+        {
+            if (u->systems[i].state == UNIVERSE_SYSTEM_LOADED || u->systems[i].state == UNIVERSE_SYSTEM_RETIRING)
+                placeUniverseSystem(u, &u->systems[i]);
+        }
+    }
+
+    if (changed)
+    {
+        u->numBodies = 0;
+
+        for (int i = 0; i < u->numSystems; ++i)
+        {
+            if (u->systems[i].state == UNIVERSE_SYSTEM_LOADED)
+                u->numBodies += u->systems[i].numBodies;
+        }
+
+        u->bodies = (StellarObject **)trackedRealloc(MEMORY_TAG_BODIES, u->bodies, ((size_t)u->numBodies + 1) * sizeof(StellarObject *));
+
+        int n = 0;
+
+        for (int i = 0; i < u->numSystems; ++i)
+        {
+            const UniverseSystem* s = &u->systems[i];
+
+            if (s->state == UNIVERSE_SYSTEM_LOADED)
+            {
+                memcpy(u->bodies + n, s->bodies, (size_t)s->numBodies * sizeof(StellarObject *));
+                n += s->numBodies;
+            }
+        }
+    }
+
+    return changed;
+}
+
+// Draws the systems farther than the render distance as points on the sky, with their names. The
+// camera's view-projection matrix is expected to be loaded into GL_PROJECTION already.
+void renderUniverse(const Universe* u, const Camera* camera)
+{
+    // On the sky sphere (see `AmbientStars.h`).
+    real_t sky_radius = camera->renderDistance * (real_t)0.8;
+
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_POINT_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glDisable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    glDepthMask(GL_FALSE);
+    glPointSize(UNIVERSE_POINT_SIZE);
+
+    for (int i = 0; i < u->numSystems; ++i)
+    {
+        const UniverseSystem* s = &u->systems[i];
+
+        real_t distance = getUniverseSystemDistance(u, s, camera->position);
+
+        if (distance <= sky_radius)
+            continue;
+
+        float p[3];
+
+        for (int a = 0; a < 3; ++a)
+            p[a] = (float)(camera->position[a] + (s->position[a] - u->origin[a] - camera->position[a]) * (sky_radius / distance));
+
+        glColor3ubv(s->color);
+
+        glBegin(GL_POINTS);
+        glVertex3fv(p);
+        glEnd();
+        countDrawCalls(1);
+
+        renderStringInWorld(p[0], p[1], p[2], GLUT_BITMAP_9_BY_15, s->name, 0xFF, 0xFF, 0xFF);
+    }
+
+    glPopAttrib();
+    glPopMatrix();
+}
+
+// Formats the HUD's line about the universe: how many systems are loaded, and the nearest one.
+void formatUniverseStatus(const Universe* u, const Camera* camera, char* buffer, size_t size)
+{
+    int nearest = 0;
+
+    for (int i = 1; i < u->numSystems; ++i)
+    {
+        if (getUniverseSystemDistance(u, &u->systems[i], camera->position) < getUniverseSystemDistance(u, &u->systems[nearest], camera->position))
+            nearest = i;
+    }
+
+    double light_years = (double)RtoAU(getUniverseSystemDistance(u, &u->systems[nearest], camera->position)) / UNIVERSE_LIGHT_YEAR_AU;
+
+    snprintf(
+        buffer, size, "Systems: %d loaded, %d loading, of %d (%d bodies); nearest %s (%.4lf ly)",
+        u->numLoaded, u->numLoading, u->numSystems, u->numBodies, u->systems[nearest].name, light_years
+    );
+}
+
+// Releases every system, waiting for those still being parsed. Textures still loading must have
+// been handed over to their bodies already (see `deleteTextureLoader`).
+void deleteUniverse(Universe* u)
+{
+    if (u == NULL)
+        return;
+
+    for (int i = 0; i < u->numSystems; ++i)
+    {
+        UniverseSystem* s = &u->systems[i];
+
+        if (s->state == UNIVERSE_SYSTEM_LOADING)
+        {
+            while (!isJobCounterDone(&s->loading))
+                thrd_yield();
+
+            closeSystemBinary(s->binary);
+            deleteStellarCatalog(s->catalog);
+        }
+        else if (s->state == UNIVERSE_SYSTEM_LOADED || s->state == UNIVERSE_SYSTEM_RETIRING)
+        {
+            unloadUniverseSystem(s);
+        }
+
+        free(s->name);
+        free(s->dataDir);
+    }
+
+    trackedFree(u->bodies);
+    free(u->systems);
+    free(u);
+}
+
+#endif // UNIVERSE_H
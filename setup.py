@@ -1,6 +1,5 @@
 from sys import argv
 from platform import system as pl_system
-from PIL import Image
 
 import os
 import stat
@@ -64,7 +63,10 @@ def onerror_handler(func, path: str, exc_info):
         raise Exception(exc_info)
 
 
-def execute_binaries_msvc(sln_dir_abs: str, sln_name: str) -> bool:
+def execute_binaries_msvc(sln_dir_abs: str, sln_name: str, target_name: str = None) -> bool:
+
+    if target_name is None:
+        target_name = sln_name
 
     if os.path.exists(f"./build/Release/{sln_name}.dll"):
         print(f"Warning: Dependency \"{sln_name}\" has already been built; `--build-depend` is ignored.")
@@ -73,7 +75,7 @@ def execute_binaries_msvc(sln_dir_abs: str, sln_name: str) -> bool:
     # Build FreeGLUT from source using the generated solution and MSVC
     command = "cmd.exe /c vcvarsall.bat x64 && "
     command += f"cd {sln_dir_abs} && "
-    command += f"msbuild {sln_name}.sln /p:Configuration=Release /p:Platform=x64 /t:{sln_name}"
+    command += f"msbuild {sln_name}.sln /p:Configuration=Release /p:Platform=x64 /t:{target_name}"
 
     # MSVC's environment variables must be loaded before build process 
     msvc_dir = f"C:\\Program Files\\Microsoft Visual Studio\\"
@@ -148,36 +150,16 @@ if __name__ == '__main__':
                 for stellarObjectBitamp in bitmapTextureFiles:
                     os.remove(f"./data/{astro_dir}/{stellarObjectBitamp}")
 
+                if os.path.exists(f"./data/{astro_dir}/data.bin"):
+                    os.remove(f"./data/{astro_dir}/data.bin")
+
+                if os.path.exists(f"./data/{astro_dir}/textures.pack"):
+                    os.remove(f"./data/{astro_dir}/textures.pack")
+
         # Exit gracefully
         exit()
 
     
-    astro_system_dirs = [x for x in os.listdir("./data") if os.path.isdir(f"./data/{x}")]
-    
-    for astro_dir in astro_system_dirs:
-        
-        jpegTextureFiles = [x for x in os.listdir(f"./data/{astro_dir}") if x.endswith(".jpg")]
-        
-        for stellarObjectJpeg in jpegTextureFiles:
-            
-            obj_name = stellarObjectJpeg.removesuffix('.jpg')
-            input_path = f"./data/{astro_dir}/{obj_name}.jpg"
-            output_path = f"./data/{astro_dir}/{obj_name}.bmp"
-            
-            if os.path.exists(output_path):
-                # Texture has already been converted from JPEG to BMP.
-                continue
-            
-            try:
-                print(f"Converting {obj_name}'s texture from JPEG to Bitmap...")
-                
-                with Image.open(input_path) as img:
-                    img.save(output_path, format="BMP")
-                    
-            except Exception as e:
-                print(f"An error occurred while converting {stellarObjectJpeg} to bitmap: {e}")
-
-    
     if not os.path.exists("./dependencies"):
         os.mkdir("./dependencies")
     
@@ -243,6 +225,55 @@ if __name__ == '__main__':
             ):
                 exit(1)
 
+            # Compile the data.json to data.bin converter
+            if not execute_binaries_msvc(
+                sln_dir_abs=f"{os.getcwd()}\\build", 
+                sln_name="solar_system",
+                target_name="convert_system"
+            ):
+                exit(1)
+
+            # Compile the texture baker
+            if not execute_binaries_msvc(
+                sln_dir_abs=f"{os.getcwd()}\\build", 
+                sln_name="solar_system",
+                target_name="bake_textures"
+            ):
+                exit(1)
+
+            # Compile the ephemeris exporter
+            if not execute_binaries_msvc(
+                sln_dir_abs=f"{os.getcwd()}\\build", 
+                sln_name="solar_system",
+                target_name="export_ephemeris"
+            ):
+                exit(1)
+
+            # Compile the event search
+            if not execute_binaries_msvc(
+                sln_dir_abs=f"{os.getcwd()}\\build", 
+                sln_name="solar_system",
+                target_name="find_events"
+            ):
+                exit(1)
+
+            # Compile the telemetry reader example
+            if not execute_binaries_msvc(
+                sln_dir_abs=f"{os.getcwd()}\\build", 
+                sln_name="solar_system",
+                target_name="telemetry_reader"
+            ):
+                exit(1)
+
+            # Compile the benchmarks
+            for benchmark in ["bench_bitmap", "bench_jobs", "bench_telemetry"]:
+                if not execute_binaries_msvc(
+                    sln_dir_abs=f"{os.getcwd()}\\build", 
+                    sln_name="solar_system",
+                    target_name=benchmark
+                ):
+                    exit(1)
+
         if "-run" in argv:
             
             # Load the program's user preferences.
@@ -252,6 +283,20 @@ if __name__ == '__main__':
             astro_system_dir = astro_system_dir[0].removeprefix('/planets:')
             astro_system_dir = f"{os.getcwd()}\\data\\{astro_system_dir}\\"
 
+            # Compile the system's data ahead of time, if the converter has been built.
+            if os.path.exists(".\\build\\Release\\convert_system.exe"):
+                subprocess.run(
+                    f".\\build\\Release\\convert_system.exe {astro_system_dir}", 
+                    check=True
+                )
+
+            # Bake the system's textures ahead of time, if the baker has been built.
+            if os.path.exists(".\\build\\Release\\bake_textures.exe"):
+                subprocess.run(
+                    f".\\build\\Release\\bake_textures.exe {astro_system_dir}", 
+                    check=True
+                )
+
             subprocess.run(
                 f".\\build\\Release\\solar_system.exe {constants} {astro_system_dir}", 
                 check=True
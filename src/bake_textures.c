@@ -0,0 +1,117 @@
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "Timer.h"
+#include "CustomTypes.h"
+#include "TexturePack.h"
+#include "ImageFormats.h"
+#include "StellarCatalog.h"
+
+
+// Bakes the textures of a system into a single pack (see `TexturePack.h`): the texture of every
+// body listed in `data.json` that has one, plus the sky texture.
+//
+// Usage: bake_textures <system_dir> [-raw]
+//
+// Levels are compressed to DXT1 unless `-raw` is given, in which case they are stored as plain BGR
+// (4 times larger, but lossless). The pack is written to `<system_dir>/textures.pack`; the system
+// directory must end with a path separator, as it does for the simulation.
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3 || (argc == 3 && strcmp(argv[2], "-raw") != 0))
+    {
+        fprintf(stderr, "Usage: %s <system_dir> [-raw]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char* directory = argv[1];
+
+    PackedTextureFormat format = (argc == 3 ? PACKED_FORMAT_BGR8 : PACKED_FORMAT_DXT1);
+
+    char* json_filename = strCat(2, directory, "data.json");
+    char* pack_filename = strCat(2, directory, TEXTURE_PACK_FILENAME);
+
+    StellarCatalog* catalog = parseStellarCatalog(json_filename, NULL, NULL);
+
+    if (catalog == NULL)
+    {
+        free(pack_filename);
+        free(json_filename);
+        return EXIT_FAILURE;
+    }
+
+    // Texture names, as the simulation requests them.
+    int num_names = catalog->names->count + 1;
+
+    const char** names = (const char **)malloc((size_t)num_names * sizeof(const char *));
+
+    for (int i = 0; i < catalog->names->count; ++i)
+        names[i] = getName(catalog->names, i);
+
+    names[num_names - 1] = "SKYBOX";
+
+    TexturePackInput* inputs = (TexturePackInput *)malloc((size_t)num_names * sizeof(TexturePackInput));
+
+    int count = 0;
+
+    uint64_t start = getAbsoluteTimeMicros();
+
+    for (int i = 0; i < num_names; ++i)
+    {
+        char* path = strCat(2, directory, names[i]);
+        char* source = findImageFile(path);
+
+        free(path);
+
+        // Bodies without a texture are simply rendered with their color.
+        if (source == NULL)
+            continue;
+
+        BitmapImage* image = loadImage(source);
+
+        if (image == NULL)
+        {
+            free(source);
+            continue;
+        }
+
+        inputs[count].name = names[i];
+        inputs[count].sourceFilename = source;
+        inputs[count].image = image;
+
+        printf("%-24s %5u x %-5u (%s)\n", names[i], image->width, image->height, source);
+
+        count += 1;
+    }
+
+    bool ok = writeTexturePack(pack_filename, inputs, count, format);
+
+    if (ok)
+    {
+        printf(
+            "Baked %d textures into \"%s\" in %.2lf s.\n",
+            count, pack_filename, (double)(getAbsoluteTimeMicros() - start) / 1e6
+        );
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        free((char *)inputs[i].sourceFilename);
+        deleteBitmapImage((BitmapImage *)inputs[i].image);
+    }
+
+    free(inputs);
+    free(names);
+
+    deleteStellarCatalog(catalog);
+
+    free(pack_filename);
+    free(json_filename);
+
+    return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
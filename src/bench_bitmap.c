@@ -0,0 +1,174 @@
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Timer.h"
+#include "BitmapImages.h"
+
+
+// Microbenchmark of the bitmap loaders: the original per-pixel `fgetc` loader, the current
+// `loadBitmapToRGBArray` (bulk mapping + row-wise BGR -> RGB swizzle) and `loadBitmapImage`,
+// whose pixels are used in place and uploaded with GL_BGR.
+//
+// Usage: bench_bitmap [image.bmp] [iterations]
+//
+// Without an image, a 4095x2048 24-bit bitmap (with row padding) is generated in the working directory.
+
+#define BENCH_DEFAULT_FILENAME "bench_bitmap.bmp"
+
+// The loader as it was before, kept for comparison.
+ubyte_t* loadBitmapPerPixel(const char* filename, unsigned int* width, unsigned int* height)
+{
+    BitmapFileHeader bmfh;
+    BitmapInfoHeader bmih;
+
+    FILE* fp = fopen(filename, "rb");
+
+    if (fp == NULL)
+        return NULL;
+
+    fread(&bmfh, sizeof(BitmapFileHeader), 1, fp);
+    fread(&bmih, sizeof(BitmapInfoHeader), 1, fp);
+
+    *width = bmih.biWidth;
+    *height = bmih.biHeight;
+
+    ubyte_t* image = (ubyte_t *)malloc((size_t)(*width) * (*height) * 3);
+
+    for (unsigned int y = 0; y < *height; y++)
+    {
+        size_t rowOffset = 3 * (size_t)(*width) * y;
+
+        for (unsigned int x = 0; x < *width; x++)
+        {
+            size_t offset = rowOffset + 3 * x;
+
+            image[offset + 2] = fgetc(fp);
+            image[offset + 1] = fgetc(fp);
+            image[offset + 0] = fgetc(fp);
+        }
+    }
+
+    fclose(fp);
+
+    return image;
+}
+
+bool writeBenchmarkBitmap(const char* filename, unsigned int width, unsigned int height)
+{
+    FILE* fp = fopen(filename, "wb");
+
+    if (fp == NULL)
+        return false;
+
+    size_t stride = ((size_t)width * 3 + 3) & ~(size_t)3;
+
+    BitmapFileHeader bmfh = { 0x4D42, 0, 0, 0, sizeof(BitmapFileHeader) + sizeof(BitmapInfoHeader) };
+    BitmapInfoHeader bmih = { sizeof(BitmapInfoHeader), (int)width, (int)height, 1, 24, 0, 0, 2835, 2835, 0, 0 };
+
+    bmfh.bfSize = (unsigned int)(bmfh.bfOffBits + stride * height);
+    bmih.biSizeImage = (unsigned int)(stride * height);
+
+    fwrite(&bmfh, sizeof(bmfh), 1, fp);
+    fwrite(&bmih, sizeof(bmih), 1, fp);
+
+    ubyte_t* row = (ubyte_t *)calloc(stride, 1);
+
+    for (unsigned int y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < (size_t)width * 3; ++x)
+            row[x] = (ubyte_t)(x * 7 + y * 13);
+
+        fwrite(row, 1, stride, fp);
+    }
+
+    free(row);
+    fclose(fp);
+
+    return true;
+}
+
+// Sums the pixels, so that lazily mapped pages are actually read.
+uint64_t checksumPixels(const ubyte_t* pixels, size_t size)
+{
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < size; ++i)
+        sum += pixels[i];
+
+    return sum;
+}
+
+void reportBenchmark(const char* name, uint64_t micros, int iterations, size_t bytes, uint64_t checksum)
+{
+    double seconds = (double)micros / 1e6;
+
+    printf(
+        "%-28s %9.2lf ms/load %10.1lf MB/s   (checksum %" PRIu64 ")\n",
+        name, seconds * 1000.0 / iterations, (double)bytes * iterations / (1024.0 * 1024.0) / seconds, checksum
+    );
+}
+
+int main(int argc, char** argv)
+{
+    const char* filename = (argc > 1 ? argv[1] : BENCH_DEFAULT_FILENAME);
+
+    int iterations = (argc > 2 ? atoi(argv[2]) : 5);
+
+    if (argc < 2 && !writeBenchmarkBitmap(filename, 4095, 2048))
+    {
+        fprintf(stderr, "Error: Unable to create \"%s\".\n", filename);
+        return EXIT_FAILURE;
+    }
+
+    BitmapImage* probe = loadBitmapImage(filename, true);
+
+    if (probe == NULL)
+        return EXIT_FAILURE;
+
+    size_t bytes = probe->rowStride * probe->height;
+
+    deleteBitmapImage(probe);
+
+    unsigned int width, height;
+
+    uint64_t checksum = 0;
+    uint64_t start = getAbsoluteTimeMicros();
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        ubyte_t* image = loadBitmapPerPixel(filename, &width, &height);
+        checksum = checksumPixels(image, (size_t)width * height * 3);
+        free(image);
+    }
+    reportBenchmark("fgetc per channel (before)", getAbsoluteTimeMicros() - start, iterations, bytes, checksum);
+
+    start = getAbsoluteTimeMicros();
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        ubyte_t* image = loadBitmapToRGBArray(filename, &width, &height, false);
+        checksum = checksumPixels(image, (size_t)width * height * 3);
+        free(image);
+    }
+    reportBenchmark("mapped + RGB swizzle", getAbsoluteTimeMicros() - start, iterations, bytes, checksum);
+
+    start = getAbsoluteTimeMicros();
+
+    for (int i = 0; i < iterations; ++i)
+    {
+        BitmapImage* image = loadBitmapImage(filename, false);
+        checksum = checksumPixels(image->pixels, image->rowStride * image->height);
+        deleteBitmapImage(image);
+    }
+    reportBenchmark("mapped, in place (GL_BGR)", getAbsoluteTimeMicros() - start, iterations, bytes, checksum);
+
+    if (argc < 2)
+        remove(filename);
+
+    return EXIT_SUCCESS;
+}
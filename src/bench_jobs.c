@@ -0,0 +1,187 @@
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include "Timer.h"
+#include "JobSystem.h"
+
+
+// Microbenchmark of the job system's scheduling overhead: jobs that do (almost) nothing are run
+// through each path of the system, and the time per job is compared against a plain function call.
+//
+// Usage: bench_jobs [workers] [jobs]
+//
+// Without arguments, one worker per additional processor and 1M jobs per test.
+
+#define BENCH_BATCH_SIZE 1024
+
+atomic_llong bench_checksum;
+
+void emptyJob(void* data)
+{
+    atomic_fetch_add_explicit(&bench_checksum, (long long)(intptr_t)data, memory_order_relaxed);
+}
+
+void emptyRange(void* data, int begin, int end)
+{
+    (void)data;
+
+    atomic_fetch_add_explicit(&bench_checksum, (long long)(end - begin), memory_order_relaxed);
+}
+
+// Submits its children from whichever thread runs it, so that the others have to steal them.
+typedef struct SpawnJobData
+{
+    JobSystem* js;
+
+    Job* children;
+
+    int numChildren;
+
+    JobCounter* counter;
+
+} SpawnJobData;
+
+void spawnJob(void* data)
+{
+    SpawnJobData* spawn = (SpawnJobData *)data;
+
+    submitJobs(spawn->js, spawn->children, spawn->numChildren, spawn->counter);
+}
+
+void reportBenchmark(const char* name, uint64_t micros, int num_jobs)
+{
+    printf(
+        "%-32s %9.1lf ns/job %12.2lf Mjobs/s   (checksum %lld)\n",
+        name, (double)micros * 1000.0 / num_jobs, (double)num_jobs / (double)(micros > 0 ? micros : 1),
+        (long long)atomic_exchange(&bench_checksum, 0)
+    );
+}
+
+int main(int argc, char** argv)
+{
+    int num_workers = (argc > 1 ? atoi(argv[1]) : -1);
+    int num_jobs = (argc > 2 ? atoi(argv[2]) : 1 << 20);
+
+    // Whole pairs of batches (see the dependent batches).
+    num_jobs -= num_jobs % (2 * BENCH_BATCH_SIZE);
+
+    if (num_jobs <= 0)
+        num_jobs = 2 * BENCH_BATCH_SIZE;
+
+    JobSystem* js = initJobSystem(num_workers);
+
+    printf("%d threads, %d jobs per test\n", getJobThreadCount(js), num_jobs);
+
+    Job* jobs = (Job *)malloc(BENCH_BATCH_SIZE * sizeof(Job));
+
+    for (int i = 0; i < BENCH_BATCH_SIZE; ++i)
+    {
+        jobs[i].function = emptyJob;
+        jobs[i].data = (void *)(intptr_t)1;
+    }
+
+    // Baseline: the jobs' functions called in a loop.
+    uint64_t start = getAbsoluteTimeMicros();
+
+    for (int i = 0; i < num_jobs; ++i)
+        jobs[i % BENCH_BATCH_SIZE].function(jobs[i % BENCH_BATCH_SIZE].data);
+
+    reportBenchmark("direct calls", getAbsoluteTimeMicros() - start, num_jobs);
+
+    // Batches submitted from the main thread, which helps running them while it waits.
+    JobCounter counter;
+    initJobCounter(&counter);
+
+    start = getAbsoluteTimeMicros();
+
+    for (int i = 0; i < num_jobs; i += BENCH_BATCH_SIZE)
+    {
+        submitJobs(js, jobs, BENCH_BATCH_SIZE, &counter);
+        waitForJobs(js, &counter);
+    }
+    reportBenchmark("submit batch + wait", getAbsoluteTimeMicros() - start, num_jobs);
+
+    // A single job at a time: the full round trip to a worker and back.
+    int num_single = num_jobs / 16;
+
+    start = getAbsoluteTimeMicros();
+
+    for (int i = 0; i < num_single; ++i)
+    {
+        submitJobs(js, jobs, 1, &counter);
+        waitForJobs(js, &counter);
+    }
+    reportBenchmark("submit one + wait", getAbsoluteTimeMicros() - start, num_single);
+
+    // Batches submitted by a job, from a worker's deque (or the main thread's, if it gets there first).
+    Job spawner;
+    SpawnJobData spawn = { js, jobs, BENCH_BATCH_SIZE, &counter };
+
+    spawner.function = spawnJob;
+    spawner.data = &spawn;
+
+    start = getAbsoluteTimeMicros();
+
+    for (int i = 0; i < num_jobs; i += BENCH_BATCH_SIZE)
+    {
+        submitJobs(js, &spawner, 1, &counter);
+        waitForJobs(js, &counter);
+    }
+    reportBenchmark("nested submit (stolen)", getAbsoluteTimeMicros() - start, num_jobs);
+
+    // Each batch queued only once the previous one is done.
+    JobCounter batches[2];
+    initJobCounter(&batches[0]);
+    initJobCounter(&batches[1]);
+
+    Job* chained = (Job *)malloc(BENCH_BATCH_SIZE * sizeof(Job));
+
+    for (int i = 0; i < BENCH_BATCH_SIZE; ++i)
+        chained[i] = jobs[i];
+
+    start = getAbsoluteTimeMicros();
+
+    for (int i = 0; i < num_jobs; i += 2 * BENCH_BATCH_SIZE)
+    {
+        submitJobs(js, jobs, BENCH_BATCH_SIZE, &batches[0]);
+        submitJobsAfter(js, chained, BENCH_BATCH_SIZE, &batches[1], &batches[0]);
+        waitForJobs(js, &batches[1]);
+    }
+    reportBenchmark("dependent batches", getAbsoluteTimeMicros() - start, num_jobs);
+
+    // Ranges of one item each, as split by `parallelFor` (up to `JOB_PARALLEL_FOR_MAX_JOBS` per call).
+    start = getAbsoluteTimeMicros();
+
+    for (int i = 0; i < num_jobs; i += JOB_PARALLEL_FOR_MAX_JOBS)
+        parallelFor(js, 0, JOB_PARALLEL_FOR_MAX_JOBS, 1, emptyRange, NULL);
+
+    reportBenchmark("parallelFor, 1 item per job", getAbsoluteTimeMicros() - start, num_jobs);
+
+    // Background jobs, which only the workers run.
+    if (js->numWorkers > 0)
+    {
+        start = getAbsoluteTimeMicros();
+
+        for (int i = 0; i < num_jobs; i += BENCH_BATCH_SIZE)
+        {
+            for (int k = 0; k < BENCH_BATCH_SIZE; ++k)
+                submitBackgroundJob(js, &jobs[k], &counter);
+
+            waitForJobs(js, &counter);
+        }
+        reportBenchmark("background queue", getAbsoluteTimeMicros() - start, num_jobs);
+    }
+
+    free(chained);
+    free(jobs);
+
+    deleteJobSystem(js);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#   define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <threads.h>
+#include <stdatomic.h>
+
+#include "Timer.h"
+#include "Telemetry.h"
+
+
+// Throughput test of the telemetry segment (see `Telemetry.h`): a writer thread publishes frames at
+// a given rate, as the simulation would, while the main thread takes snapshots of them as fast as it
+// can through a second, read-only mapping, and checks that every one of them is consistent (every
+// position of a frame is its frame number).
+//
+// Usage: bench_telemetry [bodies] [seconds] [frames_per_second]
+//
+// Without arguments, 10k bodies for 2 seconds at 1000 frames per second; 0 frames per second
+// publishes back to back.
+
+#define BENCH_TELEMETRY_SEGMENT "solar_system_bench_telemetry"
+
+typedef struct BenchWriter
+{
+    Telemetry* telemetry;
+
+    uint32_t numBodies;
+
+    double framesPerSecond;
+
+    atomic_bool done;
+
+    unsigned long long numFrames;
+
+    // Time spent publishing, in microseconds.
+    uint64_t writeMicros;
+
+} BenchWriter;
+
+int benchWriterThread(void* data)
+{
+    BenchWriter* w = (BenchWriter *)data;
+
+    Telemetry* t = w->telemetry;
+
+    uint64_t start = getAbsoluteTimeMicros();
+
+    while (!atomic_load_explicit(&w->done, memory_order_relaxed))
+    {
+        uint64_t begin = getAbsoluteTimeMicros();
+
+        beginTelemetryWrite(t);
+
+        double frame = (double)(t->header->frame + 1);
+
+        for (uint32_t i = 0; i < w->numBodies; ++i)
+        {
+            t->bodies[i].position[0] = frame;
+            t->bodies[i].position[1] = frame;
+            t->bodies[i].position[2] = frame;
+        }
+
+        t->header->numBodies = w->numBodies;
+        t->header->totalBodies = w->numBodies;
+        t->header->frame += 1;
+
+        endTelemetryWrite(t);
+
+        w->numFrames += 1;
+
+        uint64_t end = getAbsoluteTimeMicros();
+
+        w->writeMicros += end - begin;
+
+        if (w->framesPerSecond > 0.0)
+        {
+            uint64_t next = start + (uint64_t)((double)w->numFrames * 1e6 / w->framesPerSecond);
+
+            if (next > end)
+            {
+                struct timespec duration = { (time_t)((next - end) / 1000000), (long)((next - end) % 1000000) * 1000 };
+                thrd_sleep(&duration, NULL);
+            }
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t num_bodies = (argc > 1 ? (uint32_t)atoi(argv[1]) : 10000);
+    double seconds = (argc > 2 ? atof(argv[2]) : 2.0);
+    double frames_per_second = (argc > 3 ? atof(argv[3]) : 1000.0);
+
+    BenchWriter w;
+
+    w.numBodies = num_bodies;
+    w.framesPerSecond = frames_per_second;
+    w.numFrames = 0;
+    w.writeMicros = 0;
+    atomic_init(&w.done, false);
+
+    w.telemetry = openTelemetry(BENCH_TELEMETRY_SEGMENT, true, num_bodies);
+
+    if (w.telemetry == NULL)
+        return EXIT_FAILURE;
+
+    for (uint32_t i = 0; i < num_bodies; ++i)
+        setTelemetryBody(w.telemetry, i, "body", 1.0);
+
+    Telemetry* r = openTelemetry(BENCH_TELEMETRY_SEGMENT, false, 0);
+
+    if (r == NULL || !checkTelemetryLayout(r))
+    {
+        closeTelemetry(r);
+        closeTelemetry(w.telemetry);
+        return EXIT_FAILURE;
+    }
+
+    TelemetryBody* bodies = (TelemetryBody *)malloc(((size_t)num_bodies + 1) * sizeof(TelemetryBody));
+
+    TelemetryHeader header;
+
+    thrd_t writer;
+
+    if (thrd_create(&writer, benchWriterThread, &w) != thrd_success)
+    {
+        fprintf(stderr, "Error: Could not start the writer thread.\n");
+        free(bodies);
+        closeTelemetry(r);
+        closeTelemetry(w.telemetry);
+        return EXIT_FAILURE;
+    }
+
+    unsigned long long num_snapshots = 0, num_attempts = 0, num_failures = 0, num_torn = 0;
+    unsigned long long num_bytes = 0;
+
+    uint64_t start = getAbsoluteTimeMicros();
+
+    while (getAbsoluteTimeMicros() - start < (uint64_t)(seconds * 1e6))
+    {
+        int attempts;
+
+        // A writer preempted mid-write holds readers off until it runs again.
+        if (!readTelemetrySnapshot(r, &header, bodies, num_bodies, 1000, &attempts))
+        {
+            num_failures += 1;
+            thrd_yield();
+            continue;
+        }
+
+        num_snapshots += 1;
+        num_attempts += (unsigned long long)attempts;
+        num_bytes += sizeof(TelemetryHeader) + (unsigned long long)header.numBodies * sizeof(TelemetryBody);
+
+        // A consistent snapshot is a single frame's.
+        for (uint32_t i = 0; i < header.numBodies; ++i)
+        {
+            if (
+                bodies[i].position[0] != (double)header.frame ||
+                bodies[i].position[1] != (double)header.frame ||
+                bodies[i].position[2] != (double)header.frame
+            )
+            {
+                num_torn += 1;
+                break;
+            }
+        }
+    }
+
+    double elapsed = (double)(getAbsoluteTimeMicros() - start) / 1e6;
+
+    atomic_store(&w.done, true);
+    thrd_join(writer, NULL);
+
+    printf(
+        "%u bodies (%.2lf MiB per snapshot), %.1lf s:\n"
+        "    writer: %12.0lf frames/s, %.1lf us per frame\n"
+        "    reader: %12.0lf snapshots/s, %.0lf MiB/s, %.2lf reads per snapshot, %llu given up\n"
+        "    torn snapshots: %llu\n",
+        num_bodies, (double)(sizeof(TelemetryHeader) + (size_t)num_bodies * sizeof(TelemetryBody)) / (1 << 20), elapsed,
+        (double)w.numFrames / elapsed, (w.numFrames > 0 ? (double)w.writeMicros / (double)w.numFrames : 0.0),
+        (double)num_snapshots / elapsed, (double)num_bytes / (1 << 20) / elapsed,
+        (num_snapshots > 0 ? (double)num_attempts / (double)num_snapshots : 0.0), num_failures,
+        num_torn
+    );
+
+    free(bodies);
+    closeTelemetry(r);
+    closeTelemetry(w.telemetry);
+
+    return (num_torn == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
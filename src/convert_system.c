@@ -0,0 +1,43 @@
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif 
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "CustomTypes.h"
+#include "SystemBinary.h"
+#include "StellarCatalog.h"
+
+
+// Compiles a system's `data.json` into the binary format of `SystemBinary.h`.
+//
+// Usage: convert_system <system_dir> [output_file]
+//
+// The output defaults to `<system_dir>/data.bin`, which the simulation loads in place of the
+// JSON file for as long as the latter is left unmodified.
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s <system_dir> [output_file]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    char* json_filename = strCat(2, argv[1], "/data.json");
+    char* binary_filename = (argc == 3 ? strBuild(argv[2]) : strCat(2, argv[1], "/data.bin"));
+
+    StellarCatalog* catalog = parseStellarCatalog(json_filename, NULL, NULL);
+
+    bool ok = (catalog != NULL && writeSystemBinary(catalog, binary_filename, json_filename));
+
+    if (ok)
+        printf("Converted %d astronomical objects from \"%s\" to \"%s\".\n", catalog->count, json_filename, binary_filename);
+
+    deleteStellarCatalog(catalog);
+
+    free(binary_filename);
+    free(json_filename);
+
+    return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,118 @@
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#if defined(_MSC_VER) && !defined(_USE_MATH_DEFINES)
+#   define _USE_MATH_DEFINES
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "Timer.h"
+#include "Ephemeris.h"
+#include "JobSystem.h"
+#include "CustomTypes.h"
+
+
+// Exports the positions of a system's bodies over a range of simulated time, without running the
+// simulation (see `Ephemeris.h`).
+//
+// Usage: export_ephemeris <system_dir> <start> <end> <step> [output_file] [-csv]
+//
+// Times are in days since the start of the simulation; every step from `start` up to `end` (included)
+// is exported. The output defaults to `<system_dir>/ephemeris.bin`, or `ephemeris.csv` with `-csv`.
+// The system directory must end with a path separator, as it does for the simulation.
+
+bool parseEphemerisTime(const char* text, const char* what, double* value)
+{
+    char* end;
+
+    *value = strtod(text, &end);
+
+    if (end == text || *end != '\0' || !isfinite(*value))
+    {
+        fprintf(stderr, "Error: Invalid %s \"%s\"; Expected a number of days.\n", what, text);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* arguments[5];
+    int num_arguments = 0;
+
+    EphemerisFormat format = EPHEMERIS_FORMAT_BINARY;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-csv") == 0)
+            format = EPHEMERIS_FORMAT_CSV;
+        else if (num_arguments < 5)
+            arguments[num_arguments++] = argv[i];
+        else
+            num_arguments = 6;
+    }
+
+    if (num_arguments < 4 || num_arguments > 5)
+    {
+        fprintf(stderr, "Usage: %s <system_dir> <start> <end> <step> [output_file] [-csv]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double start, end, step;
+
+    if (
+        !parseEphemerisTime(arguments[1], "start", &start) ||
+        !parseEphemerisTime(arguments[2], "end", &end) ||
+        !parseEphemerisTime(arguments[3], "step", &step)
+    )
+        return EXIT_FAILURE;
+
+    if (step <= 0.0 || end < start)
+    {
+        fprintf(stderr, "Error: The step should be positive and the end no earlier than the start.\n");
+        return EXIT_FAILURE;
+    }
+
+    // A little slack, so that an end that is a whole number of steps away is not lost to rounding.
+    uint64_t num_steps = (uint64_t)floor((end - start) / step + 1e-9) + 1;
+
+    Ephemeris* e = loadEphemeris(arguments[0]);
+
+    if (e == NULL)
+        return EXIT_FAILURE;
+
+    char* filename = (
+        num_arguments == 5 ? strBuild(arguments[4]) :
+        strCat(2, arguments[0], (format == EPHEMERIS_FORMAT_CSV ? "ephemeris.csv" : "ephemeris.bin"))
+    );
+
+    JobSystem* js = initJobSystem(-1);
+
+    uint64_t begin = getAbsoluteTimeMicros();
+    uint64_t bytes;
+
+    bool ok = exportEphemeris(js, e, start, step, num_steps, filename, format, &bytes);
+
+    double seconds = (double)(getAbsoluteTimeMicros() - begin) / 1e6;
+
+    if (ok)
+    {
+        printf(
+            "Exported %d bodies x %llu steps to \"%s\": %.1lf MiB in %.2lf s (%.1lf MiB/s, %d threads).\n",
+            e->numBodies, (unsigned long long)num_steps, filename,
+            (double)bytes / (1 << 20), seconds, (double)bytes / (1 << 20) / (seconds > 0.0 ? seconds : 1e-6),
+            getJobThreadCount(js)
+        );
+    }
+
+    deleteJobSystem(js);
+    deleteEphemeris(e);
+    free(filename);
+
+    return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,216 @@
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#if defined(_MSC_VER) && !defined(_USE_MATH_DEFINES)
+#   define _USE_MATH_DEFINES
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "Timer.h"
+#include "Ephemeris.h"
+#include "JobSystem.h"
+#include "EventSearch.h"
+#include "CustomTypes.h"
+
+
+// Searches a system for close approaches, conjunctions, oppositions, occultations and eclipses over a
+// range of simulated time, without running the simulation (see `EventSearch.h`), and writes them as
+// JSON.
+//
+// Usage: find_events <system_dir> <start> <end> [-approach <distance>] [-observer <name> [-angle <degrees>]]
+//                    [-bodies <name>,<name>,...] [-o <output_file>]
+//
+// Times are in days since the start of the simulation, distances in AU. At least one of `-approach`
+// (close approaches within the distance) and `-observer` (alignments seen from the body, within the
+// angle, 1 degree by default) is required; `-bodies` restricts the search to the bodies listed. The
+// events go to the standard output unless an output file is given. The system directory must end
+// with a path separator, as it does for the simulation.
+
+bool parseEventNumber(const char* text, const char* what, double* value)
+{
+    char* end;
+
+    *value = strtod(text, &end);
+
+    if (end == text || *end != '\0' || !isfinite(*value))
+    {
+        fprintf(stderr, "Error: Invalid %s \"%s\"; Expected a number.\n", what, text);
+        return false;
+    }
+    return true;
+}
+
+int findEphemerisBody(const Ephemeris* e, const char* name)
+{
+    for (int i = 0; i < e->numBodies; ++i)
+    {
+        if (strcmp(getEphemerisName(e, i), name) == 0)
+            return i;
+    }
+
+    fprintf(stderr, "Error: No body named \"%s\" in the system.\n", name);
+    return -1;
+}
+
+// Marks the bodies of a comma-separated list.
+bool parseEventBodies(const Ephemeris* e, const char* list, bool* selected)
+{
+    char* names = strBuild(list);
+
+    bool ok = true;
+
+    for (char* name = strtok(names, ","); name != NULL && ok; name = strtok(NULL, ","))
+    {
+        int i = findEphemerisBody(e, name);
+
+        if (i >= 0)
+            selected[i] = true;
+        else
+            ok = false;
+    }
+
+    free(names);
+
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const char* arguments[3];
+    int num_arguments = 0;
+
+    const char* approach = NULL;
+    const char* observer = NULL;
+    const char* angle = NULL;
+    const char* bodies = NULL;
+    const char* output = NULL;
+
+    bool valid = true;
+
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        const char** option = (
+            strcmp(argv[i], "-approach") == 0 ? &approach :
+            strcmp(argv[i], "-observer") == 0 ? &observer :
+            strcmp(argv[i], "-angle") == 0 ? &angle :
+            strcmp(argv[i], "-bodies") == 0 ? &bodies :
+            strcmp(argv[i], "-o") == 0 ? &output :
+            NULL
+        );
+
+        if (option != NULL)
+        {
+            valid = (i + 1 < argc);
+
+            if (valid)
+                *option = argv[++i];
+        }
+        else if (num_arguments < 3)
+            arguments[num_arguments++] = argv[i];
+        else
+            valid = false;
+    }
+
+    if (!valid || num_arguments != 3 || (approach == NULL && observer == NULL))
+    {
+        fprintf(
+            stderr,
+            "Usage: %s <system_dir> <start> <end> [-approach <distance>] [-observer <name> [-angle <degrees>]] "
+            "[-bodies <name>,<name>,...] [-o <output_file>]\n",
+            argv[0]
+        );
+        return EXIT_FAILURE;
+    }
+
+    EventQuery query;
+
+    query.approachDistance = 0.0;
+    query.observer = -1;
+    query.alignmentAngle = 1.0;
+    query.selected = NULL;
+
+    if (
+        !parseEventNumber(arguments[1], "start", &query.startTime) ||
+        !parseEventNumber(arguments[2], "end", &query.endTime) ||
+        (approach != NULL && !parseEventNumber(approach, "distance", &query.approachDistance)) ||
+        (angle != NULL && !parseEventNumber(angle, "angle", &query.alignmentAngle))
+    )
+        return EXIT_FAILURE;
+
+    if (query.endTime < query.startTime || query.approachDistance < 0.0 || query.alignmentAngle <= 0.0 || query.alignmentAngle > 90.0)
+    {
+        fprintf(stderr, "Error: The end should be no earlier than the start, the distance non-negative and the angle within (0, 90] degrees.\n");
+        return EXIT_FAILURE;
+    }
+
+    Ephemeris* e = loadEphemeris(arguments[0]);
+
+    if (e == NULL)
+        return EXIT_FAILURE;
+
+    bool* selected = NULL;
+    bool ok = true;
+
+    if (observer != NULL)
+    {
+        query.observer = findEphemerisBody(e, observer);
+        ok = (query.observer >= 0);
+    }
+
+    if (ok && bodies != NULL)
+    {
+        selected = (bool *)calloc((size_t)e->numBodies + 1, sizeof(bool));
+        query.selected = selected;
+        ok = parseEventBodies(e, bodies, selected);
+    }
+
+    FILE* fp = stdout;
+
+    if (ok && output != NULL)
+    {
+        fp = fopen(output, "w");
+
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Error: Could not create \"%s\".\n", output);
+            ok = false;
+        }
+    }
+
+    if (ok)
+    {
+        JobSystem* js = initJobSystem(-1);
+
+        uint64_t begin = getAbsoluteTimeMicros();
+
+        EventList* events = searchEvents(js, e, &query);
+
+        double seconds = (double)(getAbsoluteTimeMicros() - begin) / 1e6;
+
+        writeEventsJson(fp, e, &query, events, arguments[0]);
+
+        fprintf(
+            stderr, "Found %d events over %.1lf days in %.2lf s (%d threads).\n",
+            events->count, query.endTime - query.startTime, seconds, getJobThreadCount(js)
+        );
+
+        deleteEvents(events);
+        deleteJobSystem(js);
+
+        if (fp != stdout && fclose(fp) != 0)
+        {
+            fprintf(stderr, "Error: Could not write \"%s\".\n", output);
+            ok = false;
+        }
+    }
+
+    free(selected);
+    deleteEphemeris(e);
+
+    return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
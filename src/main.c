@@ -18,12 +18,23 @@
 
 #include "Timer.h"
 #include "Camera.h"
+#include "Profiler.h"
+#include "Benchmark.h"
+#include "JobSystem.h"
 #include "MenuScreen.h"
+#include "MappedFile.h"
+#include "MemoryTracker.h"
 #include "CustomTypes.h"
 #include "AmbientStars.h"
 #include "TextRendering.h"
+#include "Universe.h"
+#include "Telemetry.h"
 #include "MouseCallback.h"
+#include "InputRecorder.h"
+#include "StellarBVH.h"
+#include "OrbitTrails.h"
 #include "StellarObject.h"
+#include "SystemReloader.h"
 #include "KeyboardCallback.h"
 #include "MouseWheelCallback.h"
 #include "MotionCallback.h"
@@ -37,6 +48,9 @@ bool fullscreen_enabled;
 
 double framerate;
 
+// Bytes of texture data uploaded per frame at most, while textures are streamed in.
+size_t texture_upload_budget;
+
 real_t simulation_speed;
 
 uint64_t refresh_ts;
@@ -45,10 +59,25 @@ StellarObject** stellarObjects;
 
 int num_stellar_objects;
 
+// The bodies grouped for parallel updates, and indexed for picking and culling; rebuilt along
+// with `stellarObjects`.
+StellarUpdateOrder* update_order;
+StellarBVH* body_bvh;
+
+// The paths the bodies travelled (see `OrbitTrails.h`), kept along with `stellarObjects`.
+OrbitTrails* orbit_trails;
+
 unsigned int trajectory_list_id; 
 
-StellarObject*** cachedAncestors;
-int* num_cached_ancestors;
+// The astronomical system's directory (argv[2]), or that of the universe's first system.
+const char* system_data_dir;
+
+// Non-null when argv[2] is a universe file, in which case `stellarObjects` are the bodies of the
+// systems it has loaded (see `Universe.h`).
+Universe* universe;
+
+// Non-null when `data.json` is hot reloaded (i.e. outside of benchmarks, recordings and replays).
+SystemReloader* system_reloader;
 
 Camera* camera;
 
@@ -56,7 +85,14 @@ AmbientStars* starsSkyBox;
 
 bool enable_sky_texture;
 
+// Star catalog to draw the sky with (see `StarCatalog.h`), NULL if none is configured.
+char* star_catalog_filename;
+
+// Seed, density and resolution of the baked star field (see `StarField.h`).
+StarFieldSettings star_field_settings;
+
 bool enable_hud;
+bool enable_trails;
 bool enable_planet_menu;
 bool enable_main_menu;
 
@@ -66,10 +102,26 @@ MenuScreen* planetMenuScreen;
 uint64_t simulation_elapsed_millis;
 uint64_t real_elapsed_millis;
 
+// Non-null when running in benchmark mode (`-benchmark <CAMERA-PATH>`).
+Benchmark* benchmark;
+
+// Non-null when the live state is published to other processes (`-telemetry <NAME>`, see
+// `Telemetry.h`); the bodies' names and radii are only rewritten once they may have changed.
+Telemetry* telemetry;
+const char* telemetry_name;
+bool telemetry_bodies_changed;
+
+// Bodies listed by the HUD, nearest to the camera first.
+#define HUD_NEAREST_BODIES 3
+
 
 void initGlobals(int, char**);
 void deallocateAll(void);
 void display(void);
+MenuScreen* buildPlanetMenuScreen(void);
+void applySystemReload(StellarCatalog*, const StellarReloadPlan*, const char*);
+void applyUniversePaging(void);
+void publishTelemetry(double);
 
 int main(int argc, char* argv[])
 {
@@ -79,7 +131,7 @@ int main(int argc, char* argv[])
         fprintf(stderr, "Please specify the JSON file of the dynamically loaded constants.\n");
         return EXIT_FAILURE;
     }
-    // argv[2] should be the filepath of the astronomical system's data. 
+    // argv[2] should be the filepath of the astronomical system's data, or a universe file. 
     if (argc < 3)
     {
         fprintf(stderr, "Please specify the JSON file of the astronomical system's objects' data.\n");
@@ -121,13 +173,32 @@ int main(int argc, char* argv[])
     callbackPassiveMotion(window_centre_X, window_centre_Y);
 
     glutDisplayFunc(display);
-    glutKeyboardFunc(callbackKeyboardDown);
-    glutKeyboardUpFunc(callbackKeyboardUp);
-    glutSpecialFunc(callbackSpecialKeyboard);
-    glutMouseFunc(callbackMouse);
-    glutMotionFunc(callbackPassiveMotion);
-    glutMouseWheelFunc(callbackMouseWheel);
-    glutPassiveMotionFunc(callbackPassiveMotion);
+
+    if (benchmark != NULL)
+    {
+        // Benchmarks run unattended; live input is ignored.
+    }
+    else if (input_recorder == NULL)
+    {
+        glutKeyboardFunc(callbackKeyboardDown);
+        glutKeyboardUpFunc(callbackKeyboardUp);
+        glutSpecialFunc(callbackSpecialKeyboard);
+        glutMouseFunc(callbackMouse);
+        glutMotionFunc(callbackPassiveMotion);
+        glutMouseWheelFunc(callbackMouseWheel);
+        glutPassiveMotionFunc(callbackPassiveMotion);
+    }
+    else if (input_recorder->mode == INPUT_RECORDER_RECORD)
+    {
+        glutKeyboardFunc(callbackRecordKeyboardDown);
+        glutKeyboardUpFunc(callbackRecordKeyboardUp);
+        glutSpecialFunc(callbackRecordSpecialKeyboard);
+        glutMouseFunc(callbackRecordMouse);
+        glutMotionFunc(callbackRecordPassiveMotion);
+        glutMouseWheelFunc(callbackRecordMouseWheel);
+        glutPassiveMotionFunc(callbackRecordPassiveMotion);
+    }
+    // On replay mode, live input is ignored altogether; it is fed from the recording instead.
 
 
     {
@@ -139,6 +210,14 @@ int main(int argc, char* argv[])
 
     printf("[2] >>> Exited Main Loop.\n");
 
+    if (input_recorder != NULL)
+        printInputReplayStatistics(input_recorder);
+
+    if (benchmark != NULL)
+        writeBenchmarkReport(benchmark, system_data_dir);
+
+    printMemoryReport();
+
     deallocateAll();
 
     printf("[3] >>> Deallocated all memory.\n");
@@ -151,31 +230,77 @@ int main(int argc, char* argv[])
 
 void display(void)
 {
-    keyToggle('H', &enable_hud, 250);
-    keyToggle('P', &enable_planet_menu, 250);
-    keyToggle(27,  &enable_main_menu, 250);
+    bool replaying = (input_recorder != NULL && input_recorder->mode == INPUT_RECORDER_REPLAY);
 
     double elapsed_seconds = (double)(getAbsoluteTimeMillis() - refresh_ts) / 1000.0;
 
-    // Force framerate cap using time scheduling variables. 
-    if (elapsed_seconds < 1.0 / framerate) 
+    // Force framerate cap using time scheduling variables (replays and benchmarks run uncapped). 
+    if (elapsed_seconds < 1.0 / framerate && !replaying && benchmark == NULL) 
     {
         glutPostRedisplay();
         return;
     }
     refresh_ts = getAbsoluteTimeMillis();
 
+    if (input_recorder != NULL && !beginInputFrame(input_recorder))
+    {
+        // The replay has run out of recorded frames.
+        glutDestroyWindow(window_id);
+        glutLeaveMainLoop();
+        return;
+    }
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (benchmark != NULL && !beginBenchmarkFrame(benchmark, &simulation_speed))
+    {
+        // The camera path is over; the report is written after exiting the main loop.
+        glutDestroyWindow(window_id);
+        glutLeaveMainLoop();
+        return;
+    }
 
+    beginProfilerFrame();
 
-    camera->movementSpeed *= move_speed_scale_factor;
-    updateCamera(camera);
-    move_speed_scale_factor = 1.0f;
+    // Toggles are polled once per rendered frame, so that recorded input replays identically.
+    keyToggle('H', &enable_hud, 250);
+    keyToggle('P', &enable_planet_menu, 250);
+    keyToggle('T', &enable_trails, 250);
 
+    // While the planets' menu takes typing, which 'P' is part of, ESC closes it (forgetting the
+    // search) instead of opening the main menu.
+    if (enable_planet_menu && !enable_main_menu)
+    {
+        bool close_planet_menu = false;
+
+        keyToggle(27, &close_planet_menu, 250);
+
+        if (close_planet_menu)
+        {
+            enable_planet_menu = false;
+            clearMenuScreenSearch(planetMenuScreen);
+        }
+    }
+    else
+    {
+        keyToggle(27, &enable_main_menu, 250);
+    }
+
+    // Typing goes to the planets' menu's search while it is open.
+    keyboard_text_input = (enable_planet_menu && !enable_main_menu);
+
+    if (!keyboard_text_input)
+        num_typed_characters = 0;
+
+    // Recording, replaying and benchmarking advance the simulation by a fixed timestep instead of the elapsed time.
+    double simulation_seconds = elapsed_seconds;
+
+    if (input_recorder != NULL)
+        simulation_seconds = input_recorder->header.timestep;
+    else if (benchmark != NULL)
+        simulation_seconds = (double)benchmark->path->timestep;
+
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
 
     if (keystrokes['+']) {
         simulation_speed *= (real_t)1.05;
@@ -184,18 +309,122 @@ void display(void)
         simulation_speed /= (real_t)1.05;
     }
 
+    beginProfilerStage();
+
+    // Upload (part of) the textures decoded so far, within the frame's budget.
+    streamTextureUploads(texture_loader, texture_upload_budget);
+
+    endProfilerStage(PROFILER_STAGE_TEXTURES);
+    beginProfilerStage();
+
+    // Systems are paged in and out before the bodies are updated, so that those just loaded are
+    // placed right away.
+    if (universe != NULL)
+    {
+        vector3r origin_shift;
+
+        if (updateUniverse(universe, camera, origin_shift))
+            applyUniversePaging();
+
+        // The trails are in world coordinates, which change along with the origin.
+        shiftOrbitTrails(orbit_trails, origin_shift);
+    }
+
+    if (system_reloader != NULL)
+    {
+        StellarReloadPlan* plan;
+        StellarCatalog* catalog = pollSystemReloader(system_reloader, stellarObjects, num_stellar_objects, &plan);
+
+        if (catalog != NULL)
+        {
+            applySystemReload(catalog, plan, system_data_dir);
+            deleteStellarReloadPlan(plan);
+            deleteStellarCatalog(catalog);
+        }
+    }
+
+    // Update celestial bodies' positions after moving 
+    // by v * dt, where v is their linear velocity. Bodies too small or too far away for their motion
+    // to show are updated less often, as seen from where the camera was on the last frame.
+    StellarUpdateView update_view;
+
+    memcpy(update_view.viewpoint, camera->position, sizeof(vector3r));
+    update_view.anchor = camera->anchor;
+    update_view.pixelsPerRadian = (real_t)((double)window_height / (2.0 * tan(CAMERA_FIELD_OF_VIEW * (M_PI / 360.0))));
+
+    updateStellarObjects(job_system, update_order, &update_view, simulation_speed, (float)simulation_seconds / 3600.0f);
+
+    refitStellarBVH(job_system, body_bvh);
+
+    recordOrbitTrails(job_system, orbit_trails);
+
+    endProfilerStage(PROFILER_STAGE_SIMULATION);
+    beginProfilerStage();
+
+    // The camera is updated once per frame, after the bodies, so that 
+    // an anchored camera follows its anchor's up-to-date position.
+    if (benchmark != NULL)
+    {
+        evaluateCameraPath(benchmark->path, benchmark->pathTime, camera);
+        updateCameraMatrices(camera);
+    }
+    else
+    {
+        camera->movementSpeed *= move_speed_scale_factor;
+        updateCamera(camera);
+        move_speed_scale_factor = 1.0f;
+    }
+
+    // A left click outside of the menus anchors the camera to the body under the cursor, if any.
+    if (mouse_click_pending)
+    {
+        mouse_click_pending = false;
+
+        if (!enable_main_menu && !enable_planet_menu)
+        {
+            vector3r direction;
+
+            getCameraRay(camera, (double)mouse_click_x, (double)mouse_click_y, direction);
+
+            // Widening of the bodies per unit of distance that covers the tolerance on screen.
+            real_t slope = (real_t)(MOUSE_PICK_TOLERANCE_PIXELS * 2.0 * tan(CAMERA_FIELD_OF_VIEW * (M_PI / 360.0)) / (double)window_height);
+
+            int picked = pickStellarObject(body_bvh, camera->position, direction, slope, NULL);
+
+            if (picked >= 0)
+                camera->anchor = stellarObjects[picked];
+        }
+    }
+
+    endProfilerStage(PROFILER_STAGE_CAMERA);
+    beginProfilerStage();
+
+
+    // The sky is the background of everything else.
+    renderStars(starsSkyBox);
+
+    if (universe != NULL)
+        renderUniverse(universe, camera);
+
+    endProfilerStage(PROFILER_STAGE_SKYBOX);
+    beginProfilerStage();
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    cullStellarObjectsWithBVH(job_system, body_bvh, camera->viewProjectionMatrix);
+
     for (int i = 0; i < num_stellar_objects; ++i)
     {
-        // Update celestial body's position after moving 
-        // by v * dt, where v is its linear velocity.
-        updateStellarObject(stellarObjects[i], simulation_speed, (float)elapsed_seconds / 3600.0f);
         // Render the body as well as its trajectory.
         renderStellarObject(stellarObjects[i], true, trajectory_list_id);
     }
 
-    camera->movementSpeed *= move_speed_scale_factor;
-    updateCamera(camera);
-    move_speed_scale_factor = 1.0f;
+    if (enable_trails)
+        renderOrbitTrails(job_system, orbit_trails, camera->viewProjectionMatrix);
+
+    endProfilerStage(PROFILER_STAGE_BODIES);
+    beginProfilerStage();
 
     const char* option;
     int option_index;
@@ -248,12 +477,13 @@ void display(void)
         }
     }
 
-    renderStars(starsSkyBox);
+    endProfilerStage(PROFILER_STAGE_MENUS);
+    beginProfilerStage();
 
 
     static char time_format_buffer[1024];
 
-    simulation_elapsed_millis += (uint64_t)(elapsed_seconds * simulation_speed * 1000);
+    simulation_elapsed_millis += (uint64_t)(simulation_seconds * simulation_speed * 1000);
     real_elapsed_millis += (uint64_t)(elapsed_seconds * 1000);
 
     static char hud_buffer[1024];
@@ -279,6 +509,37 @@ void display(void)
         getTimeFormatStringFromMillis(time_format_buffer, sizeof(time_format_buffer), simulation_elapsed_millis);
         snprintf(hud_buffer, sizeof(hud_buffer), "Elapsed Virtual time: %s", time_format_buffer);
         renderStringOnScreen(0.0, window_height - 105.0f, GLUT_BITMAP_9_BY_15, hud_buffer, 0xFF, 0xFF, 0xFF);
+
+        int nearest[HUD_NEAREST_BODIES];
+        real_t nearest_distances[HUD_NEAREST_BODIES];
+
+        int num_nearest = findNearestStellarObjects(body_bvh, camera->position, HUD_NEAREST_BODIES, nearest, nearest_distances);
+
+        int length = snprintf(hud_buffer, sizeof(hud_buffer), "Nearest:");
+
+        for (int i = 0; i < num_nearest && length >= 0 && (size_t)length < sizeof(hud_buffer); ++i)
+        {
+            length += snprintf(
+                hud_buffer + length, sizeof(hud_buffer) - (size_t)length, " %s (%.4lf AU)%s",
+                stellarObjects[nearest[i]]->name, (double)RtoAU(nearest_distances[i]), (i + 1 < num_nearest ? "," : "")
+            );
+        }
+        renderStringOnScreen(0.0, window_height - 120.0f, GLUT_BITMAP_9_BY_15, hud_buffer, 0xFF, 0xFF, 0xFF);
+
+        formatMemoryUsage(hud_buffer, sizeof(hud_buffer), false);
+        renderStringOnScreen(0.0, window_height - 135.0f, GLUT_BITMAP_9_BY_15, hud_buffer, 0xFF, 0xFF, 0xFF);
+
+        formatMemoryUsage(hud_buffer, sizeof(hud_buffer), true);
+        renderStringOnScreen(0.0, window_height - 150.0f, GLUT_BITMAP_9_BY_15, hud_buffer, 0xFF, 0xFF, 0xFF);
+
+        formatStellarUpdateTiers(update_order, hud_buffer, sizeof(hud_buffer));
+        renderStringOnScreen(0.0, window_height - 165.0f, GLUT_BITMAP_9_BY_15, hud_buffer, 0xFF, 0xFF, 0xFF);
+
+        if (universe != NULL)
+        {
+            formatUniverseStatus(universe, camera, hud_buffer, sizeof(hud_buffer));
+            renderStringOnScreen(0.0, window_height - 180.0f, GLUT_BITMAP_9_BY_15, hud_buffer, 0xFF, 0xFF, 0xFF);
+        }
     }
 
     float pixel_offset_centre;
@@ -297,26 +558,77 @@ void display(void)
         );
     }
 
+    endProfilerStage(PROFILER_STAGE_HUD);
+    beginProfilerStage();
+
+    // Benchmarks wait for the GPU, so that the frame times include the rendering itself.
+    if (benchmark != NULL)
+        glFinish();
+
     glutSwapBuffers();
+
+    endProfilerStage(PROFILER_STAGE_SWAP);
+    endProfilerFrame();
+
+    if (input_recorder != NULL)
+        endInputFrame(input_recorder);
+
+    if (benchmark != NULL)
+        endBenchmarkFrame(benchmark);
+
+    if (telemetry != NULL)
+        publishTelemetry(elapsed_seconds);
+
     glutPostRedisplay();
 }
 
 
 void initGlobals(int argc, char* argv[])
 {
-    srand((unsigned int)time(NULL));
+    // Optional arguments, following the constants' and the astronomical system's paths.
+    const char* record_filename = NULL;
+    const char* replay_filename = NULL;
+    const char* benchmark_filename = NULL;
+    const char* report_filename = "benchmark_report.json";
+
+    telemetry_name = NULL;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-record") == 0 && i + 1 < argc)
+            record_filename = argv[++i];
+
+        else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc)
+            replay_filename = argv[++i];
+
+        else if (strcmp(argv[i], "-benchmark") == 0 && i + 1 < argc)
+            benchmark_filename = argv[++i];
+
+        else if (strcmp(argv[i], "-report") == 0 && i + 1 < argc)
+            report_filename = argv[++i];
+
+        else if (strcmp(argv[i], "-telemetry") == 0 && i + 1 < argc)
+            telemetry_name = argv[++i];
+
+        else
+            fprintf(stderr, "Warning: Unrecognised argument \"%s\"; Ignoring.\n", argv[i]);
+    }
 
     // Default Values
     window_width = 1280;
     window_height = 720;
     framerate = 60.0;
+    texture_upload_budget = (size_t)4 << 20;
 
     simulation_elapsed_millis = 0;
     real_elapsed_millis = 0;
 
     enable_sky_texture = false;
+    star_catalog_filename = NULL;
+    initStarFieldSettings(&star_field_settings);
 
     enable_hud = false;
+    enable_trails = false;
     enable_planet_menu = false;
     enable_main_menu = false;
 
@@ -324,26 +636,19 @@ void initGlobals(int argc, char* argv[])
 
     simulation_speed = 1.0;
 
-    // open the _constants.json file 
-    FILE *fp = fopen(argv[1], "r"); 
+    // map the _constants.json file 
+    MappedFile* constants_file = openMappedFile(argv[1], true);
 
-    if (fp == NULL) 
+    if (constants_file == NULL) 
     { 
         fprintf(stderr, "Error: Unable to open the JSON file.\n"); 
         exit(EXIT_FAILURE);
     }
- 
-    // Read the file contents into a string 
-    const size_t JSON_BUFFER_SIZE = 1024 * 1024;
-
-    char* buffer = (char *)malloc(JSON_BUFFER_SIZE * sizeof(char));
-
-    fread(buffer, 1, JSON_BUFFER_SIZE, fp);
-
-    fclose(fp); 
 
     // parse the JSON data 
-    cJSON *json = cJSON_Parse(buffer); 
+    cJSON *json = cJSON_ParseWithLength(constants_file->data, constants_file->size); 
+
+    closeMappedFile(constants_file);
 
     if (json == NULL) 
     { 
@@ -351,8 +656,6 @@ void initGlobals(int argc, char* argv[])
         if (error_ptr != NULL) { 
             fprintf(stderr, "Error: %s\n", error_ptr); 
         } 
-        cJSON_Delete(json); 
-        free(buffer);
         exit(EXIT_FAILURE); 
     }
 
@@ -383,15 +686,91 @@ void initGlobals(int argc, char* argv[])
     if (cJSON_IsBool(sky_texture))
         enable_sky_texture = (bool)sky_texture->valueint;
 
+    cJSON *star_catalog = cJSON_GetObjectItemCaseSensitive(json, "star_catalog"); 
+    if (cJSON_IsString(star_catalog) && star_catalog->valuestring != NULL)
+        star_catalog_filename = strBuild(star_catalog->valuestring);
+
+    cJSON *star_field = cJSON_GetObjectItemCaseSensitive(json, "star_field");
+    if (cJSON_IsObject(star_field))
+    {
+        cJSON *seed = cJSON_GetObjectItemCaseSensitive(star_field, "seed");
+        cJSON *density = cJSON_GetObjectItemCaseSensitive(star_field, "density");
+        cJSON *resolution = cJSON_GetObjectItemCaseSensitive(star_field, "resolution");
+
+        if (cJSON_IsNumber(seed) && seed->valuedouble >= 0.0)
+            star_field_settings.seed = (uint32_t)seed->valuedouble;
+
+        if (cJSON_IsNumber(density) && density->valuedouble >= 0.0)
+            star_field_settings.density = (float)density->valuedouble;
+
+        if (cJSON_IsNumber(resolution) && resolution->valueint >= STAR_FIELD_MIN_RESOLUTION)
+            star_field_settings.resolution = resolution->valueint;
+    }
+
+    cJSON *upload_budget = cJSON_GetObjectItemCaseSensitive(json, "texture_upload_budget"); 
+    if (cJSON_IsNumber(upload_budget) && upload_budget->valuedouble > 0.0)
+        texture_upload_budget = (size_t)(upload_budget->valuedouble * (1 << 20));
+
+    // Budgets of the memory tags (see `MemoryTracker.h`), in MiB.
+    cJSON *memory_budgets = cJSON_GetObjectItemCaseSensitive(json, "memory_budgets");
+    if (cJSON_IsObject(memory_budgets))
+    {
+        cJSON *budget = NULL;
+
+        cJSON_ArrayForEach(budget, memory_budgets)
+        {
+            MemoryTag tag = findMemoryTag(budget->string);
+
+            if (tag == MEMORY_NUM_TAGS || !cJSON_IsNumber(budget) || budget->valuedouble < 0.0)
+                fprintf(stderr, "Warning: Invalid memory budget \"%s\"; Ignoring.\n", budget->string);
+            else
+                setMemoryBudget(tag, (size_t)(budget->valuedouble * (1 << 20)));
+        }
+    }
+
 
     // delete the JSON object 
     cJSON_Delete(json); 
-    free(buffer);
 
     initModuleMotionCallback(window_width, window_height);
     initModuleKeyboardCallback();
     initModuleMouseWheelCallback();
 
+    unsigned int seed = (unsigned int)time(NULL);
+
+    if (benchmark_filename != NULL && (replay_filename != NULL || record_filename != NULL))
+    {
+        fprintf(stderr, "Error: -benchmark cannot be combined with -record or -replay.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Camera paths refer to the bodies of a single system.
+    if (benchmark_filename != NULL && isUniverseFilename(argv[2]))
+    {
+        fprintf(stderr, "Error: -benchmark cannot be combined with a universe file.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (benchmark_filename != NULL)
+    {
+        // Benchmarks are meant to be comparable between runs.
+        seed = 0;
+    }
+    else if (replay_filename != NULL)
+    {
+        if ((input_recorder = initInputReplayer(replay_filename)) == NULL)
+            exit(EXIT_FAILURE);
+
+        seed = input_recorder->header.seed;
+    }
+    else if (record_filename != NULL)
+    {
+        if ((input_recorder = initInputRecorder(record_filename, seed, 1.0 / framerate)) == NULL)
+            exit(EXIT_FAILURE);
+    }
+
+    srand(seed);
+
     camera = initCamera(
         // Initial camera position .
         16.47074, 32.79276,  5.98598,
@@ -405,23 +784,117 @@ void initGlobals(int argc, char* argv[])
 
     // ----------- Stellar Objects (BEGIN) ----------- //
 
-    stellarObjects = loadAllStellarObjects(&num_stellar_objects, argv[2]);
+    // Simulation, culling and texture decoding all share the job system's workers.
+    job_system = initJobSystem(-1);
+
+    universe = NULL;
 
-    if (stellarObjects == NULL)
+    if (isUniverseFilename(argv[2]) && (universe = loadUniverse(argv[2], job_system)) == NULL)
         exit(EXIT_FAILURE);
 
-    cachedAncestors = (StellarObject ***)malloc(num_stellar_objects * sizeof(StellarObject **));
-    // Number of ancestors for each celestial body. 
-    num_cached_ancestors = (int *)malloc(num_stellar_objects * sizeof(int));
+    system_data_dir = (universe != NULL ? universe->systems[0].dataDir : argv[2]);
 
-    for (int i = 0; i < num_stellar_objects; ++i)
+    // Edits to the catalog are applied live, except when the frames must be reproducible.
+    bool reproducible = (benchmark_filename != NULL || replay_filename != NULL || record_filename != NULL);
+
+    // Baked textures (if the system has been through `bake_textures`) are uploaded as they are;
+    // the rest are decoded by worker threads while the catalog is being parsed.
+    texture_pack = openTexturePack(system_data_dir);
+    texture_loader = initTextureLoader(job_system);
+
+    // A star catalog takes precedence over the sky texture, which is by far the largest texture,
+    // and so is submitted first. Catalog and procedural stars are baked into a cube map, unless the
+    // driver has none.
+    starsSkyBox = NULL;
+
+    if (star_catalog_filename != NULL)
     {
-        cachedAncestors[i] = getStellarObjectAncestors(stellarObjects[i], &num_cached_ancestors[i]);
-        // printf("%s -> cached: %d\n", stellarObjects[i]->name, numCachedAncestors[i]);
+        starsSkyBox = (
+            isCubeMapSupported() ? 
+            buildStarsCubeMap(job_system, &star_field_settings, star_catalog_filename, system_data_dir, camera) : 
+            buildStarsFromCatalog(job_system, star_catalog_filename, camera)
+        );
     }
 
+    if (starsSkyBox == NULL && enable_sky_texture)
+        starsSkyBox = buildStarsFromTexture(system_data_dir, camera);
+
+    if (starsSkyBox == NULL)
+        starsSkyBox = buildStarsCubeMap(job_system, &star_field_settings, NULL, system_data_dir, camera);
+
+    if (starsSkyBox == NULL)
+        starsSkyBox = buildStars(1000, star_field_settings.seed, camera);
+
+    // Bodies, names and texture requests are allocated in bulk and released all at once.
+    stellar_arena = initArena(MEMORY_TAG_BODIES, 0);
+
+    if (universe != NULL)
+    {
+        // The systems around the camera are there from the first frame; later ones are paged in
+        // over the following frames, unless the frames must be reproducible.
+        universe->synchronous = true;
+        updateUniverse(universe, camera, NULL);
+        universe->synchronous = reproducible;
+
+        stellarObjects = universe->bodies;
+        num_stellar_objects = universe->numBodies;
+    }
+    else
+    {
+        stellarObjects = loadAllStellarObjects(&num_stellar_objects, argv[2]);
+
+        if (stellarObjects == NULL)
+            exit(EXIT_FAILURE);
+
+        printArenaStatistics(stellar_arena, "bodies");
+    }
+
+    update_order = initStellarUpdateOrder(stellarObjects, num_stellar_objects);
+
+    body_bvh = initStellarBVH(job_system, stellarObjects, num_stellar_objects);
+
+    printStellarBVHStatistics(body_bvh);
+
+    orbit_trails = initOrbitTrails(stellarObjects, num_stellar_objects, NULL);
+
+    telemetry = NULL;
+    telemetry_bodies_changed = true;
+
+    if (telemetry_name != NULL)
+    {
+        // Room for the bodies of systems that are paged in later as well; should there be more, the
+        // segment is replaced by a larger one (see `publishTelemetry`).
+        uint32_t capacity = (uint32_t)(2 * num_stellar_objects > TELEMETRY_MIN_CAPACITY ? 2 * num_stellar_objects : TELEMETRY_MIN_CAPACITY);
+
+        telemetry = openTelemetry(telemetry_name, true, capacity);
+
+        if (telemetry == NULL)
+            exit(EXIT_FAILURE);
+    }
+
+    // Rendering starts right away, with untextured bodies drawn in their color; textures are
+    // streamed in over the first frames (see `display`). Benchmarks, recordings and replays wait for
+    // them, so that every run renders the same frames.
+    if (reproducible)
+        finishTextureLoads(texture_loader);
+
+    // A universe's systems are not reloaded, as they come and go anyway.
+    system_reloader = (reproducible || universe != NULL ? NULL : initSystemReloader(argv[2]));
+
     trajectory_list_id = generateStellarObjectTrajectoryDisplayList();
 
+    benchmark = NULL;
+
+    if (benchmark_filename != NULL)
+    {
+        CameraPath* path = loadCameraPath(benchmark_filename, stellarObjects, num_stellar_objects);
+
+        if (path == NULL)
+            exit(EXIT_FAILURE);
+
+        benchmark = initBenchmark(path, report_filename);
+    }
+
     // ----------- Stellar Objects (END) ----------- //
     
 
@@ -451,46 +924,181 @@ void initGlobals(int argc, char* argv[])
         window_width, window_height
     );
 
-    planetMenuScreen = setMenuScreenDimensions(
-        initMenuScreenEmpty(
+    planetMenuScreen = buildPlanetMenuScreen();
+}
+
+// Lists the current bodies (heap-allocated).
+MenuScreen* buildPlanetMenuScreen(void)
+{
+    // The bodies' names are listed as they are, not copied.
+    const char** names = (const char **)trackedMalloc(MEMORY_TAG_MENUS, ((size_t)num_stellar_objects + 1) * sizeof(char *));
+
+    for (int i = 0; i < num_stellar_objects; ++i) {
+        names[i] = stellarObjects[i]->name;
+    }
+
+    return setMenuScreenDimensions(
+        initMenuScreenList(
             "CELESTIAL BODIES",
             window_matrix, 
+            names,
             num_stellar_objects
         ),
         window_width, window_height
     );
+}
 
-    for (int i = 0; i < num_stellar_objects; ++i) {
-        assignMenuScreenElement(planetMenuScreen, i, stellarObjects[i]->name);
+// Applies the re-parsed `data.json` to the running simulation, which keeps its time and camera.
+void applySystemReload(StellarCatalog* catalog, const StellarReloadPlan* plan, const char* data_dir)
+{
+    uint64_t start = getAbsoluteTimeMicros();
+
+    StellarReloadStats stats = reloadStellarObjects(
+        &stellarObjects, &num_stellar_objects, catalog, plan, data_dir, &camera->anchor
+    );
+
+    deleteStellarUpdateOrder(update_order);
+    update_order = initStellarUpdateOrder(stellarObjects, num_stellar_objects);
+
+    deleteStellarBVH(body_bvh);
+    body_bvh = initStellarBVH(job_system, stellarObjects, num_stellar_objects);
+
+    // Bodies that are still there keep their trails.
+    orbit_trails = initOrbitTrails(stellarObjects, num_stellar_objects, orbit_trails);
+
+    telemetry_bodies_changed = true;
+
+    // The menu lists the bodies by index, so it only has to follow when they were added, removed or moved.
+    if (stats.reordered)
+    {
+        deleteMenuScreen(planetMenuScreen);
+        planetMenuScreen = buildPlanetMenuScreen();
     }
 
-    if (enable_sky_texture)
-        starsSkyBox = buildStarsFromTexture(argv[2], camera);
-    else
-        starsSkyBox = buildStars(1000, camera);
+    printf(
+        "Reloaded %d bodies in %.2lf ms: %d added, %d removed, %d changed, %d unchanged.\n",
+        num_stellar_objects, (double)(getAbsoluteTimeMicros() - start) / 1000.0,
+        stats.added, stats.removed, stats.changed, stats.unchanged
+    );
 }
 
-// Free all dynamically allocated memory and FreeGLUT's resources.
-void deallocateAll(void)
+// Follows the systems paged in and out of the universe, which keeps its time and camera.
+void applyUniversePaging(void)
 {
-    for (int i = 0; i < num_stellar_objects; ++i)
+    stellarObjects = universe->bodies;
+    num_stellar_objects = universe->numBodies;
+
+    deleteStellarUpdateOrder(update_order);
+    update_order = initStellarUpdateOrder(stellarObjects, num_stellar_objects);
+
+    deleteStellarBVH(body_bvh);
+    body_bvh = initStellarBVH(job_system, stellarObjects, num_stellar_objects);
+
+    // Bodies that are still there keep their trails.
+    orbit_trails = initOrbitTrails(stellarObjects, num_stellar_objects, orbit_trails);
+
+    telemetry_bodies_changed = true;
+
+    deleteMenuScreen(planetMenuScreen);
+    planetMenuScreen = buildPlanetMenuScreen();
+
+    // Systems paged in synchronously come with their textures, for the same reason (see `initGlobals`).
+    if (universe->synchronous)
+        finishTextureLoads(texture_loader);
+}
+
+// Publishes the frame's state to the telemetry segment (see `Telemetry.h`).
+void publishTelemetry(double frame_seconds)
+{
+    if ((uint32_t)num_stellar_objects > telemetry->header->capacity)
+    {
+        uint32_t capacity = 2 * (uint32_t)num_stellar_objects;
+
+        fprintf(
+            stderr, "Warning: %d bodies do not fit the telemetry's %u records; Replacing the segment \"%s\" with one of %u records.\n",
+            num_stellar_objects, (unsigned)telemetry->header->capacity, telemetry_name, (unsigned)capacity
+        );
+
+        telemetry = resizeTelemetry(telemetry, telemetry_name, capacity);
+        telemetry_bodies_changed = true;
+
+        if (telemetry == NULL)
+            return;
+    }
+
+    TelemetryHeader* header = telemetry->header;
+
+    uint32_t count = (num_stellar_objects < (int)header->capacity ? (uint32_t)num_stellar_objects : header->capacity);
+
+    beginTelemetryWrite(telemetry);
+
+    if (telemetry_bodies_changed)
     {
-        deleteStellarObject(stellarObjects[i]);
-        
-        if (cachedAncestors[i] != NULL)
-            free(cachedAncestors[i]);
+        for (uint32_t i = 0; i < count; ++i)
+            setTelemetryBody(telemetry, i, stellarObjects[i]->name, (double)RtoAU(stellarObjects[i]->radius));
+
+        header->bodiesVersion += 1;
+        telemetry_bodies_changed = false;
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        for (int a = 0; a < 3; ++a)
+            telemetry->bodies[i].position[a] = (double)RtoAU(stellarObjects[i]->position[a]);
     }
-    
-    free(stellarObjects);
-    free(cachedAncestors);
-    free(num_cached_ancestors);
+
+    header->numBodies = count;
+    header->totalBodies = (uint32_t)num_stellar_objects;
+    header->frame += 1;
+    header->simulationTime = (double)simulation_elapsed_millis / 1000.0;
+    header->realTime = (double)real_elapsed_millis / 1000.0;
+    header->frameTime = frame_seconds;
+    header->simulationSpeed = (double)simulation_speed;
+
+    endTelemetryWrite(telemetry);
+}
+
+// Free all dynamically allocated memory and FreeGLUT's resources.
+void deallocateAll(void)
+{
+    // Textures still loading are handed over to their bodies and sky before those are deleted.
+    deleteTextureLoader(texture_loader);
+
+    deleteSystemReloader(system_reloader);
+
+    deleteJobSystem(job_system);
+
+    deleteStellarUpdateOrder(update_order);
+
+    deleteStellarBVH(body_bvh);
+
+    deleteOrbitTrails(orbit_trails);
+
+    closeTelemetry(telemetry);
+
+    // A universe owns its bodies, and waits for the systems still being parsed.
+    if (universe != NULL)
+        deleteUniverse(universe);
+    else
+        deleteStellarObjects(stellarObjects, num_stellar_objects);
+
+    deleteArena(stellar_arena);
+
+    deleteStellarObjectQuadrics();
 
     deleteCamera(camera);
 
     deleteStars(starsSkyBox);
+    free(star_catalog_filename);
 
     deleteMenuScreen(mainMenuScreen);
     deleteMenuScreen(planetMenuScreen);
 
+    deleteInputRecorder(input_recorder);
+
+    deleteBenchmark(benchmark);
+
+    closeTexturePack(texture_pack);
+
     glutExit();
 }
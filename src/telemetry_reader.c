@@ -0,0 +1,164 @@
+#if defined(_MSC_VER) && !defined(_CRT_SECURE_NO_WARNINGS)
+#   define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#   define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <threads.h>
+
+#include "Timer.h"
+#include "Telemetry.h"
+#include "CustomTypes.h"
+
+
+// Example reader of the telemetry that the simulation publishes with `-telemetry <NAME>` (see
+// `Telemetry.h`): prints the frame's statistics and the first bodies' positions once per second,
+// along with how many snapshots it could take in that time.
+//
+// Usage: telemetry_reader <name> [seconds] [bodies]
+//
+// Reads for 10 seconds by default, and prints the first 5 bodies.
+
+// Torn copies in a row before a snapshot is given up on, which only a writer stuck in the middle
+// of a write (e.g. one that crashed) would cause.
+#define TELEMETRY_READER_MAX_ATTEMPTS 1000000
+
+// Attempts at opening a segment that the simulation replaced (see `resizeTelemetry`), 10 ms apart,
+// as the new one may not be there yet.
+#define TELEMETRY_READER_MAX_REOPENS 100
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argc > 4)
+    {
+        fprintf(stderr, "Usage: %s <name> [seconds] [bodies]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    double seconds = (argc > 2 ? atof(argv[2]) : 10.0);
+    int num_printed = (argc > 3 ? atoi(argv[3]) : 5);
+
+    Telemetry* t = openTelemetry(argv[1], false, 0);
+
+    if (t == NULL)
+        return EXIT_FAILURE;
+
+    if (!checkTelemetryLayout(t))
+    {
+        fprintf(stderr, "Error: Unknown telemetry layout (version %u); Inspect \"%s\".\n", (unsigned)t->header->version, argv[1]);
+        closeTelemetry(t);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t capacity = t->header->capacity;
+
+    TelemetryBody* bodies = (TelemetryBody *)malloc(((size_t)capacity + 1) * sizeof(TelemetryBody));
+
+    TelemetryHeader header;
+
+    uint64_t start = getAbsoluteTimeMicros();
+    uint64_t last_report = start;
+
+    unsigned long long num_snapshots = 0, num_retries = 0, num_bytes = 0;
+    unsigned long long total_snapshots = 0;
+
+    uint64_t last_frame = 0;
+
+    bool ok = true;
+
+    while (ok && getAbsoluteTimeMicros() - start < (uint64_t)(seconds * 1e6))
+    {
+        int attempts;
+
+        ok = readTelemetrySnapshot(t, &header, bodies, capacity, TELEMETRY_READER_MAX_ATTEMPTS, &attempts);
+
+        if (!ok)
+        {
+            fprintf(stderr, "Error: The telemetry stayed mid-write for %d reads; Inspect \"%s\".\n", attempts, argv[1]);
+            break;
+        }
+
+        // The simulation has moved on to a larger segment.
+        if (header.magic != TELEMETRY_MAGIC)
+        {
+            printf("The segment was replaced; Opening the new one.\n");
+
+            closeTelemetry(t);
+            t = NULL;
+
+            for (int i = 0; i < TELEMETRY_READER_MAX_REOPENS && t == NULL; ++i)
+            {
+                struct timespec duration = { 0, 10000000 };
+                thrd_sleep(&duration, NULL);
+
+                t = openTelemetry(argv[1], false, 0);
+
+                if (t != NULL && !checkTelemetryLayout(t))
+                {
+                    closeTelemetry(t);
+                    t = NULL;
+                }
+            }
+
+            if (t == NULL)
+            {
+                fprintf(stderr, "Error: The replaced telemetry segment did not come back; Inspect \"%s\".\n", argv[1]);
+                ok = false;
+                break;
+            }
+
+            capacity = t->header->capacity;
+            bodies = (TelemetryBody *)realloc(bodies, ((size_t)capacity + 1) * sizeof(TelemetryBody));
+            continue;
+        }
+
+        num_snapshots += 1;
+        num_retries += (unsigned long long)(attempts - 1);
+        num_bytes += sizeof(TelemetryHeader) + (unsigned long long)header.numBodies * sizeof(TelemetryBody);
+
+        uint64_t now = getAbsoluteTimeMicros();
+
+        if (now - last_report >= 1000000)
+        {
+            double elapsed = (double)(now - last_report) / 1e6;
+
+            printf(
+                "Frame %llu (%llu since last): %u/%u bodies, simulated %.1lf s at x%.2lf, frame %.2lf ms; "
+                "%llu snapshots/s (%.1lf MiB/s, %llu retries)\n",
+                (unsigned long long)header.frame, (unsigned long long)(header.frame - last_frame),
+                header.numBodies, header.totalBodies, header.simulationTime, header.simulationSpeed, header.frameTime * 1e3,
+                (unsigned long long)((double)num_snapshots / elapsed), (double)num_bytes / (1 << 20) / elapsed, num_retries
+            );
+
+            for (int i = 0; i < num_printed && (uint32_t)i < header.numBodies; ++i)
+            {
+                printf(
+                    "    %-24s (%12.6lf, %12.6lf, %12.6lf) AU\n",
+                    bodies[i].name, bodies[i].position[0], bodies[i].position[1], bodies[i].position[2]
+                );
+            }
+
+            last_frame = header.frame;
+            total_snapshots += num_snapshots;
+            num_snapshots = num_retries = num_bytes = 0;
+            last_report = now;
+        }
+
+        // Nothing changes between frames; readers that only want each frame once would wait for the
+        // frame number to change instead.
+        thrd_yield();
+    }
+
+    printf("Took %llu snapshots.\n", total_snapshots + num_snapshots);
+
+    free(bodies);
+    closeTelemetry(t);
+
+    return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
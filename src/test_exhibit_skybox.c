@@ -274,7 +274,7 @@ int main(int argc, char* argv[])
     initModuleKeyboardCallback();
 
     {
-        char* bitmap_filepath = strCat(2, argv[2], "sample_universe.bmp");
+        char* bitmap_filepath = strCat(2, argv[2], "sample_universe");
         registerTexture(bitmap_filepath, &texture_id);
         free(bitmap_filepath);
     }